@@ -0,0 +1,710 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "btree.h"
+#include "buffer.h"
+#include "crc32c.h"
+#include "file.h"
+#include "latency_histogram.h"
+#include "log_manager.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+/**
+ * @file bench.cpp
+ * @brief Benchmarks of the buffer manager.
+ *
+ * restart: a child process fills a logged buffer pool with pages, changes random pages in small
+ * transactions and dies without writing a page back. The parent then times opening the log, which
+ * redoes the changes, with and without fuzzy checkpoints.
+ * Run as badgerdb_bench restart [pool MB] [transactions] [checkpoint interval].
+ *
+ * checksum: CRC32C throughput with and without the processor's CRC instructions, then the time a
+ * small pool takes to write back and read in random pages of a larger file with page checksums off
+ * and on. Run as badgerdb_bench checksum [file MB] [page reads].
+ *
+ * pool: the time to create a buffer pool and fill it from a file, then to read random pages that are
+ * all in the pool, for the ways the pool memory can be mapped.
+ * Run as badgerdb_bench pool [pool MB] [page reads].
+ *
+ * index: builds an INTEGER index over a relation whose keys follow a distribution, then times inserts,
+ * point lookups and range scans, for each pool size. Keys come from a generator seeded the same way
+ * on every run and platform, so two builds can be compared on the same work. Prints one JSON object.
+ * Run as badgerdb_bench index [records] [distribution] [pool frames,...] [operations] [seed], where the
+ * distribution is sequential, reverse, uniform, zipfian or all.
+ *
+ * scaling: throughput of random page reads through the pool and of index lookups for each number of
+ * threads, with every thread reading as much. Page reads run in a pool holding the whole file, all
+ * hits, and in one holding a quarter of it, where misses read the file and evict pages. Lookups run on
+ * an index of uniform keys whose pages all fit the pool. Prints one JSON object.
+ * Run as badgerdb_bench scaling [file pages] [threads,...] [operations per thread] [records].
+ */
+
+using namespace badgerdb;
+
+const std::string blobName = "bench.blob";
+const std::string logName = "bench.log";
+
+void removeIfExists(const std::string &name)
+{
+    try
+    {
+        File::remove(name);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
+
+// runs the workload in a child that crashes at the end, then times recovery
+void crashAndRecover(std::uint32_t numPages, int numTransactions, int checkpointInterval)
+{
+    removeIfExists(blobName);
+    removeIfExists(logName);
+    {
+        BlobFile blob = BlobFile::create(blobName);
+        for (std::uint32_t i = 0; i < numPages; i++)
+        {
+            PageId pageNo;
+            blob.allocatePage(pageNo);
+        }
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        BlobFile *blob = new BlobFile(BlobFile::open(blobName));
+        LogManager *log = new LogManager(logName);
+        BufMgr *bufMgr = new BufMgr(numPages, log);
+        srand(17);
+        for (int t = 0; t < numTransactions; t++)
+        {
+            bufMgr->beginTransaction();
+            for (int u = 0; u < 8; u++)
+            {
+                PageId pageNo = 1 + rand() % numPages;
+                Page *page;
+                bufMgr->readPage(blob, pageNo, page);
+                int value = rand();
+                memcpy(reinterpret_cast<char *>(page) + (rand() % (Page::SIZE / sizeof(int))) * sizeof(int), &value, sizeof(int));
+                bufMgr->unPinPage(blob, pageNo, true);
+            }
+            bufMgr->commitTransaction(t % 64 == 63);
+            if (checkpointInterval > 0 && t % checkpointInterval == checkpointInterval - 1)
+            {
+                bufMgr->checkpoint();
+            }
+        }
+        bufMgr->waitForLog(log->nextLSN());
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    LogStats stats;
+    {
+        LogManager log(logName);
+        stats = log.getLogStats();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << (checkpointInterval > 0 ? "checkpoint every " + std::to_string(checkpointInterval) : std::string("no checkpoints"))
+              << ": restart " << ms << " ms, " << stats.recoveredTransactions << " of " << numTransactions
+              << " transactions replayed, " << stats.skippedRecords << " records skipped" << std::endl;
+    removeIfExists(blobName);
+    removeIfExists(logName);
+}
+
+// checksums the same page over and over, returns MB per second
+double checksumThroughput(std::uint32_t (*checksum)(const void *, const std::size_t, const std::uint32_t), int rounds)
+{
+    std::string page(Page::SIZE, '\0');
+    for (std::size_t i = 0; i < page.size(); i++)
+    {
+        page[i] = (char)rand();
+    }
+    std::uint32_t crc = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        crc = checksum(page.data(), page.size(), crc);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // keeps the loop from being optimized away
+    if (crc == 1)
+    {
+        std::cout << "";
+    }
+    return (double)rounds * Page::SIZE / (1024 * 1024) / seconds;
+}
+
+// changes random pages through a pool of 64 frames, so nearly every read misses and evicts a dirty page
+void evictRandomPages(std::uint32_t numPages, int numReads, bool checksums)
+{
+    BlobFile blob = BlobFile::open(blobName);
+    BufMgr bufMgr(64);
+    bufMgr.enablePageChecksums(checksums);
+    srand(17);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numReads; i++)
+    {
+        PageId pageNo = 1 + rand() % numPages;
+        Page *page;
+        bufMgr.readPage(&blob, pageNo, page);
+        reinterpret_cast<int *>(page)[rand() % 1024] = i;
+        bufMgr.unPinPage(&blob, pageNo, true);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "checksums " << (checksums ? "on: " : "off: ") << ms << " ms, "
+              << ms * 1000 / numReads << " us per page read and written back" << std::endl;
+}
+
+void checksumOverhead(std::uint32_t numPages, int numReads)
+{
+    std::cout << "CRC32C software: " << checksumThroughput(crc32cSoftware, 20000) << " MB/s" << std::endl;
+    std::cout << "CRC32C " << (crc32cHardware() ? "instructions" : "software (no CRC instructions)") << ": "
+              << checksumThroughput(crc32c, 200000) << " MB/s" << std::endl;
+
+    removeIfExists(blobName);
+    {
+        BlobFile blob = BlobFile::create(blobName);
+        for (std::uint32_t i = 0; i < numPages; i++)
+        {
+            PageId pageNo;
+            blob.allocatePage(pageNo);
+        }
+    }
+    std::cout << "file of " << numPages << " pages, " << numReads << " page reads through 64 frames" << std::endl;
+    // once without checksums first, to warm the file cache for both measured runs
+    evictRandomPages(numPages, numReads, false);
+    evictRandomPages(numPages, numReads, false);
+    evictRandomPages(numPages, numReads, true);
+    removeIfExists(blobName);
+}
+
+// reads every page of the file into a pool mapped with the given options, then random pages that are all hits
+void poolAccess(std::uint32_t numPages, int numReads, int poolOptions, const std::string &label)
+{
+    BlobFile blob = BlobFile::open(blobName);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BufMgr bufMgr(numPages, NULL, poolOptions);
+    for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+    {
+        Page *page;
+        bufMgr.readPage(&blob, pageNo, page);
+        bufMgr.unPinPage(&blob, pageNo, false);
+    }
+    double fillMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    srand(17);
+    long sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numReads; i++)
+    {
+        PageId pageNo = 1 + rand() % numPages;
+        Page *page;
+        bufMgr.readPage(&blob, pageNo, page);
+        sum += reinterpret_cast<const int *>(page)[rand() % (Page::SIZE / sizeof(int))];
+        bufMgr.unPinPage(&blob, pageNo, false);
+    }
+    double readMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const PoolMemory &memory = bufMgr.getPoolMemory();
+    std::cout << label << ": create and fill " << fillMs << " ms, " << readMs * 1000000 / numReads << " ns per hit"
+              << " (page size " << memory.pageSize() << (memory.transparentHugePages() ? ", transparent huge pages" : "")
+              << ", " << memory.numaNodes() << " nodes)" << (sum == 1 ? " " : "") << std::endl;
+}
+
+void poolMapping(std::uint32_t numPages, int numReads)
+{
+    removeIfExists(blobName);
+    {
+        BlobFile blob = BlobFile::create(blobName);
+        for (std::uint32_t i = 0; i < numPages; i++)
+        {
+            PageId pageNo;
+            blob.allocatePage(pageNo);
+        }
+    }
+    std::cout << "pool of " << numPages << " pages, " << numReads << " random hits" << std::endl;
+    poolAccess(numPages, numReads, POOL_DEFAULT, "4 KB pages");
+    poolAccess(numPages, numReads, POOL_PREFAULT, "prefaulted");
+    poolAccess(numPages, numReads, POOL_HUGE_PAGES, "huge pages");
+    poolAccess(numPages, numReads, POOL_HUGE_PAGES | POOL_PREFAULT, "huge pages, prefaulted");
+    poolAccess(numPages, numReads, POOL_NUMA_INTERLEAVE, "interleaved");
+    removeIfExists(blobName);
+}
+
+const std::string relationName = "bench.rel";
+
+/**
+ * Keys in the order records are inserted or looked up.
+ */
+enum Distribution
+{
+    SEQUENTIAL,
+    REVERSE,
+    UNIFORM,
+    ZIPFIAN
+};
+
+const char *distributionNames[] = {"sequential", "reverse", "uniform", "zipfian"};
+
+/**
+ * Draws keys of a distribution over [0, domain). Sequential keys go on past the domain and reverse keys
+ * below 0, so drawing more keys after a relation is made appends to it. Random numbers come from
+ * splitmix64 rather than the standard library, whose distributions differ between implementations.
+ */
+class KeyGenerator
+{
+    Distribution distribution;
+    int domain;
+    std::uint64_t state;
+    std::uint64_t count;
+
+    // Gray et al., "Quickly generating billion-record synthetic databases", with theta 0.99 as in YCSB
+    double theta;
+    double zetaN;
+    double alpha;
+    double eta;
+
+ public:
+    KeyGenerator(Distribution distributionIn, int domainIn, std::uint64_t seed)
+        : distribution(distributionIn), domain(domainIn), state(seed), count(0), theta(0.99), zetaN(0), alpha(0), eta(0)
+    {
+        if (distribution == ZIPFIAN)
+        {
+            for (int i = 1; i <= domain; i++)
+            {
+                zetaN += 1 / std::pow((double)i, theta);
+            }
+            double zeta2 = 1 + std::pow(0.5, theta);
+            alpha = 1 / (1 - theta);
+            eta = (1 - std::pow(2.0 / domain, 1 - theta)) / (1 - zeta2 / zetaN);
+        }
+    }
+
+    std::uint64_t nextRandom()
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    int next()
+    {
+        switch (distribution)
+        {
+        case SEQUENTIAL:
+            return (int)count++;
+        case REVERSE:
+            return domain - 1 - (int)count++;
+        case UNIFORM:
+            return (int)(nextRandom() % domain);
+        default:
+            break;
+        }
+        double u = (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+        double uz = u * zetaN;
+        std::uint64_t rank;
+        if (uz < 1)
+        {
+            rank = 0;
+        }
+        else if (uz < 1 + std::pow(0.5, theta))
+        {
+            rank = 1;
+        }
+        else
+        {
+            rank = (std::uint64_t)(domain * std::pow(eta * u - eta + 1, alpha));
+        }
+        // hot keys are scattered over the domain instead of all sitting in the first leaf
+        std::uint64_t z = (rank + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 31)) * 0xbf58476d1ce4e5b9ull;
+        return (int)((z ^ (z >> 29)) % domain);
+    }
+};
+
+struct BenchRecord
+{
+    int i;
+    double d;
+    char s[64];
+};
+
+// writes a relation of numRecords records with keys drawn from the generator
+void createBenchRelation(KeyGenerator &keys, int numRecords)
+{
+    removeIfExists(relationName);
+    PageFile relation = PageFile::create(relationName);
+    BenchRecord record;
+    memset(record.s, ' ', sizeof(record.s));
+    PageId pageNo;
+    Page page = relation.allocatePage(pageNo);
+    for (int r = 0; r < numRecords; r++)
+    {
+        record.i = keys.next();
+        record.d = (double)record.i;
+        sprintf(record.s, "%05d string record", record.i);
+        std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+        while (true)
+        {
+            try
+            {
+                page.insertRecord(data);
+                break;
+            }
+            catch(const InsufficientSpaceException &e)
+            {
+                relation.writePage(pageNo, page);
+                page = relation.allocatePage(pageNo);
+            }
+        }
+    }
+    relation.writePage(pageNo, page);
+}
+
+std::uint64_t elapsedNanos(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string latencyJson(const LatencyHistogram &latency)
+{
+    std::ostringstream json;
+    json << "{\"count\": " << latency.count() << ", \"meanNs\": " << (std::uint64_t)latency.mean()
+         << ", \"p50Ns\": " << latency.percentile(0.5) << ", \"p90Ns\": " << latency.percentile(0.9)
+         << ", \"p99Ns\": " << latency.percentile(0.99) << ", \"p999Ns\": " << latency.percentile(0.999)
+         << ", \"maxNs\": " << latency.max() << "}";
+    return json.str();
+}
+
+std::string bufferJson(const BufStats &usage)
+{
+    std::ostringstream json;
+    json << "{\"hitRatio\": " << usage.hitRatio() << ", \"diskReads\": " << usage.diskreads
+         << ", \"diskWrites\": " << usage.diskwrites << ", \"evictions\": " << usage.evictions << "}";
+    return json.str();
+}
+
+// builds the index over the relation in a pool of numFrames frames and runs each operation on it
+std::string indexRun(Distribution distribution, int numRecords, std::uint32_t numFrames, int numOperations, std::uint64_t seed)
+{
+    BufMgr bufMgr(numFrames);
+    std::ostringstream json;
+    json << "{\"distribution\": \"" << distributionNames[distribution] << "\", \"poolFrames\": " << numFrames;
+    std::string indexName;
+    {
+        // one thread, so the build reads the relation in the same order every run
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        BufStats before = bufMgr.snapshotBufStats();
+        BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER, INDEX_DEFAULT, 1);
+        std::uint64_t buildNanos = elapsedNanos(start);
+        json << ", \"build\": {\"ms\": " << buildNanos / 1e6 << ", \"recordsPerSecond\": " << (std::uint64_t)(numRecords / (buildNanos / 1e9))
+             << ", \"buffer\": " << bufferJson(bufMgr.snapshotBufStats() - before) << "}";
+
+        // the relation's generator again, so the inserted keys continue its sequence
+        KeyGenerator insertKeys(distribution, numRecords, seed);
+        for (int r = 0; r < numRecords; r++)
+        {
+            insertKeys.next();
+        }
+        LatencyHistogram latency;
+        before = bufMgr.snapshotBufStats();
+        start = std::chrono::steady_clock::now();
+        for (int o = 0; o < numOperations; o++)
+        {
+            int key = insertKeys.next();
+            RecordId rid;
+            rid.page_number = 1000000 + o / 1000;
+            rid.slot_number = o % 1000 + 1;
+            rid.padding = 0;
+            std::chrono::steady_clock::time_point opStart = std::chrono::steady_clock::now();
+            index.insertEntry(&key, rid);
+            latency.record(elapsedNanos(opStart));
+        }
+        std::uint64_t insertNanos = elapsedNanos(start);
+        json << ", \"insert\": {\"opsPerSecond\": " << (std::uint64_t)(numOperations / (insertNanos / 1e9))
+             << ", \"latency\": " << latencyJson(latency) << ", \"buffer\": " << bufferJson(bufMgr.snapshotBufStats() - before) << "}";
+
+        // lookups and scans draw their own keys, folded back into the relation's domain
+        KeyGenerator lookupKeys(distribution, numRecords, seed + 1);
+        std::vector<RecordId> rids;
+        std::uint64_t found = 0;
+        latency.clear();
+        before = bufMgr.snapshotBufStats();
+        for (int o = 0; o < numOperations; o++)
+        {
+            int key = (lookupKeys.next() % numRecords + numRecords) % numRecords;
+            std::chrono::steady_clock::time_point opStart = std::chrono::steady_clock::now();
+            index.lookup(&key, rids);
+            latency.record(elapsedNanos(opStart));
+            found += rids.size();
+        }
+        json << ", \"lookup\": {\"latency\": " << latencyJson(latency) << ", \"ridsPerLookup\": " << (double)found / numOperations
+             << ", \"buffer\": " << bufferJson(bufMgr.snapshotBufStats() - before) << "}";
+
+        // ranges of 100 keys, a tenth as many as there are lookups
+        const int scanWidth = 100;
+        KeyGenerator scanKeys(distribution, numRecords, seed + 2);
+        found = 0;
+        latency.clear();
+        before = bufMgr.snapshotBufStats();
+        for (int o = 0; o < numOperations / 10; o++)
+        {
+            int low = (scanKeys.next() % numRecords + numRecords) % numRecords;
+            int high = low + scanWidth;
+            std::chrono::steady_clock::time_point opStart = std::chrono::steady_clock::now();
+            try
+            {
+                index.startScan(&low, GTE, &high, LT);
+                RecordId rid;
+                while (true)
+                {
+                    index.scanNext(rid);
+                    found++;
+                }
+            }
+            catch(const NoSuchKeyFoundException &e)
+            {
+            }
+            catch(const IndexScanCompletedException &e)
+            {
+                index.endScan();
+            }
+            latency.record(elapsedNanos(opStart));
+        }
+        json << ", \"scan\": {\"width\": " << scanWidth << ", \"latency\": " << latencyJson(latency)
+             << ", \"ridsPerScan\": " << (numOperations < 10 ? 0 : (double)found / (numOperations / 10))
+             << ", \"buffer\": " << bufferJson(bufMgr.snapshotBufStats() - before) << "}";
+
+        IndexStats shape = index.stats(1);
+        json << ", \"index\": {\"height\": " << shape.height << ", \"pages\": " << shape.pages
+             << ", \"averageLeafFill\": " << shape.averageLeafFill << "}}";
+    }
+    removeIfExists(indexName);
+    return json.str();
+}
+
+void indexBenchmark(int numRecords, const std::string &distributionName, const std::vector<std::uint32_t> &poolFrames,
+                    int numOperations, std::uint64_t seed)
+{
+    std::cout << "{\"benchmark\": \"index\", \"records\": " << numRecords << ", \"operations\": " << numOperations
+              << ", \"seed\": " << seed << ", \"runs\": [";
+    bool first = true;
+    for (int d = SEQUENTIAL; d <= ZIPFIAN; d++)
+    {
+        if (distributionName != "all" && distributionName != distributionNames[d])
+        {
+            continue;
+        }
+        KeyGenerator keys((Distribution)d, numRecords, seed);
+        createBenchRelation(keys, numRecords);
+        for (size_t p = 0; p < poolFrames.size(); p++)
+        {
+            std::cout << (first ? "\n  " : ",\n  ") << indexRun((Distribution)d, numRecords, poolFrames[p], numOperations, seed);
+            std::cout.flush();
+            first = false;
+        }
+        removeIfExists(relationName);
+    }
+    std::cout << "\n]}" << std::endl;
+}
+
+// numThreads threads each reading numReads random pages of the blob through the pool
+std::string pageReadScaling(BufMgr &bufMgr, BlobFile &blob, std::uint32_t numPages, int numThreads, int numReads)
+{
+    std::vector<std::thread> threads;
+    BufStats before = bufMgr.snapshotBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.push_back(std::thread([&bufMgr, &blob, numPages, numReads, t]() {
+            KeyGenerator pages(UNIFORM, numPages, 100 + t);
+            for (int o = 0; o < numReads; o++)
+            {
+                PageId pageNo = 1 + pages.next();
+                Page *page;
+                bufMgr.readPage(&blob, pageNo, page);
+                bufMgr.unPinPage(&blob, pageNo, false);
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    std::uint64_t nanos = elapsedNanos(start);
+    std::ostringstream json;
+    json << "{\"work\": \"pageRead\", \"poolFrames\": " << bufMgr.getNumBufs() << ", \"threads\": " << numThreads
+         << ", \"opsPerSecond\": " << (std::uint64_t)((double)numThreads * numReads / (nanos / 1e9))
+         << ", \"buffer\": " << bufferJson(bufMgr.snapshotBufStats() - before) << "}";
+    return json.str();
+}
+
+// numThreads threads each looking up numLookups uniform keys of the index
+std::string lookupScaling(BufMgr &bufMgr, BTreeIndex &index, int numRecords, int numThreads, int numLookups)
+{
+    std::vector<std::thread> threads;
+    BufStats before = bufMgr.snapshotBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.push_back(std::thread([&index, numRecords, numLookups, t]() {
+            KeyGenerator keys(UNIFORM, numRecords, 200 + t);
+            std::vector<RecordId> rids;
+            for (int o = 0; o < numLookups; o++)
+            {
+                int key = keys.next();
+                index.lookup(&key, rids);
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    std::uint64_t nanos = elapsedNanos(start);
+    std::ostringstream json;
+    json << "{\"work\": \"lookup\", \"poolFrames\": " << bufMgr.getNumBufs() << ", \"threads\": " << numThreads
+         << ", \"opsPerSecond\": " << (std::uint64_t)((double)numThreads * numLookups / (nanos / 1e9))
+         << ", \"buffer\": " << bufferJson(bufMgr.snapshotBufStats() - before) << "}";
+    return json.str();
+}
+
+void threadScaling(std::uint32_t numPages, const std::vector<int> &threadCounts, int numOperations, int numRecords)
+{
+    std::cout << "{\"benchmark\": \"scaling\", \"filePages\": " << numPages << ", \"records\": " << numRecords
+              << ", \"operationsPerThread\": " << numOperations << ", \"hardwareThreads\": "
+              << std::thread::hardware_concurrency() << ", \"runs\": [";
+    bool first = true;
+    removeIfExists(blobName);
+    {
+        BlobFile blob = BlobFile::create(blobName);
+        for (std::uint32_t i = 0; i < numPages; i++)
+        {
+            PageId pageNo;
+            blob.allocatePage(pageNo);
+        }
+    }
+    {
+        BlobFile blob = BlobFile::open(blobName);
+        std::uint32_t poolFrames[] = {numPages, numPages / 4 + 1};
+        for (int p = 0; p < 2; p++)
+        {
+            BufMgr bufMgr(poolFrames[p]);
+            // once through the file, so the first run does not pay for filling the pool
+            for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+            {
+                Page *page;
+                bufMgr.readPage(&blob, pageNo, page);
+                bufMgr.unPinPage(&blob, pageNo, false);
+            }
+            for (size_t t = 0; t < threadCounts.size(); t++)
+            {
+                std::cout << (first ? "\n  " : ",\n  ") << pageReadScaling(bufMgr, blob, numPages, threadCounts[t], numOperations);
+                std::cout.flush();
+                first = false;
+            }
+        }
+    }
+    removeIfExists(blobName);
+
+    KeyGenerator keys(UNIFORM, numRecords, 17);
+    createBenchRelation(keys, numRecords);
+    std::string indexName;
+    {
+        BufMgr bufMgr(numPages);
+        BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+        lookupScaling(bufMgr, index, numRecords, 1, numOperations);
+        for (size_t t = 0; t < threadCounts.size(); t++)
+        {
+            std::cout << (first ? "\n  " : ",\n  ") << lookupScaling(bufMgr, index, numRecords, threadCounts[t], numOperations);
+            std::cout.flush();
+            first = false;
+        }
+    }
+    removeIfExists(indexName);
+    removeIfExists(relationName);
+    std::cout << "\n]}" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string benchmark = argc > 1 ? argv[1] : "restart";
+    if (benchmark == "index")
+    {
+        int numRecords = argc > 2 ? atoi(argv[2]) : 100000;
+        std::string distributionName = argc > 3 ? argv[3] : "all";
+        std::vector<std::uint32_t> poolFrames;
+        std::stringstream frames(argc > 4 ? argv[4] : "100,1000,10000");
+        std::string frameCount;
+        while (std::getline(frames, frameCount, ','))
+        {
+            poolFrames.push_back(atoi(frameCount.c_str()));
+        }
+        int numOperations = argc > 5 ? atoi(argv[5]) : 100000;
+        std::uint64_t seed = argc > 6 ? strtoull(argv[6], NULL, 10) : 17;
+        indexBenchmark(numRecords, distributionName, poolFrames, numOperations, seed);
+        return 0;
+    }
+    if (benchmark == "scaling")
+    {
+        std::uint32_t numPages = argc > 2 ? atoi(argv[2]) : 4096;
+        std::vector<int> threadCounts;
+        std::stringstream threads(argc > 3 ? argv[3] : "1,2,4,8,16,32");
+        std::string threadCount;
+        while (std::getline(threads, threadCount, ','))
+        {
+            threadCounts.push_back(atoi(threadCount.c_str()));
+        }
+        int numOperations = argc > 4 ? atoi(argv[4]) : 200000;
+        int numRecords = argc > 5 ? atoi(argv[5]) : 100000;
+        threadScaling(numPages, threadCounts, numOperations, numRecords);
+        return 0;
+    }
+    if (benchmark == "pool")
+    {
+        int poolMB = argc > 2 ? atoi(argv[2]) : 256;
+        int numReads = argc > 3 ? atoi(argv[3]) : 2000000;
+        poolMapping((std::uint64_t)poolMB * 1024 * 1024 / Page::SIZE, numReads);
+        return 0;
+    }
+    if (benchmark == "checksum")
+    {
+        int fileMB = argc > 2 ? atoi(argv[2]) : 64;
+        int numReads = argc > 3 ? atoi(argv[3]) : 200000;
+        checksumOverhead((std::uint64_t)fileMB * 1024 * 1024 / Page::SIZE, numReads);
+        return 0;
+    }
+
+    int poolMB = argc > 2 ? atoi(argv[2]) : 256;
+    int numTransactions = argc > 3 ? atoi(argv[3]) : 200000;
+    int checkpointInterval = argc > 4 ? atoi(argv[4]) : numTransactions / 10;
+    std::uint32_t numPages = (std::uint64_t)poolMB * 1024 * 1024 / Page::SIZE;
+
+    std::cout << "pool of " << numPages << " pages, " << numTransactions << " transactions of 8 page changes" << std::endl;
+    crashAndRecover(numPages, numTransactions, 0);
+    crashAndRecover(numPages, numTransactions, checkpointInterval);
+    return 0;
+}
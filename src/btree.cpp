@@ -6,8 +6,10 @@
  */
 
 #include "btree.h"
-#include "filescan.h"
+#include <algorithm>
 #include <climits>
+#include <random>
+#include <vector>
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
@@ -15,7 +17,6 @@
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
-#include "exceptions/end_of_file_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 
 //#define DEBUG
@@ -39,7 +40,163 @@
 namespace badgerdb
 {
 
-    void BTreeIndex::handleAlreadyPresent(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int _attrByteOffset, const Datatype attrType)
+    /**
+     * @brief maps a rid onto a single integer that keeps (page_number, slot_number) order, used to delta encode posting lists
+     */
+    static std::uint64_t ridOrdinal(const RecordId &rid)
+    {
+        return ((std::uint64_t)rid.page_number << 16) | rid.slot_number;
+    }
+
+    static RecordId ridFromOrdinal(std::uint64_t ordinal)
+    {
+        RecordId rid;
+        rid.page_number = (PageId)(ordinal >> 16);
+        rid.slot_number = (SlotId)(ordinal & 0xFFFF);
+        rid.padding = 0;
+        return rid;
+    }
+
+    static int varintLength(std::uint64_t value)
+    {
+        int length = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            length++;
+        }
+        return length;
+    }
+
+    static int putVarint(unsigned char *out, std::uint64_t value)
+    {
+        int length = 0;
+        while (value >= 0x80)
+        {
+            out[length++] = (unsigned char)(value | 0x80);
+            value >>= 7;
+        }
+        out[length++] = (unsigned char)value;
+        return length;
+    }
+
+    static std::uint64_t getVarint(const unsigned char *in, int &offset)
+    {
+        std::uint64_t value = 0;
+        int shift = 0;
+        while (in[offset] & 0x80)
+        {
+            value |= (std::uint64_t)(in[offset++] & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= (std::uint64_t)in[offset++] << shift;
+        return value;
+    }
+
+    /**
+     * @brief number of bits needed to hold every offset up to range in a compressed leaf
+     */
+    static int bitsNeeded(std::uint32_t range)
+    {
+        int bits = 0;
+        while (range != 0)
+        {
+            range >>= 1;
+            bits++;
+        }
+        return bits;
+    }
+
+    static int packedKeyBytes(int count, int keyBits)
+    {
+        return (count * keyBits + 7) / 8;
+    }
+
+    static std::uint32_t unpackKey(const unsigned char *data, int index, int keyBits)
+    {
+        if (keyBits == 0)
+        {
+            return 0;
+        }
+        // unaligned 8 byte read always covers the key since keyBits <= 32
+        std::uint64_t word;
+        std::int64_t bitPos = (std::int64_t)index * keyBits;
+        memcpy(&word, data + bitPos / 8, sizeof(word));
+        word >>= bitPos % 8;
+        return (std::uint32_t)(word & ((((std::uint64_t)1) << keyBits) - 1));
+    }
+
+    /**
+     * @brief index of the first packed key at or past keyInt in a compressed leaf, past keyInt if not inclusive
+     */
+    static int findPackedIndex(int keyInt, const unsigned char *data, int baseKey, int keyBits, int count, bool inclusive)
+    {
+        // keys outside the frame need no search at all
+        std::int64_t target = (std::int64_t)keyInt - baseKey;
+        if (target < 0)
+        {
+            return 0;
+        }
+        if (target > (std::int64_t)0xFFFFFFFF)
+        {
+            return count;
+        }
+        int low = 0;
+        int high = count;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            std::int64_t curOffset = unpackKey(data, mid, keyBits);
+            if (curOffset < target || (!inclusive && curOffset == target))
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    static RecordId unpackRid(const unsigned char *data)
+    {
+        RecordId rid;
+        memcpy(&rid.page_number, data, sizeof(PageId));
+        memcpy(&rid.slot_number, data + sizeof(PageId), sizeof(SlotId));
+        rid.padding = 0;
+        return rid;
+    }
+
+    /**
+     * @brief the keys, rids and included fields of a covering leaf sit back to back, each array sized for capacity entries
+     */
+    static int *coveringKeys(Page *leafPage)
+    {
+        return reinterpret_cast<CoveringLeafNodeInt *>(leafPage)->data;
+    }
+
+    static RecordId *coveringRids(Page *leafPage, int capacity)
+    {
+        return reinterpret_cast<RecordId *>(coveringKeys(leafPage) + capacity);
+    }
+
+    static char *coveringIncluded(Page *leafPage, int capacity)
+    {
+        return reinterpret_cast<char *>(coveringRids(leafPage, capacity) + capacity);
+    }
+
+    /**
+     * @brief insert one size byte entry at index into an array of count such entries
+     */
+    static void insertFixed(char *arr, int index, int count, const char *entry, int size)
+    {
+        memmove(arr + (index + 1) * size, arr + index * size, (count - index) * size);
+        memcpy(arr + index * size, entry, size);
+    }
+
+    void BTreeIndex::handleAlreadyPresent(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int _attrByteOffset, const Datatype attrType,
+                                          const std::vector<KeyComponent> &components)
     {
         // set bufMgr attribute
         bufMgr = bufMgrIn;
@@ -50,17 +207,55 @@ namespace badgerdb
         IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
 
         // check if arguments are correct
-        if (relationName != metaInfo->relationName || _attrByteOffset != metaInfo->attrByteOffset || attrType != metaInfo->attrType)
+        std::vector<KeyComponent> fileComponents;
+        if (metaInfo->indexOptions & INDEX_COMPOSITE_KEY)
+        {
+            fileComponents.assign(metaInfo->keyComponents, metaInfo->keyComponents + metaInfo->numKeyComponents);
+        }
+        bool sameComponents = fileComponents.size() == components.size();
+        for (size_t c = 0; sameComponents && c < components.size(); c++)
+        {
+            sameComponents = fileComponents[c].attrByteOffset == components[c].attrByteOffset &&
+                             fileComponents[c].attrType == components[c].attrType &&
+                             CompositeKey::encodedLength(fileComponents[c]) == CompositeKey::encodedLength(components[c]);
+        }
+        if (relationName != metaInfo->relationName || _attrByteOffset != metaInfo->attrByteOffset || attrType != metaInfo->attrType || !sameComponents)
         {
+            bufMgr->unPinPage(file, (PageId)1, false);
             throw BadIndexInfoException("error");
         }
         // set attributes and unpin
+        headerPageNum = (PageId)1;
         rootPageNum = metaInfo->rootPageNo;
         numPages = metaInfo->numPages;
+        reorganizeState = NULL;
+        activeInserts = 0;
+        insertsPaused = false;
+        readEpoch = 0;
+        activeReads[0] = 0;
+        activeReads[1] = 0;
+        attributeType = attrType; // selects the node format
+        attrByteOffset = _attrByteOffset;
+        indexOptions = metaInfo->indexOptions;
+        leafOccupancy = (indexOptions & INDEX_COMPRESSED_LEAVES) ? COMPRESSEDLEAFMAXSIZE : INTARRAYLEAFSIZE;
+        nodeOccupancy = (indexOptions & INDEX_SUBTREE_COUNTS) ? INTARRAYCOUNTEDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+        std::vector<ScanField> columns;
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            columns.assign(metaInfo->includedColumns, metaInfo->includedColumns + metaInfo->numIncludedColumns);
+        }
+        keyComponents = fileComponents;
+        compositeKeyLength = 0;
+        for (size_t c = 0; c < keyComponents.size(); c++)
+        {
+            compositeKeyLength += CompositeKey::encodedLength(keyComponents[c]);
+        }
         bufMgr->unPinPage(file, (PageId)1, false); // unpin page
+        setIncludedColumns(relationName, columns);
     }
 
-    void BTreeIndex::handleNew(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int _attrByteOffset, const Datatype attrType)
+    void BTreeIndex::handleNew(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int _attrByteOffset, const Datatype attrType, const int options,
+                               const std::vector<ScanField> &columns, const std::vector<KeyComponent> &components)
     {
 
         // set bufMgr attribute
@@ -76,8 +271,22 @@ namespace badgerdb
         strcpy(metaInfo->relationName, relationName.c_str());
         metaInfo->attrByteOffset = _attrByteOffset;
         metaInfo->attrType = attrType;
-        metaInfo->rootPageNo = (PageId)2; // might need to dynamically set this after root created
+        metaInfo->rootPageNo = (PageId)2; // moves once the root splits
         metaInfo->numPages = 2;
+        metaInfo->freeListPageNo = Page::INVALID_NUMBER;
+        metaInfo->numFreePages = 0;
+        int allOptions = options | (columns.empty() ? 0 : INDEX_INCLUDED_COLUMNS) | (components.empty() ? 0 : INDEX_COMPOSITE_KEY);
+        metaInfo->indexOptions = allOptions;
+        metaInfo->numIncludedColumns = columns.size();
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            metaInfo->includedColumns[c] = columns[c];
+        }
+        metaInfo->numKeyComponents = components.size();
+        for (size_t c = 0; c < components.size(); c++)
+        {
+            metaInfo->keyComponents[c] = components[c];
+        }
         bufMgr->unPinPage(file, metaPageNo, true);
 
         // set Btree instance fields
@@ -86,350 +295,1300 @@ namespace badgerdb
         attributeType = attrType;
         attrByteOffset = _attrByteOffset;
         numPages = 2;
+        reorganizeState = NULL;
+        activeInserts = 0;
+        insertsPaused = false;
+        readEpoch = 0;
+        activeReads[0] = 0;
+        activeReads[1] = 0;
+        indexOptions = allOptions;
+        keyComponents = components;
+        compositeKeyLength = 0;
+        for (size_t c = 0; c < components.size(); c++)
+        {
+            compositeKeyLength += CompositeKey::encodedLength(components[c]);
+        }
+        leafOccupancy = (indexOptions & INDEX_COMPRESSED_LEAVES) ? COMPRESSEDLEAFMAXSIZE : INTARRAYLEAFSIZE;
+        nodeOccupancy = (indexOptions & INDEX_SUBTREE_COUNTS) ? INTARRAYCOUNTEDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+        setIncludedColumns(relationName, columns);
 
-        // create root
+        // create root, its children are leaves until it splits
         Page *root;
         PageId rootPageNo;
         bufMgr->allocPage(file, rootPageNo, root);
-        NonLeafNodeInt *rootNode = reinterpret_cast<NonLeafNodeInt *>(root);
-        rootNode->level = 1; // How will this be updated once height reaches 3?
-        initalizeNonLeafNode(rootNode);
+        if (attributeType == STRING)
+        {
+            initalizeStringNode(reinterpret_cast<SlottedNodeString *>(root), false, 1);
+        }
+        else
+        {
+            initalizeNonLeafPage(root, 1);
+        }
         bufMgr->unPinPage(file, rootPageNo, true);
     }
 
-    void BTreeIndex::createFirstChild(int keyInt, RecordId rid, NonLeafNodeInt *root)
+    void BTreeIndex::setIncludedColumns(const std::string &relationName, const std::vector<ScanField> &columns)
     {
-        // create first child page manually
-        Page *firstPage;
-        PageId firstPageId;
-        bufMgr->allocPage(file, firstPageId, firstPage);
-        LeafNodeInt *firstNode = reinterpret_cast<LeafNodeInt *>(firstPage);
-
-        // initalize leaf node values
-        initalizeLeafNode(firstNode);
-
-        // set first entry of child page and unpin
-        firstNode->keyArray[0] = keyInt;
-        firstNode->ridArray[0] = rid;
-        bufMgr->unPinPage(file, firstPageId, true);
-
-        // update root and unpin
-        root->keyArray[0] = keyInt + 1;
-        root->pageNoArray[0] = firstPageId;
-        bufMgr->unPinPage(file, rootPageNum, true); // unpin root
+        includedColumns = columns;
+        includedSize = 0;
+        relationFile = NULL;
+        postingThreshold = POSTINGTHRESHOLD;
+        if (!(indexOptions & INDEX_INCLUDED_COLUMNS))
+        {
+            return;
+        }
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            includedSize += columns[c].attrLength;
+        }
 
-        // update numPages in file and instance
-        numPages++;
-        Page *metaPage;
-        bufMgr->readPage(file, (PageId)1, metaPage);
-        IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
-        metaInfo->numPages++;
-        bufMgr->unPinPage(file, (PageId)1, true);
+        // wider entries leave fewer per leaf, and a run must stay well under half a leaf for splits to work
+        leafOccupancy = COVERINGLEAFDATASIZE / (sizeof(int) + sizeof(RecordId) + includedSize);
+        postingThreshold = std::min(POSTINGTHRESHOLD, leafOccupancy / 4);
+        relationFile = new PageFile(relationName, false);
     }
 
-    int BTreeIndex::findInsertIndex(int keyInt, LeafNodeInt *curNode)
+    void BTreeIndex::checkIncludedColumns(const Datatype attrType, const int options, const std::vector<ScanField> &columns)
     {
-        // leaf is full, subsequent code will split and handle
-        if (curNode->keyArray[INTARRAYLEAFSIZE - 1] != INT_MAX)
+        if (columns.empty())
+        {
+            return;
+        }
+        if (attrType == STRING || (options & INDEX_COMPRESSED_LEAVES))
         {
-            return INTARRAYLEAFSIZE;
+            throw BadIndexInfoException("included columns need an uncompressed INTEGER index");
         }
-        for (int i = 0; i < INTARRAYLEAFSIZE; i++)
+        if ((int)columns.size() > MAXINCLUDEDCOLUMNS)
         {
-            int curKey = curNode->keyArray[i];
-            int nextKey = curNode->keyArray[i + 1];
-
-            // found empty slot
-            if (curKey == INT_MAX)
-            {
-                return i;
-            }
-            // key goes in first element
-            if (i == 0 && keyInt < curKey)
+            throw BadIndexInfoException("too many included columns");
+        }
+        int size = 0;
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            if (columns[c].attrByteOffset < 0 || columns[c].attrLength <= 0)
             {
-                return 0;
+                throw BadIndexInfoException("bad included column");
             }
+            size += columns[c].attrLength;
+        }
+        if (size > MAXINCLUDEDSIZE)
+        {
+            throw BadIndexInfoException("included columns are too wide");
+        }
+    }
 
-            // key goes inbetween current and next
-            if (keyInt > curKey && keyInt < nextKey)
+    void BTreeIndex::checkKeyComponents(const std::vector<KeyComponent> &components)
+    {
+        if (components.size() < 2 || (int)components.size() > MAXKEYCOMPONENTS)
+        {
+            throw BadIndexInfoException("a composite key needs 2 to 4 components");
+        }
+        int length = 0;
+        for (size_t c = 0; c < components.size(); c++)
+        {
+            if (components[c].attrByteOffset < 0 || (components[c].attrType == STRING && components[c].attrLength <= 0))
             {
-                return i + 1;
+                throw BadIndexInfoException("bad key component");
             }
+            length += CompositeKey::encodedLength(components[c]);
+        }
+        if (length > STRINGKEYSIZE)
+        {
+            throw BadIndexInfoException("composite key is too long");
         }
-        return -1; // Error if code reached
     }
 
-    int BTreeIndex::findInsertIndexArr(int keyInt, int *arr)
+    void BTreeIndex::compositeBound(const CompositeKey &bound, bool fillHigh, std::string &out)
     {
-        if (keyInt > arr[INTARRAYLEAFSIZE])
+        if ((int)bound.bytes().size() > compositeKeyLength)
         {
-            return INTARRAYLEAFSIZE;
+            throw BadIndexInfoException("scan bound has too many components");
         }
+        out = bound.bytes();
+        out.append(compositeKeyLength - out.size(), fillHigh ? (char)0xFF : '\0');
+    }
 
-        if (keyInt < arr[0])
-        {
-            return 0;
-        }
-        for (int i = 0; i < INTARRAYLEAFSIZE; i++)
-        {
-            int cur = arr[i];
-            int next = arr[i + 1];
+    void BTreeIndex::updateMetaInfo()
+    {
+        std::lock_guard<std::mutex> guard(metaMutex);
+        Page *metaPage;
+        bufMgr->readPage(file, headerPageNum, metaPage);
+        IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
+        metaInfo->rootPageNo = rootPageNum;
+        metaInfo->numPages = numPages;
+        bufMgr->unPinPage(file, headerPageNum, true);
+    }
 
-            if (keyInt > cur && keyInt < next)
+    void BTreeIndex::allocNodePage(PageId &pageNo, Page *&page)
+    {
+        {
+            std::lock_guard<std::mutex> guard(metaMutex);
+            Page *metaPage;
+            bufMgr->readPage(file, headerPageNum, metaPage);
+            IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
+            PageId listPageNo = metaInfo->freeListPageNo;
+            if (listPageNo != Page::INVALID_NUMBER)
             {
-                return i + 1;
+                Page *listPage;
+                bufMgr->readPage(file, listPageNo, listPage);
+                FreeListNodeInt *list = reinterpret_cast<FreeListNodeInt *>(listPage);
+                if (list->numFree > 0)
+                {
+                    pageNo = list->freePageNos[--list->numFree];
+                    bufMgr->unPinPage(file, listPageNo, true);
+                    bufMgr->readPage(file, pageNo, page);
+                }
+                else
+                {
+                    // the list page holds no more numbers, so it is handed out itself
+                    pageNo = listPageNo;
+                    page = listPage;
+                    metaInfo->freeListPageNo = list->nextPageNo;
+                }
+                metaInfo->numFreePages--;
+                bufMgr->unPinPage(file, headerPageNum, true);
+                memset(reinterpret_cast<char *>(page), 0, NODESIZE);
+                return;
             }
+            bufMgr->unPinPage(file, headerPageNum, false);
         }
-        return 0;
+        bufMgr->allocPage(file, pageNo, page);
+        numPages++;
     }
 
-    int BTreeIndex::findInsertIndexSplit(int keyInt, LeafNodeInt *curNode)
+    void BTreeIndex::freeNodePages(const std::vector<PageId> &pageNos)
     {
-        for (int i = 0; i < INTARRAYLEAFSIZE; i++)
+        std::lock_guard<std::mutex> guard(metaMutex);
+        Page *metaPage;
+        bufMgr->readPage(file, headerPageNum, metaPage);
+        IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
+        PageId listPageNo = metaInfo->freeListPageNo;
+        Page *listPage = NULL;
+        for (size_t i = 0; i < pageNos.size(); i++)
         {
-            int curKey = curNode->keyArray[i];
-            int nextKey = curNode->keyArray[i + 1];
-
-            // key goes in last element
-            if (keyInt > curNode->keyArray[INTARRAYLEAFSIZE - 1])
+            if (listPage == NULL && listPageNo != Page::INVALID_NUMBER)
             {
-                return INTARRAYLEAFSIZE - 1;
+                bufMgr->readPage(file, listPageNo, listPage);
             }
-
-            // key goes in first element
-            if (i == 0 && keyInt < curKey)
+            FreeListNodeInt *list = reinterpret_cast<FreeListNodeInt *>(listPage);
+            if (list != NULL && list->numFree < FREELISTSIZE)
             {
-                return 0;
+                list->freePageNos[list->numFree++] = pageNos[i];
+                continue;
             }
 
-            // key goes inbetween current and next
-            if (keyInt > curKey && keyInt < nextKey)
+            // a full list gets a new first page, made of the page being freed
+            if (listPage != NULL)
             {
-                return i + 1;
+                bufMgr->unPinPage(file, listPageNo, true);
             }
+            PageId nextPageNo = listPageNo;
+            listPageNo = pageNos[i];
+            bufMgr->readPage(file, listPageNo, listPage);
+            memset(reinterpret_cast<char *>(listPage), 0, NODESIZE);
+            list = reinterpret_cast<FreeListNodeInt *>(listPage);
+            list->nextPageNo = nextPageNo;
+            list->numFree = 0;
+        }
+        if (listPage != NULL)
+        {
+            bufMgr->unPinPage(file, listPageNo, true);
         }
-        return -1; // Error if code reached
+        metaInfo->freeListPageNo = listPageNo;
+        metaInfo->numFreePages += pageNos.size();
+        bufMgr->unPinPage(file, headerPageNum, true);
     }
 
-    void BTreeIndex::insertHelper(bool regular, int index, int keyInt, RecordId rid, NonLeafNodeInt *root, LeafNodeInt *firstNode)
+    void BTreeIndex::createFirstChild(int keyInt, RecordId rid, const char *included, Page *rootPage)
     {
-        int rootValue = INT_MAX;
-        // key is going to be furthest in page
-        if (firstNode->keyArray[index] == INT_MAX)
+        // create first child page manually
+        Page *firstPage;
+        PageId firstPageId;
+        allocNodePage(firstPageId, firstPage);
+
+        // initalize leaf node values
+        initalizeLeafPage(firstPage);
+
+        // set first entry of child page and unpin
+        writeLeaf(firstPage, &keyInt, &rid, 1, included);
+        bufMgr->unPinPage(file, firstPageId, true);
+
+        // root has no keys yet, so every key goes to its first child
+        nonLeafPageNos(rootPage)[0] = firstPageId;
+        int *counts = nonLeafCounts(rootPage);
+        if (counts != NULL)
         {
-            // insert key and rid
-            firstNode->keyArray[index] = keyInt;
-            firstNode->ridArray[index] = rid;
-            rootValue = keyInt;
+            counts[0] = 1;
         }
-        else
-        {
-            int i = INTARRAYLEAFSIZE - 2; // starts at second to last element since we know last element is intmax
 
-            while (i + 1 > index)
-            { // shift all values before index of new key one to the right (replace last with second to last (avoids index out of bounds))
-                firstNode->keyArray[i + 1] = firstNode->keyArray[i];
-                firstNode->ridArray[i + 1] = firstNode->ridArray[i];
-                if (rootValue == INT_MAX)
-                {
-                    rootValue = firstNode->keyArray[i + 1];
-                }
-                i--;
-            }
-            firstNode->keyArray[index] = keyInt;
-            firstNode->ridArray[index] = rid;
+        // update numPages in file and instance
+        updateMetaInfo();
+    }
+
+    int BTreeIndex::leafEntryCount(Page *leafPage)
+    {
+        if (attributeType == STRING)
+        {
+            return reinterpret_cast<SlottedNodeString *>(leafPage)->numSlots;
         }
-        // update root key
-        if (!regular)
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
         {
-            root->keyArray[0] = rootValue + 1;
+            return reinterpret_cast<CompressedLeafNodeInt *>(leafPage)->numEntries;
         }
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            return reinterpret_cast<CoveringLeafNodeInt *>(leafPage)->numEntries;
+        }
+
+        return reinterpret_cast<LeafNodeInt *>(leafPage)->numEntries;
+    }
 
-        // unpin root and firstPage
-        if (!regular)
+    int BTreeIndex::leafKey(Page *leafPage, int index)
+    {
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            CompressedLeafNodeInt *leaf = reinterpret_cast<CompressedLeafNodeInt *>(leafPage);
+            return (int)((std::int64_t)leaf->baseKey + unpackKey(leaf->data, index, leaf->keyBits));
+        }
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
         {
-            bufMgr->unPinPage(file, (PageId)2, true);
-            bufMgr->unPinPage(file, root->pageNoArray[0], true);
+            return coveringKeys(leafPage)[index];
         }
+        return reinterpret_cast<LeafNodeInt *>(leafPage)->keyArray[index];
     }
 
-    void BTreeIndex::insertHelperArr(int index, int keyInt, int *arr, RecordId *arrR, RecordId rid)
+    RecordId BTreeIndex::leafRid(Page *leafPage, int index)
     {
-        for (int i = INTARRAYLEAFSIZE; i >= index; i--)
+        if (attributeType == STRING)
         {
-            if (arr[i] != INT_MAX)
-            {
-                arr[i + 1] = arr[i];
-                arrR[i + 1] = arrR[i];
-            }
+            StringSlot *slots = reinterpret_cast<StringSlot *>(reinterpret_cast<SlottedNodeString *>(leafPage)->data);
+            RecordId rid;
+            rid.page_number = slots[index].pageNo;
+            rid.slot_number = slots[index].slotNo;
+            rid.padding = 0;
+            return rid;
         }
-        arr[index] = keyInt;
-        arrR[index] = rid;
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            CompressedLeafNodeInt *leaf = reinterpret_cast<CompressedLeafNodeInt *>(leafPage);
+            int ridStart = packedKeyBytes(leaf->numEntries, leaf->keyBits);
+            return unpackRid(leaf->data + ridStart + index * PACKEDRIDSIZE);
+        }
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            return coveringRids(leafPage, leafOccupancy)[index];
+        }
+        return reinterpret_cast<LeafNodeInt *>(leafPage)->ridArray[index];
     }
 
-    void BTreeIndex::NonLeafNodeInsertHelper(int index, int keyInt, PageId pageNo, NonLeafNodeInt *leafHolder)
+    char *BTreeIndex::leafIncluded(Page *leafPage, int index)
     {
-        for (int i = INTARRAYNONLEAFSIZE - 1; i >= index; i--)
+        return coveringIncluded(leafPage, leafOccupancy) + index * includedSize;
+    }
+
+    void BTreeIndex::fetchIncluded(RecordId rid, char *out)
+    {
+        Page *page;
+        bufMgr->readPage(relationFile, rid.page_number, page);
+        std::size_t length;
+        const char *record = page->getRecordData(rid, length);
+        for (size_t c = 0; c < includedColumns.size(); c++)
         {
-            if (leafHolder->keyArray[i] != INT_MAX)
-            {
-                leafHolder->keyArray[i + 1] = leafHolder->keyArray[i];
-                leafHolder->pageNoArray[i + 2] = leafHolder->pageNoArray[i + 1];
-            }
+            std::size_t begin = std::min(length, (std::size_t)includedColumns[c].attrByteOffset);
+            std::size_t end = std::min(length, begin + includedColumns[c].attrLength);
+            memcpy(out, record + begin, end - begin);
+            memset(out + (end - begin), 0, includedColumns[c].attrLength - (end - begin));
+            out += includedColumns[c].attrLength;
         }
-        leafHolder->keyArray[index] = keyInt;
-        leafHolder->pageNoArray[index + 1] = pageNo;
+        bufMgr->unPinPage(relationFile, rid.page_number, false);
     }
 
-    bool BTreeIndex::insertInFirstPage(int keyInt, RecordId rid, NonLeafNodeInt *root)
+    PageId &BTreeIndex::leafRightSib(Page *leafPage)
     {
-        Page *firstPage;
-        bufMgr->readPage(file, root->pageNoArray[0], firstPage);
-        LeafNodeInt *firstNode = reinterpret_cast<LeafNodeInt *>(firstPage);
-        int insertIndex = findInsertIndex(keyInt, firstNode);
-        if (insertIndex == INTARRAYLEAFSIZE)
+        if (attributeType == STRING)
         {
-            bufMgr->unPinPage(file, root->pageNoArray[0], false);
-            return false;
+            return reinterpret_cast<SlottedNodeString *>(leafPage)->rightSibPageNo;
         }
-        insertHelper(false, insertIndex, keyInt, rid, root, firstNode);
-        return true;
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            return reinterpret_cast<CompressedLeafNodeInt *>(leafPage)->rightSibPageNo;
+        }
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            return reinterpret_cast<CoveringLeafNodeInt *>(leafPage)->rightSibPageNo;
+        }
+        return reinterpret_cast<LeafNodeInt *>(leafPage)->rightSibPageNo;
     }
 
-    void BTreeIndex::initalizeNonLeafNode(NonLeafNodeInt *nonLeafNode)
+    PageId &BTreeIndex::leafLeftSib(Page *leafPage)
     {
-        for (int i = 0; i < INTARRAYNONLEAFSIZE + 1; i++)
+        if (attributeType == STRING)
         {
-            if (i < INTARRAYNONLEAFSIZE)
-            {
-                nonLeafNode->keyArray[i] = INT_MAX; // pre fill values
-            }
-            nonLeafNode->pageNoArray[i] = 0; // pre fill values
+            return reinterpret_cast<SlottedNodeString *>(leafPage)->leftSibPageNo;
         }
-        nonLeafNode->isLeaf = false;
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            return reinterpret_cast<CompressedLeafNodeInt *>(leafPage)->leftSibPageNo;
+        }
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            return reinterpret_cast<CoveringLeafNodeInt *>(leafPage)->leftSibPageNo;
+        }
+        return reinterpret_cast<LeafNodeInt *>(leafPage)->leftSibPageNo;
     }
-    void BTreeIndex::initalizeLeafNode(LeafNodeInt *leafNode)
+
+    void BTreeIndex::linkSplitLeaf(PageId leafPageNo, Page *leafPage, PageId newLeafPageNo, Page *newLeafPage)
     {
-        for (int i = 0; i < INTARRAYNONLEAFSIZE; i++)
+        PageId oldRightPageNo = leafRightSib(leafPage);
+        leafRightSib(newLeafPage) = oldRightPageNo;
+        leafLeftSib(newLeafPage) = leafPageNo;
+        leafRightSib(leafPage) = newLeafPageNo;
+        if (oldRightPageNo != Page::INVALID_NUMBER)
         {
-            leafNode->keyArray[i] = INT_MAX; // pre fill values
+            Page *oldRightPage;
+            bufMgr->readPage(file, oldRightPageNo, oldRightPage);
+            leafLeftSib(oldRightPage) = newLeafPageNo;
+            bufMgr->unPinPage(file, oldRightPageNo, true);
         }
-        leafNode->rightSibPageNo = 0;
-        leafNode->isLeaf = true;
     }
 
-    void BTreeIndex::findPlace(int keyInt, NonLeafNodeInt *curRoot, PageId curRootPageId, int &index, NonLeafNodeInt *&leafHolder, PageId &leafHolderPageId)
+    int BTreeIndex::decodeLeaf(Page *leafPage, int *keys, RecordId *rids, char *included, int *counts)
     {
-        leafHolderPageId = curRootPageId;
-        for (int i = 0; i < INTARRAYNONLEAFSIZE; i++)
+        int count = leafEntryCount(leafPage);
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
         {
-            // key belongs in end and at level 1
-            if ((i == INTARRAYNONLEAFSIZE - 1) && (keyInt > curRoot->keyArray[i]) && (curRoot->level == 1))
+            CompressedLeafNodeInt *leaf = reinterpret_cast<CompressedLeafNodeInt *>(leafPage);
+            int ridStart = packedKeyBytes(count, leaf->keyBits);
+            for (int i = 0; i < count; i++)
             {
-                leafHolder = curRoot;
-                index = i + 1;
-                return;
+                keys[i] = (int)((std::int64_t)leaf->baseKey + unpackKey(leaf->data, i, leaf->keyBits));
+                rids[i] = unpackRid(leaf->data + ridStart + i * PACKEDRIDSIZE);
+            }
+        }
+        else if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            memcpy(keys, coveringKeys(leafPage), count * sizeof(int));
+            memcpy(rids, coveringRids(leafPage, leafOccupancy), count * sizeof(RecordId));
+            if (included != NULL)
+            {
+                memcpy(included, coveringIncluded(leafPage, leafOccupancy), count * includedSize);
             }
-            // key belongs in end and at level 0
-            else if ((i == INTARRAYNONLEAFSIZE - 1) && (keyInt > curRoot->keyArray[i]))
+        }
+        else
+        {
+            LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt *>(leafPage);
+            memcpy(keys, leaf->keyArray, count * sizeof(int));
+            memcpy(rids, leaf->ridArray, count * sizeof(RecordId));
+        }
+        if (counts != NULL)
+        {
+            int posting = 0;
+            for (int i = 0; i < count; i++)
             {
-                Page *nextRootPage;
-                bufMgr->readPage(file, curRoot->pageNoArray[i + 1], nextRootPage);
-                NonLeafNodeInt *nextRoot = reinterpret_cast<NonLeafNodeInt *>(nextRootPage);
-                PageId nextRootPageId = curRoot->pageNoArray[i + 1];
-                bufMgr->unPinPage(file, curRootPageId, false);
-                findPlace(keyInt, nextRoot, nextRootPageId, index, leafHolder, leafHolderPageId);
+                counts[i] = rids[i].slot_number == Page::INVALID_SLOT ? postingCount(leafPage, posting++) : 1;
             }
+        }
+        return count;
+    }
 
-            int currentKey = curRoot->keyArray[i];
-            int nextKey = curRoot->keyArray[i + 1];
+    void BTreeIndex::writeLeaf(Page *leafPage, int *keys, RecordId *rids, int count, const char *included, const int *counts)
+    {
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            CompressedLeafNodeInt *leaf = reinterpret_cast<CompressedLeafNodeInt *>(leafPage);
+            leaf->numEntries = count;
+            leaf->baseKey = count > 0 ? keys[0] : 0;
+            leaf->keyBits = count > 0 ? bitsNeeded((std::uint32_t)((std::int64_t)keys[count - 1] - keys[0])) : 0;
+
+            // pack keys a byte at a time through a bit buffer
+            memset(leaf->data, 0, COMPRESSEDLEAFDATASIZE);
+            std::uint64_t buffer = 0;
+            int bufferBits = 0;
+            int offset = 0;
+            for (int i = 0; i < count; i++)
+            {
+                buffer |= (std::uint64_t)(std::uint32_t)((std::int64_t)keys[i] - leaf->baseKey) << bufferBits;
+                bufferBits += leaf->keyBits;
+                while (bufferBits >= 8)
+                {
+                    leaf->data[offset++] = (unsigned char)buffer;
+                    buffer >>= 8;
+                    bufferBits -= 8;
+                }
+            }
+            if (bufferBits > 0)
+            {
+                leaf->data[offset++] = (unsigned char)buffer;
+            }
 
-            // smaller than first key and at level 1
-            if (i == 0 && keyInt < currentKey && curRoot->level == 1)
+            for (int i = 0; i < count; i++)
             {
-                leafHolder = curRoot;
-                index = 0;
-                return;
+                memcpy(leaf->data + offset, &rids[i].page_number, sizeof(PageId));
+                memcpy(leaf->data + offset + sizeof(PageId), &rids[i].slot_number, sizeof(SlotId));
+                offset += PACKEDRIDSIZE;
+            }
+        }
+        else if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            reinterpret_cast<CoveringLeafNodeInt *>(leafPage)->numEntries = count;
+            memmove(coveringKeys(leafPage), keys, count * sizeof(int));
+            memmove(coveringRids(leafPage, leafOccupancy), rids, count * sizeof(RecordId));
+            memmove(coveringIncluded(leafPage, leafOccupancy), included, count * includedSize);
+            if (indexOptions & INDEX_SUBTREE_COUNTS)
+            {
+                // the posting list lengths sit past the last rid and may have moved
+                memset(coveringRids(leafPage, leafOccupancy) + count, 0, (leafOccupancy - count) * sizeof(RecordId));
             }
-            // smaller than first key at level 0
-            else if (i == 0 && keyInt < currentKey)
+        }
+        else
+        {
+            LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt *>(leafPage);
+            if (keys != leaf->keyArray)
             {
-                Page *nextRootPage;
-                bufMgr->readPage(file, curRoot->pageNoArray[0], nextRootPage);
-                NonLeafNodeInt *nextRoot = reinterpret_cast<NonLeafNodeInt *>(nextRootPage);
-                PageId nextRootPageId = curRoot->pageNoArray[0];
-                bufMgr->unPinPage(file, curRootPageId, false);
-                findPlace(keyInt, nextRoot, nextRootPageId, index, leafHolder, leafHolderPageId);
+                memmove(leaf->keyArray, keys, count * sizeof(int));
+                memmove(leaf->ridArray, rids, count * sizeof(RecordId));
             }
-            // found somewhere in middle at level 1
-            if (keyInt >= currentKey && keyInt < nextKey && curRoot->level == 1)
+            // clear entries left past the end, so a leaf that shrank compresses like a new one
+            if (leaf->numEntries > count)
             {
-                leafHolder = curRoot;
-                index = i + 1;
-                return;
+                memset(leaf->keyArray + count, 0, (leaf->numEntries - count) * sizeof(int));
+                memset(leaf->ridArray + count, 0, (leaf->numEntries - count) * sizeof(RecordId));
             }
-            // found somewhere in middle at level 0
-            else if (keyInt >= currentKey && keyInt < nextKey)
+            if (indexOptions & INDEX_SUBTREE_COUNTS)
             {
-                Page *nextRootPage;
-                bufMgr->readPage(file, curRoot->pageNoArray[i + 1], nextRootPage);
-                NonLeafNodeInt *nextRoot = reinterpret_cast<NonLeafNodeInt *>(nextRootPage);
-                PageId nextRootPageId = curRoot->pageNoArray[i + 1];
-                try
-                {
-                    bufMgr->unPinPage(file, curRootPageId, false);
-                }
-                catch (PageNotPinnedException &e)
+                memset(leaf->ridArray + count, 0, (INTARRAYLEAFSIZE - count) * sizeof(RecordId));
+            }
+            leaf->numEntries = count;
+        }
+
+        if (counts != NULL)
+        {
+            int posting = 0;
+            for (int i = 0; i < count; i++)
+            {
+                if (rids[i].slot_number == Page::INVALID_SLOT)
                 {
-                    std::cout << "unpin error: 330\n";
+                    setPostingCount(leafPage, posting++, counts[i]);
                 }
-                findPlace(keyInt, nextRoot, nextRootPageId, index, leafHolder, leafHolderPageId);
             }
         }
     }
 
-    bool BTreeIndex::easyInsert(int keyInt, RecordId rid, NonLeafNodeInt *root, int index, NonLeafNodeInt *leafHolder)
+    unsigned char *BTreeIndex::postingCountEnd(Page *leafPage)
     {
-        // try to insert
-        PageId leafPageId = leafHolder->pageNoArray[index];
-        Page *leafPage;
-        bufMgr->readPage(file, leafPageId, leafPage);
-        LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt *>(leafPage);
-        if (leaf->keyArray[INTARRAYLEAFSIZE - 1] != INT_MAX)
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
         {
-            bufMgr->unPinPage(file, leafPageId, true);
-            return false;
+            return reinterpret_cast<CompressedLeafNodeInt *>(leafPage)->data + COMPRESSEDLEAFDATASIZE;
         }
-        int leaf_index = findInsertIndex(keyInt, leaf);
-        insertHelper(true, leaf_index, keyInt, rid, leafHolder, leaf);
-        bufMgr->unPinPage(file, leafPageId, true);
-        return true;
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            return reinterpret_cast<unsigned char *>(coveringRids(leafPage, leafOccupancy) + leafOccupancy);
+        }
+        return reinterpret_cast<unsigned char *>(reinterpret_cast<LeafNodeInt *>(leafPage)->ridArray + INTARRAYLEAFSIZE);
     }
 
-    // -----------------------------------------------------------------------------
-    // BTreeIndex::BTreeIndex -- Constructor
-    // -----------------------------------------------------------------------------
+    int BTreeIndex::postingCount(Page *leafPage, int posting)
+    {
+        int count;
+        memcpy(&count, postingCountEnd(leafPage) - (posting + 1) * sizeof(int), sizeof(int));
+        return count;
+    }
 
-    BTreeIndex::BTreeIndex(const std::string &relationName,
-                           std::string &outIndexName,
+    void BTreeIndex::setPostingCount(Page *leafPage, int posting, int count)
+    {
+        memcpy(postingCountEnd(leafPage) - (posting + 1) * sizeof(int), &count, sizeof(int));
+    }
+
+    int BTreeIndex::countPostingSlots(const RecordId *rids, int count)
+    {
+        int postingSlots = 0;
+        for (int i = 0; i < count; i++)
+        {
+            postingSlots += rids[i].slot_number == Page::INVALID_SLOT;
+        }
+        return postingSlots;
+    }
+
+    bool BTreeIndex::leafFits(int count, int postingSlots, int minKey, int maxKey, double fillFactor)
+    {
+        int countBytes = (indexOptions & INDEX_SUBTREE_COUNTS) ? postingSlots * sizeof(int) : 0;
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            // 8 spare bytes let unpackKey read a whole word past the last key
+            int keyBits = bitsNeeded((std::uint32_t)((std::int64_t)maxKey - minKey));
+            return count <= COMPRESSEDLEAFMAXSIZE * fillFactor &&
+                   packedKeyBytes(count, keyBits) + count * PACKEDRIDSIZE + countBytes + 8 <= COMPRESSEDLEAFDATASIZE * fillFactor;
+        }
+        // plain and covering leaves hold a fixed number of entries, less the rid slots the lengths take
+        int countSlots = (countBytes + sizeof(RecordId) - 1) / sizeof(RecordId);
+        return count + countSlots <= leafOccupancy * fillFactor;
+    }
+
+    int BTreeIndex::nonLeafKeyCount(Page *nonLeafPage)
+    {
+        // children are filled from the left and the rest are 0, key i is in use if child i + 1 is
+        PageId *pageNos = nonLeafPageNos(nonLeafPage);
+        int low = 0;
+        int high = nodeOccupancy;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (pageNos[mid + 1] == Page::INVALID_NUMBER)
+            {
+                high = mid;
+            }
+            else
+            {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+
+    int BTreeIndex::findKeyIndexArr(int keyInt, int *arr, int count, bool inclusive)
+    {
+        int low = 0;
+        int high = count;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            int curKey = arr[mid];
+            if (curKey < keyInt || (!inclusive && curKey == keyInt))
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    int BTreeIndex::findKeyIndex(int keyInt, Page *leafPage, int count, bool inclusive)
+    {
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            return findKeyIndexArr(keyInt, coveringKeys(leafPage), count, inclusive);
+        }
+        if (!(indexOptions & INDEX_COMPRESSED_LEAVES))
+        {
+            return findKeyIndexArr(keyInt, reinterpret_cast<LeafNodeInt *>(leafPage)->keyArray, count, inclusive);
+        }
+
+        // search the packed offsets directly
+        CompressedLeafNodeInt *leaf = reinterpret_cast<CompressedLeafNodeInt *>(leafPage);
+        return findPackedIndex(keyInt, leaf->data, leaf->baseKey, leaf->keyBits, count, inclusive);
+    }
+
+    int BTreeIndex::findInsertIndex(int keyInt, RecordId rid, int *arr, RecordId *arrR, int count)
+    {
+        RIDKeyPair<int> newPair;
+        newPair.set(rid, keyInt);
+
+        // first entry the new pair sorts before, so duplicates stay ordered by rid
+        int low = 0;
+        int high = count;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            RIDKeyPair<int> curPair;
+            curPair.set(arrR[mid], arr[mid]);
+            if (newPair < curPair)
+            {
+                high = mid;
+            }
+            else
+            {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+
+    int BTreeIndex::findChildIndex(int keyInt, Page *curPage)
+    {
+        // keyArray[i] is the smallest key under pageNoArray[i + 1], so take the number of keys <= keyInt
+        int *keys = nonLeafKeys(curPage);
+        int low = 0;
+        int high = nonLeafKeyCount(curPage);
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (keys[mid] <= keyInt)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    void BTreeIndex::insertHelper(int index, int count, int keyInt, RecordId rid, int *arr, RecordId *arrR)
+    {
+        for (int i = count; i > index; i--)
+        {
+            arr[i] = arr[i - 1];
+            arrR[i] = arrR[i - 1];
+        }
+        arr[index] = keyInt;
+        arrR[index] = rid;
+    }
+
+    void BTreeIndex::NonLeafNodeInsertHelper(int index, int keyInt, PageId pageNo, int pageCount, Page *nonLeafPage)
+    {
+        int *keys = nonLeafKeys(nonLeafPage);
+        PageId *pageNos = nonLeafPageNos(nonLeafPage);
+        int *counts = nonLeafCounts(nonLeafPage);
+        int count = nonLeafKeyCount(nonLeafPage);
+        for (int i = count; i > index; i--)
+        {
+            keys[i] = keys[i - 1];
+            pageNos[i + 1] = pageNos[i];
+            if (counts != NULL)
+            {
+                counts[i + 1] = counts[i];
+            }
+        }
+        keys[index] = keyInt;
+        pageNos[index + 1] = pageNo;
+        if (counts != NULL)
+        {
+            // the new page was split off its left neighbour
+            counts[index] -= pageCount;
+            counts[index + 1] = pageCount;
+        }
+    }
+
+    void BTreeIndex::initalizeNonLeafNode(NonLeafNodeInt *nonLeafNode)
+    {
+        for (int i = 0; i < INTARRAYNONLEAFSIZE + 1; i++)
+        {
+            if (i < INTARRAYNONLEAFSIZE)
+            {
+                nonLeafNode->keyArray[i] = INT_MAX; // pre fill values
+            }
+            nonLeafNode->pageNoArray[i] = 0; // pre fill values
+        }
+        nonLeafNode->isLeaf = false;
+    }
+
+    void BTreeIndex::initalizeNonLeafPage(Page *nonLeafPage, int level)
+    {
+        if (indexOptions & INDEX_SUBTREE_COUNTS)
+        {
+            CountedNonLeafNodeInt *node = reinterpret_cast<CountedNonLeafNodeInt *>(nonLeafPage);
+            for (int i = 0; i < INTARRAYCOUNTEDNONLEAFSIZE + 1; i++)
+            {
+                if (i < INTARRAYCOUNTEDNONLEAFSIZE)
+                {
+                    node->keyArray[i] = INT_MAX; // pre fill values
+                }
+                node->pageNoArray[i] = 0;
+                node->countArray[i] = 0;
+            }
+            node->isLeaf = false;
+            node->level = level;
+            return;
+        }
+        NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt *>(nonLeafPage);
+        initalizeNonLeafNode(node);
+        node->level = level;
+    }
+
+    int &BTreeIndex::nonLeafLevel(Page *nonLeafPage)
+    {
+        if (indexOptions & INDEX_SUBTREE_COUNTS)
+        {
+            return reinterpret_cast<CountedNonLeafNodeInt *>(nonLeafPage)->level;
+        }
+        return reinterpret_cast<NonLeafNodeInt *>(nonLeafPage)->level;
+    }
+
+    int *BTreeIndex::nonLeafKeys(Page *nonLeafPage)
+    {
+        if (indexOptions & INDEX_SUBTREE_COUNTS)
+        {
+            return reinterpret_cast<CountedNonLeafNodeInt *>(nonLeafPage)->keyArray;
+        }
+        return reinterpret_cast<NonLeafNodeInt *>(nonLeafPage)->keyArray;
+    }
+
+    PageId *BTreeIndex::nonLeafPageNos(Page *nonLeafPage)
+    {
+        if (indexOptions & INDEX_SUBTREE_COUNTS)
+        {
+            return reinterpret_cast<CountedNonLeafNodeInt *>(nonLeafPage)->pageNoArray;
+        }
+        return reinterpret_cast<NonLeafNodeInt *>(nonLeafPage)->pageNoArray;
+    }
+
+    int *BTreeIndex::nonLeafCounts(Page *nonLeafPage)
+    {
+        if (indexOptions & INDEX_SUBTREE_COUNTS)
+        {
+            return reinterpret_cast<CountedNonLeafNodeInt *>(nonLeafPage)->countArray;
+        }
+        return NULL;
+    }
+
+    void BTreeIndex::initalizeLeafNode(LeafNodeInt *leafNode)
+    {
+        leafNode->numEntries = 0;
+        leafNode->rightSibPageNo = 0;
+        leafNode->leftSibPageNo = 0;
+        leafNode->isLeaf = true;
+    }
+
+    void BTreeIndex::initalizeLeafPage(Page *leafPage)
+    {
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            CompressedLeafNodeInt *leaf = reinterpret_cast<CompressedLeafNodeInt *>(leafPage);
+            leaf->numEntries = 0;
+            leaf->baseKey = 0;
+            leaf->keyBits = 0;
+            leaf->rightSibPageNo = 0;
+            leaf->leftSibPageNo = 0;
+            leaf->isLeaf = true;
+            return;
+        }
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            CoveringLeafNodeInt *leaf = reinterpret_cast<CoveringLeafNodeInt *>(leafPage);
+            leaf->numEntries = 0;
+            leaf->rightSibPageNo = 0;
+            leaf->leftSibPageNo = 0;
+            leaf->isLeaf = true;
+            return;
+        }
+        initalizeLeafNode(reinterpret_cast<LeafNodeInt *>(leafPage));
+    }
+
+    bool BTreeIndex::insertRecursive(int keyInt, RecordId rid, const char *included, PageId pageNo, bool isLeaf, PageKeyPair<int> &newChild)
+    {
+        if (isLeaf)
+        {
+            bool split = insertIntoLeaf(keyInt, rid, included, pageNo, newChild);
+            if (reorganizeState != NULL)
+            {
+                noteReorganizeInsert(pageNo, split ? newChild.pageNo : Page::INVALID_NUMBER, keyInt, rid);
+            }
+            return split;
+        }
+
+        // find the child to descend into, unpin while below
+        Page *curPage;
+        bufMgr->readPage(file, pageNo, curPage);
+        int index = findChildIndex(keyInt, curPage);
+        PageId childPageNo = nonLeafPageNos(curPage)[index];
+        bool childIsLeaf = nonLeafLevel(curPage) == 1;
+        int *counts = nonLeafCounts(curPage);
+        if (counts != NULL)
+        {
+            // the entry ends up under this child whether or not it splits
+            counts[index]++;
+        }
+        bufMgr->unPinPage(file, pageNo, counts != NULL);
+
+        PageKeyPair<int> pushedUp;
+        if (!insertRecursive(keyInt, rid, included, childPageNo, childIsLeaf, pushedUp))
+        {
+            return false;
+        }
+        int pushedUpCount = (indexOptions & INDEX_SUBTREE_COUNTS) ? subtreeCount(pushedUp.pageNo, childIsLeaf) : 0;
+
+        // child split, add the new child to this node
+        bufMgr->readPage(file, pageNo, curPage);
+        if (nonLeafKeyCount(curPage) < nodeOccupancy)
+        {
+            NonLeafNodeInsertHelper(index, pushedUp.key, pushedUp.pageNo, pushedUpCount, curPage);
+            bufMgr->unPinPage(file, pageNo, true);
+            return false;
+        }
+        splitNonLeaf(curPage, index, pushedUp, pushedUpCount, newChild);
+        bufMgr->unPinPage(file, pageNo, true);
+        return true;
+    }
+
+    bool BTreeIndex::insertIntoLeaf(int keyInt, RecordId rid, const char *included, PageId leafPageNo, PageKeyPair<int> &newChild)
+    {
+        Page *leafPage;
+        bufMgr->readPage(file, leafPageNo, leafPage);
+
+        // plain leaves are changed in place, compressed and covering leaves and those keeping posting list
+        // lengths are decoded and written again
+        int decodedKeys[COMPRESSEDLEAFMAXSIZE + 1];
+        RecordId decodedRids[COMPRESSEDLEAFMAXSIZE + 1];
+        char decodedIncluded[COVERINGLEAFDATASIZE + MAXINCLUDEDSIZE];
+        int decodedCounts[COMPRESSEDLEAFMAXSIZE + 1];
+        int *keys = decodedKeys;
+        RecordId *rids = decodedRids;
+        char *includedArr = (indexOptions & INDEX_INCLUDED_COLUMNS) ? decodedIncluded : NULL;
+        int *counts = (indexOptions & INDEX_SUBTREE_COUNTS) ? decodedCounts : NULL;
+        int count;
+        if (indexOptions & (INDEX_COMPRESSED_LEAVES | INDEX_INCLUDED_COLUMNS | INDEX_SUBTREE_COUNTS))
+        {
+            count = decodeLeaf(leafPage, keys, rids, includedArr, counts);
+        }
+        else
+        {
+            LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt *>(leafPage);
+            keys = leaf->keyArray;
+            rids = leaf->ridArray;
+            count = leafEntryCount(leafPage);
+        }
+
+        // run of entries already holding this key
+        int runStart = findKeyIndexArr(keyInt, keys, count, true);
+        int runEnd = findKeyIndexArr(keyInt, keys, count, false);
+
+        // key already has a posting list, leaf does not change but for the length it may keep
+        if (runEnd - runStart == 1 && rids[runStart].slot_number == Page::INVALID_SLOT)
+        {
+            insertIntoPostingList(rids[runStart].page_number, rid);
+            if (counts != NULL)
+            {
+                setPostingCount(leafPage, countPostingSlots(rids, runStart), counts[runStart] + 1);
+            }
+            bufMgr->unPinPage(file, leafPageNo, counts != NULL);
+            return false;
+        }
+
+        // too many duplicates to keep inline, collapse the run into one posting list entry
+        if (runEnd - runStart >= postingThreshold)
+        {
+            int runLength = runEnd - runStart;
+            int runKeys[POSTINGTHRESHOLD + 1];
+            RecordId runRids[POSTINGTHRESHOLD + 1];
+            for (int i = 0; i < runLength; i++)
+            {
+                runKeys[i] = keyInt;
+                runRids[i] = rids[runStart + i];
+            }
+            int runIndex = findInsertIndex(keyInt, rid, keys, rids, runEnd) - runStart;
+            insertHelper(runIndex, runLength, keyInt, rid, runKeys, runRids);
+
+            RecordId postingRid;
+            postingRid.page_number = createPostingList(runRids, runLength + 1);
+            postingRid.slot_number = Page::INVALID_SLOT;
+            postingRid.padding = 0;
+            rids[runStart] = postingRid;
+
+            // close the gap left by the run
+            int removed = runLength - 1;
+            for (int i = runEnd; i < count; i++)
+            {
+                keys[i - removed] = keys[i];
+                rids[i - removed] = rids[i];
+            }
+            if (counts != NULL)
+            {
+                counts[runStart] = runLength + 1;
+                memmove(counts + runStart + 1, counts + runEnd, (count - runEnd) * sizeof(int));
+            }
+            if (includedArr != NULL)
+            {
+                // rids in a posting list read their fields from the relation
+                memset(includedArr + runStart * includedSize, 0, includedSize);
+                memmove(includedArr + (runStart + 1) * includedSize, includedArr + runEnd * includedSize, (count - runEnd) * includedSize);
+            }
+            writeLeaf(leafPage, keys, rids, count - removed, includedArr, counts);
+            bufMgr->unPinPage(file, leafPageNo, true);
+            return false;
+        }
+
+        int minKey = count > 0 && keys[0] < keyInt ? keys[0] : keyInt;
+        int maxKey = count > 0 && keys[count - 1] > keyInt ? keys[count - 1] : keyInt;
+        int postingSlots = counts != NULL ? countPostingSlots(rids, count) : 0;
+        if (leafFits(count + 1, postingSlots, minKey, maxKey))
+        {
+            int index = findInsertIndex(keyInt, rid, keys, rids, count);
+            insertHelper(index, count, keyInt, rid, keys, rids);
+            if (includedArr != NULL)
+            {
+                insertFixed(includedArr, index, count, included, includedSize);
+            }
+            if (counts != NULL)
+            {
+                int one = 1;
+                insertFixed(reinterpret_cast<char *>(counts), index, count, reinterpret_cast<const char *>(&one), sizeof(int));
+            }
+            writeLeaf(leafPage, keys, rids, count + 1, includedArr, counts);
+            bufMgr->unPinPage(file, leafPageNo, true);
+            return false;
+        }
+
+        splitLeaf(keyInt, rid, included, leafPageNo, leafPage, keys, rids, includedArr, counts, count, newChild);
+        bufMgr->unPinPage(file, leafPageNo, true);
+        return true;
+    }
+
+    void BTreeIndex::splitLeaf(int keyInt, RecordId rid, const char *included, PageId leafPageNo, Page *leafPage, int *keys, RecordId *rids,
+                               char *includedArr, int *counts, int count, PageKeyPair<int> &newChild)
+    {
+        int temp[COMPRESSEDLEAFMAXSIZE + 1];
+        RecordId tempR[COMPRESSEDLEAFMAXSIZE + 1];
+        for (int i = 0; i < count; i++)
+        {
+            temp[i] = keys[i];
+            tempR[i] = rids[i];
+        }
+        int index = findInsertIndex(keyInt, rid, keys, rids, count);
+        insertHelper(index, count, keyInt, rid, temp, tempR);
+        if (includedArr != NULL)
+        {
+            // decoded by insertIntoLeaf, so it has room for the new entry
+            insertFixed(includedArr, index, count, included, includedSize);
+        }
+        if (counts != NULL)
+        {
+            int one = 1;
+            insertFixed(reinterpret_cast<char *>(counts), index, count, reinterpret_cast<const char *>(&one), sizeof(int));
+        }
+        int total = count + 1;
+
+        // move the split point to a run boundary so a key never spans two leaves.
+        // runs are shorter than postingThreshold, so one of the two directions always works
+        int mid = total / 2;
+        if (temp[mid] == temp[mid - 1])
+        {
+            int runStart = mid;
+            while (runStart > 0 && temp[runStart - 1] == temp[mid])
+            {
+                runStart--;
+            }
+            if (runStart > 0)
+            {
+                mid = runStart;
+            }
+            else
+            {
+                while (mid < total && temp[mid] == temp[mid - 1])
+                {
+                    mid++;
+                }
+            }
+        }
+
+        // create new leaf
+        Page *newLeafPage;
+        PageId newLeafPageId;
+        allocNodePage(newLeafPageId, newLeafPage);
+        initalizeLeafPage(newLeafPage);
+
+        // set new leaf and subtract from old leaf
+        writeLeaf(newLeafPage, temp + mid, tempR + mid, total - mid, includedArr != NULL ? includedArr + mid * includedSize : NULL,
+                  counts != NULL ? counts + mid : NULL);
+        writeLeaf(leafPage, temp, tempR, mid, includedArr, counts);
+
+        linkSplitLeaf(leafPageNo, leafPage, newLeafPageId, newLeafPage);
+        bufMgr->unPinPage(file, newLeafPageId, true);
+
+        newChild.set(newLeafPageId, temp[mid]);
+    }
+
+    void BTreeIndex::splitNonLeaf(Page *nodePage, int index, PageKeyPair<int> &pushedUp, int pushedUpCount, PageKeyPair<int> &newChild)
+    {
+        int *keys = nonLeafKeys(nodePage);
+        PageId *pageNos = nonLeafPageNos(nodePage);
+        int *counts = nonLeafCounts(nodePage);
+        int count = nonLeafKeyCount(nodePage);
+        int temp[INTARRAYNONLEAFSIZE + 1];
+        PageId tempP[INTARRAYNONLEAFSIZE + 2];
+        int tempC[INTARRAYNONLEAFSIZE + 2];
+        for (int i = 0; i <= count; i++)
+        {
+            if (i < count)
+            {
+                temp[i] = keys[i];
+            }
+            tempP[i] = pageNos[i];
+            tempC[i] = counts != NULL ? counts[i] : 0;
+        }
+        for (int i = count; i > index; i--)
+        {
+            temp[i] = temp[i - 1];
+            tempP[i + 1] = tempP[i];
+            tempC[i + 1] = tempC[i];
+        }
+        temp[index] = pushedUp.key;
+        tempP[index + 1] = pushedUp.pageNo;
+        tempC[index] -= pushedUpCount;
+        tempC[index + 1] = pushedUpCount;
+        int total = count + 1;
+
+        // middle key moves up, keys right of it go to the new node
+        int mid = total / 2;
+
+        Page *newPage;
+        PageId newPageNo;
+        allocNodePage(newPageNo, newPage);
+        initalizeNonLeafPage(newPage, nonLeafLevel(nodePage));
+        int *newKeys = nonLeafKeys(newPage);
+        PageId *newPageNos = nonLeafPageNos(newPage);
+        int *newCounts = nonLeafCounts(newPage);
+        for (int i = mid + 1; i <= total; i++)
+        {
+            if (i < total)
+            {
+                newKeys[i - mid - 1] = temp[i];
+            }
+            newPageNos[i - mid - 1] = tempP[i];
+            if (newCounts != NULL)
+            {
+                newCounts[i - mid - 1] = tempC[i];
+            }
+        }
+
+        for (int i = 0; i < nodeOccupancy; i++)
+        {
+            keys[i] = i < mid ? temp[i] : INT_MAX;
+            pageNos[i + 1] = i < mid ? tempP[i + 1] : 0;
+            if (counts != NULL)
+            {
+                counts[i + 1] = i < mid ? tempC[i + 1] : 0;
+            }
+        }
+        pageNos[0] = tempP[0];
+        if (counts != NULL)
+        {
+            counts[0] = tempC[0];
+        }
+        bufMgr->unPinPage(file, newPageNo, true);
+
+        newChild.set(newPageNo, temp[mid]);
+    }
+
+    PageId BTreeIndex::createPostingList(RecordId *rids, int count, bool reuse)
+    {
+        Page *headPage;
+        PageId headPageNo;
+        if (reuse)
+        {
+            allocNodePage(headPageNo, headPage);
+        }
+        else
+        {
+            bufMgr->allocPage(file, headPageNo, headPage);
+            numPages++;
+        }
+        PostingNodeInt *head = reinterpret_cast<PostingNodeInt *>(headPage);
+
+        int done = encodePostingPage(head, rids, count);
+        head->nextPageNo = 0;
+        head->tailPageNo = headPageNo;
+        head->totalRids = count;
+
+        // chain more pages if the rids do not fit in one
+        PostingNodeInt *prev = head;
+        PageId prevPageNo = headPageNo;
+        while (done < count)
+        {
+            Page *curPage;
+            PageId curPageNo;
+            if (reuse)
+            {
+                allocNodePage(curPageNo, curPage);
+            }
+            else
+            {
+                bufMgr->allocPage(file, curPageNo, curPage);
+                numPages++;
+            }
+            PostingNodeInt *cur = reinterpret_cast<PostingNodeInt *>(curPage);
+
+            done += encodePostingPage(cur, rids + done, count - done);
+            cur->nextPageNo = 0;
+            cur->tailPageNo = 0;
+            cur->totalRids = 0;
+            prev->nextPageNo = curPageNo;
+            head->tailPageNo = curPageNo;
+            if (prev != head)
+            {
+                bufMgr->unPinPage(file, prevPageNo, true);
+            }
+            prev = cur;
+            prevPageNo = curPageNo;
+        }
+        if (prev != head)
+        {
+            bufMgr->unPinPage(file, prevPageNo, true);
+        }
+        bufMgr->unPinPage(file, headPageNo, true);
+        return headPageNo;
+    }
+
+    int BTreeIndex::encodePostingPage(PostingNodeInt *node, RecordId *rids, int count)
+    {
+        node->firstRid = rids[0];
+        node->lastRid = rids[0];
+        node->numRids = 1;
+        node->dataLength = 0;
+        std::uint64_t prev = ridOrdinal(rids[0]);
+        for (int i = 1; i < count; i++)
+        {
+            std::uint64_t cur = ridOrdinal(rids[i]);
+            if (node->dataLength + varintLength(cur - prev) > POSTINGDATASIZE)
+            {
+                break;
+            }
+            node->dataLength += putVarint(node->data + node->dataLength, cur - prev);
+            node->lastRid = rids[i];
+            node->numRids++;
+            prev = cur;
+        }
+        return node->numRids;
+    }
+
+    void BTreeIndex::decodePostingPage(PostingNodeInt *node, RecordId *out)
+    {
+        out[0] = node->firstRid;
+        std::uint64_t prev = ridOrdinal(node->firstRid);
+        int offset = 0;
+        for (int i = 1; i < node->numRids; i++)
+        {
+            prev += getVarint(node->data, offset);
+            out[i] = ridFromOrdinal(prev);
+        }
+    }
+
+    void BTreeIndex::insertIntoPostingList(PageId headPageNo, RecordId rid)
+    {
+        Page *headPage;
+        bufMgr->readPage(file, headPageNo, headPage);
+        PostingNodeInt *head = reinterpret_cast<PostingNodeInt *>(headPage);
+        head->totalRids++;
+
+        // common case, rids arrive in heap order and are appended to the tail
+        PageId tailPageNo = head->tailPageNo;
+        PostingNodeInt *tail = head;
+        if (tailPageNo != headPageNo)
+        {
+            Page *tailPage;
+            bufMgr->readPage(file, tailPageNo, tailPage);
+            tail = reinterpret_cast<PostingNodeInt *>(tailPage);
+        }
+        std::uint64_t ordinal = ridOrdinal(rid);
+        std::uint64_t tailOrdinal = ridOrdinal(tail->lastRid);
+        if (ordinal > tailOrdinal)
+        {
+            if (tail->dataLength + varintLength(ordinal - tailOrdinal) <= POSTINGDATASIZE)
+            {
+                tail->dataLength += putVarint(tail->data + tail->dataLength, ordinal - tailOrdinal);
+                tail->lastRid = rid;
+                tail->numRids++;
+            }
+            else
+            {
+                Page *newPage;
+                PageId newPageNo;
+                allocNodePage(newPageNo, newPage);
+                PostingNodeInt *newNode = reinterpret_cast<PostingNodeInt *>(newPage);
+                encodePostingPage(newNode, &rid, 1);
+                newNode->nextPageNo = 0;
+                newNode->tailPageNo = 0;
+                newNode->totalRids = 0;
+                tail->nextPageNo = newPageNo;
+                head->tailPageNo = newPageNo;
+                bufMgr->unPinPage(file, newPageNo, true);
+            }
+            if (tail != head)
+            {
+                bufMgr->unPinPage(file, tailPageNo, true);
+            }
+            bufMgr->unPinPage(file, headPageNo, true);
+            return;
+        }
+        if (tail != head)
+        {
+            bufMgr->unPinPage(file, tailPageNo, false);
+        }
+
+        // otherwise walk to the first page whose last rid is not smaller
+        PostingNodeInt *cur = head;
+        PageId curPageNo = headPageNo;
+        while (ordinal > ridOrdinal(cur->lastRid) && cur->nextPageNo != 0)
+        {
+            PageId nextPageNo = cur->nextPageNo;
+            if (cur != head)
+            {
+                bufMgr->unPinPage(file, curPageNo, false);
+            }
+            Page *nextPage;
+            bufMgr->readPage(file, nextPageNo, nextPage);
+            cur = reinterpret_cast<PostingNodeInt *>(nextPage);
+            curPageNo = nextPageNo;
+        }
+
+        // decode the page, insert in order and encode it again
+        std::vector<RecordId> rids(cur->numRids + 1);
+        decodePostingPage(cur, &rids[0]);
+        int count = cur->numRids;
+        int index = count;
+        while (index > 0 && ridOrdinal(rids[index - 1]) > ordinal)
+        {
+            rids[index] = rids[index - 1];
+            index--;
+        }
+        rids[index] = rid;
+        count++;
+
+        int done = encodePostingPage(cur, &rids[0], count);
+        if (done < count)
+        {
+            // page overflowed, the rest goes into a new page right after it
+            Page *newPage;
+            PageId newPageNo;
+            allocNodePage(newPageNo, newPage);
+            PostingNodeInt *newNode = reinterpret_cast<PostingNodeInt *>(newPage);
+            encodePostingPage(newNode, &rids[done], count - done);
+            newNode->nextPageNo = cur->nextPageNo;
+            newNode->tailPageNo = 0;
+            newNode->totalRids = 0;
+            cur->nextPageNo = newPageNo;
+            if (head->tailPageNo == curPageNo)
+            {
+                head->tailPageNo = newPageNo;
+            }
+            bufMgr->unPinPage(file, newPageNo, true);
+        }
+        if (cur != head)
+        {
+            bufMgr->unPinPage(file, curPageNo, true);
+        }
+        bufMgr->unPinPage(file, headPageNo, true);
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::BTreeIndex -- Constructor
+    // -----------------------------------------------------------------------------
+
+    BTreeIndex::BTreeIndex(const std::string &relationName,
+                           std::string &outIndexName,
                            BufMgr *bufMgrIn,
                            const int attrByteOffset,
-                           const Datatype attrType)
+                           const Datatype attrType,
+                           const int indexOptions,
+                           const int buildThreads,
+                           const std::vector<ScanField> &includedColumns)
     {
         // create name of this index
-        std::ostringstream idxStr;
-        idxStr << relationName << '.' << attrByteOffset;
-        std::string indexName = idxStr.str();
+        std::string indexName = indexFileName(relationName, attrByteOffset);
 
         // return indexName
         outIndexName = indexName;
 
+        // no scan yet
+        initalizeScanState();
+
         try
         {
-            // BlobFile indexFile = BlobFile::open(indexName);
-            // file = &indexFile;
             file = new BlobFile(indexName, false);
-            handleAlreadyPresent(indexName, bufMgrIn, relationName, attrByteOffset, attrType);
+            handleAlreadyPresent(indexName, bufMgrIn, relationName, attrByteOffset, attrType, std::vector<KeyComponent>());
             return;
         }
         catch (FileNotFoundException &e)
@@ -438,349 +1597,1130 @@ namespace badgerdb
         }
 
         // create actual Btree file in disc
-        file = new BlobFile(indexName, true);
+        checkIncludedColumns(attrType, indexOptions, includedColumns);
+        file = new BlobFile(indexName, true, (indexOptions & INDEX_COMPRESSED_PAGES) != 0);
 
         // set up new file
-        handleNew(indexName, bufMgrIn, relationName, attrByteOffset, attrType);
+        handleNew(indexName, bufMgrIn, relationName, attrByteOffset, attrType, indexOptions, includedColumns, std::vector<KeyComponent>());
+
+        // create BTree
+        buildIndex(relationName, buildThreads);
+    }
+
+    BTreeIndex::BTreeIndex(const std::string &relationName,
+                           std::string &outIndexName,
+                           BufMgr *bufMgrIn,
+                           const std::vector<KeyComponent> &keyComponents,
+                           const int buildThreads)
+    {
+        checkKeyComponents(keyComponents);
+        std::string indexName = indexFileName(relationName, keyComponents);
+        outIndexName = indexName;
+        initalizeScanState();
+
+        // encoded keys are compared as STRING keys
+        try
+        {
+            file = new BlobFile(indexName, false);
+            handleAlreadyPresent(indexName, bufMgrIn, relationName, keyComponents[0].attrByteOffset, STRING, keyComponents);
+            return;
+        }
+        catch (FileNotFoundException &e)
+        {
+        }
+        file = new BlobFile(indexName, true);
+        handleNew(indexName, bufMgrIn, relationName, keyComponents[0].attrByteOffset, STRING, INDEX_DEFAULT, std::vector<ScanField>(), keyComponents);
+        buildIndex(relationName, buildThreads);
+    }
+
+    BTreeIndex::BTreeIndex(const std::string &relationName,
+                           BufMgr *bufMgrIn,
+                           const IndexSpec &spec,
+                           std::vector<RIDKeyPair<int> > &intEntries,
+                           std::vector<RIDKeyPair<std::string> > &stringEntries)
+    {
+        bool composite = !spec.keyComponents.empty();
+        std::string indexName = composite ? indexFileName(relationName, spec.keyComponents) : indexFileName(relationName, spec.attrByteOffset);
+        initalizeScanState();
+        checkIncludedColumns(composite ? STRING : spec.attrType, spec.indexOptions, spec.includedColumns);
+        file = new BlobFile(indexName, true, (spec.indexOptions & INDEX_COMPRESSED_PAGES) != 0);
+        handleNew(indexName, bufMgrIn, relationName, composite ? spec.keyComponents[0].attrByteOffset : spec.attrByteOffset,
+                  composite ? STRING : spec.attrType, spec.indexOptions, spec.includedColumns, spec.keyComponents);
+        loadEntries(intEntries, stringEntries);
+    }
+
+    std::string BTreeIndex::indexFileName(const std::string &relationName, int attrByteOffset)
+    {
+        std::ostringstream idxStr;
+        idxStr << relationName << '.' << attrByteOffset;
+        return idxStr.str();
+    }
+
+    std::string BTreeIndex::indexFileName(const std::string &relationName, const std::vector<KeyComponent> &components)
+    {
+        std::ostringstream idxStr;
+        idxStr << relationName;
+        for (size_t c = 0; c < components.size(); c++)
+        {
+            idxStr << '.' << components[c].attrByteOffset;
+        }
+        return idxStr.str();
+    }
+
+    void BTreeIndex::initalizeScanState()
+    {
+        scanExecuting = false;
+        currentPageNum = Page::INVALID_NUMBER;
+        currentPageData = NULL;
+        postingPageNum = Page::INVALID_NUMBER;
+        postingPageData = NULL;
+        scanOrder = ASCENDING;
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::~BTreeIndex -- destructor
+    // -----------------------------------------------------------------------------
+
+    BTreeIndex::~BTreeIndex()
+    {
+
+        if (scanExecuting)
+        {
+            endScan();
+        }
+        bufMgr->flushFile(file);
+        delete file;
+        if (relationFile != NULL)
+        {
+            bufMgr->flushFile(relationFile);
+            delete relationFile;
+        }
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::insertEntry
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::insertEntry(const void *key, const RecordId rid)
+    {
+        // reorganize() pauses inserts before it takes the log mutex, so a paused insert must not hold it
+        enterInsert();
+        std::unique_lock<std::mutex> logGuard(logMutex, std::defer_lock);
+        if (bufMgr->isLogged())
+        {
+            logGuard.lock();
+        }
+        bufMgr->beginTransaction();
+        try
+        {
+            applyInsert(key, rid);
+        }
+        catch (...)
+        {
+            bufMgr->abortTransaction();
+            if (logGuard.owns_lock())
+            {
+                logGuard.unlock();
+            }
+            leaveInsert();
+            throw;
+        }
+
+        // the next insert may change the same pages once these changes are in the log buffer, and
+        // its commit can then share the sync with this one
+        LogSeqNum commitLSN = bufMgr->commitTransaction(false);
+        if (logGuard.owns_lock())
+        {
+            logGuard.unlock();
+        }
+        leaveInsert();
+        bufMgr->waitForLog(commitLSN);
+    }
+
+    void BTreeIndex::applyInsert(const void *key, const RecordId rid)
+    {
+        if (indexOptions & INDEX_COMPOSITE_KEY)
+        {
+            const std::string &encoded = static_cast<const CompositeKey *>(key)->bytes();
+            if ((int)encoded.size() != compositeKeyLength)
+            {
+                throw BadIndexInfoException("composite key must have every component");
+            }
+            insertEntryString(encoded.data(), encoded.size(), rid);
+            return;
+        }
+        if (attributeType == STRING)
+        {
+            insertEntryString((const char *)key, strnlen((const char *)key, STRINGKEYSIZE), rid);
+            return;
+        }
+
+        int keyInt = *((int *)key);
+        int oldNumPages = numPages;
+        PageId oldRootPageNo = rootPageNum;
+
+        // included fields are read off the record before any latch is taken
+        char includedBuf[MAXINCLUDEDSIZE];
+        const char *included = NULL;
+        if (relationFile != NULL)
+        {
+            fetchIncluded(rid, includedBuf);
+            included = includedBuf;
+        }
+
+        // latch only the leaf, and the path when the leaf splits. Counts change on every level, so
+        // counted indexes always latch the path
+        bool latchPath = (indexOptions & INDEX_SUBTREE_COUNTS) != 0;
+        while (true)
+        {
+            if (!latchPath && insertOptimistic(keyInt, rid, included, latchPath))
+            {
+                break;
+            }
+            if (latchPath && insertPessimistic(keyInt, rid, included))
+            {
+                break;
+            }
+        }
+
+        // a root split may take a free page, which leaves the page count as it was
+        if (numPages != oldNumPages || rootPageNum != oldRootPageNo)
+        {
+            updateMetaInfo();
+        }
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::insertEntry Helper
+    // -----------------------------------------------------------------------------
+
+    PageId BTreeIndex::growRoot(PageId oldRootPageNo, PageKeyPair<int> &newChild)
+    {
+        Page *newRootPage;
+        PageId newRootPageNo;
+        allocNodePage(newRootPageNo, newRootPage);
+        initalizeNonLeafPage(newRootPage, 0);
+        nonLeafPageNos(newRootPage)[0] = oldRootPageNo;
+        nonLeafKeys(newRootPage)[0] = newChild.key;
+        nonLeafPageNos(newRootPage)[1] = newChild.pageNo;
+        int *counts = nonLeafCounts(newRootPage);
+        if (counts != NULL)
+        {
+            counts[0] = subtreeCount(oldRootPageNo, false);
+            counts[1] = subtreeCount(newChild.pageNo, false);
+        }
+        bufMgr->unPinPage(file, newRootPageNo, true);
+        return newRootPageNo;
+    }
+
+    bool BTreeIndex::descendOptimistic(int keyInt, PageId &leafPageNo, Page *&leafPage, std::uint64_t &leafVersion)
+    {
+        PageId curPageNo = rootPageNum;
+        Page *curPage;
+        bufMgr->readPage(file, curPageNo, curPage);
+        VersionLatch *curLatch = &bufMgr->pageLatch(curPage);
+        std::uint64_t curVersion = curLatch->readLock();
+        if (curPageNo != rootPageNum)
+        {
+            bufMgr->unPinPage(file, curPageNo, false);
+            return false;
+        }
+
+        while (true)
+        {
+            PageId childPageNo = nonLeafPageNos(curPage)[findChildIndex(keyInt, curPage)];
+            bool childIsLeaf = nonLeafLevel(curPage) == 1;
+            if (!curLatch->validate(curVersion))
+            {
+                bufMgr->unPinPage(file, curPageNo, false);
+                return false;
+            }
+            if (childPageNo == Page::INVALID_NUMBER)
+            {
+                // only an empty root has no child
+                bufMgr->unPinPage(file, curPageNo, false);
+                leafPageNo = Page::INVALID_NUMBER;
+                leafPage = NULL;
+                return true;
+            }
+
+            Page *childPage;
+            bufMgr->readPage(file, childPageNo, childPage);
+            VersionLatch *childLatch = &bufMgr->pageLatch(childPage);
+            std::uint64_t childVersion = childLatch->readLock();
+
+            // parent unchanged since the child was chosen, so the child is still the right one
+            bool valid = curLatch->validate(curVersion);
+            bufMgr->unPinPage(file, curPageNo, false);
+            if (!valid)
+            {
+                bufMgr->unPinPage(file, childPageNo, false);
+                return false;
+            }
+            curPageNo = childPageNo;
+            curPage = childPage;
+            curLatch = childLatch;
+            curVersion = childVersion;
+            if (childIsLeaf)
+            {
+                leafPageNo = curPageNo;
+                leafPage = curPage;
+                leafVersion = curVersion;
+                return true;
+            }
+        }
+    }
+
+    bool BTreeIndex::insertOptimistic(int keyInt, RecordId rid, const char *included, bool &needsSplit)
+    {
+        PageId leafPageNo;
+        Page *leafPage;
+        std::uint64_t leafVersion;
+        if (!descendOptimistic(keyInt, leafPageNo, leafPage, leafVersion))
+        {
+            return false;
+        }
+        if (leafPage == NULL)
+        {
+            // the first leaf hangs off the root, which needs its latch
+            needsSplit = true;
+            return false;
+        }
+
+        VersionLatch &leafLatch = bufMgr->pageLatch(leafPage);
+        if (!leafLatch.tryUpgrade(leafVersion))
+        {
+            bufMgr->unPinPage(file, leafPageNo, false);
+            return false;
+        }
+        if (leafInsertSplits(leafPage, keyInt))
+        {
+            leafLatch.unlock();
+            bufMgr->unPinPage(file, leafPageNo, false);
+            needsSplit = true;
+            return false;
+        }
+        PageKeyPair<int> newChild;
+        insertIntoLeaf(keyInt, rid, included, leafPageNo, newChild);
+        if (reorganizeState != NULL)
+        {
+            noteReorganizeInsert(leafPageNo, Page::INVALID_NUMBER, keyInt, rid);
+        }
+        leafLatch.unlock();
+        bufMgr->unPinPage(file, leafPageNo, false);
+        return true;
+    }
+
+    bool BTreeIndex::insertPessimistic(int keyInt, RecordId rid, const char *included)
+    {
+        // latches are taken top down and left to right, so writers never wait on each other in a cycle
+        std::vector<PageId> latchedPageNos;
+        std::vector<Page *> latchedPages;
+        PageId rootPageNo = rootPageNum;
+        Page *rootPage;
+        bufMgr->readPage(file, rootPageNo, rootPage);
+        bufMgr->pageLatch(rootPage).lock();
+        if (rootPageNo != rootPageNum)
+        {
+            // root split while waiting for its latch
+            bufMgr->pageLatch(rootPage).unlock();
+            bufMgr->unPinPage(file, rootPageNo, false);
+            return false;
+        }
+
+        // check if this is the first entry, if so, need to create roots first child manually
+        if (nonLeafPageNos(rootPage)[0] == Page::INVALID_NUMBER)
+        {
+            createFirstChild(keyInt, rid, included, rootPage);
+            bufMgr->pageLatch(rootPage).unlock();
+            bufMgr->unPinPage(file, rootPageNo, true);
+            return true;
+        }
+        latchedPageNos.push_back(rootPageNo);
+        latchedPages.push_back(rootPage);
+
+        Page *curPage = rootPage;
+        bool isLeaf = false;
+        while (!isLeaf)
+        {
+            PageId childPageNo = nonLeafPageNos(curPage)[findChildIndex(keyInt, curPage)];
+            isLeaf = nonLeafLevel(curPage) == 1;
+            Page *childPage;
+            bufMgr->readPage(file, childPageNo, childPage);
+            bufMgr->pageLatch(childPage).lock();
+            if (!isLeaf && nonLeafCounts(childPage) == NULL && nonLeafKeyCount(childPage) < nodeOccupancy)
+            {
+                // child takes a split from below without splitting itself, nothing above it changes
+                releaseLatches(latchedPageNos, latchedPages, latchedPages.size());
+            }
+            latchedPageNos.push_back(childPageNo);
+            latchedPages.push_back(childPage);
+            curPage = childPage;
+        }
+
+        // a leaf split relinks the leaf to its right
+        PageId rightSibPageNo = leafRightSib(curPage);
+        if (rightSibPageNo != Page::INVALID_NUMBER)
+        {
+            Page *rightSibPage;
+            bufMgr->readPage(file, rightSibPageNo, rightSibPage);
+            bufMgr->pageLatch(rightSibPage).lock();
+            latchedPageNos.push_back(rightSibPageNo);
+            latchedPages.push_back(rightSibPage);
+        }
+
+        // everything from the top latched node down is latched, insert as if single threaded
+        PageKeyPair<int> newChild;
+        if (insertRecursive(keyInt, rid, included, latchedPageNos[0], false, newChild))
+        {
+            // only the root is kept latched while it can split. Walks that read the old root number
+            // fail validation on the old root and start over
+            rootPageNum = growRoot(rootPageNo, newChild);
+        }
+        releaseLatches(latchedPageNos, latchedPages, latchedPages.size());
+        return true;
+    }
+
+    void BTreeIndex::releaseLatches(std::vector<PageId> &pageNos, std::vector<Page *> &pages, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            bufMgr->pageLatch(pages[i]).unlock();
+            bufMgr->unPinPage(file, pageNos[i], false);
+        }
+        pageNos.erase(pageNos.begin(), pageNos.begin() + count);
+        pages.erase(pages.begin(), pages.begin() + count);
+    }
+
+    bool BTreeIndex::leafInsertSplits(Page *leafPage, int keyInt)
+    {
+        int count = leafEntryCount(leafPage);
+        int runStart = findKeyIndex(keyInt, leafPage, count, true);
+        int runEnd = findKeyIndex(keyInt, leafPage, count, false);
+
+        // joining an existing posting list or collapsing a run into one never grows the leaf
+        if (runEnd - runStart == 1 && leafRid(leafPage, runStart).slot_number == Page::INVALID_SLOT)
+        {
+            return false;
+        }
+        if (runEnd - runStart >= postingThreshold)
+        {
+            return false;
+        }
+
+        int postingSlots = 0;
+        if (indexOptions & INDEX_SUBTREE_COUNTS)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                postingSlots += leafRid(leafPage, i).slot_number == Page::INVALID_SLOT;
+            }
+        }
+        int minKey = count > 0 && leafKey(leafPage, 0) < keyInt ? leafKey(leafPage, 0) : keyInt;
+        int maxKey = count > 0 && leafKey(leafPage, count - 1) > keyInt ? leafKey(leafPage, count - 1) : keyInt;
+        return !leafFits(count + 1, postingSlots, minKey, maxKey);
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::lookup
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::lookup(const void *key, std::vector<RecordId> &outRids)
+    {
+        if (attributeType != INTEGER)
+        {
+            throw BadIndexInfoException("lookup is only supported on INTEGER indexes");
+        }
+        int keyInt = *((const int *)key);
+        ReadGuard readGuard(*this);
+        while (!lookupOptimistic(keyInt, outRids))
+        {
+        }
+    }
+
+    bool BTreeIndex::lookupOptimistic(int keyInt, std::vector<RecordId> &outRids)
+    {
+        outRids.clear();
+        PageId leafPageNo;
+        Page *leafPage;
+        std::uint64_t leafVersion;
+        if (!descendOptimistic(keyInt, leafPageNo, leafPage, leafVersion))
+        {
+            return false;
+        }
+        if (leafPage == NULL)
+        {
+            return true;
+        }
+
+        VersionLatch &leafLatch = bufMgr->pageLatch(leafPage);
+        bool consistent;
+        try
+        {
+            unlatchedLeafRun(keyInt, leafPage, outRids);
+            consistent = leafLatch.validate(leafVersion);
+
+            // a key with a posting list has no other slot in the leaf
+            if (consistent && outRids.size() == 1 && outRids[0].slot_number == Page::INVALID_SLOT)
+            {
+                PageId postingPageNo = outRids[0].page_number;
+                outRids.clear();
+                while (consistent && postingPageNo != 0)
+                {
+                    Page *postingPage;
+                    bufMgr->readPage(file, postingPageNo, postingPage);
+                    PageId nextPageNo;
+                    try
+                    {
+                        PostingNodeInt *node = reinterpret_cast<PostingNodeInt *>(postingPage);
+                        unlatchedPostingPage(node, outRids);
+                        nextPageNo = reinterpret_cast<volatile PostingNodeInt *>(node)->nextPageNo;
+                    }
+                    catch (...)
+                    {
+                        bufMgr->unPinPage(file, postingPageNo, false);
+                        throw;
+                    }
+                    bufMgr->unPinPage(file, postingPageNo, false);
+
+                    // posting lists only change under the leaf latch, so an unchanged leaf vouches for the rids
+                    consistent = leafLatch.validate(leafVersion);
+                    postingPageNo = nextPageNo;
+                }
+            }
+        }
+        catch (...)
+        {
+            bufMgr->unPinPage(file, leafPageNo, false);
+            throw;
+        }
+        bufMgr->unPinPage(file, leafPageNo, false);
+        return consistent;
+    }
+
+    void BTreeIndex::unlatchedLeafRun(int keyInt, Page *leafPage, std::vector<RecordId> &outRids)
+    {
+        // header fields are read once and clamped, so entries are only looked for inside the page
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            volatile CompressedLeafNodeInt *header = reinterpret_cast<volatile CompressedLeafNodeInt *>(leafPage);
+            int count = header->numEntries;
+            int baseKey = header->baseKey;
+            int keyBits = std::max(0, std::min((int)header->keyBits, 32));
+
+            // as leafFits keeps it, room for the packed entries and the word unpackKey reads past the last key
+            int maxCount = std::min(COMPRESSEDLEAFMAXSIZE, (COMPRESSEDLEAFDATASIZE - 9) * 8 / (keyBits + 8 * PACKEDRIDSIZE));
+            while (maxCount < COMPRESSEDLEAFMAXSIZE &&
+                   packedKeyBytes(maxCount + 1, keyBits) + (maxCount + 1) * PACKEDRIDSIZE + 8 <= COMPRESSEDLEAFDATASIZE)
+            {
+                maxCount++;
+            }
+            count = std::max(0, std::min(count, maxCount));
+
+            const unsigned char *data = reinterpret_cast<CompressedLeafNodeInt *>(leafPage)->data;
+            int runStart = findPackedIndex(keyInt, data, baseKey, keyBits, count, true);
+            // the two searches may see different keys, so the run is kept from running backwards
+            int runEnd = std::max(runStart, findPackedIndex(keyInt, data, baseKey, keyBits, count, false));
+            int ridStart = packedKeyBytes(count, keyBits);
+            for (int i = runStart; i < runEnd; i++)
+            {
+                outRids.push_back(unpackRid(data + ridStart + i * PACKEDRIDSIZE));
+            }
+            return;
+        }
+
+        int count;
+        int *keys;
+        RecordId *rids;
+        if (indexOptions & INDEX_INCLUDED_COLUMNS)
+        {
+            count = reinterpret_cast<volatile CoveringLeafNodeInt *>(leafPage)->numEntries;
+            keys = coveringKeys(leafPage);
+            rids = coveringRids(leafPage, leafOccupancy);
+        }
+        else
+        {
+            count = reinterpret_cast<volatile LeafNodeInt *>(leafPage)->numEntries;
+            keys = reinterpret_cast<LeafNodeInt *>(leafPage)->keyArray;
+            rids = reinterpret_cast<LeafNodeInt *>(leafPage)->ridArray;
+        }
+        count = std::max(0, std::min(count, leafOccupancy));
+        int runStart = findKeyIndexArr(keyInt, keys, count, true);
+        // the two searches may see different keys, so the run is kept from running backwards
+        int runEnd = std::max(runStart, findKeyIndexArr(keyInt, keys, count, false));
+        outRids.insert(outRids.end(), rids + runStart, rids + runEnd);
+    }
+
+    void BTreeIndex::unlatchedPostingPage(PostingNodeInt *node, std::vector<RecordId> &outRids)
+    {
+        // every delta takes a byte at least, and none is read past the bytes in use
+        volatile PostingNodeInt *header = node;
+        int dataLength = std::max(0, std::min((int)header->dataLength, POSTINGDATASIZE));
+        int numRids = std::max(1, std::min((int)header->numRids, dataLength + 1));
+        RecordId firstRid = node->firstRid;
+        outRids.push_back(firstRid);
+        std::uint64_t prev = ridOrdinal(firstRid);
+        int offset = 0;
+        for (int i = 1; i < numRids && offset < dataLength; i++)
+        {
+            std::uint64_t delta = 0;
+            int shift = 0;
+            unsigned char byte;
+            do
+            {
+                byte = node->data[offset++];
+                if (shift < 64)
+                {
+                    delta |= (std::uint64_t)(byte & 0x7F) << shift;
+                }
+                shift += 7;
+            } while ((byte & 0x80) && offset < dataLength);
+            prev += delta;
+            outRids.push_back(ridFromOrdinal(prev));
+        }
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::startScan Helper
+    // -----------------------------------------------------------------------------
 
-        // create BTree
-        FileScan fs = FileScan(relationName, bufMgrIn);
+    PageId BTreeIndex::locateLeaf(int keyInt)
+    {
+        PageId curPageNum = rootPageNum;
         while (true)
         {
-            RecordId rid;
-            try
-            {
-                fs.scanNext(rid);
-                std::string recordStr = fs.getRecord();
-                insertEntry(&recordStr.c_str()[0] + attrByteOffset, rid);
-            }
-            catch (EndOfFileException &e)
+            Page *curPage;
+            bufMgr->readPage(file, curPageNum, curPage);
+            PageId childPageNum = nonLeafPageNos(curPage)[findChildIndex(keyInt, curPage)];
+            bool childIsLeaf = nonLeafLevel(curPage) == 1;
+            bufMgr->unPinPage(file, curPageNum, false);
+
+            if (childIsLeaf || childPageNum == Page::INVALID_NUMBER)
             {
-                break;
+                return childPageNum;
             }
+            curPageNum = childPageNum;
         }
     }
 
-    // -----------------------------------------------------------------------------
-    // BTreeIndex::~BTreeIndex -- destructor
-    // -----------------------------------------------------------------------------
+    bool BTreeIndex::pastHighBound(Page *leafPage, int index)
+    {
+        if (attributeType == STRING)
+        {
+            int result = compareStringKey(reinterpret_cast<SlottedNodeString *>(leafPage), index,
+                                          highValString.data(), highValString.size());
+            return (highOp == LT && result >= 0) || (highOp == LTE && result > 0);
+        }
+        int key = leafKey(leafPage, index);
+        return (highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt);
+    }
 
-    BTreeIndex::~BTreeIndex()
+    bool BTreeIndex::pastLowBound(Page *leafPage, int index)
     {
+        if (attributeType == STRING)
+        {
+            int result = compareStringKey(reinterpret_cast<SlottedNodeString *>(leafPage), index,
+                                          lowValString.data(), lowValString.size());
+            return (lowOp == GT && result <= 0) || (lowOp == GTE && result < 0);
+        }
+        int key = leafKey(leafPage, index);
+        return (lowOp == GT && key <= lowValInt) || (lowOp == GTE && key < lowValInt);
+    }
 
-        if (scanExecuting)
+    void BTreeIndex::endPostingScan()
+    {
+        if (postingPageNum != Page::INVALID_NUMBER)
         {
-            endScan();
+            bufMgr->unPinPage(file, postingPageNum, false);
+            postingPageNum = Page::INVALID_NUMBER;
+            postingPageData = NULL;
         }
-        // somehow close file scan
-        bufMgr->flushFile(file);
-        // somehow delete file object
-        delete file;
     }
 
     // -----------------------------------------------------------------------------
-    // BTreeIndex::insertEntry
+    // BTreeIndex::startScan
     // -----------------------------------------------------------------------------
 
-    void BTreeIndex::insertEntry(const void *key, const RecordId rid)
+    void BTreeIndex::startScan(const void *lowValParm,
+                               const Operator lowOpParm,
+                               const void *highValParm,
+                               const Operator highOpParm,
+                               const ScanOrder order)
     {
-        int keyInt = *((int *)key);
-
-        // get root page
-        Page *rootPage;
-        bufMgr->readPage(file, rootPageNum, rootPage);
-        NonLeafNodeInt *root = reinterpret_cast<NonLeafNodeInt *>(rootPage);
-
-        // check if this is the first entry, if so, need to create roots first child manually
-        if (root->pageNoArray[0] == 0)
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE))
         {
-            createFirstChild(keyInt, rid, root);
-            return;
+            throw BadOpcodesException();
         }
-
-        // check if more than one child page exists
-        if (numPages == 3)
+        if (attributeType == STRING)
         {
-            bool keyInserted = insertInFirstPage(keyInt, rid, root);
-            if (keyInserted)
+            if (indexOptions & INDEX_COMPOSITE_KEY)
             {
-                return;
+                // a GT bound skips, and an LTE bound takes in, every key starting with it
+                compositeBound(*((const CompositeKey *)lowValParm), lowOpParm == GT, lowValString);
+                compositeBound(*((const CompositeKey *)highValParm), highOpParm == LTE, highValString);
+            }
+            else
+            {
+                lowValString.assign((const char *)lowValParm, strnlen((const char *)lowValParm, STRINGKEYSIZE));
+                highValString.assign((const char *)highValParm, strnlen((const char *)highValParm, STRINGKEYSIZE));
+            }
+            if (lowValString > highValString)
+            {
+                throw BadScanrangeException();
             }
         }
-
-        // needs to be set to force first insertion into full child
-        if (numPages == 3)
+        else if (*((int *)lowValParm) > *((int *)highValParm))
         {
-            root->keyArray[0] = INT_MAX;
+            throw BadScanrangeException();
         }
-
-        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        // regular insert logic from here
-        ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-        // search and detrmine if there is space
-        int index;                  // to be filled in by reference
-        NonLeafNodeInt *leafHolder; // to be filled in by reference
-        PageId leafHolderPageId;    // to be filled in by reference
-
-        // find PageId index and leafHolder Page
-        findPlace(keyInt, root, rootPageNum, index, leafHolder, leafHolderPageId);
-        // if leafHolder is not root, then root was unpinned
-        if (leafHolderPageId != rootPageNum)
+        if (scanExecuting == true)
+        {
+            endScan();
+        }
+        lowOp = lowOpParm;
+        highOp = highOpParm;
+        scanOrder = order;
+        if (attributeType != STRING)
         {
-            Page *rrootPage;
-            bufMgr->readPage(file, rootPageNum, rrootPage);
-            root = reinterpret_cast<NonLeafNodeInt *>(rootPage);
+            lowValInt = *((int *)lowValParm);
+            highValInt = *((int *)highValParm);
         }
 
-        // try to insert keyInt and rid. If it works without splits, we done
-        if (easyInsert(keyInt, rid, root, index, leafHolder))
+        // an ascending scan starts at the low bound, a descending one at the high bound
+        bool ascending = scanOrder == ASCENDING;
+        int epoch = enterRead();
+        try
+        {
+            locateScanStart(ascending);
+        }
+        catch (...)
         {
+            leaveRead(epoch);
+            throw;
+        }
+        scanReadEpoch = epoch;
+        scanExecuting = true;
+    }
 
-            Page *firstChildPage;
-            bufMgr->readPage(file, root->pageNoArray[0], firstChildPage);
-            LeafNodeInt *firstChild = reinterpret_cast<LeafNodeInt *>(firstChildPage);
-            bufMgr->unPinPage(file, root->pageNoArray[0], false);
+    void BTreeIndex::locateScanStart(bool ascending)
+    {
+        if (attributeType == STRING)
+        {
+            const std::string &bound = ascending ? lowValString : highValString;
+            currentPageNum = locateStringLeaf(bound.data(), bound.size(), !ascending);
+        }
+        else
+        {
+            currentPageNum = locateLeaf(ascending ? lowValInt : highValInt);
+        }
+        if (currentPageNum == Page::INVALID_NUMBER)
+        {
+            throw NoSuchKeyFoundException();
+        }
+        bufMgr->readPage(file, currentPageNum, currentPageData);
 
-            try
+        // find the first key satisfying the starting bound, it may be in a sibling
+        while (true)
+        {
+            currentEntryCount = leafEntryCount(currentPageData);
+            // ascending: first entry not below the low bound, descending: one before the first entry above the high bound
+            bool inclusive = ascending ? lowOp == GTE : highOp == LT;
+            if (attributeType == STRING)
+            {
+                const std::string &boundString = ascending ? lowValString : highValString;
+                nextEntry = findStringIndex(boundString.data(), boundString.size(),
+                                            reinterpret_cast<SlottedNodeString *>(currentPageData), inclusive);
+            }
+            else
+            {
+                nextEntry = findKeyIndex(ascending ? lowValInt : highValInt, currentPageData, currentEntryCount, inclusive);
+            }
+            if (!ascending)
+            {
+                nextEntry--;
+            }
+            if (nextEntry >= 0 && nextEntry < currentEntryCount)
             {
-                bufMgr->unPinPage(file, leafHolderPageId, false);
+                break;
             }
-            catch (PageNotPinnedException &e)
+            PageId sibPageNum = ascending ? leafRightSib(currentPageData) : leafLeftSib(currentPageData);
+            bufMgr->unPinPage(file, currentPageNum, false);
+            if (sibPageNum == Page::INVALID_NUMBER)
             {
-                std::cout << "unpin error: 477\n";
+                throw NoSuchKeyFoundException();
             }
-            if (rootPageNum != leafHolderPageId)
+            currentPageNum = sibPageNum;
+            bufMgr->readPage(file, currentPageNum, currentPageData);
+        }
+
+        if (ascending ? pastHighBound(currentPageData, nextEntry) : pastLowBound(currentPageData, nextEntry))
+        {
+            bufMgr->unPinPage(file, currentPageNum, false);
+            throw NoSuchKeyFoundException();
+        }
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::scanNext
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::scanNext(RecordId &outRid)
+    {
+        if (!scanExecuting)
+        {
+            throw ScanNotInitializedException();
+        }
+
+        bool ascending = scanOrder == ASCENDING;
+        int step = ascending ? 1 : -1;
+        while (true)
+        {
+            // inside a posting list, return its rids before moving on in the leaf
+            if (postingPageNum != Page::INVALID_NUMBER)
             {
-                try
+                PostingNodeInt *posting = reinterpret_cast<PostingNodeInt *>(postingPageData);
+                if (postingEntry < posting->numRids)
+                {
+                    if (postingEntry == 0)
+                    {
+                        postingRid = posting->firstRid;
+                    }
+                    else
+                    {
+                        postingRid = ridFromOrdinal(ridOrdinal(postingRid) + getVarint(posting->data, postingOffset));
+                    }
+                    postingEntry++;
+                    outRid = postingRid;
+                    return;
+                }
+                PageId nextPostingPageNum = posting->nextPageNo;
+                endPostingScan();
+                if (nextPostingPageNum != Page::INVALID_NUMBER)
                 {
-                    bufMgr->unPinPage(file, rootPageNum, false);
+                    postingPageNum = nextPostingPageNum;
+                    bufMgr->readPage(file, postingPageNum, postingPageData);
+                    postingEntry = 0;
+                    postingOffset = 0;
+                    continue;
                 }
-                catch (PageNotPinnedException &e)
+                nextEntry += step;
+            }
+
+            if (nextEntry < 0 || nextEntry >= currentEntryCount)
+            {
+                // current leaf done, move on to the next sibling in scan order
+                PageId sibPageNum = ascending ? leafRightSib(currentPageData) : leafLeftSib(currentPageData);
+                if (sibPageNum == Page::INVALID_NUMBER)
                 {
-                    std::cout << "unpin error: 478\n";
+                    throw IndexScanCompletedException();
                 }
+                bufMgr->unPinPage(file, currentPageNum, false);
+                currentPageNum = sibPageNum;
+                bufMgr->readPage(file, currentPageNum, currentPageData);
+                currentEntryCount = leafEntryCount(currentPageData);
+                nextEntry = ascending ? 0 : currentEntryCount - 1;
+                continue;
+            }
+
+            if (ascending ? pastHighBound(currentPageData, nextEntry) : pastLowBound(currentPageData, nextEntry))
+            {
+                throw IndexScanCompletedException();
             }
 
+            RecordId rid = leafRid(currentPageData, nextEntry);
+            if (rid.slot_number == Page::INVALID_SLOT)
+            {
+                // entry refers to the posting list of a duplicated key
+                postingPageNum = rid.page_number;
+                bufMgr->readPage(file, postingPageNum, postingPageData);
+                postingEntry = 0;
+                postingOffset = 0;
+                continue;
+            }
+            outRid = rid;
+            nextEntry += step;
             return;
         }
+    }
 
-        // leaf is full, must split
-
-        // Whoops, looks like a nonleafnode split coming up, I can't handle this
-        if (leafHolder->keyArray[INTARRAYNONLEAFSIZE - 1] != INT_MAX)
+    void BTreeIndex::scanNext(RecordId &outRid, void *outIncluded)
+    {
+        if (!(indexOptions & INDEX_INCLUDED_COLUMNS))
+        {
+            throw BadIndexInfoException("index has no included columns");
+        }
+        scanNext(outRid);
+        if (postingPageNum != Page::INVALID_NUMBER)
         {
-            std::cout << "Nonleaf node split X(\n";
-            exit(1);
+            fetchIncluded(outRid, (char *)outIncluded);
         }
+        else
+        {
+            // scanNext already stepped past the entry it returned
+            int index = nextEntry - (scanOrder == ASCENDING ? 1 : -1);
+            memcpy(outIncluded, leafIncluded(currentPageData, index), includedSize);
+        }
+    }
 
-        // get old leaf
-        Page *oldLeafPage;
-        bufMgr->readPage(file, leafHolder->pageNoArray[index], oldLeafPage);
-        LeafNodeInt *oldLeaf = reinterpret_cast<LeafNodeInt *>(oldLeafPage);
-        PageId oldLeafSib = oldLeaf->rightSibPageNo;
+    int BTreeIndex::includedColumnsSize()
+    {
+        return includedSize;
+    }
 
-        // create new leaf
-        Page *newLeafPage;
-        PageId newLeafPageId;
-        bufMgr->allocPage(file, newLeafPageId, newLeafPage);
-        LeafNodeInt *newLeaf = reinterpret_cast<LeafNodeInt *>(newLeafPage);
-        initalizeLeafNode(newLeaf);
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::endScan
+    // -----------------------------------------------------------------------------
+    //
+    void BTreeIndex::endScan()
+    {
 
-        int temp[INTARRAYLEAFSIZE + 1];
-        RecordId tempR[INTARRAYLEAFSIZE + 1];
-        for (int i = 0; i < INTARRAYLEAFSIZE; i++)
-        {
-            temp[i] = oldLeaf->keyArray[i];
-            tempR[i] = oldLeaf->ridArray[i];
+        if (!scanExecuting)
+        {                                        // check if scanexe is fale
+            throw ScanNotInitializedException(); // is false throw exception
         }
-        temp[INTARRAYLEAFSIZE] = INT_MAX;
 
-        int indexIntoOldLeaf = findInsertIndexArr(keyInt, temp);
-        insertHelperArr(indexIntoOldLeaf, keyInt, temp, tempR, rid);
+        endPostingScan();
+        bufMgr->unPinPage(file, currentPageNum, false);
+        scanExecuting = false;
+        currentPageData = NULL;
+        currentPageNum = Page::INVALID_NUMBER;
+        leaveRead(scanReadEpoch);
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::countRange and order statistics
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::requireSubtreeCounts()
+    {
+        if (attributeType != INTEGER || !(indexOptions & INDEX_SUBTREE_COUNTS))
+        {
+            throw BadIndexInfoException("index was not created with INDEX_SUBTREE_COUNTS");
+        }
+    }
 
-        int counter = 0;
-        // set new leaf
-        for (int i = INTARRAYLEAFSIZE / 2; i < INTARRAYLEAFSIZE + 1; i++)
+    int BTreeIndex::slotEntryCount(Page *leafPage, int index, int &posting)
+    {
+        if (leafRid(leafPage, index).slot_number != Page::INVALID_SLOT)
         {
-            newLeaf->keyArray[counter] = temp[i];
-            newLeaf->ridArray[counter] = tempR[i];
-            counter++;
+            return 1;
         }
-        // subtract from old leaf
-        for (int i = 0; i < INTARRAYLEAFSIZE; i++)
+        return postingCount(leafPage, posting++);
+    }
+
+    int BTreeIndex::subtreeCount(PageId pageNo, bool isLeaf)
+    {
+        Page *page;
+        bufMgr->readPage(file, pageNo, page);
+        int total = 0;
+        if (isLeaf)
         {
-            if (i < INTARRAYLEAFSIZE / 2)
+            int count = leafEntryCount(page);
+            int posting = 0;
+            for (int i = 0; i < count; i++)
             {
-                oldLeaf->keyArray[i] = temp[i];
-                oldLeaf->ridArray[i] = tempR[i];
+                total += slotEntryCount(page, i, posting);
             }
-            else
+        }
+        else
+        {
+            int *counts = nonLeafCounts(page);
+            int keyCount = nonLeafKeyCount(page);
+            for (int i = 0; i <= keyCount; i++)
             {
-                oldLeaf->keyArray[i] = INT_MAX;
+                total += counts[i];
             }
         }
+        bufMgr->unPinPage(file, pageNo, false);
+        return total;
+    }
 
-        // perform split
-        newLeaf->rightSibPageNo = oldLeafSib;
-        oldLeaf->rightSibPageNo = newLeafPageId;
-        NonLeafNodeInsertHelper(index, newLeaf->keyArray[0], newLeafPageId, leafHolder);
-
-        try
+    int BTreeIndex::rankOf(int keyInt, bool inclusive)
+    {
+        // every child left of the one holding keyInt only has smaller keys
+        int rank = 0;
+        PageId curPageNum = rootPageNum;
+        bool isLeaf = false;
+        while (true)
         {
-            bufMgr->unPinPage(file, rootPageNum, true);
-            bufMgr->unPinPage(file, leafHolder->pageNoArray[index], true);
-            if (leafHolderPageId != rootPageNum)
+            Page *curPage;
+            bufMgr->readPage(file, curPageNum, curPage);
+            if (isLeaf)
             {
-                bufMgr->unPinPage(file, leafHolderPageId, true);
+                int index = findKeyIndex(keyInt, curPage, leafEntryCount(curPage), !inclusive);
+                int posting = 0;
+                for (int i = 0; i < index; i++)
+                {
+                    rank += slotEntryCount(curPage, i, posting);
+                }
+                bufMgr->unPinPage(file, curPageNum, false);
+                return rank;
             }
-            bufMgr->unPinPage(file, newLeafPageId, true);
-        }
-        catch (PageNotPinnedException &e)
-        {
+
+            int childIndex = findChildIndex(keyInt, curPage);
+            int *counts = nonLeafCounts(curPage);
+            for (int i = 0; i < childIndex; i++)
+            {
+                rank += counts[i];
+            }
+            PageId childPageNum = nonLeafPageNos(curPage)[childIndex];
+            isLeaf = nonLeafLevel(curPage) == 1;
+            bufMgr->unPinPage(file, curPageNum, false);
+            if (childPageNum == Page::INVALID_NUMBER)
+            {
+                return rank;
+            }
+            curPageNum = childPageNum;
         }
-        numPages++;
     }
-    // -----------------------------------------------------------------------------
-    // BTreeIndex::startScan Helper
-    // -----------------------------------------------------------------------------
-    void BTreeIndex::locatePage(PageId currPageNumber)
-    {
-        Page *currPage;
-        bufMgr->readPage(file, currPageNumber, currPage);
 
-        NonLeafNodeInt *nleafNode = (NonLeafNodeInt *)(currPage);
+    RecordId BTreeIndex::postingRidAt(PageId headPageNo, int position)
+    {
+        PageId curPageNo = headPageNo;
+        Page *curPage;
+        bufMgr->readPage(file, curPageNo, curPage);
+        PostingNodeInt *cur = reinterpret_cast<PostingNodeInt *>(curPage);
+        while (position >= cur->numRids)
+        {
+            position -= cur->numRids;
+            PageId nextPageNo = cur->nextPageNo;
+            bufMgr->unPinPage(file, curPageNo, false);
+            curPageNo = nextPageNo;
+            bufMgr->readPage(file, curPageNo, curPage);
+            cur = reinterpret_cast<PostingNodeInt *>(curPage);
+        }
 
-        if (nleafNode->isLeaf)
+        RecordId rid = cur->firstRid;
+        int offset = 0;
+        for (int i = 0; i < position; i++)
         {
-            currentPageNum = currPageNumber;
-            bufMgr->unPinPage(file, currPageNumber, false);
-            return;
+            rid = ridFromOrdinal(ridOrdinal(rid) + getVarint(cur->data, offset));
         }
+        bufMgr->unPinPage(file, curPageNo, false);
+        return rid;
+    }
 
-        for (size_t i = 0; i < INTARRAYNONLEAFSIZE; i++)
+    int BTreeIndex::entryCount()
+    {
+        requireSubtreeCounts();
+        ReadGuard readGuard(*this);
+        Page *rootPage;
+        bufMgr->readPage(file, rootPageNum, rootPage);
+        int *counts = nonLeafCounts(rootPage);
+        int keyCount = nonLeafKeyCount(rootPage);
+        int total = 0;
+        for (int i = 0; i <= keyCount; i++)
         {
-            if (i == INTARRAYNONLEAFSIZE || nleafNode->pageNoArray[i + 1] == Page::INVALID_NUMBER || nleafNode->keyArray[i] >= lowValInt)
-            {
-                if (nleafNode->level == 1)
-                {
-                    currentPageNum = nleafNode->pageNoArray[i];
-                    bufMgr->unPinPage(file, currPageNumber, false);
-                    return;
-                }
-                else
-                {
-                    locatePage(nleafNode->pageNoArray[i]);
-                    bufMgr->unPinPage(file, currPageNumber, false);
-                    return;
-                }
-            }
+            total += counts[i];
         }
+        bufMgr->unPinPage(file, rootPageNum, false);
+        return total;
     }
-    // -----------------------------------------------------------------------------
-    // BTreeIndex::startScan
-    // -----------------------------------------------------------------------------
 
-    void BTreeIndex::startScan(const void *lowValParm,
+    int BTreeIndex::countRange(const void *lowValParm,
                                const Operator lowOpParm,
                                const void *highValParm,
                                const Operator highOpParm)
     {
-        lowValInt = *((int *)lowValParm);
-        highValInt = *((int *)highValParm);
-        if ((lowOpParm == LT || lowOpParm == LTE) || (highOpParm == GT || highOpParm == GTE))
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE))
         {
             throw BadOpcodesException();
         }
-        lowOp = lowOpParm;
-        highOp = highOpParm;
-
-        if (lowValInt > highValInt)
+        requireSubtreeCounts();
+        int lowInt = *((int *)lowValParm);
+        int highInt = *((int *)highValParm);
+        if (lowInt > highInt)
         {
             throw BadScanrangeException();
         }
-        if (scanExecuting == true)
-        {
-            endScan();
-        }
-
-        locatePage(rootPageNum);
-        bufMgr->readPage(file, currentPageNum, currentPageData);
-        LeafNodeInt *node = (LeafNodeInt *)(currentPageData);
-        for (size_t i = 0; i < INTARRAYLEAFSIZE; i++)
-        {
 
-            if (((lowOp == GTE && highOp == LTE) && (node->keyArray[i] <= highValInt && node->keyArray[i] >= lowValInt)) || ((lowOp == GTE && highOp == LT) && (node->keyArray[i] < highValInt && node->keyArray[i] >= lowValInt)) || ((lowOp == GT && highOp == LTE) && (node->keyArray[i] <= highValInt && node->keyArray[i] > lowValInt)) || ((lowOp == GT && highOp == LT) && (node->keyArray[i] < highValInt && node->keyArray[i] > lowValInt)))
-            {
-                bufMgr->unPinPage(file, currentPageNum, false);
-                nextEntry = i;
-                scanExecuting = true;
-                return;
-            }
-        }
-        bufMgr->unPinPage(file, currentPageNum, false);
-        throw NoSuchKeyFoundException();
+        ReadGuard readGuard(*this);
+        int count = rankOf(highInt, highOpParm == LTE) - rankOf(lowInt, lowOpParm == GT);
+        return count > 0 ? count : 0; // (k, k) is empty
     }
 
-    // -----------------------------------------------------------------------------
-    // BTreeIndex::scanNext
-    // -----------------------------------------------------------------------------
+    int BTreeIndex::rank(const void *key)
+    {
+        requireSubtreeCounts();
+        ReadGuard readGuard(*this);
+        return rankOf(*((int *)key), false);
+    }
 
-    void BTreeIndex::scanNext(RecordId &outRid)
+    void BTreeIndex::select(int position, void *outKey, RecordId &outRid)
     {
-        if (scanExecuting)
+        requireSubtreeCounts();
+        if (position < 0)
         {
-            LeafNodeInt *node = (LeafNodeInt *)(currentPageData);
-
-            if (node->keyArray[nextEntry] == INT_MAX)
-            {
-                nextEntry = INTARRAYLEAFSIZE - 1;
-            }
+            throw NoSuchKeyFoundException();
+        }
 
-            if (nextEntry == INTARRAYLEAFSIZE - 1)
+        ReadGuard readGuard(*this);
+        PageId curPageNum = rootPageNum;
+        bool isLeaf = false;
+        while (true)
+        {
+            Page *curPage;
+            bufMgr->readPage(file, curPageNum, curPage);
+            if (isLeaf)
             {
-                if (node->rightSibPageNo != Page::INVALID_NUMBER)
-                {
-                    bufMgr->readPage(file, node->rightSibPageNo, currentPageData);
-                    currentPageNum = node->rightSibPageNo;
-                    bufMgr->unPinPage(file, currentPageNum, false);
-
-                    nextEntry = 0;
-                }
-                else
+                int count = leafEntryCount(curPage);
+                int posting = 0;
+                for (int i = 0; i < count; i++)
                 {
-                    throw IndexScanCompletedException();
+                    RecordId rid = leafRid(curPage, i);
+                    int entries = slotEntryCount(curPage, i, posting);
+                    if (position < entries)
+                    {
+                        *((int *)outKey) = leafKey(curPage, i);
+                        outRid = rid.slot_number == Page::INVALID_SLOT ? postingRidAt(rid.page_number, position) : rid;
+                        bufMgr->unPinPage(file, curPageNum, false);
+                        return;
+                    }
+                    position -= entries;
                 }
+                bufMgr->unPinPage(file, curPageNum, false);
+                throw NoSuchKeyFoundException();
             }
-            if (((highOp == LTE && (node->keyArray[nextEntry] <= highValInt))) || (highOp == LT && (node->keyArray[nextEntry] < highValInt)))
+
+            // skip whole children until the position falls inside one
+            int *counts = nonLeafCounts(curPage);
+            int keyCount = nonLeafKeyCount(curPage);
+            int childIndex = 0;
+            while (childIndex <= keyCount && position >= counts[childIndex])
             {
-                outRid = node->ridArray[nextEntry];
-                nextEntry++;
+                position -= counts[childIndex];
+                childIndex++;
             }
-            else
+            if (childIndex > keyCount)
             {
-                throw IndexScanCompletedException();
+                bufMgr->unPinPage(file, curPageNum, false);
+                throw NoSuchKeyFoundException();
             }
+            PageId childPageNum = nonLeafPageNos(curPage)[childIndex];
+            isLeaf = nonLeafLevel(curPage) == 1;
+            bufMgr->unPinPage(file, curPageNum, false);
+            curPageNum = childPageNum;
         }
-        else
-            throw ScanNotInitializedException();
     }
 
-    // -----------------------------------------------------------------------------
-    // BTreeIndex::endScan
-    // -----------------------------------------------------------------------------
-    //
-    void BTreeIndex::endScan()
+    void BTreeIndex::sample(int sampleSize, unsigned int seed, std::vector<RecordId> &outRids)
     {
-
-        if (!scanExecuting)
-        {                                        // check if scanexe is fale
-            throw ScanNotInitializedException(); // is false throw exception
+        outRids.clear();
+        int total = entryCount();
+        if (total == 0)
+        {
+            return;
         }
 
-        scanExecuting = false;
-        currentPageData = NULL;
-        currentPageNum = Page::INVALID_NUMBER;
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<int> distribution(0, total - 1);
+        for (int i = 0; i < sampleSize; i++)
+        {
+            int key;
+            RecordId rid;
+            select(distribution(generator), &key, rid);
+            outRids.push_back(rid);
+        }
     }
 
 }
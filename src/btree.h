@@ -11,11 +11,20 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <set>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "work_stealing.h"
+#include "composite_key.h"
 /**
  * @file buffer.
  * @author Zahaan Motiwala (9081204399)
@@ -35,37 +44,251 @@ namespace badgerdb
 {
 
   /**
-   * @brief Datatype enumeration type.
+   * @brief Order in which a scan returns entries. Passed to BTreeIndex::startScan() method.
    */
-  enum Datatype
+  enum ScanOrder
   {
-    INTEGER = 0,
-    DOUBLE = 1,
-    STRING = 2
+    ASCENDING,  /* From the low bound up, following right siblings */
+    DESCENDING  /* From the high bound down, following left siblings */
   };
 
   /**
-   * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() method.
+   * @brief Optional index features. Values are or'ed together and passed to the BTreeIndex constructor.
+   * They are recorded in the meta page, so an existing index keeps the options it was created with.
    */
-  enum Operator
+  enum IndexOption
   {
-    LT,  /* Less Than */
-    LTE, /* Less Than or Equal to */
-    GTE, /* Greater Than or Equal to */
-    GT   /* Greater Than */
+    INDEX_DEFAULT = 0,           /* Plain leaves */
+    INDEX_COMPRESSED_LEAVES = 1, /* Leaves store frame-of-reference bit packed keys and unpadded RecordIds */
+    INDEX_SUBTREE_COUNTS = 2,    /* Non-leaf nodes keep the number of entries under each child, leaves the length of their posting lists */
+    INDEX_INCLUDED_COLUMNS = 4,  /* Leaves also hold fields of the record. Set when included columns are given */
+    INDEX_COMPOSITE_KEY = 8,     /* Keys are several attributes encoded into one STRING key. Set by the composite constructor */
+    INDEX_COMPRESSED_PAGES = 16  /* The index file stores its pages compressed, see ExtentMap */
   };
 
+  /**
+   * @brief One index to create with BTreeIndex::buildIndexes().
+   */
+  struct IndexSpec
+  {
+    /**
+     * Offset of attribute, over which index is built, inside the record stored in pages.
+     */
+    int attrByteOffset;
+
+    /**
+     * Type of the attribute over which index is built.
+     */
+    Datatype attrType;
+
+    /**
+     * IndexOption values or'ed together.
+     */
+    int indexOptions;
+
+    /**
+     * Fields of the record to keep next to each RecordId in the leaves, empty for none.
+     */
+    std::vector<ScanField> includedColumns;
+
+    /**
+     * Attributes of a composite key, empty for an index on the single attribute above.
+     */
+    std::vector<KeyComponent> keyComponents;
+  };
+
+  /**
+   * @brief Number of buckets of IndexStats::leafFill, each a tenth of a leaf wide.
+   */
+  const int LEAFFILLBUCKETS = 10;
+
+  /**
+   * @brief Shape of an index, returned by BTreeIndex::stats().
+   */
+  struct IndexStats
+  {
+    /**
+     * Offset of the attribute the index is built over, inside the record.
+     */
+    int attrByteOffset;
+
+    /**
+     * Type of the attribute the index is built over.
+     */
+    Datatype attrType;
+
+    /**
+     * Number of levels of nodes, the leaves included.
+     */
+    int height;
+
+    /**
+     * Number of nodes on each level, from the root down to the leaves.
+     */
+    std::vector<int> nodesPerLevel;
+
+    /**
+     * Number of posting list pages.
+     */
+    int postingPages;
+
+    /**
+     * Number of pages reached from the root, posting lists and the meta page included.
+     */
+    int pages;
+
+    /**
+     * Number of pages on the free list, the pages holding the list included.
+     */
+    int freePages;
+
+    /**
+     * Number of pages the meta page records. Equals pages plus freePages unless pages were lost.
+     */
+    int filePages;
+
+    /**
+     * Number of entries, duplicates in posting lists included.
+     */
+    std::uint64_t entries;
+
+    /**
+     * Number of leaves by how full they are: bucket i counts the leaves using from i to i + 1 tenths
+     * of their space, and full leaves are counted in the last bucket.
+     */
+    std::vector<int> leafFill;
+
+    /**
+     * Average fraction of the space of a leaf in use.
+     */
+    double averageLeafFill;
+
+    /**
+     * Average fraction of the space of a non-leaf node in use.
+     */
+    double averageNodeFill;
+
+    /**
+     * Smallest and largest key of an index on an INTEGER attribute. Both 0 if the index is empty.
+     */
+    int minKey;
+    int maxKey;
+
+    /**
+     * Smallest and largest key of an index on a STRING attribute or a composite key, as stored.
+     */
+    std::string minStringKey;
+    std::string maxStringKey;
+
+    /**
+     * Bytes of index pages per entry.
+     */
+    double bytesPerEntry;
+
+    /**
+     * Average number of leaves that follow each other in the file as they do in the leaf chain. A
+     * freshly built index has one long run; splits scatter leaves over the file and shorten the runs,
+     * so scans read more randomly.
+     */
+    double averageLeafRun;
+
+    /**
+     * Constructor of IndexStats class.
+     */
+    IndexStats()
+        : attrByteOffset(0), attrType(INTEGER), height(0), postingPages(0), pages(0), freePages(0), filePages(0), entries(0),
+          leafFill(LEAFFILLBUCKETS, 0), averageLeafFill(0), averageNodeFill(0), minKey(0), maxKey(0),
+          bytesPerEntry(0), averageLeafRun(0) {}
+  };
+
+  /**
+   * @brief Number of bytes of a page a node may use. The rest holds the page checksum.
+   */
+  const int NODESIZE = Page::SIZE - Page::CHECKSUM_SIZE;
+
   /**
    * @brief Number of key slots in B+Tree leaf for INTEGER key.
    */
-  //                                                  sibling ptr             key               rid
-  const int INTARRAYLEAFSIZE = (Page::SIZE - sizeof(bool) - sizeof(PageId)) / (sizeof(int) + sizeof(RecordId));
+  //                                                 numEntries              sibling ptrs                key               rid
+  const int INTARRAYLEAFSIZE = (NODESIZE - sizeof(int) - sizeof(bool) - 2 * sizeof(PageId)) / (sizeof(int) + sizeof(RecordId));
 
   /**
    * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
    */
   //                                                               level     extra pageNo                  key       pageNo
-  const int INTARRAYNONLEAFSIZE = (Page::SIZE - sizeof(bool) - sizeof(int) - sizeof(PageId)) / (sizeof(int) + sizeof(PageId));
+  const int INTARRAYNONLEAFSIZE = (NODESIZE - sizeof(bool) - sizeof(int) - sizeof(PageId)) / (sizeof(int) + sizeof(PageId));
+
+  /**
+   * @brief Number of key slots in B+Tree non-leaf for INTEGER key when subtree counts are kept.
+   */
+  //                                                                       level     extra pageNo, count               key       pageNo          count
+  const int INTARRAYCOUNTEDNONLEAFSIZE = (NODESIZE - sizeof(bool) - sizeof(int) - sizeof(PageId) - sizeof(int)) / (sizeof(int) + sizeof(PageId) + sizeof(int));
+
+  /**
+   * @brief Number of bytes a RecordId takes in a compressed leaf, the padding field is dropped.
+   */
+  const int PACKEDRIDSIZE = sizeof(PageId) + sizeof(SlotId);
+
+  /**
+   * @brief Number of bytes of packed keys and RecordIds in a compressed leaf.
+   */
+  //                                                  numEntries, baseKey, keyBits, sibling ptr      isLeaf
+  const int COMPRESSEDLEAFDATASIZE = NODESIZE - 3 * sizeof(int) - 2 * sizeof(PageId) - sizeof(bool);
+
+  /**
+   * @brief Upper bound on the number of entries in a compressed leaf, reached when all keys pack into 0 bits.
+   */
+  const int COMPRESSEDLEAFMAXSIZE = COMPRESSEDLEAFDATASIZE / PACKEDRIDSIZE;
+
+  /**
+   * @brief Most fields an index may include in its leaves.
+   */
+  const int MAXINCLUDEDCOLUMNS = 4;
+
+  /**
+   * @brief Most bytes of included fields an index may keep per entry.
+   */
+  const int MAXINCLUDEDSIZE = 64;
+
+  /**
+   * @brief Most attributes in a composite key.
+   */
+  const int MAXKEYCOMPONENTS = 4;
+
+  /**
+   * @brief Number of bytes of keys, RecordIds and included fields in a covering leaf.
+   */
+  //                                                 numEntries, sibling ptrs       isLeaf, padded
+  const int COVERINGLEAFDATASIZE = (NODESIZE - sizeof(int) - 2 * sizeof(PageId) - sizeof(int)) / sizeof(int) * sizeof(int);
+
+  /**
+   * @brief Longest STRING key. Keys are read from the record up to the first NUL or this many bytes.
+   */
+  const int STRINGKEYSIZE = 64;
+
+  /**
+   * @brief Number of bytes of slots and key data in a node of a STRING index.
+   */
+  //                                           level, sibling ptrs, leftmost ptr   numSlots, freeSpaceOffset, prefixOffset, prefixLength   isLeaf
+  const int STRINGNODEDATASIZE = (NODESIZE - 4 * sizeof(int) - 4 * sizeof(std::uint16_t) - sizeof(bool)) / sizeof(int) * sizeof(int);
+
+  /**
+   * @brief Number of RecordIds a single key may hold inline in a leaf. Once a key reaches this many
+   * duplicates its entries are collapsed into one leaf slot that points to a posting list.
+   */
+  const int POSTINGTHRESHOLD = INTARRAYLEAFSIZE / 4;
+
+  /**
+   * @brief Number of bytes of delta encoded RecordIds that fit in one posting list page.
+   */
+  //                                                    next/tail pageNo      numRids, dataLength, totalRids   first/last rid
+  const int POSTINGDATASIZE = NODESIZE - 2 * sizeof(PageId) - 3 * sizeof(int) - 2 * sizeof(RecordId);
+
+  /**
+   * @brief Fraction of each node BTreeIndex::reorganize() fills unless told otherwise. The room left lets
+   * a leaf take some inserts before it splits and a new page breaks the run of leaves.
+   */
+  const double REORGANIZEFILLFACTOR = 0.9;
 
   /**
    * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that
@@ -104,15 +327,17 @@ namespace badgerdb
   /**
    * @brief Overloaded operator to compare the key values of two rid-key pairs
    * and if they are the same compares to see if the first pair has
-   * a smaller rid.pageNo value.
+   * a smaller rid. Duplicate keys are kept in this order inside leaves and posting lists.
    */
   template <class T>
   bool operator<(const RIDKeyPair<T> &r1, const RIDKeyPair<T> &r2)
   {
     if (r1.key != r2.key)
       return r1.key < r2.key;
-    else
+    else if (r1.rid.page_number != r2.rid.page_number)
       return r1.rid.page_number < r2.rid.page_number;
+    else
+      return r1.rid.slot_number < r2.rid.slot_number;
   }
 
   /**
@@ -152,6 +377,41 @@ namespace badgerdb
      * if there is only one child, this leaf node can have < 50% occupancy.
      */
     int numPages;
+
+    /**
+     * IndexOption values the index was created with.
+     */
+    int indexOptions;
+
+    /**
+     * Number of fields kept in the leaves of an index with INDEX_INCLUDED_COLUMNS.
+     */
+    int numIncludedColumns;
+
+    /**
+     * Fields kept in the leaves, in the order they are returned.
+     */
+    ScanField includedColumns[MAXINCLUDEDCOLUMNS];
+
+    /**
+     * Number of attributes of the key of an index with INDEX_COMPOSITE_KEY.
+     */
+    int numKeyComponents;
+
+    /**
+     * Attributes of the key, most significant first.
+     */
+    KeyComponent keyComponents[MAXKEYCOMPONENTS];
+
+    /**
+     * First page of the list of free pages, Page::INVALID_NUMBER if no page is free.
+     */
+    PageId freeListPageNo;
+
+    /**
+     * Number of free pages, the pages holding the list included.
+     */
+    int numFreePages;
   };
 
   /*
@@ -182,6 +442,40 @@ namespace badgerdb
     PageId pageNoArray[INTARRAYNONLEAFSIZE + 1];
   };
 
+  static_assert(sizeof(NonLeafNodeInt) <= NODESIZE,
+                "Non-leaf node must fit in a page.");
+
+  /**
+   * @brief Structure for non-leaf nodes of an index created with INDEX_SUBTREE_COUNTS.
+   * countArray[i] is the number of entries, duplicates included, in the subtree under pageNoArray[i],
+   * so rank, select and range counts only read one node per level.
+   */
+  struct CountedNonLeafNodeInt
+  {
+    /**
+     * Level of the node in the tree.
+     */
+    int level;
+    bool isLeaf;
+    /**
+     * Stores keys.
+     */
+    int keyArray[INTARRAYCOUNTEDNONLEAFSIZE];
+
+    /**
+     * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+     */
+    PageId pageNoArray[INTARRAYCOUNTEDNONLEAFSIZE + 1];
+
+    /**
+     * Number of entries under each child page.
+     */
+    int countArray[INTARRAYCOUNTEDNONLEAFSIZE + 1];
+  };
+
+  static_assert(sizeof(CountedNonLeafNodeInt) <= NODESIZE,
+                "Counted non-leaf node must fit in a page.");
+
   /**
    * @brief Structure for all leaf nodes when the key is of INTEGER type.
    */
@@ -203,334 +497,1879 @@ namespace badgerdb
      * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
      */
     PageId rightSibPageNo;
+
+    /**
+     * Page number of the leaf on the left side, followed by descending scans.
+     */
+    PageId leftSibPageNo;
+
+    /**
+     * Number of entries in the leaf. Keys may take any value, INT_MAX included, so they cannot mark the end.
+     */
+    int numEntries;
   };
 
+  static_assert(sizeof(LeafNodeInt) <= NODESIZE,
+                "Leaf node must fit in a page.");
+
   /**
-   * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
-   * relation. This index supports only one scan at a time.
+   * @brief Structure for leaf nodes of an index created with INDEX_COMPRESSED_LEAVES.
+   * Keys are stored frame-of-reference: each key is kept as its offset from baseKey, the smallest key
+   * in the leaf, bit packed at keyBits bits per key. The packed keys come first in data and are followed by
+   * the RecordIds, PACKEDRIDSIZE bytes each. Any key can be unpacked on its own, so the leaf is binary
+   * searched in place and only decoded as a whole when it is modified.
    */
-  class BTreeIndex
+  struct CompressedLeafNodeInt
   {
+    /**
+     * Number of entries in the leaf.
+     */
+    int numEntries;
 
-  private:
     /**
-     * File object for the index file.
+     * Smallest key in the leaf, the frame of reference for the packed keys.
      */
-    File *file;
+    int baseKey;
 
     /**
-     * Buffer Manager Instance.
+     * Number of bits each packed key takes.
      */
-    BufMgr *bufMgr;
+    int keyBits;
 
     /**
-     * Page number of meta page.
+     * Page number of the leaf on the right side.
      */
-    PageId headerPageNum;
+    PageId rightSibPageNo;
 
     /**
-     * page number of root page of B+ tree inside index file.
+     * Page number of the leaf on the left side.
      */
-    PageId rootPageNum;
+    PageId leftSibPageNo;
+
+    bool isLeaf;
 
     /**
-     * Datatype of attribute over which index is built.
+     * Packed keys followed by packed RecordIds.
      */
-    Datatype attributeType;
+    unsigned char data[COMPRESSEDLEAFDATASIZE];
+  };
 
+  static_assert(sizeof(CompressedLeafNodeInt) <= NODESIZE,
+                "Compressed leaf must fit in a page.");
+
+  /**
+   * @brief Structure for leaf nodes of an index created with included columns. data holds the keys, then
+   * the RecordIds, then the included fields of every entry packed one after another. How many entries
+   * fit depends on the width of the included fields, so the arrays are laid out at run time.
+   */
+  struct CoveringLeafNodeInt
+  {
     /**
-     * Offset of attribute, over which index is built, inside records.
+     * Number of entries in the leaf.
      */
-    int attrByteOffset;
+    int numEntries;
 
     /**
-     * Number of keys in leaf node, depending upon the type of key.
+     * Page number of the leaf on the right side.
      */
-    int leafOccupancy;
+    PageId rightSibPageNo;
 
     /**
-     * Number of keys in non-leaf node, depending upon the type of key.
+     * Page number of the leaf on the left side.
      */
-    int nodeOccupancy;
+    PageId leftSibPageNo;
+
+    bool isLeaf;
 
     /**
-     * Number of pages that comprise btree file. Used to determine if
-     * btree is in special case where only one child node present as
-     * due to implementation details of root being always nonleafnode,
-     * if there is only one child, this leaf node can have < 50% occupancy.
+     * Keys, RecordIds and included fields.
      */
-    int numPages;
+    int data[COVERINGLEAFDATASIZE / sizeof(int)];
+  };
 
-    // MEMBERS SPECIFIC TO SCANNING
+  static_assert(sizeof(CoveringLeafNodeInt) <= NODESIZE,
+                "Covering leaf must fit in a page.");
 
+  /**
+   * @brief Slot of a SlottedNodeString. Points at the key bytes inside the node.
+   */
+  struct StringSlot
+  {
     /**
-     * True if an index scan has been started.
+     * Offset of the key bytes in the node data.
      */
-    bool scanExecuting;
+    std::uint16_t keyOffset;
 
     /**
-     * Index of next entry to be scanned in current leaf being scanned.
+     * Number of key bytes stored. In leaves this excludes the common prefix of the node.
      */
-    int nextEntry;
+    std::uint16_t keyLength;
 
     /**
-     * Page number of current page being scanned.
+     * In leaves the page of the RecordId. In non-leaf nodes the child to the right of the key.
      */
-    PageId currentPageNum;
+    PageId pageNo;
 
     /**
-     * Current Page being scanned.
+     * In leaves the slot of the RecordId. Unused in non-leaf nodes.
      */
-    Page *currentPageData;
+    SlotId slotNo;
+  };
 
+  /**
+   * @brief Structure for all nodes when the key is of STRING type. Keys are variable length, so the node
+   * is slotted: the slot array grows up from the start of data and key bytes grow down from its end.
+   * Non-leaf nodes hold suffix truncated separators, the shortest prefix of the first key on the right
+   * that is still larger than the last key on the left. Leaves store the prefix common to all their keys
+   * once and only the remaining suffix of each key.
+   */
+  struct SlottedNodeString
+  {
     /**
-     * Low INTEGER value for scan.
+     * Slot array followed by free space and key bytes.
      */
-    int lowValInt;
+    unsigned char data[STRINGNODEDATASIZE];
 
     /**
-     * Low DOUBLE value for scan.
+     * Level of the node in the tree, 1 if its children are leaves. Unused in leaves.
      */
-    double lowValDouble;
+    int level;
 
     /**
-     * Low STRING value for scan.
+     * Page number of the leaf on the right side. Unused in non-leaf nodes.
      */
-    std::string lowValString;
+    PageId rightSibPageNo;
 
     /**
-     * High INTEGER value for scan.
+     * Page number of the leaf on the left side. Unused in non-leaf nodes.
      */
-    int highValInt;
+    PageId leftSibPageNo;
 
     /**
-     * High DOUBLE value for scan.
+     * Child holding the keys smaller than the first separator. Unused in leaves.
      */
-    double highValDouble;
+    PageId leftmostPageNo;
 
     /**
-     * High STRING value for scan.
+     * Number of slots in use.
      */
-    std::string highValString;
+    std::uint16_t numSlots;
 
     /**
-     * Low Operator. Can only be GT(>) or GTE(>=).
+     * Offset of the lowest key byte in use. Free space lies between the slot array and this offset.
      */
-    Operator lowOp;
+    std::uint16_t freeSpaceOffset;
 
     /**
-     * High Operator. Can only be LT(<) or LTE(<=).
+     * Offset of the common key prefix of a leaf.
      */
-    Operator highOp;
+    std::uint16_t prefixOffset;
 
-  public:
     /**
-     * BTreeIndex Constructor.
-     * Check to see if the corresponding index file exists. If so, open the file.
-     * If not, create it and insert entries for every tuple in the base relation using FileScan class.
-     *
-     * @param relationName        Name of file.
-     * @param outIndexName        Return the name of index file.
+     * Length of the common key prefix of a leaf, 0 for non-leaf nodes.
+     */
+    std::uint16_t prefixLength;
+
+    bool isLeaf;
+  };
+
+  static_assert(sizeof(SlottedNodeString) <= NODESIZE,
+                "String node must fit in a page.");
+
+  /**
+   * @brief Structure for the overflow pages that hold the posting list of a heavily duplicated key.
+   * A leaf entry whose rid has slot_number Page::INVALID_SLOT refers to the head page of such a list
+   * through its page_number. RecordIds are kept sorted and stored as varint deltas from the previous rid,
+   * so a long run of rows on the same heap pages costs one or two bytes per rid.
+   */
+  struct PostingNodeInt
+  {
+    /**
+     * Page number of the next page in the posting list, 0 if this is the last one.
+     */
+    PageId nextPageNo;
+
+    /**
+     * Page number of the last page in the posting list. Only maintained in the head page.
+     */
+    PageId tailPageNo;
+
+    /**
+     * Number of RecordIds stored in this page.
+     */
+    int numRids;
+
+    /**
+     * Number of bytes of data in use.
+     */
+    int dataLength;
+
+    /**
+     * Number of RecordIds in the whole posting list. Only maintained in the head page.
+     */
+    int totalRids;
+
+    /**
+     * First RecordId of this page, stored uncompressed. The deltas in data start from it.
+     */
+    RecordId firstRid;
+
+    /**
+     * Last RecordId of this page, kept so appends need not decode the page.
+     */
+    RecordId lastRid;
+
+    /**
+     * Varint encoded deltas between consecutive RecordIds.
+     */
+    unsigned char data[POSTINGDATASIZE];
+  };
+
+  static_assert(sizeof(PostingNodeInt) <= NODESIZE,
+                "Posting list node must fit in a page.");
+
+  /**
+   * @brief Number of page numbers held by one page of the free page list.
+   */
+  //                                       next page, count
+  const int FREELISTSIZE = (NODESIZE - sizeof(PageId) - sizeof(int)) / sizeof(PageId);
+
+  /**
+   * @brief Page of the list of pages an index no longer uses, which are handed out again before the file
+   * grows. The meta page points at the first one. A list page whose numbers are all handed out is
+   * handed out itself.
+   */
+  struct FreeListNodeInt
+  {
+    /**
+     * Page number of the next page of the list, 0 if this is the last one.
+     */
+    PageId nextPageNo;
+
+    /**
+     * Number of page numbers stored in this page.
+     */
+    int numFree;
+
+    /**
+     * Free pages.
+     */
+    PageId freePageNos[FREELISTSIZE];
+  };
+
+  static_assert(sizeof(FreeListNodeInt) <= NODESIZE,
+                "Free list node must fit in a page.");
+
+  /**
+   * @brief Bookkeeping of a BTreeIndex::reorganize() of an INTEGER index while inserts go on. Leaves are
+   * copied under their latch, so an insert lands in a leaf either before it is copied or after; the
+   * entries of the later ones are kept here and added to the new tree before it replaces the old one.
+   */
+  struct ReorganizeState
+  {
+    /**
+     * Guards the members below, taken by inserts with their leaf latched.
+     */
+    std::mutex mutex;
+
+    /**
+     * Leaves of the old tree already copied, and leaves split off them since.
+     */
+    std::set<PageId> copiedLeaves;
+
+    /**
+     * Entries inserted into copied leaves, in insert order.
+     */
+    std::vector<RIDKeyPair<int> > missedEntries;
+  };
+
+  /**
+   * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+   * relation. This index supports only one scan at a time.
+   * Inserts and lookup() on INTEGER indexes may run from several threads at once, and alongside
+   * reorganize(). Scans, STRING inserts and the counting functions assume no concurrent insert.
+   */
+  class BTreeIndex
+  {
+
+  private:
+    /**
+     * @brief Counts a lookup or count as reading the tree while it is in scope, see enterRead().
+     */
+    class ReadGuard
+    {
+    public:
+      ReadGuard(BTreeIndex &tree) : index(tree), epoch(tree.enterRead()) {}
+      ~ReadGuard() { index.leaveRead(epoch); }
+
+    private:
+      BTreeIndex &index;
+      int epoch;
+    };
+
+    /**
+     * Create a new index file and load it from entries already read off the relation by buildIndexes().
+     *
+     * @param relationName        Name of file.
      * @param bufMgrIn						Buffer Manager Instance
-     * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
-     * @param attrType						Datatype of attribute over which index is built
+     * @param spec								Index to create
+     * @param intEntries					Sorted entries of a non STRING index
+     * @param stringEntries				Sorted entries of a STRING index
+     */
+    BTreeIndex(const std::string &relationName, BufMgr *bufMgrIn, const IndexSpec &spec,
+               std::vector<RIDKeyPair<int> > &intEntries, std::vector<RIDKeyPair<std::string> > &stringEntries);
+
+    /**
+     * File object for the index file.
+     */
+    File *file;
+
+    /**
+     * Buffer Manager Instance.
+     */
+    BufMgr *bufMgr;
+
+    /**
+     * Page number of meta page.
+     */
+    PageId headerPageNum;
+
+    /**
+     * page number of root page of B+ tree inside index file. Read without a latch by concurrent
+     * inserts and lookups, which check it again once they hold the root.
+     */
+    std::atomic<PageId> rootPageNum;
+
+    /**
+     * Datatype of attribute over which index is built.
+     */
+    Datatype attributeType;
+
+    /**
+     * Offset of attribute, over which index is built, inside records.
+     */
+    int attrByteOffset;
+
+    /**
+     * Number of keys in leaf node, depending upon the type of key.
+     */
+    int leafOccupancy;
+
+    /**
+     * Number of keys in non-leaf node, depending upon the type of key.
+     */
+    int nodeOccupancy;
+
+    /**
+     * Number of pages that comprise btree file. Used to determine if
+     * btree is in special case where only one child node present as
+     * due to implementation details of root being always nonleafnode,
+     * if there is only one child, this leaf node can have < 50% occupancy.
+     */
+    std::atomic<int> numPages;
+
+    /**
+     * Serializes writes of the meta page between concurrent inserts.
+     */
+    std::mutex metaMutex;
+
+    /**
+     * Makes inserts take turns when changes are logged. Log records are redo only, so a transaction
+     * must not share pages with another one still open.
+     */
+    std::mutex logMutex;
+
+    /**
+     * Number of inserts running, counted so reorganize() can wait for them to finish.
+     */
+    std::atomic<int> activeInserts;
+
+    /**
+     * Set while reorganize() holds new inserts back.
+     */
+    std::atomic<bool> insertsPaused;
+
+    /**
+     * Guards the waits on pauseChanged.
+     */
+    std::mutex pauseMutex;
+
+    /**
+     * Signalled when inserts are resumed, and when the last running insert finishes while they are paused.
+     */
+    std::condition_variable pauseChanged;
+
+    /**
+     * Lets one reorganize() run at a time.
+     */
+    std::mutex reorganizeMutex;
+
+    /**
+     * Copied leaves and missed entries of the running reorganize(), NULL if none is running.
+     */
+    ReorganizeState *reorganizeState;
+
+    /**
+     * Bumped by reorganize() once it has switched to the new root. Readers that started before it
+     * may still be in the old tree, whose pages are freed once they are done.
+     */
+    std::atomic<int> readEpoch;
+
+    /**
+     * Number of lookups, counts and open scans, by the parity of the readEpoch they started in.
+     */
+    std::atomic<int> activeReads[2];
+
+    /**
+     * IndexOption values the index was created with.
+     */
+    int indexOptions;
+
+    /**
+     * Number of entries of one key kept inline in a leaf before they move to a posting list.
+     * POSTINGTHRESHOLD, or less for leaves that hold fewer entries.
+     */
+    int postingThreshold;
+
+    /**
+     * Fields of the record kept in the leaves next to each RecordId.
+     */
+    std::vector<ScanField> includedColumns;
+
+    /**
+     * Total width of the included fields in bytes, 0 without INDEX_INCLUDED_COLUMNS.
+     */
+    int includedSize;
+
+    /**
+     * Relation the included fields are read from on insert, NULL without INDEX_INCLUDED_COLUMNS.
+     */
+    PageFile *relationFile;
+
+    /**
+     * Attributes of the key of an index with INDEX_COMPOSITE_KEY, most significant first.
+     */
+    std::vector<KeyComponent> keyComponents;
+
+    /**
+     * Length of an encoded composite key with every component, 0 without INDEX_COMPOSITE_KEY.
+     */
+    int compositeKeyLength;
+
+    // MEMBERS SPECIFIC TO SCANNING
+
+    /**
+     * True if an index scan has been started.
+     */
+    bool scanExecuting;
+
+    /**
+     * readEpoch the running scan started in.
+     */
+    int scanReadEpoch;
+
+    /**
+     * Index of next entry to be scanned in current leaf being scanned.
+     */
+    int nextEntry;
+
+    /**
+     * Number of entries in the current leaf being scanned.
+     */
+    int currentEntryCount;
+
+    /**
+     * Page number of current page being scanned.
+     */
+    PageId currentPageNum;
+
+    /**
+     * Current Page being scanned.
+     */
+    Page *currentPageData;
+
+    /**
+     * Page number of the posting list page being scanned, 0 if the scan is not inside a posting list.
+     */
+    PageId postingPageNum;
+
+    /**
+     * Posting list page being scanned. Kept pinned until the page is exhausted.
+     */
+    Page *postingPageData;
+
+    /**
+     * Number of RecordIds of the current posting list page returned so far.
+     */
+    int postingEntry;
+
+    /**
+     * Byte offset of the next delta to decode in the current posting list page.
+     */
+    int postingOffset;
+
+    /**
+     * Last RecordId returned from the current posting list page.
+     */
+    RecordId postingRid;
+
+    /**
+     * Low INTEGER value for scan.
+     */
+    int lowValInt;
+
+    /**
+     * Low DOUBLE value for scan.
+     */
+    double lowValDouble;
+
+    /**
+     * Low STRING value for scan.
+     */
+    std::string lowValString;
+
+    /**
+     * High INTEGER value for scan.
+     */
+    int highValInt;
+
+    /**
+     * High DOUBLE value for scan.
+     */
+    double highValDouble;
+
+    /**
+     * High STRING value for scan.
+     */
+    std::string highValString;
+
+    /**
+     * Low Operator. Can only be GT(>) or GTE(>=).
+     */
+    Operator lowOp;
+
+    /**
+     * High Operator. Can only be LT(<) or LTE(<=).
+     */
+    Operator highOp;
+
+    /**
+     * Direction of the current scan.
+     */
+    ScanOrder scanOrder;
+
+  public:
+    /**
+     * BTreeIndex Constructor.
+     * Check to see if the corresponding index file exists. If so, open the file.
+     * If not, create it and load it with an entry for every tuple in the base relation. The relation pages are
+     * split between buildThreads threads that sort their entries, and the sorted runs are merged into the index.
+     *
+     * @param relationName        Name of file.
+     * @param outIndexName        Return the name of index file.
+     * @param bufMgrIn						Buffer Manager Instance
+     * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+     * @param attrType						Datatype of attribute over which index is built
+     * @param indexOptions				IndexOption values or'ed together, only used when the index file is created
+     * @param buildThreads				Threads reading the relation when the index file is created, 0 for one per hardware thread
+     * @param includedColumns		Fields of the record kept in the leaves, only used when the index file is created.
+     *														Scans can return them without reading the relation.
+     * @throws  BadIndexInfoException If included columns are asked of a STRING or compressed index, or do not fit.
+     */
+    BTreeIndex(const std::string &relationName, std::string &outIndexName,
+               BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType,
+               const int indexOptions = INDEX_DEFAULT, const int buildThreads = 0,
+               const std::vector<ScanField> &includedColumns = std::vector<ScanField>());
+
+    /**
+     * BTreeIndex Constructor for a key made of several attributes, compared in the order given.
+     * Opens the index file if it exists, else creates and loads it like the constructor above.
+     * Keys are CompositeKey values. A scan whose bounds hold only the leading components returns every
+     * key that starts with them, so one descent finds all rows of a (tenant, time range) query.
+     *
+     * @param relationName        Name of file.
+     * @param outIndexName        Return the name of index file, relationName followed by every offset.
+     * @param bufMgrIn						Buffer Manager Instance
+     * @param keyComponents				Attributes of the key, most significant first
+     * @param buildThreads				Threads reading the relation when the index file is created, 0 for one per hardware thread
+     * @throws  BadIndexInfoException If there are fewer than 2 or more than MAXKEYCOMPONENTS components, the key is
+     *                                longer than STRINGKEYSIZE, or an existing index file has other components.
+     */
+    BTreeIndex(const std::string &relationName, std::string &outIndexName, BufMgr *bufMgrIn,
+               const std::vector<KeyComponent> &keyComponents, const int buildThreads = 0);
+
+    /**
+     * BTreeIndex Destructor.
+     * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+     * and delete file instance thereby closing the index file.
+     * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
+     * */
+    ~BTreeIndex();
+
+    /**
+     * Create several indexes of one relation, reading every relation page once. Each pinned page feeds the
+     * entries of all the indexes, which are then sorted, merged and loaded as by the constructor. Index files
+     * that already exist are left alone. The indexes are opened afterwards with the constructor.
+     *
+     * @param relationName        Name of file.
+     * @param specs								Indexes to create
+     * @param outIndexNames				Return the name of the index file of every spec
+     * @param bufMgrIn						Buffer Manager Instance
+     * @param buildThreads				Threads reading the relation, 0 for one per hardware thread
+     */
+    static void buildIndexes(const std::string &relationName, const std::vector<IndexSpec> &specs,
+                             std::vector<std::string> &outIndexNames, BufMgr *bufMgrIn, const int buildThreads = 0);
+
+    /**
+     * Insert a new entry using the pair <value,rid>.
+     * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
+     * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
+     * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
+     * Make sure to unpin pages as soon as you can.
+     * When the buffer manager logs changes, every page the insert changes, splits included, is logged
+     * as one transaction, and inserts into the index take turns.
+     * @param key			Key to insert, pointer to integer/double/char string, or to a CompositeKey with every component
+     * @param rid			Record ID of a record whose entry is getting inserted into the index.
+     * @throws  BadIndexInfoException If a composite key is missing components.
+     **/
+    void insertEntry(const void *key, const RecordId rid);
+
+    /**
+     * Find all RecordIds stored under a key. Safe to call while other threads insert into an INTEGER index.
+     * Nodes are read without latching them and the lookup starts over if a writer changed one meanwhile.
+     * @param key			Key to look up, pointer to integer
+     * @param outRids	Filled in with the RecordIds of the key in rid order, empty if the key is not present
+     * @throws  BadIndexInfoException If the index is not on an INTEGER attribute.
+     **/
+    void lookup(const void *key, std::vector<RecordId> &outRids);
+
+    /**
+     * Begin a filtered scan of the index.  For instance, if the method is called
+     * using ("a",GT,"d",LTE) then we should seek all entries with a value
+     * greater than "a" and less than or equal to "d".
+     * If another scan is already executing, that needs to be ended here.
+     * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
+     * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+     * A DESCENDING scan starts at the high bound and walks left, so the largest keys come first and a
+     * top-k query can stop after k entries. Duplicates held in a posting list are returned in RecordId order
+     * in both directions.
+     * A composite index takes CompositeKey bounds that may hold only the leading components. Such a bound
+     * covers every key starting with it, so (k, GTE, k, LTE) is a prefix scan of k.
+     * @param lowVal	Low value of range, pointer to integer / double / char string / CompositeKey
+     * @param lowOp		Low operator (GT/GTE)
+     * @param highVal	High value of range, pointer to integer / double / char string / CompositeKey
+     * @param highOp	High operator (LT/LTE)
+     * @param order		ASCENDING or DESCENDING key order
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+     * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+     **/
+    void startScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp, const ScanOrder order = ASCENDING);
+
+    /**
+     * Fetch the record id of the next index entry that matches the scan.
+     * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+     * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+     * @throws ScanNotInitializedException If no scan has been initialized.
+     * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+     **/
+    void scanNext(RecordId &outRid); // returned record id
+
+    /**
+     * Fetch the record id of the next index entry that matches the scan together with the included fields
+     * of its record, packed in the order they were given. The fields are copied from the leaf, so a covered
+     * query never reads the relation. Only duplicates moved out to a posting list have their fields read
+     * from the record.
+     * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+     * @param outIncluded	Filled in with includedColumnsSize() bytes
+     * @throws ScanNotInitializedException If no scan has been initialized.
+     * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+     * @throws BadIndexInfoException If the index has no included columns.
+     **/
+    void scanNext(RecordId &outRid, void *outIncluded);
+
+    /**
+     * Number of bytes of included fields scanNext() returns per entry, 0 if the index has none.
+     **/
+    int includedColumnsSize();
+
+    /**
+     * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+     * @throws ScanNotInitializedException If no scan has been initialized.
+     **/
+    void endScan();
+
+    /**
+     * Scan a range from several threads. The range is cut at separator keys of the non-leaf nodes into pieces
+     * covering about the same number of leaves, and a work stealing pool of threads scans them with a cursor each.
+     * The pieces are put back together in key order, so outRids holds what startScan() and scanNext() would return.
+     * Must not run at the same time as inserts.
+     * @param lowVal	Low value of range, pointer to integer
+     * @param lowOp		Low operator (GT/GTE)
+     * @param highVal	High value of range, pointer to integer
+     * @param highOp	High operator (LT/LTE)
+     * @param outRids	Filled in with the RecordIds of the range in key order
+     * @param numThreads	Number of threads, 0 for one per hardware thread
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+     * @throws  BadIndexInfoException If the index is not on an INTEGER attribute.
+     **/
+    void parallelScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                      std::vector<RecordId> &outRids, const int numThreads = 0);
+
+    /**
+     * Unordered parallel scan for aggregation. visit is called from the worker threads as each piece of the
+     * range is scanned, with the number of the worker so that callers can keep one accumulator per worker.
+     * @param lowVal	Low value of range, pointer to integer
+     * @param lowOp		Low operator (GT/GTE)
+     * @param highVal	High value of range, pointer to integer
+     * @param highOp	High operator (LT/LTE)
+     * @param visit		Called with the worker number, below numThreads, and each RecordId of the range
+     * @param numThreads	Number of threads, 0 for one per hardware thread
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+     * @throws  BadIndexInfoException If the index is not on an INTEGER attribute.
+     **/
+    void parallelScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp,
+                      const std::function<void(int, const RecordId &)> &visit, const int numThreads = 0);
+
+    /**
+     * Number of entries in the index, duplicates included.
+     * Needs an index created with INDEX_SUBTREE_COUNTS, as do the other counting methods below.
+     * @throws  BadIndexInfoException If the index does not keep subtree counts.
+     **/
+    int entryCount();
+
+    /**
+     * Number of entries a scan with the same arguments would return, found by reading one node per level
+     * at each end of the range instead of walking the leaves.
+     * @param lowVal	Low value of range, pointer to integer
+     * @param lowOp		Low operator (GT/GTE)
+     * @param highVal	High value of range, pointer to integer
+     * @param highOp	High operator (LT/LTE)
+     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+     * @throws  BadScanrangeException If lowVal > highval
+     * @throws  BadIndexInfoException If the index does not keep subtree counts.
+     **/
+    int countRange(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp);
+
+    /**
+     * Rank of a key, the number of entries with a smaller key.
+     * @param key		Pointer to integer
+     * @throws  BadIndexInfoException If the index does not keep subtree counts.
+     **/
+    int rank(const void *key);
+
+    /**
+     * Entry at a position of the index in key order, the inverse of rank.
+     * @param position	Zero based position
+     * @param outKey	Key of the entry, pointer to integer
+     * @param outRid	RecordId of the entry
+     * @throws  NoSuchKeyFoundException If position is not smaller than entryCount().
+     * @throws  BadIndexInfoException If the index does not keep subtree counts.
+     **/
+    void select(int position, void *outKey, RecordId &outRid);
+
+    /**
+     * Uniform random sample of entries, drawn with replacement. Every draw selects a random position.
+     * @param sampleSize	Number of entries to draw
+     * @param seed		Seed of the random number generator
+     * @param outRids	Filled in with the sampled RecordIds, empty if the index is
+     * @throws  BadIndexInfoException If the index does not keep subtree counts.
+     **/
+    void sample(int sampleSize, unsigned int seed, std::vector<RecordId> &outRids);
+
+    /**
+     * Shape of the index: nodes per level, how full the leaves are, the key range and how scattered the
+     * leaf chain is over the file, to tell when the index is worth rebuilding. Every node is read once,
+     * level by level, with the nodes of a level spread over a work stealing pool of threads.
+     * Must not run at the same time as inserts.
+     * @param numThreads	Number of threads, 0 for one per hardware thread
+     * @return The statistics of the index
+     **/
+    IndexStats stats(const int numThreads = 0);
+
+    /**
+     * Rewrites the index into new pages at the end of the file: leaves in key order on consecutive pages,
+     * filled to fillFactor, then the non-leaf nodes above them, and switches the meta page to the new root.
+     * Range scans then read the leaves sequentially again, however scattered inserts left them.
+     * On INTEGER indexes inserts and lookups go on meanwhile: inserts only wait while the entries that
+     * reached copied leaves are added to the new tree and the root is switched. STRING inserts wait for
+     * the whole call. The pages of the old tree go on the free list of the file, for later splits and
+     * posting lists to take, once the lookups and scans that started on the old tree are done, so a
+     * scan the calling thread left open keeps this call from returning.
+     *
+     * @param fillFactor	Fraction of each node to fill, more than 0 and at most 1
+     * @throws  BadIndexInfoException If the fill factor is out of range.
+     **/
+    void reorganize(const double fillFactor = REORGANIZEFILLFACTOR);
+
+    /**
+     * @brief initalizes the key array of node to INT_MAX and the pageNoArray to 0 (invalid page). Only the page numbers
+     * tell which keys are in use.
+     *
+     * @param nonLeafNode - to be initalized
+     */
+    void initalizeNonLeafNode(NonLeafNodeInt* nonLeafNode);
+
+    /**
+     * @brief initalizes a non leaf page in the format selected by the index options
+     *
+     * @param nonLeafPage - to be initalized
+     * @param level - level of the node, 1 if its children are leaves
+     */
+    void initalizeNonLeafPage(Page* nonLeafPage, int level);
+
+    /**
+     * @brief level field of a non leaf node in either format
+     *
+     * @param nonLeafPage - node being read
+     * @return int& - reference to the field
+     */
+    int& nonLeafLevel(Page* nonLeafPage);
+
+    /**
+     * @brief key array of a non leaf node in either format
+     *
+     * @param nonLeafPage - node being read
+     * @return int* - the keys
+     */
+    int* nonLeafKeys(Page* nonLeafPage);
+
+    /**
+     * @brief child page array of a non leaf node in either format
+     *
+     * @param nonLeafPage - node being read
+     * @return PageId* - the children
+     */
+    PageId* nonLeafPageNos(Page* nonLeafPage);
+
+    /**
+     * @brief subtree count array of a non leaf node
+     *
+     * @param nonLeafPage - node being read
+     * @return int* - the counts, NULL if the index does not keep them
+     */
+    int* nonLeafCounts(Page* nonLeafPage);
+
+    /**
+     * @brief number of entries a leaf slot stands for, the length of the posting list for collapsed keys.
+     * Slots are meant to be visited in order, so the length is found without reading the posting list
+     *
+     * @param leafPage - leaf of an index with INDEX_SUBTREE_COUNTS
+     * @param index - slot being counted
+     * @param posting - number of posting list slots before index, advanced past this slot
+     * @return int - number of entries
+     */
+    int slotEntryCount(Page* leafPage, int index, int& posting);
+
+    /**
+     * @brief number of entries under a node, from its counts or, for a leaf, its slots
+     *
+     * @param pageNo - node to count
+     * @param isLeaf - whether pageNo is a leaf
+     * @return int - number of entries
+     */
+    int subtreeCount(PageId pageNo, bool isLeaf);
+
+    /**
+     * @brief number of entries with a key smaller than keyInt, or not larger if inclusive
+     *
+     * @param keyInt - key being ranked
+     * @param inclusive - whether entries equal to keyInt are counted
+     * @return int - number of entries
+     */
+    int rankOf(int keyInt, bool inclusive);
+
+    /**
+     * @brief throw unless the index was created with INDEX_SUBTREE_COUNTS
+     */
+    void requireSubtreeCounts();
+
+    /**
+     * @brief RecordId at a position of a posting list. Whole pages are skipped by their rid count.
+     *
+     * @param headPageNo - first page of the posting list
+     * @param position - zero based position in the list
+     * @return RecordId - the rid
+     */
+    RecordId postingRidAt(PageId headPageNo, int position);
+
+    /**
+     * @brief initalzies the leaf node as empty, with no siblings.
+     *
+     * @param leafNode
+     */
+    void initalizeLeafNode(LeafNodeInt* leafNode);
+
+    /**
+     * @brief initalizes an empty leaf in the format this index uses
+     *
+     * @param leafPage - page of the new leaf
+     */
+    void initalizeLeafPage(Page* leafPage);
+
+    /**
+     * @brief called in constructor to set up instance fields if a b tree file already exists
+     *
+     * @param indexName - name of the index file
+     * @param bufMgrIn - bufMgr for the index file
+     * @param relationName - name of the relation index is built on
+     * @param attrByteOffset - offset in bytes our key in the record is
+     * @param attrType - type of data were storing
+     * @param components - attributes of a composite key, empty for a single attribute key
+     */
+    void handleAlreadyPresent(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int attrByteOffset, const Datatype attrType,
+                              const std::vector<KeyComponent>& components);
+
+    /**
+     * @brief called in constructor to set up new index file and build from scratch
+     *
+     * @param indexName - name of the index file
+     * @param bufMgrIn - bufMgr for the index file
+     * @param relationName - name of the relation index is built on
+     * @param attrByteOffset - offset in bytes our key in the record is
+     * @param attrType - type of data were storing
+     * @param options - IndexOption values for the new index
+     * @param columns - fields to include in the leaves, empty for none
+     * @param components - attributes of a composite key, empty for a single attribute key
+     */
+    void handleNew(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int attrByteOffset, const Datatype attrType, const int options,
+                   const std::vector<ScanField>& columns, const std::vector<KeyComponent>& components);
+
+    /**
+     * @brief writes the root page number and page count of the index back to the meta page
+     */
+    void updateMetaInfo();
+
+    /**
+     * @brief allocate a page for a node or posting list, taking a free page before growing the file
+     *
+     * @param pageNo - filled in with the page number
+     * @param page - filled in with the page, zeroed and pinned
+     */
+    void allocNodePage(PageId& pageNo, Page*& page);
+
+    /**
+     * @brief put pages the index no longer uses on the free list in the meta page
+     *
+     * @param pageNos - pages to free, none of them reachable from the root
+     */
+    void freeNodePages(const std::vector<PageId>& pageNos);
+
+    /**
+     * @brief Create a First Child object of index. Because our root is always a non leaf, the first leaf is created by hand
+     *
+     * @param keyInt - key of very first record
+     * @param rid - very first record
+     * @param included - included fields of the record, NULL without included columns
+     * @param rootPage - root page of index, pinned by the caller and left pinned
+     */
+    void createFirstChild(int keyInt, RecordId rid, const char* included, Page* rootPage);
+
+    /**
+     * @brief put a new root above the old one after the old root split. The old root must still be latched by the caller.
+     *
+     * @param oldRootPageNo - root that split
+     * @param newChild - separator key and page split off the old root
+     * @return PageId - the new root, which the caller publishes
+     */
+    PageId growRoot(PageId oldRootPageNo, PageKeyPair<int>& newChild);
+
+    /**
+     * @brief walk from the root to the leaf for keyInt without latching, validating each node before trusting the page number read from it
+     *
+     * @param keyInt - key to look for
+     * @param leafPageNo - filled in with the leaf, Page::INVALID_NUMBER if the tree is empty
+     * @param leafPage - filled in with the leaf, left pinned, NULL if the tree is empty
+     * @param leafVersion - filled in with the version of the leaf latch the leaf was read under
+     * @return true - if the walk was consistent
+     * @return false - if a writer got in the way and the walk has to start over, nothing is left pinned
+     */
+    bool descendOptimistic(int keyInt, PageId& leafPageNo, Page*& leafPage, std::uint64_t& leafVersion);
+
+    /**
+     * @brief insert by latching only the leaf, which works unless the leaf has to split
+     *
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param included - included fields of the record, NULL without included columns
+     * @param needsSplit - set if the insert has to latch the path instead
+     * @return true - if the pair was inserted
+     * @return false - if it was not, either retry or use insertPessimistic() as needsSplit says
+     */
+    bool insertOptimistic(int keyInt, RecordId rid, const char* included, bool& needsSplit);
+
+    /**
+     * @brief insert with write latches coupled down the path. Latches above a node that has room for one more key are let go.
+     * Indexes with subtree counts keep the whole path latched because every count on it changes.
+     *
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param included - included fields of the record, NULL without included columns
+     * @return true - if the pair was inserted
+     * @return false - if the root changed before its latch was taken and the insert has to start over
+     */
+    bool insertPessimistic(int keyInt, RecordId rid, const char* included);
+
+    /**
+     * @brief unlatch and unpin the first count latched pages and drop them from the lists
+     *
+     * @param pageNos - latched page numbers, in latching order
+     * @param pages - latched pages, in latching order
+     * @param count - number of pages to release from the front
+     */
+    void releaseLatches(std::vector<PageId>& pageNos, std::vector<Page*>& pages, int count);
+
+    /**
+     * @brief whether inserting keyInt makes insertIntoLeaf() split the leaf. Mirrors its cases.
+     *
+     * @param leafPage - leaf the key goes into, latched
+     * @param keyInt - key to be inserted
+     * @return true - if the leaf has to split
+     */
+    bool leafInsertSplits(Page* leafPage, int keyInt);
+
+    /**
+     * @brief one attempt at lookup(). The pinned leaf and posting list pages are searched in place, only the
+     * matching RecordIds are copied out, and the leaf version is checked after each copy.
+     *
+     * @param keyInt - key to look up
+     * @param outRids - filled in with the RecordIds of the key
+     * @return true - if the result is consistent
+     * @return false - if a writer changed the leaf and the lookup has to start over
+     */
+    bool lookupOptimistic(int keyInt, std::vector<RecordId>& outRids);
+
+    /**
+     * @brief appends the RecordIds stored under a key in a leaf that writers may be changing. Counts are
+     * clamped to what fits the leaf, so a torn read gives wrong RecordIds but no offset outside the page.
+     *
+     * @param keyInt - key to look up
+     * @param leafPage - pinned leaf, searched without its latch
+     * @param outRids - RecordIds of the matching slots are appended here, posting list slots included
+     */
+    void unlatchedLeafRun(int keyInt, Page* leafPage, std::vector<RecordId>& outRids);
+
+    /**
+     * @brief appends the RecordIds of a posting list page that writers may be changing. No delta is read
+     * past the bytes the page says are in use.
+     *
+     * @param node - pinned posting list page, read without the latch of its leaf
+     * @param outRids - RecordIds of the page are appended here
+     */
+    void unlatchedPostingPage(PostingNodeInt* node, std::vector<RecordId>& outRids);
+
+    /**
+     * @brief number of entries in use in a leaf
+     *
+     * @param leafPage - leaf to count
+     * @return int - number of keys in leaf
+     */
+    int leafEntryCount(Page* leafPage);
+
+    /**
+     * @brief key at an index of a leaf in either format
+     *
+     * @param leafPage - leaf being read
+     * @param index - index of entry
+     * @return int - the key
+     */
+    int leafKey(Page* leafPage, int index);
+
+    /**
+     * @brief rid at an index of a leaf in either format
+     *
+     * @param leafPage - leaf being read
+     * @param index - index of entry
+     * @return RecordId - the rid, or a posting list reference
+     */
+    RecordId leafRid(Page* leafPage, int index);
+
+    /**
+     * @brief page number of the right sibling field of a leaf in either format
+     *
+     * @param leafPage - leaf being read
+     * @return PageId& - reference to the field
+     */
+    PageId& leafRightSib(Page* leafPage);
+
+    /**
+     * @brief page number of the left sibling field of a leaf in either format
+     *
+     * @param leafPage - leaf being read
+     * @return PageId& - reference to the field
+     */
+    PageId& leafLeftSib(Page* leafPage);
+
+    /**
+     * @brief link a leaf created by a split in between the split leaf and its old right sibling
+     *
+     * @param leafPageNo - leaf that was split
+     * @param leafPage - leaf that was split, pinned
+     * @param newLeafPageNo - new right half
+     * @param newLeafPage - new right half, pinned
+     */
+    void linkSplitLeaf(PageId leafPageNo, Page* leafPage, PageId newLeafPageNo, Page* newLeafPage);
+
+    /**
+     * @brief copy every entry of a leaf into key/rid arrays
+     *
+     * @param leafPage - leaf being read
+     * @param keys - filled in with the keys
+     * @param rids - filled in with the rids
+     * @param included - filled in with the included fields of covering leaves, may be NULL
+     * @param counts - filled in with the number of entries of each slot of a leaf keeping them, may be NULL
+     * @return int - number of entries
+     */
+    int decodeLeaf(Page* leafPage, int* keys, RecordId* rids, char* included = NULL, int* counts = NULL);
+
+    /**
+     * @brief replace the entries of a leaf with the given sorted arrays. Sibling pointers are kept.
+     *
+     * @param leafPage - leaf being written
+     * @param keys - sorted keys
+     * @param rids - rids matching the keys
+     * @param count - number of entries
+     * @param included - included fields matching the keys, needed for covering leaves
+     * @param counts - number of entries of each slot, needed with INDEX_SUBTREE_COUNTS unless no slot holds a posting list
+     */
+    void writeLeaf(Page* leafPage, int* keys, RecordId* rids, int count, const char* included = NULL, const int* counts = NULL);
+
+    /**
+     * @brief end of the lengths of the posting lists of a leaf of an index with INDEX_SUBTREE_COUNTS. They are
+     * stored in slot order from the end of the node down, past the last packed rid of compressed leaves and
+     * in the unused tail of the rid array of the others, so counting never reads a posting list
+     *
+     * @param leafPage - leaf being read
+     * @return unsigned char* - byte after the first length
+     */
+    unsigned char* postingCountEnd(Page* leafPage);
+
+    /**
+     * @brief length of a posting list of a leaf, see postingCountEnd()
+     *
+     * @param leafPage - leaf being read
+     * @param posting - number of posting list slots before the one being read
+     * @return int - number of entries in the posting list
+     */
+    int postingCount(Page* leafPage, int posting);
+
+    /**
+     * @brief store the length of a posting list of a leaf, see postingCountEnd()
+     *
+     * @param leafPage - leaf being written
+     * @param posting - number of posting list slots before the one being written
+     * @param count - number of entries in the posting list
+     */
+    void setPostingCount(Page* leafPage, int posting, int count);
+
+    /**
+     * @brief number of slots holding a posting list
+     *
+     * @param rids - rids of the slots
+     * @param count - number of slots
+     * @return int - number of posting list slots
+     */
+    static int countPostingSlots(const RecordId* rids, int count);
+
+    /**
+     * @brief included fields at an index of a covering leaf
+     *
+     * @param leafPage - leaf being read
+     * @param index - index of entry
+     * @return char* - includedSize bytes
+     */
+    char* leafIncluded(Page* leafPage, int index);
+
+    /**
+     * @brief read the included fields of a record from the relation. Bytes past the end of the record are zero.
+     *
+     * @param rid - record to read
+     * @param out - filled in with includedSize bytes
+     */
+    void fetchIncluded(RecordId rid, char* out);
+
+    /**
+     * @brief set up the members that depend on the included columns, after the index options are known
+     *
+     * @param relationName - relation the fields are read from
+     * @param columns - included columns, empty for none
+     */
+    void setIncludedColumns(const std::string& relationName, const std::vector<ScanField>& columns);
+
+    /**
+     * @brief check included columns asked of a new index before its file is created
+     *
+     * @param attrType - type of the key
+     * @param options - IndexOption values of the index
+     * @param columns - included columns, empty for none
+     * @throws BadIndexInfoException if the index cannot hold them
+     */
+    static void checkIncludedColumns(const Datatype attrType, const int options, const std::vector<ScanField>& columns);
+
+    /**
+     * @brief check the attributes of a composite key before its index file is named or created
+     *
+     * @param components - attributes of the key
+     * @throws BadIndexInfoException if they cannot form a key
+     */
+    static void checkKeyComponents(const std::vector<KeyComponent>& components);
+
+    /**
+     * @brief turn a CompositeKey scan bound into a key of full length. Missing components are filled with the
+     * lowest or highest bytes, so the bound takes in or leaves out every key that starts with it.
+     *
+     * @param bound - bound given to startScan(), may hold only the leading components
+     * @param fillHigh - fill with 0xFF instead of 0
+     * @param out - filled in with the full length bound
+     * @throws BadIndexInfoException if the bound is longer than a key
+     */
+    void compositeBound(const CompositeKey& bound, bool fillHigh, std::string& out);
+
+    /**
+     * @brief whether a leaf holding count entries with the given smallest and largest keys fits in one page
+     *
+     * @param count - number of entries
+     * @param postingSlots - number of entries holding a posting list, whose length takes room with INDEX_SUBTREE_COUNTS
+     * @param minKey - smallest key
+     * @param maxKey - largest key
+     * @param fillFactor - fraction of the page the entries may take
+     * @return true - if the entries fit
+     */
+    bool leafFits(int count, int postingSlots, int minKey, int maxKey, double fillFactor = 1.0);
+
+    /**
+     * @brief number of keys in use in a non leaf node. Keys may be INT_MAX, so the children are counted instead.
+     *
+     * @param nonLeafPage - node to count
+     * @return int - number of keys in node, it has one more child than this
+     */
+    int nonLeafKeyCount(Page* nonLeafPage);
+
+    /**
+     * @brief index of the first key in an array that is not smaller than keyInt (strictly greater if inclusive is false)
+     *
+     * @param keyInt - key being searched for
+     * @param arr - sorted keys
+     * @param count - number of keys in arr
+     * @param inclusive - whether keys equal to keyInt count as a match
+     * @return int - index of first matching key, count if there is none
+     */
+    int findKeyIndexArr(int keyInt, int* arr, int count, bool inclusive);
+
+    /**
+     * @brief same as findKeyIndexArr but searching a leaf page in place, compressed leaves are not decoded
+     *
+     * @param keyInt - key being searched for
+     * @param leafPage - leaf being searched
+     * @param count - number of entries in the leaf
+     * @param inclusive - whether keys equal to keyInt count as a match
+     * @return int - index of first matching key, count if there is none
+     */
+    int findKeyIndex(int keyInt, Page* leafPage, int count, bool inclusive);
+
+    /**
+     * @brief find where this key/rid pair will be going in key/rid arrays. Duplicates of a key are ordered by rid.
+     *
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param arr - sorted keys
+     * @param arrR - rids matching the keys
+     * @param count - number of entries
+     * @return int - index of where the key would be inserted
+     */
+    int findInsertIndex(int keyInt, RecordId rid, int* arr, RecordId* arrR, int count);
+
+    /**
+     * @brief find which child of a non leaf node the key belongs under
+     *
+     * @param keyInt - key being searched for
+     * @param curPage - non leaf node being searched
+     * @return int - index into pageNoArray of the child
+     */
+    int findChildIndex(int keyInt, Page* curPage);
+
+    /**
+     * @brief shift entries right and place key/rid pair at index in a pair of key/rid arrays
+     *
+     * @param index - index the key is to be inserted
+     * @param count - number of entries in use in the arrays
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param arr - array of keys
+     * @param arrR - array of records
      */
-    BTreeIndex(const std::string &relationName, std::string &outIndexName,
-               BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+    void insertHelper(int index, int count, int keyInt, RecordId rid, int* arr, RecordId* arrR);
 
     /**
-     * BTreeIndex Destructor.
-     * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
-     * and delete file instance thereby closing the index file.
-     * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
-     * */
-    ~BTreeIndex();
+     * @brief same as insert helper but for inserting into a non leaf node. The page goes to the right of the key.
+     *
+     * @param index - the index to be inserted at
+     * @param keyInt - the key to be inserted
+     * @param pageNo - the page number to be inserted
+     * @param pageCount - entries under pageNo, moved out of the count of its left neighbour
+     * @param nonLeafPage - the non leaf node being inserted into
+     */
+    void NonLeafNodeInsertHelper(int index, int keyInt, PageId pageNo, int pageCount, Page* nonLeafPage);
 
-    void locatePage(PageId currPageNumber);
+    /**
+     * @brief recursive function to insert the pair into the subtree rooted at pageNo, splitting nodes on the way back up
+     *
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param included - included fields of the record, NULL without included columns
+     * @param pageNo - page of the subtree root
+     * @param isLeaf - whether pageNo is a leaf
+     * @param newChild - filled in with the separator key and new page if pageNo was split
+     * @return true - if pageNo was split and newChild must be inserted into the parent
+     * @return false - if no split happened
+     */
+    bool insertRecursive(int keyInt, RecordId rid, const char* included, PageId pageNo, bool isLeaf, PageKeyPair<int>& newChild);
 
     /**
-     * Insert a new entry using the pair <value,rid>.
-     * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
-     * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
-     * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
-     * Make sure to unpin pages as soon as you can.
-     * @param key			Key to insert, pointer to integer/double/char string
-     * @param rid			Record ID of a record whose entry is getting inserted into the index.
-     **/
-    void insertEntry(const void *key, const RecordId rid);
+     * @brief insert the pair into a leaf, adding to or creating a posting list for heavily duplicated keys
+     *
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param included - included fields of the record, NULL without included columns
+     * @param leafPageNo - leaf to be inserted into
+     * @param newChild - filled in with the separator key and new page if the leaf was split
+     * @return true - if the leaf was split
+     * @return false - if no split happened
+     */
+    bool insertIntoLeaf(int keyInt, RecordId rid, const char* included, PageId leafPageNo, PageKeyPair<int>& newChild);
 
     /**
-     * Begin a filtered scan of the index.  For instance, if the method is called
-     * using ("a",GT,"d",LTE) then we should seek all entries with a value
-     * greater than "a" and less than or equal to "d".
-     * If another scan is already executing, that needs to be ended here.
-     * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
-     * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
-     * @param lowVal	Low value of range, pointer to integer / double / char string
-     * @param lowOp		Low operator (GT/GTE)
-     * @param highVal	High value of range, pointer to integer / double / char string
-     * @param highOp	High operator (LT/LTE)
-     * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
-     * @throws  BadScanrangeException If lowVal > highval
-     * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
-     **/
-    void startScan(const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp);
+     * @brief split a full leaf. The split point is moved to a run boundary so that all entries of a key stay in one leaf.
+     *
+     * @param keyInt - key to be inserted
+     * @param rid - rid to be inserted
+     * @param included - included fields of the record, NULL without included columns
+     * @param leafPageNo - full leaf being split
+     * @param leafPage - full leaf being split, stays pinned
+     * @param keys - keys of the leaf
+     * @param rids - rids of the leaf
+     * @param includedArr - included fields of the leaf, NULL without included columns
+     * @param counts - number of entries of each slot of the leaf, NULL without INDEX_SUBTREE_COUNTS
+     * @param count - number of entries in leaf
+     * @param newChild - filled in with the first key of the new right leaf and its page
+     */
+    void splitLeaf(int keyInt, RecordId rid, const char* included, PageId leafPageNo, Page* leafPage, int* keys, RecordId* rids,
+                   char* includedArr, int* counts, int count, PageKeyPair<int>& newChild);
 
     /**
-     * Fetch the record id of the next index entry that matches the scan.
-     * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
-     * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
-     * @throws ScanNotInitializedException If no scan has been initialized.
-     * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
-     **/
-    void scanNext(RecordId &outRid); // returned record id
+     * @brief split a full non leaf node while inserting the child pushed up from below. The middle key moves up.
+     *
+     * @param nodePage - full node being split, stays pinned
+     * @param index - index the pushed up key would go at
+     * @param pushedUp - separator key and page that caused the split
+     * @param pushedUpCount - entries under the pushed up page
+     * @param newChild - filled in with the key moving up and the new right node
+     */
+    void splitNonLeaf(Page* nodePage, int index, PageKeyPair<int>& pushedUp, int pushedUpCount, PageKeyPair<int>& newChild);
 
     /**
-     * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
-     * @throws ScanNotInitializedException If no scan has been initialized.
-     **/
-    void endScan();
-   /**
-     * @brief initalizes the key array of node to INT_MAX and the pageNoArray to 0 (invalid page)
-     * 
-     * @param nonLeafNode - to be initalized
+     * @brief move a run of duplicate rids into a newly created posting list
+     *
+     * @param rids - sorted rids of the run
+     * @param count - number of rids
+     * @param reuse - false to append the pages to the file and leave the meta page and free list alone
+     * @return PageId - head page of the posting list
      */
-    void initalizeNonLeafNode(NonLeafNodeInt* nonLeafNode);
+    PageId createPostingList(RecordId* rids, int count, bool reuse = true);
 
     /**
-     * @brief initalzies the leaf node by setting all keyArray elements to INT_MAX. ridArray doesn't need to be initalzied as its never used to search.
-     * 
-     * @param leafNode 
+     * @brief insert a rid into a posting list keeping it sorted
+     *
+     * @param headPageNo - head page of the posting list
+     * @param rid - rid to be inserted
      */
-    void initalizeLeafNode(LeafNodeInt* leafNode);
+    void insertIntoPostingList(PageId headPageNo, RecordId rid);
 
     /**
-     * @brief called in constructor to set up instance fields if a b tree file already exists
-     * 
-     * @param indexName - name of the index file
-     * @param bufMgrIn - bufMgr for the index file
-     * @param relationName - name of the relation index is built on
-     * @param attrByteOffset - offset in bytes our key in the record is
-     * @param attrType - type of data were storing
+     * @brief decode every rid of a posting list page
+     *
+     * @param node - posting list page
+     * @param out - array of at least node->numRids entries filled in
      */
-    void handleAlreadyPresent(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int attrByteOffset, const Datatype attrType);
+    void decodePostingPage(PostingNodeInt* node, RecordId* out);
 
     /**
-     * @brief called in constructor to set up new index file and build from scratch
+     * @brief encode rids into an empty posting list page
      *
-     * @param indexName - name of the index file
-     * @param bufMgrIn - bufMgr for the index file
-     * @param relationName - name of the relation index is built on
-     * @param attrByteOffset - offset in bytes our key in the record is
-     * @param attrType - type of data were storing
+     * @param node - posting list page, its rid fields are overwritten
+     * @param rids - sorted rids
+     * @param count - number of rids to try to encode
+     * @return int - number of rids that fit in the page
      */
-    void handleNew(std::string indexName, BufMgr *bufMgrIn, std::string relationName, const int attrByteOffset, const Datatype attrType);
+    int encodePostingPage(PostingNodeInt* node, RecordId* rids, int count);
 
     /**
-     * @brief Create a First Child object of index. Because our root is always a non leaf, first child is special and can have 0 - INTARRAYLEAFSIZE elements
-     * 
-     * @param keyInt - key of very first record
-     * @param rid - very first record
-     * @param root - root page of index
+     * @brief descend from the root to the leaf the key would be in
+     *
+     * @param keyInt - key being searched for
+     * @return PageId - the leaf page
      */
-    void createFirstChild(int keyInt, RecordId rid, NonLeafNodeInt* root);
+    PageId locateLeaf(int keyInt);
 
     /**
-     * @brief special case of when there is only one child node to root. We fill completly from scratch until full
-     * 
-     * @param keyInt - key to be inserted
-     * @param rid - rid to be inserted
-     * @param root - root of index
-     * @return true - if rid was inserted
-     * @return false - if rid was not inserted (first page is full)
+     * @brief pin the leaf a scan starts in and find its first entry, from the bounds already set
+     *
+     * @param ascending - whether the scan starts at the low bound
+     * @throws NoSuchKeyFoundException If no key is within the bounds, with no page left pinned
      */
-    bool insertInFirstPage(int keyInt, RecordId rid, NonLeafNodeInt* root);
+    void locateScanStart(bool ascending);
 
     /**
-     * @brief find where this key/rid pair will be going in the input leaf node
-     * 
-     * @param KeyInt - key to be inserted
-     * @param curNode - node being inserted into
-     * @return int - index of where the key would be inserted 
+     * @brief unpin the posting list page being scanned, if any
      */
-    int findInsertIndex(int KeyInt, LeafNodeInt* curNode);
+    void endPostingScan();
 
     /**
-     * @brief same as findInsertIndex except just for an array of ints
-     * 
-     * @param keyInt - key to be inserted
-     * @param arr - arrray that holds keys
-     * @return int - index of where key would be inserted
+     * @brief key of the current scan entry is past the high bound of the scan
+     *
+     * @param leafPage - leaf being scanned
+     * @param index - index of the entry
+     * @return true - if the scan is complete at this entry
      */
-    int findInsertIndexArr(int keyInt, int* arr);
+    bool pastHighBound(Page* leafPage, int index);
 
     /**
-     * @brief finds the insert index when we need to split 
-     * 
-     * @param keyInt - key to be inserted
-     * @param curNode - node that is being inserted into
-     * @return int - index of where the key would be inserted
+     * @brief key of the current scan entry is past the low bound of a descending scan
+     *
+     * @param leafPage - leaf being scanned
+     * @param index - index of the entry
+     * @return true - if the scan is complete at this entry
      */
-    int findInsertIndexSplit(int keyInt, LeafNodeInt* curNode);
+    bool pastLowBound(Page* leafPage, int index);
+
+    // STRING KEYS, see btree_string.cpp
 
     /**
-     * @brief actuallu inserts key/rid pair into a node at the correct position
-     * 
-     * @param regular - whether or not this is being called after the first node is complete
-     * @param index - index the key is to be inserted
-     * @param keyInt - key to be inserted
-     * @param rid - rid to be inserted
-     * @param root - root of the index
-     * @param firstNode - node of first node of root
+     * @brief initalizes an empty node of a STRING index
+     *
+     * @param node - node to be initalized
+     * @param isLeaf - whether the node is a leaf
+     * @param level - level of a non leaf node
+     */
+    void initalizeStringNode(SlottedNodeString* node, bool isLeaf, int level);
+
+    /**
+     * @brief compare the key at an index of a string node with a key
+     *
+     * @param node - node being read
+     * @param index - slot index
+     * @param key - key bytes
+     * @param keyLength - number of key bytes
+     * @return int - negative, zero or positive as the node key is smaller, equal or larger
      */
-    void insertHelper(bool regular, int index, int keyInt, RecordId rid, NonLeafNodeInt* root, LeafNodeInt* firstNode);
+    int compareStringKey(SlottedNodeString* node, int index, const char* key, int keyLength);
 
+    /**
+     * @brief full key at an index of a string node, prefix included
+     *
+     * @param node - node being read
+     * @param index - slot index
+     * @return std::string - the key
+     */
+    std::string stringKeyAt(SlottedNodeString* node, int index);
 
     /**
-     * @brief same as insert helper but just for an int array
-     * 
-     * @param index - index to be inserted at
-     * @param keyInt - key to be inserted
-     * @param arr - array to be inserted into
-     * @param arrR - arrray of records
+     * @brief index of the first key in a string node that is not smaller than key (strictly greater if inclusive is false)
+     *
+     * @param key - key bytes
+     * @param keyLength - number of key bytes
+     * @param node - node being searched
+     * @param inclusive - whether keys equal to key count as a match
+     * @return int - index of first matching key, numSlots if there is none
+     */
+    int findStringIndex(const char* key, int keyLength, SlottedNodeString* node, bool inclusive);
+
+    /**
+     * @brief child page of a non leaf string node
+     *
+     * @param node - non leaf node
+     * @param index - child index, 0 is the leftmost child
+     * @return PageId - the child
+     */
+    PageId stringChildAt(SlottedNodeString* node, int index);
+
+    /**
+     * @brief copy every entry of a string leaf out of the page
+     *
+     * @param node - leaf being read
+     * @param entries - filled in with the entries
+     */
+    void decodeStringLeaf(SlottedNodeString* node, std::vector<RIDKeyPair<std::string> >& entries);
+
+    /**
+     * @brief bytes a string leaf holding entries [begin, end) needs, common prefix factored out
+     *
+     * @param entries - sorted entries
+     * @param begin - first entry
+     * @param end - one past the last entry
+     * @return int - number of data bytes needed
+     */
+    int stringLeafSize(std::vector<RIDKeyPair<std::string> >& entries, int begin, int end);
+
+    /**
+     * @brief replace the contents of a string leaf with entries [begin, end). Sibling pointers are kept.
+     *
+     * @param node - leaf being written
+     * @param entries - sorted entries, must fit
+     * @param begin - first entry
+     * @param end - one past the last entry
+     */
+    void encodeStringLeaf(SlottedNodeString* node, std::vector<RIDKeyPair<std::string> >& entries, int begin, int end);
+
+    /**
+     * @brief copy the separators and children of a non leaf string node out of the page
+     *
+     * @param node - node being read
+     * @param entries - filled in with each separator and the child to its right
+     * @return PageId - the leftmost child
+     */
+    PageId decodeStringNonLeaf(SlottedNodeString* node, std::vector<PageKeyPair<std::string> >& entries);
+
+    /**
+     * @brief bytes a non leaf string node holding entries [begin, end) needs
+     *
+     * @param entries - separators and children
+     * @param begin - first entry
+     * @param end - one past the last entry
+     * @return int - number of data bytes needed
+     */
+    int stringNonLeafSize(std::vector<PageKeyPair<std::string> >& entries, int begin, int end);
+
+    /**
+     * @brief replace the contents of a non leaf string node. Level is kept.
+     *
+     * @param node - node being written
+     * @param leftmost - leftmost child
+     * @param entries - separators and children, must fit
+     * @param begin - first entry
+     * @param end - one past the last entry
+     */
+    void encodeStringNonLeaf(SlottedNodeString* node, PageId leftmost, std::vector<PageKeyPair<std::string> >& entries, int begin, int end);
+
+    /**
+     * @brief shortest separator that is larger than left and not larger than right (suffix truncation)
+     *
+     * @param left - last key of the left node
+     * @param right - first key of the right node
+     * @return std::string - the separator
+     */
+    std::string shortestSeparator(const std::string& left, const std::string& right);
+
+    /**
+     * @brief insert a key/rid pair, inside the transaction insertEntry opened if changes are logged
+     *
+     * @param key - key to insert, as passed to insertEntry
      * @param rid - rid to be inserted
      */
-    void insertHelperArr(int index, int keyInt, int* arr, RecordId* arrR, RecordId rid);
+    void applyInsert(const void *key, const RecordId rid);
 
     /**
-     * @brief same as insert helper but for inserting into a non leaf node
-     * 
-     * @param index - the index to be inserted at
-     * @param keyInt - the key to be inserted
-     * @param pageNo - the page number to be inserted
-     * @param leafHolder - the nonLeafNode that holds the leaf
+     * @brief insert a key/rid pair into a STRING index
+     *
+     * @param key - key bytes
+     * @param keyLength - number of key bytes
+     * @param rid - rid to be inserted
      */
-    void NonLeafNodeInsertHelper(int index, int keyInt, PageId pageNo, NonLeafNodeInt* leafHolder);
+    void insertEntryString(const char* key, int keyLength, RecordId rid);
 
     /**
-     * @brief recursive function to traverse tree and find in logn pages
-     * 
-     * @param keyInt - the key trying to find
-     * @param curRoot - the nonleaf node we are searching from
-     * @param curRootPageId - current page no of curroot
-     * @param index - the index that we need to insert at
-     * @param leafHolder - the nonleafnode that holds the leaf we need to insert into
-     * @param leafHolderPageId - the page no of above 
+     * @brief recursive function to insert the pair into the subtree rooted at pageNo of a STRING index
+     *
+     * @param key - key bytes
+     * @param keyLength - number of key bytes
+     * @param rid - rid to be inserted
+     * @param pageNo - page of the subtree root
+     * @param isLeaf - whether pageNo is a leaf
+     * @param newChild - filled in with the separator key and new page if pageNo was split
+     * @return true - if pageNo was split
+     * @return false - if no split happened
      */
-    void findPlace(int keyInt, NonLeafNodeInt* curRoot, PageId curRootPageId, int& index, NonLeafNodeInt*& leafHolder, PageId& leafHolderPageId);
+    bool insertStringRecursive(const char* key, int keyLength, RecordId rid, PageId pageNo, bool isLeaf, PageKeyPair<std::string>& newChild);
 
     /**
-     * @brief hanles insert if there are no splits invloved
-     * 
-     * @param keyInt - key to be inserted 
+     * @brief insert the pair into a string leaf, in place when the key shares the leaf prefix and fits
+     *
+     * @param key - key bytes
+     * @param keyLength - number of key bytes
      * @param rid - rid to be inserted
-     * @param root - root of tree
-     * @param index - index to be inserted at
-     * @param leafHolder - nonleafnode that  holds leaf to be inserrted at
-     * @return true - whether a splitless insert occured
-     * @return false - whether a splitless insert occured
+     * @param leafPageNo - leaf to be inserted into
+     * @param newChild - filled in with the separator key and new page if the leaf was split
+     * @return true - if the leaf was split
+     * @return false - if no split happened
+     */
+    bool insertIntoStringLeaf(const char* key, int keyLength, RecordId rid, PageId leafPageNo, PageKeyPair<std::string>& newChild);
+
+    /**
+     * @brief descend from the root of a STRING index to the leftmost, or rightmost, leaf that may hold key
+     *
+     * @param key - key bytes
+     * @param keyLength - number of key bytes
+     * @param rightmost - find the last leaf that may hold key, used by descending scans
+     * @return PageId - the leaf page
+     */
+    PageId locateStringLeaf(const char* key, int keyLength, bool rightmost);
+
+    /**
+     * @brief name of the index file of an attribute of a relation
+     *
+     * @param relationName - relation being indexed
+     * @param attrByteOffset - offset of the attribute
+     * @return std::string - relationName.attrByteOffset
+     */
+    static std::string indexFileName(const std::string& relationName, int attrByteOffset);
+
+    /**
+     * @brief name of the index file of a composite key of a relation
+     *
+     * @param relationName - relation being indexed
+     * @param components - attributes of the key
+     * @return std::string - relationName followed by the offset of every component
+     */
+    static std::string indexFileName(const std::string& relationName, const std::vector<KeyComponent>& components);
+
+    /**
+     * @brief reset the members of the scan state so that no scan is executing
+     */
+    void initalizeScanState();
+
+    /**
+     * @brief fill a new index from its relation. Each thread sorts the entries of an equal share of the relation
+     * pages and the runs are merged. INTEGER indexes are bulk loaded, STRING entries are inserted in key order.
+     *
+     * @param relationName - relation being indexed
+     * @param buildThreads - number of threads, 0 for one per hardware thread
+     */
+    void buildIndex(const std::string& relationName, int buildThreads);
+
+    /**
+     * @brief fill a new index from all of its entries, sorted
+     *
+     * @param intEntries - entries of a non STRING index, emptied here
+     * @param stringEntries - entries of a STRING index, emptied here
+     */
+    void loadEntries(std::vector<RIDKeyPair<int> >& intEntries, std::vector<RIDKeyPair<std::string> >& stringEntries);
+
+    /**
+     * @brief fill an INTEGER tree bottom up: posting lists, then leaves left to right, then each level of non leaf
+     * nodes with the children spread evenly, the last level written into the root page. Every page goes to the
+     * end of the file and nothing else in it changes, so the tree only becomes reachable through its root.
+     *
+     * @param entries - every entry of the tree, sorted
+     * @param entryIncluded - included fields of every entry, NULL to read them from the relation
+     * @param fillFactor - fraction of each leaf and non leaf node to fill
+     * @param rootPageNo - empty root to write the top level into, Page::INVALID_NUMBER for a new one
+     * @return PageId - root of the tree
+     */
+    PageId bulkLoad(const std::vector<RIDKeyPair<int> >& entries, const char* entryIncluded, double fillFactor, PageId rootPageNo);
+
+    /**
+     * @brief write a new leaf to the right of the last one written by the bulk load
+     *
+     * @param keys - keys of the leaf
+     * @param rids - rids of the leaf
+     * @param included - included fields of the leaf, NULL without included columns
+     * @param counts - number of entries of each slot, NULL without INDEX_SUBTREE_COUNTS
+     * @param count - number of entries
+     * @param prevLeafPageNo - leaf to its left, Page::INVALID_NUMBER for the first leaf
+     * @return PageId - the new leaf
+     */
+    PageId appendBulkLeaf(int* keys, RecordId* rids, const char* included, const int* counts, int count, PageId prevLeafPageNo);
+
+    /**
+     * @brief write children [begin, end) of the level below into a non leaf node being bulk loaded
+     *
+     * @param nodePage - node to write
+     * @param level - level of the node, 1 if its children are leaves
+     * @param children - smallest key and page of every node on the level below
+     * @param childCounts - number of entries under every node on the level below
+     * @param begin - first child of the node
+     * @param end - one past the last child of the node
+     * @return int - number of entries under the node
+     */
+    int bulkLoadNonLeaf(Page* nodePage, int level, std::vector<PageKeyPair<int> >& children, std::vector<int>& childCounts, int begin, int end);
+
+    /**
+     * @brief shared part of both parallelScan() calls: check the arguments, cut the range and run the workers
+     *
+     * @param lowValParm - low value of range
+     * @param lowOpParm - low operator
+     * @param highValParm - high value of range
+     * @param highOpParm - high operator
+     * @param numThreads - number of threads, 0 for one per hardware thread
+     * @param partitionRids - filled in with the RecordIds of every piece when visit is NULL
+     * @param visit - called for every RecordId instead, may be NULL
+     */
+    void runParallelScan(const void *lowValParm, const Operator lowOpParm, const void *highValParm, const Operator highOpParm,
+                         int numThreads, std::vector<std::vector<RecordId> >& partitionRids,
+                         const std::function<void(int, const RecordId &)>* visit);
+
+    /**
+     * @brief descend level by level, keeping the children overlapping [low, high], until there are maxPartitions of
+     * them or they are leaves, and pick cut keys evenly spread over their separators
+     *
+     * @param low - smallest key of the range
+     * @param high - largest key of the range
+     * @param maxPartitions - most pieces wanted
+     * @param cuts - filled in with the first key of every piece but the first, ascending
+     */
+    void partitionRange(std::int64_t low, std::int64_t high, int maxPartitions, std::vector<std::int64_t>& cuts);
+
+    /**
+     * @brief body of one parallel scan thread, scanning pieces until none is left to take or steal
+     *
+     * @param worker - number of this worker
+     * @param queues - pieces still to scan
+     * @param low - smallest key of the range
+     * @param high - largest key of the range
+     * @param cuts - first key of every piece but the first
+     * @param partitionRids - RecordIds of every piece, filled in when visit is NULL
+     * @param visit - called for every RecordId instead, may be NULL
+     * @param error - set to the exception that stopped the worker, if any
+     */
+    void parallelScanWorker(int worker, WorkStealingQueues* queues, std::int64_t low, std::int64_t high,
+                            const std::vector<std::int64_t>* cuts, std::vector<std::vector<RecordId> >* partitionRids,
+                            const std::function<void(int, const RecordId &)>* visit, std::exception_ptr* error);
+
+    /**
+     * @brief cursor of a parallel scan: append the RecordIds of all keys in [low, high], walking right from the leaf of low
+     *
+     * @param low - smallest key
+     * @param high - largest key
+     * @param outRids - RecordIds appended in key order
+     */
+    void scanPartition(std::int64_t low, std::int64_t high, std::vector<RecordId>& outRids);
+
+    /**
+     * @brief append every RecordId of a posting list, in rid order
+     *
+     * @param headPageNo - first page of the list
+     * @param outRids - RecordIds appended
+     */
+    void appendPostingList(PageId headPageNo, std::vector<RecordId>& outRids);
+
+    /**
+     * @brief body of one stats() thread, reading nodes of a level until none is left to take or steal
+     *
+     * @param worker - number of this worker
+     * @param queues - indexes into level of the nodes still to read
+     * @param level - nodes of the level, in key order
+     * @param leaves - whether the level is the leaves
+     * @param children - filled in with the children of every node of a non-leaf level, in key order
+     * @param fills - filled in with the fraction of the space of every node in use
+     * @param entries - filled in with the number of entries of every leaf, posting lists included
+     * @param postingPages - filled in with the number of posting list pages of every leaf
+     * @param error - set to the exception that stopped the worker, if any
+     */
+    void statsWorker(int worker, WorkStealingQueues* queues, const std::vector<PageId>* level, bool leaves,
+                     std::vector<std::vector<PageId> >* children, std::vector<double>* fills,
+                     std::vector<std::uint64_t>* entries, std::vector<int>* postingPages, std::exception_ptr* error);
+
+    /**
+     * @brief fraction of the space of a node in use
+     *
+     * @param nodePage - page of the node
+     * @param leaf - whether the node is a leaf
+     * @param count - number of entries of a leaf or keys of a non-leaf node
+     */
+    double nodeFill(Page* nodePage, bool leaf, int count);
+
+    /**
+     * @brief wait until reorganize() lets inserts in and count this one as running
+     */
+    void enterInsert();
+
+    /**
+     * @brief count this insert as finished, waking reorganize() if it waits for the last one
+     */
+    void leaveInsert();
+
+    /**
+     * @brief hold new inserts back and wait for the running ones to finish
+     */
+    void pauseInserts();
+
+    /**
+     * @brief let inserts in again
+     */
+    void resumeInserts();
+
+    /**
+     * @brief count a lookup, count or scan as reading the tree
+     *
+     * @return int - readEpoch the read started in, to pass to leaveRead()
+     */
+    int enterRead();
+
+    /**
+     * @brief count a read as finished, waking reorganize() if it waits for the last one of its epoch
+     *
+     * @param epoch - value returned by enterRead()
+     */
+    void leaveRead(int epoch);
+
+    /**
+     * @brief start a new read epoch and wait for the reads started in the previous one to finish
+     */
+    void waitForOldReads();
+
+    /**
+     * @brief list every page of a tree, the posting lists of its leaves included
+     *
+     * @param rootPageNo - root of the tree, which no insert may change
+     * @param pageNos - pages to append to
+     */
+    void collectTreePages(PageId rootPageNo, std::vector<PageId>& pageNos);
+
+    /**
+     * @brief keep an entry inserted during reorganize() if its leaf was already copied. Called with the leaf latched.
+     *
+     * @param leafPageNo - leaf the entry went into
+     * @param newLeafPageNo - leaf split off it, Page::INVALID_NUMBER if it did not split
+     * @param keyInt - key of the entry
+     * @param rid - rid of the entry
+     */
+    void noteReorganizeInsert(PageId leafPageNo, PageId newLeafPageNo, int keyInt, RecordId rid);
+
+    /**
+     * @brief reorganize() of an INTEGER index, inserts go on while the leaves are copied
+     *
+     * @param fillFactor - fraction of each node to fill
+     */
+    void reorganizeInt(double fillFactor);
+
+    /**
+     * @brief reorganize() of a STRING index, inserts are paused throughout
+     *
+     * @param fillFactor - fraction of each node to fill
+     */
+    void reorganizeString(double fillFactor);
+
+    /**
+     * @brief append the entries of a leaf, posting lists expanded, and mark it copied. The leaf is latched meanwhile.
+     *
+     * @param leafPageNo - leaf to copy
+     * @param entries - entries to append to
+     * @param included - included fields to append to, one per entry
+     * @return PageId - leaf to its right, Page::INVALID_NUMBER after the last one
+     */
+    PageId copyLeaf(PageId leafPageNo, std::vector<RIDKeyPair<int> >& entries, std::vector<char>& included);
+
+    /**
+     * @brief build a STRING tree from its sorted entries, packing slotted nodes to the fill factor. Every page goes
+     * to the end of the file and the meta page is left as it was.
+     *
+     * @param entries - every entry of the tree, sorted
+     * @param fillFactor - fraction of the data area of each node to fill
+     * @return PageId - root of the tree
      */
-    bool easyInsert(int keyInt, RecordId rid, NonLeafNodeInt* root, int index, NonLeafNodeInt* leafHolder);
+    PageId bulkLoadString(std::vector<RIDKeyPair<std::string> >& entries, double fillFactor);
   };
 
 }
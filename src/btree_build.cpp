@@ -0,0 +1,491 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "file_iterator.h"
+#include "page_iterator.h"
+
+/**
+ * @file btree_build.cpp
+ * @brief Building new BTreeIndexes from their relation. The heap pages are split between threads,
+ * every thread sorts the entries of its pages into one run per index and the runs are merged.
+ * INTEGER indexes are then bulk loaded bottom up, STRING and composite indexes get the entries inserted in key order.
+ * Several indexes of one relation can be built from a single read of it.
+ */
+
+namespace badgerdb
+{
+
+    static void extractKey(const char *record, int attrByteOffset, int &key)
+    {
+        key = *((const int *)(record + attrByteOffset));
+    }
+
+    static void extractKey(const char *record, int attrByteOffset, std::string &key)
+    {
+        const char *start = record + attrByteOffset;
+        key.assign(start, strnlen(start, STRINGKEYSIZE));
+    }
+
+    /**
+     * @brief Sorted runs one thread produced, one per index being built. Only the vector matching
+     * the key type of an index is used.
+     */
+    struct BuildRuns
+    {
+        std::vector<std::vector<RIDKeyPair<int> > > intRuns;
+        std::vector<std::vector<RIDKeyPair<std::string> > > stringRuns;
+    };
+
+    /**
+     * @brief collect and sort the entries of every index from the relation pages [begin, end). Each page is
+     * pinned once for all the indexes. Runs on its own thread, so any exception is handed back through error.
+     */
+    static void extractRuns(BufMgr *bufMgr, PageFile *relationFile, const std::vector<PageId> &pageNos, int begin, int end,
+                            const std::vector<IndexSpec> &specs, BuildRuns &runs, std::exception_ptr &error)
+    {
+        try
+        {
+            runs.intRuns.resize(specs.size());
+            runs.stringRuns.resize(specs.size());
+            for (int i = begin; i < end; i++)
+            {
+                Page *page;
+                bufMgr->readPage(relationFile, pageNos[i], page);
+                for (PageIterator it = page->begin(); it != page->end(); it++)
+                {
+                    // keys are read straight off the pinned page
+                    RecordId rid = it.getCurrentRecord();
+                    std::size_t length;
+                    const char *record = page->getRecordData(rid, length);
+                    for (size_t s = 0; s < specs.size(); s++)
+                    {
+                        if (!specs[s].keyComponents.empty())
+                        {
+                            RIDKeyPair<std::string> entry;
+                            entry.key = CompositeKey::fromRecord(record, specs[s].keyComponents).bytes();
+                            entry.rid = rid;
+                            runs.stringRuns[s].push_back(entry);
+                        }
+                        else if (specs[s].attrType == STRING)
+                        {
+                            RIDKeyPair<std::string> entry;
+                            extractKey(record, specs[s].attrByteOffset, entry.key);
+                            entry.rid = rid;
+                            runs.stringRuns[s].push_back(entry);
+                        }
+                        else
+                        {
+                            RIDKeyPair<int> entry;
+                            extractKey(record, specs[s].attrByteOffset, entry.key);
+                            entry.rid = rid;
+                            runs.intRuns[s].push_back(entry);
+                        }
+                    }
+                }
+                bufMgr->unPinPage(relationFile, pageNos[i], false);
+            }
+            for (size_t s = 0; s < specs.size(); s++)
+            {
+                std::sort(runs.intRuns[s].begin(), runs.intRuns[s].end());
+                std::sort(runs.stringRuns[s].begin(), runs.stringRuns[s].end());
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    /**
+     * @brief k-way merge of sorted runs, the smallest head of all runs is kept at the top of a heap
+     */
+    template <class T>
+    static void mergeRuns(std::vector<std::vector<RIDKeyPair<T> > > &runs, std::vector<RIDKeyPair<T> > &merged)
+    {
+        typedef std::pair<RIDKeyPair<T>, int> RunHead;
+        std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead> > heads;
+        std::vector<size_t> positions(runs.size(), 0);
+        size_t total = 0;
+        for (size_t r = 0; r < runs.size(); r++)
+        {
+            total += runs[r].size();
+            if (!runs[r].empty())
+            {
+                heads.push(RunHead(runs[r][0], r));
+            }
+        }
+
+        merged.reserve(total);
+        while (!heads.empty())
+        {
+            int r = heads.top().second;
+            merged.push_back(heads.top().first);
+            heads.pop();
+            if (++positions[r] < runs[r].size())
+            {
+                heads.push(RunHead(runs[r][positions[r]], r));
+            }
+            else
+            {
+                std::vector<RIDKeyPair<T> >().swap(runs[r]);
+            }
+        }
+    }
+
+    /**
+     * @brief read the relation once, splitting its pages evenly between threads, and return the sorted
+     * entries of every index
+     */
+    static void readRelation(BufMgr *bufMgr, const std::string &relationName, const std::vector<IndexSpec> &specs, int buildThreads,
+                             std::vector<std::vector<RIDKeyPair<int> > > &intEntries,
+                             std::vector<std::vector<RIDKeyPair<std::string> > > &stringEntries)
+    {
+        PageFile relationFile(relationName, false);
+        std::vector<PageId> pageNos = relationFile.pageDirectory();
+
+        int numThreads = buildThreads > 0 ? buildThreads : (int)std::thread::hardware_concurrency();
+        numThreads = std::max(1, std::min(numThreads, (int)pageNos.size()));
+        std::vector<BuildRuns> runs(numThreads);
+        std::vector<std::exception_ptr> errors(numThreads);
+        std::vector<std::thread> threads;
+        int numPageNos = pageNos.size();
+        for (int t = 0; t < numThreads; t++)
+        {
+            int begin = (int)((long long)numPageNos * t / numThreads);
+            int end = (int)((long long)numPageNos * (t + 1) / numThreads);
+            threads.push_back(std::thread(extractRuns, bufMgr, &relationFile, std::cref(pageNos), begin, end,
+                                          std::cref(specs), std::ref(runs[t]), std::ref(errors[t])));
+        }
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads[t].join();
+        }
+        bufMgr->flushFile(&relationFile);
+        for (int t = 0; t < numThreads; t++)
+        {
+            if (errors[t])
+            {
+                std::rethrow_exception(errors[t]);
+            }
+        }
+
+        intEntries.resize(specs.size());
+        stringEntries.resize(specs.size());
+        for (size_t s = 0; s < specs.size(); s++)
+        {
+            std::vector<std::vector<RIDKeyPair<int> > > intRuns(numThreads);
+            std::vector<std::vector<RIDKeyPair<std::string> > > stringRuns(numThreads);
+            for (int t = 0; t < numThreads; t++)
+            {
+                intRuns[t].swap(runs[t].intRuns[s]);
+                stringRuns[t].swap(runs[t].stringRuns[s]);
+            }
+            mergeRuns(intRuns, intEntries[s]);
+            mergeRuns(stringRuns, stringEntries[s]);
+        }
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::buildIndex
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::buildIndex(const std::string &relationName, int buildThreads)
+    {
+        std::vector<IndexSpec> specs(1);
+        specs[0].attrByteOffset = attrByteOffset;
+        specs[0].attrType = attributeType;
+        specs[0].indexOptions = indexOptions;
+        specs[0].keyComponents = keyComponents;
+        std::vector<std::vector<RIDKeyPair<int> > > intEntries;
+        std::vector<std::vector<RIDKeyPair<std::string> > > stringEntries;
+        readRelation(bufMgr, relationName, specs, buildThreads, intEntries, stringEntries);
+        loadEntries(intEntries[0], stringEntries[0]);
+    }
+
+    void BTreeIndex::buildIndexes(const std::string &relationName, const std::vector<IndexSpec> &specs,
+                                  std::vector<std::string> &outIndexNames, BufMgr *bufMgrIn, const int buildThreads)
+    {
+        // only indexes without a file are built, each once
+        std::vector<IndexSpec> newSpecs;
+        std::vector<std::string> newNames;
+        outIndexNames.clear();
+        for (size_t s = 0; s < specs.size(); s++)
+        {
+            if (!specs[s].keyComponents.empty())
+            {
+                checkKeyComponents(specs[s].keyComponents);
+            }
+            std::string indexName = specs[s].keyComponents.empty() ? indexFileName(relationName, specs[s].attrByteOffset)
+                                                                   : indexFileName(relationName, specs[s].keyComponents);
+            outIndexNames.push_back(indexName);
+            if (!File::exists(indexName) && std::find(newNames.begin(), newNames.end(), indexName) == newNames.end())
+            {
+                newSpecs.push_back(specs[s]);
+                newNames.push_back(indexName);
+            }
+        }
+        if (newSpecs.empty())
+        {
+            return;
+        }
+
+        std::vector<std::vector<RIDKeyPair<int> > > intEntries;
+        std::vector<std::vector<RIDKeyPair<std::string> > > stringEntries;
+        readRelation(bufMgrIn, relationName, newSpecs, buildThreads, intEntries, stringEntries);
+        for (size_t s = 0; s < newSpecs.size(); s++)
+        {
+            BTreeIndex index(relationName, bufMgrIn, newSpecs[s], intEntries[s], stringEntries[s]);
+        }
+    }
+
+    void BTreeIndex::loadEntries(std::vector<RIDKeyPair<int> > &intEntries, std::vector<RIDKeyPair<std::string> > &stringEntries)
+    {
+        if (attributeType == STRING)
+        {
+            for (size_t i = 0; i < stringEntries.size(); i++)
+            {
+                insertEntryString(stringEntries[i].key.data(), stringEntries[i].key.size(), stringEntries[i].rid);
+            }
+        }
+        else
+        {
+            bulkLoad(intEntries, NULL, 1.0, rootPageNum);
+            updateMetaInfo();
+        }
+        std::vector<RIDKeyPair<int> >().swap(intEntries);
+        std::vector<RIDKeyPair<std::string> >().swap(stringEntries);
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::bulkLoad
+    // -----------------------------------------------------------------------------
+
+    PageId BTreeIndex::bulkLoad(const std::vector<RIDKeyPair<int> > &entries, const char *entryIncluded, double fillFactor, PageId rootPageNo)
+    {
+        if (entries.empty())
+        {
+            return rootPageNo;
+        }
+
+        // posting lists are written first, so the leaves after them take consecutive pages
+        std::vector<PageId> postingPageNos;
+        size_t runStart = 0;
+        while (runStart < entries.size())
+        {
+            size_t runEnd = runStart + 1;
+            while (runEnd < entries.size() && entries[runEnd].key == entries[runStart].key)
+            {
+                runEnd++;
+            }
+            int runLength = runEnd - runStart;
+            if (runLength >= postingThreshold)
+            {
+                std::vector<RecordId> runRids(runLength);
+                for (int i = 0; i < runLength; i++)
+                {
+                    runRids[i] = entries[runStart + i].rid;
+                }
+                bufMgr->beginTransaction();
+                postingPageNos.push_back(createPostingList(&runRids[0], runLength, false));
+                bufMgr->commitTransaction(false);
+            }
+            runStart = runEnd;
+        }
+
+        // fill leaves left to right. A key never spans two leaves and long runs go to posting lists
+        std::vector<PageKeyPair<int> > children;
+        std::vector<int> childCounts;
+        int keys[COMPRESSEDLEAFMAXSIZE + 1];
+        RecordId rids[COMPRESSEDLEAFMAXSIZE + 1];
+        int slotCounts[COMPRESSEDLEAFMAXSIZE + 1];
+        int *counts = (indexOptions & INDEX_SUBTREE_COUNTS) ? slotCounts : NULL;
+        std::vector<char> includedArr(relationFile != NULL ? COVERINGLEAFDATASIZE + MAXINCLUDEDSIZE : 0);
+        char *included = relationFile != NULL ? &includedArr[0] : NULL;
+        int count = 0;
+        int postingSlots = 0;
+        int leafEntries = 0;
+        size_t nextPosting = 0;
+        PageId prevLeafPageNo = Page::INVALID_NUMBER;
+        runStart = 0;
+        while (runStart < entries.size())
+        {
+            int key = entries[runStart].key;
+            size_t runEnd = runStart + 1;
+            while (runEnd < entries.size() && entries[runEnd].key == key)
+            {
+                runEnd++;
+            }
+            int runLength = runEnd - runStart;
+            bool posting = runLength >= postingThreshold;
+            int slots = posting ? 1 : runLength;
+
+            if (count > 0 && !leafFits(count + slots, postingSlots + posting, keys[0], key, fillFactor))
+            {
+                prevLeafPageNo = appendBulkLeaf(keys, rids, included, counts, count, prevLeafPageNo);
+                PageKeyPair<int> leaf;
+                leaf.set(prevLeafPageNo, keys[0]);
+                children.push_back(leaf);
+                childCounts.push_back(leafEntries);
+                count = 0;
+                postingSlots = 0;
+                leafEntries = 0;
+            }
+
+            if (posting)
+            {
+                keys[count] = key;
+                rids[count].page_number = postingPageNos[nextPosting++];
+                rids[count].slot_number = Page::INVALID_SLOT;
+                rids[count].padding = 0;
+                if (included != NULL)
+                {
+                    // rids in a posting list read their fields from the relation
+                    memset(included + count * includedSize, 0, includedSize);
+                }
+                if (counts != NULL)
+                {
+                    counts[count] = runLength;
+                }
+                count++;
+                postingSlots++;
+            }
+            else
+            {
+                for (size_t i = runStart; i < runEnd; i++)
+                {
+                    keys[count] = key;
+                    rids[count] = entries[i].rid;
+                    if (counts != NULL)
+                    {
+                        counts[count] = 1;
+                    }
+                    if (included != NULL && entryIncluded != NULL)
+                    {
+                        memcpy(included + count * includedSize, entryIncluded + i * includedSize, includedSize);
+                    }
+                    else if (included != NULL)
+                    {
+                        fetchIncluded(entries[i].rid, included + count * includedSize);
+                    }
+                    count++;
+                }
+            }
+            leafEntries += runLength;
+            runStart = runEnd;
+        }
+        prevLeafPageNo = appendBulkLeaf(keys, rids, included, counts, count, prevLeafPageNo);
+        PageKeyPair<int> lastLeaf;
+        lastLeaf.set(prevLeafPageNo, keys[0]);
+        children.push_back(lastLeaf);
+        childCounts.push_back(leafEntries);
+
+        // build levels of non leaf nodes until the children fit in the root, spreading children evenly
+        int maxChildren = std::max(2, (int)((nodeOccupancy + 1) * fillFactor));
+        int level = 1;
+        while ((int)children.size() > nodeOccupancy + 1)
+        {
+            std::vector<PageKeyPair<int> > parents;
+            std::vector<int> parentCounts;
+            int numChildren = children.size();
+            int numNodes = (numChildren + maxChildren - 1) / maxChildren;
+            for (int n = 0; n < numNodes; n++)
+            {
+                int begin = (int)((long long)numChildren * n / numNodes);
+                int end = (int)((long long)numChildren * (n + 1) / numNodes);
+                Page *nodePage;
+                PageId nodePageNo;
+                bufMgr->beginTransaction();
+                bufMgr->allocPage(file, nodePageNo, nodePage);
+                numPages++;
+                int total = bulkLoadNonLeaf(nodePage, level, children, childCounts, begin, end);
+                bufMgr->unPinPage(file, nodePageNo, true);
+                bufMgr->commitTransaction(false);
+
+                PageKeyPair<int> parent;
+                parent.set(nodePageNo, children[begin].key);
+                parents.push_back(parent);
+                parentCounts.push_back(total);
+            }
+            children.swap(parents);
+            childCounts.swap(parentCounts);
+            level = 0;
+        }
+
+        Page *rootPage;
+        bufMgr->beginTransaction();
+        if (rootPageNo == Page::INVALID_NUMBER)
+        {
+            bufMgr->allocPage(file, rootPageNo, rootPage);
+            numPages++;
+        }
+        else
+        {
+            bufMgr->readPage(file, rootPageNo, rootPage);
+        }
+        bulkLoadNonLeaf(rootPage, level, children, childCounts, 0, children.size());
+        bufMgr->unPinPage(file, rootPageNo, true);
+        bufMgr->commitTransaction(false);
+        return rootPageNo;
+    }
+
+    PageId BTreeIndex::appendBulkLeaf(int *keys, RecordId *rids, const char *included, const int *counts, int count, PageId prevLeafPageNo)
+    {
+        // one transaction per leaf, so a logged pool never holds more than two leaves back
+        bufMgr->beginTransaction();
+        Page *leafPage;
+        PageId leafPageNo;
+        bufMgr->allocPage(file, leafPageNo, leafPage);
+        numPages++;
+        initalizeLeafPage(leafPage);
+        writeLeaf(leafPage, keys, rids, count, included, counts);
+        leafLeftSib(leafPage) = prevLeafPageNo;
+        bufMgr->unPinPage(file, leafPageNo, true);
+
+        if (prevLeafPageNo != Page::INVALID_NUMBER)
+        {
+            Page *prevLeafPage;
+            bufMgr->readPage(file, prevLeafPageNo, prevLeafPage);
+            leafRightSib(prevLeafPage) = leafPageNo;
+            bufMgr->unPinPage(file, prevLeafPageNo, true);
+        }
+        bufMgr->commitTransaction(false);
+        return leafPageNo;
+    }
+
+    int BTreeIndex::bulkLoadNonLeaf(Page *nodePage, int level, std::vector<PageKeyPair<int> > &children,
+                                    std::vector<int> &childCounts, int begin, int end)
+    {
+        initalizeNonLeafPage(nodePage, level);
+        int *keys = nonLeafKeys(nodePage);
+        PageId *pageNos = nonLeafPageNos(nodePage);
+        int *counts = nonLeafCounts(nodePage);
+        int total = 0;
+        for (int i = begin; i < end; i++)
+        {
+            // keyArray[i] is the smallest key under pageNoArray[i + 1]
+            if (i > begin)
+            {
+                keys[i - begin - 1] = children[i].key;
+            }
+            pageNos[i - begin] = children[i].pageNo;
+            if (counts != NULL)
+            {
+                counts[i - begin] = childCounts[i];
+            }
+            total += childCounts[i];
+        }
+        return total;
+    }
+
+}
@@ -0,0 +1,277 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+
+/**
+ * @file btree_parallel.cpp
+ * @brief Range scans of BTreeIndex spread over several threads. The range is cut at separator keys
+ * taken from the non-leaf nodes, and the pieces are scanned by a pool of threads that steal pieces
+ * from each other once their own run out.
+ */
+
+namespace badgerdb
+{
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::parallelScan
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::parallelScan(const void *lowValParm,
+                                  const Operator lowOpParm,
+                                  const void *highValParm,
+                                  const Operator highOpParm,
+                                  std::vector<RecordId> &outRids,
+                                  const int numThreads)
+    {
+        std::vector<std::vector<RecordId> > partitionRids;
+        runParallelScan(lowValParm, lowOpParm, highValParm, highOpParm, numThreads, partitionRids, NULL);
+
+        // pieces are disjoint and ascending, so putting them in order is a concatenation
+        outRids.clear();
+        for (size_t p = 0; p < partitionRids.size(); p++)
+        {
+            outRids.insert(outRids.end(), partitionRids[p].begin(), partitionRids[p].end());
+        }
+    }
+
+    void BTreeIndex::parallelScan(const void *lowValParm,
+                                  const Operator lowOpParm,
+                                  const void *highValParm,
+                                  const Operator highOpParm,
+                                  const std::function<void(int, const RecordId &)> &visit,
+                                  const int numThreads)
+    {
+        std::vector<std::vector<RecordId> > partitionRids;
+        runParallelScan(lowValParm, lowOpParm, highValParm, highOpParm, numThreads, partitionRids, &visit);
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::parallelScan Helper
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::runParallelScan(const void *lowValParm, const Operator lowOpParm, const void *highValParm, const Operator highOpParm,
+                                     int numThreads, std::vector<std::vector<RecordId> > &partitionRids,
+                                     const std::function<void(int, const RecordId &)> *visit)
+    {
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE))
+        {
+            throw BadOpcodesException();
+        }
+        if (attributeType != INTEGER)
+        {
+            throw BadIndexInfoException("parallel scans are only supported on INTEGER indexes");
+        }
+        if (*((const int *)lowValParm) > *((const int *)highValParm))
+        {
+            throw BadScanrangeException();
+        }
+        ReadGuard readGuard(*this);
+
+        // inclusive bounds, wide enough that GT INT_MAX or LT INT_MIN do not wrap around
+        std::int64_t low = (std::int64_t)*((const int *)lowValParm) + (lowOpParm == GT ? 1 : 0);
+        std::int64_t high = (std::int64_t)*((const int *)highValParm) - (highOpParm == LT ? 1 : 0);
+        partitionRids.clear();
+        if (low > high)
+        {
+            return;
+        }
+
+        if (numThreads <= 0)
+        {
+            numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+
+        // a few pieces per thread leave room for stealing when pieces differ in cost
+        std::vector<std::int64_t> cuts;
+        partitionRange(low, high, 4 * numThreads, cuts);
+        int numPartitions = cuts.size() + 1;
+        numThreads = std::min(numThreads, numPartitions);
+        if (visit == NULL)
+        {
+            partitionRids.resize(numPartitions);
+        }
+
+        WorkStealingQueues queues(numThreads, numPartitions);
+        std::vector<std::exception_ptr> errors(numThreads);
+        std::vector<std::thread> threads;
+        for (int w = 0; w < numThreads; w++)
+        {
+            threads.push_back(std::thread(&BTreeIndex::parallelScanWorker, this, w, &queues, low, high,
+                                          &cuts, &partitionRids, visit, &errors[w]));
+        }
+        for (int w = 0; w < numThreads; w++)
+        {
+            threads[w].join();
+        }
+        for (int w = 0; w < numThreads; w++)
+        {
+            if (errors[w])
+            {
+                std::rethrow_exception(errors[w]);
+            }
+        }
+    }
+
+    void BTreeIndex::partitionRange(std::int64_t low, std::int64_t high, int maxPartitions, std::vector<std::int64_t> &cuts)
+    {
+        // nodes of the current level overlapping the range, with the smallest key each may hold
+        std::vector<PageId> frontier(1, rootPageNum);
+        std::vector<std::int64_t> frontierLows(1, low);
+        std::vector<PageId> children;
+        std::vector<std::int64_t> childLows;
+        while (true)
+        {
+            children.clear();
+            childLows.clear();
+            bool childrenAreLeaves = false;
+            for (size_t n = 0; n < frontier.size(); n++)
+            {
+                Page *nodePage;
+                bufMgr->readPage(file, frontier[n], nodePage);
+                int *keys = nonLeafKeys(nodePage);
+                PageId *pageNos = nonLeafPageNos(nodePage);
+                int count = nonLeafKeyCount(nodePage);
+                childrenAreLeaves = nonLeafLevel(nodePage) == 1;
+                for (int i = 0; i <= count && pageNos[i] != Page::INVALID_NUMBER; i++)
+                {
+                    // child i holds the keys in [keys[i - 1], keys[i])
+                    if (i < count && keys[i] <= low)
+                    {
+                        continue;
+                    }
+                    if (i > 0 && keys[i - 1] > high)
+                    {
+                        break;
+                    }
+                    children.push_back(pageNos[i]);
+                    childLows.push_back(i > 0 ? keys[i - 1] : frontierLows[n]);
+                }
+                bufMgr->unPinPage(file, frontier[n], false);
+            }
+            if (childrenAreLeaves || children.empty() || (int)children.size() >= maxPartitions)
+            {
+                break;
+            }
+            frontier.swap(children);
+            frontierLows.swap(childLows);
+        }
+
+        // every child but the first starts a piece. The last child of a node is kept without looking at
+        // its upper bound, so it may lie below the range and start no piece
+        std::vector<std::int64_t> separators;
+        for (size_t c = 1; c < childLows.size(); c++)
+        {
+            if (childLows[c] > low)
+            {
+                separators.push_back(childLows[c]);
+            }
+        }
+
+        // keep maxPartitions - 1 of them spread evenly
+        cuts.clear();
+        int numSeparators = separators.size();
+        if (numSeparators < maxPartitions)
+        {
+            cuts.swap(separators);
+            return;
+        }
+        for (int p = 1; p < maxPartitions; p++)
+        {
+            cuts.push_back(separators[(long long)(numSeparators + 1) * p / maxPartitions - 1]);
+        }
+    }
+
+    void BTreeIndex::parallelScanWorker(int worker, WorkStealingQueues *queues, std::int64_t low, std::int64_t high,
+                                        const std::vector<std::int64_t> *cuts, std::vector<std::vector<RecordId> > *partitionRids,
+                                        const std::function<void(int, const RecordId &)> *visit, std::exception_ptr *error)
+    {
+        try
+        {
+            int numPartitions = cuts->size() + 1;
+            std::vector<RecordId> buffer;
+            int partition;
+            while (queues->next(worker, partition))
+            {
+                std::int64_t partitionLow = partition == 0 ? low : (*cuts)[partition - 1];
+                std::int64_t partitionHigh = partition == numPartitions - 1 ? high : (*cuts)[partition] - 1;
+                std::vector<RecordId> &out = visit == NULL ? (*partitionRids)[partition] : buffer;
+                out.clear();
+                scanPartition(partitionLow, partitionHigh, out);
+                if (visit != NULL)
+                {
+                    for (size_t i = 0; i < out.size(); i++)
+                    {
+                        (*visit)(worker, out[i]);
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            *error = std::current_exception();
+        }
+    }
+
+    void BTreeIndex::scanPartition(std::int64_t low, std::int64_t high, std::vector<RecordId> &outRids)
+    {
+        PageId leafPageNo = locateLeaf((int)low);
+        bool firstLeaf = true;
+        while (leafPageNo != Page::INVALID_NUMBER)
+        {
+            Page *leafPage;
+            bufMgr->readPage(file, leafPageNo, leafPage);
+            int count = leafEntryCount(leafPage);
+            int index = firstLeaf ? findKeyIndex((int)low, leafPage, count, true) : 0;
+            for (; index < count; index++)
+            {
+                if (leafKey(leafPage, index) > high)
+                {
+                    bufMgr->unPinPage(file, leafPageNo, false);
+                    return;
+                }
+                RecordId rid = leafRid(leafPage, index);
+                if (rid.slot_number == Page::INVALID_SLOT)
+                {
+                    appendPostingList(rid.page_number, outRids);
+                }
+                else
+                {
+                    outRids.push_back(rid);
+                }
+            }
+            PageId rightSibPageNo = leafRightSib(leafPage);
+            bufMgr->unPinPage(file, leafPageNo, false);
+            leafPageNo = rightSibPageNo;
+            firstLeaf = false;
+        }
+    }
+
+    void BTreeIndex::appendPostingList(PageId headPageNo, std::vector<RecordId> &outRids)
+    {
+        PageId postingPageNo = headPageNo;
+        while (postingPageNo != 0)
+        {
+            Page *postingPage;
+            bufMgr->readPage(file, postingPageNo, postingPage);
+            PostingNodeInt *node = reinterpret_cast<PostingNodeInt *>(postingPage);
+            std::size_t start = outRids.size();
+            outRids.resize(start + node->numRids);
+            decodePostingPage(node, &outRids[start]);
+            PageId nextPageNo = node->nextPageNo;
+            bufMgr->unPinPage(file, postingPageNo, false);
+            postingPageNo = nextPageNo;
+        }
+    }
+
+}
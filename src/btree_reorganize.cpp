@@ -0,0 +1,440 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+#include <vector>
+#include "exceptions/bad_index_info_exception.h"
+
+/**
+ * @file btree_reorganize.cpp
+ * @brief Online rebuild of a BTreeIndex. The leaf chain is read in key order and bulk loaded into new
+ * pages at the end of the file, then the meta page is pointed at the new root. Inserts into INTEGER
+ * indexes go on into the old tree meanwhile and are carried over before the switch. The pages of the
+ * old tree are freed once no lookup or scan can still be in it.
+ */
+
+namespace badgerdb
+{
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::reorganize
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::reorganize(const double fillFactor)
+    {
+        if (!(fillFactor > 0 && fillFactor <= 1))
+        {
+            throw BadIndexInfoException("fill factor must be more than 0 and at most 1");
+        }
+        std::lock_guard<std::mutex> reorganizeGuard(reorganizeMutex);
+        PageId oldRootPageNo = rootPageNum;
+        if (attributeType == STRING)
+        {
+            reorganizeString(fillFactor);
+        }
+        else
+        {
+            reorganizeInt(fillFactor);
+        }
+        if (rootPageNum == oldRootPageNo)
+        {
+            return;
+        }
+
+        // inserts only reach the new tree now, and once the reads that started on the old one are done
+        // nothing reaches the old tree
+        std::vector<PageId> oldPageNos;
+        collectTreePages(oldRootPageNo, oldPageNos);
+        waitForOldReads();
+
+        // the free list lives in the meta page, which logged inserts change in their transactions
+        std::unique_lock<std::mutex> logGuard(logMutex, std::defer_lock);
+        if (bufMgr->isLogged())
+        {
+            logGuard.lock();
+        }
+        bufMgr->beginTransaction();
+        try
+        {
+            freeNodePages(oldPageNos);
+        }
+        catch (...)
+        {
+            bufMgr->abortTransaction();
+            throw;
+        }
+        bufMgr->commitTransaction(true);
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::reorganize Helper
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::reorganizeInt(double fillFactor)
+    {
+        ReorganizeState state;
+
+        // logged inserts share the meta page with the switch, so with a log it takes its turn like an insert
+        std::unique_lock<std::mutex> logGuard(logMutex, std::defer_lock);
+
+        // the leftmost leaf never moves, splits only add leaves to its right
+        pauseInserts();
+        bool paused = true;
+        try
+        {
+            PageId leafPageNo = rootPageNum;
+            bool isLeaf = false;
+            while (!isLeaf && leafPageNo != Page::INVALID_NUMBER)
+            {
+                Page *nodePage;
+                bufMgr->readPage(file, leafPageNo, nodePage);
+                PageId childPageNo = nonLeafPageNos(nodePage)[0];
+                isLeaf = nonLeafLevel(nodePage) == 1;
+                bufMgr->unPinPage(file, leafPageNo, false);
+                leafPageNo = childPageNo;
+            }
+            if (leafPageNo == Page::INVALID_NUMBER)
+            {
+                resumeInserts();
+                return;
+            }
+
+            reorganizeState = &state;
+            resumeInserts();
+            paused = false;
+
+            std::vector<RIDKeyPair<int> > entries;
+            std::vector<char> included;
+            while (leafPageNo != Page::INVALID_NUMBER)
+            {
+                leafPageNo = copyLeaf(leafPageNo, entries, included);
+            }
+            PageId newRootPageNo = bulkLoad(entries, relationFile != NULL ? &included[0] : NULL, fillFactor, Page::INVALID_NUMBER);
+            std::vector<RIDKeyPair<int> >().swap(entries);
+            std::vector<char>().swap(included);
+
+            // the new tree misses only the entries of inserts into copied leaves
+            pauseInserts();
+            paused = true;
+            reorganizeState = NULL;
+            if (bufMgr->isLogged())
+            {
+                logGuard.lock();
+            }
+            bufMgr->beginTransaction();
+            for (size_t i = 0; i < state.missedEntries.size(); i++)
+            {
+                char includedBuf[MAXINCLUDEDSIZE];
+                const char *missedIncluded = NULL;
+                if (relationFile != NULL)
+                {
+                    fetchIncluded(state.missedEntries[i].rid, includedBuf);
+                    missedIncluded = includedBuf;
+                }
+                PageKeyPair<int> newChild;
+                if (insertRecursive(state.missedEntries[i].key, state.missedEntries[i].rid, missedIncluded, newRootPageNo, false, newChild))
+                {
+                    newRootPageNo = growRoot(newRootPageNo, newChild);
+                }
+            }
+
+            // lookups that read the old root number finish on the old tree, which is left as it was
+            rootPageNum = newRootPageNo;
+            updateMetaInfo();
+            bufMgr->commitTransaction(true);
+        }
+        catch (...)
+        {
+            bufMgr->abortTransaction();
+            if (logGuard.owns_lock())
+            {
+                logGuard.unlock();
+            }
+            if (!paused)
+            {
+                pauseInserts();
+            }
+            reorganizeState = NULL;
+            resumeInserts();
+            throw;
+        }
+        if (logGuard.owns_lock())
+        {
+            logGuard.unlock();
+        }
+        resumeInserts();
+    }
+
+    void BTreeIndex::reorganizeString(double fillFactor)
+    {
+        // STRING inserts take no latches, so the leaves must not change while they are read
+        pauseInserts();
+        try
+        {
+            PageId leafPageNo = rootPageNum;
+            bool isLeaf = false;
+            while (!isLeaf && leafPageNo != Page::INVALID_NUMBER)
+            {
+                Page *nodePage;
+                bufMgr->readPage(file, leafPageNo, nodePage);
+                SlottedNodeString *node = reinterpret_cast<SlottedNodeString *>(nodePage);
+                PageId childPageNo = node->leftmostPageNo;
+                isLeaf = node->level == 1;
+                bufMgr->unPinPage(file, leafPageNo, false);
+                leafPageNo = childPageNo;
+            }
+
+            std::vector<RIDKeyPair<std::string> > entries;
+            std::vector<RIDKeyPair<std::string> > leafEntries;
+            while (leafPageNo != Page::INVALID_NUMBER)
+            {
+                Page *leafPage;
+                bufMgr->readPage(file, leafPageNo, leafPage);
+                SlottedNodeString *leaf = reinterpret_cast<SlottedNodeString *>(leafPage);
+                decodeStringLeaf(leaf, leafEntries);
+                entries.insert(entries.end(), leafEntries.begin(), leafEntries.end());
+                PageId rightSibPageNo = leaf->rightSibPageNo;
+                bufMgr->unPinPage(file, leafPageNo, false);
+                leafPageNo = rightSibPageNo;
+            }
+
+            if (!entries.empty())
+            {
+                PageId newRootPageNo = bulkLoadString(entries, fillFactor);
+                std::unique_lock<std::mutex> logGuard(logMutex, std::defer_lock);
+                if (bufMgr->isLogged())
+                {
+                    logGuard.lock();
+                }
+                bufMgr->beginTransaction();
+                rootPageNum = newRootPageNo;
+                updateMetaInfo();
+                bufMgr->commitTransaction(true);
+            }
+        }
+        catch (...)
+        {
+            bufMgr->abortTransaction();
+            resumeInserts();
+            throw;
+        }
+        resumeInserts();
+    }
+
+    PageId BTreeIndex::copyLeaf(PageId leafPageNo, std::vector<RIDKeyPair<int> > &entries, std::vector<char> &included)
+    {
+        // an insert holding the latch finishes first, one waiting for it finds the leaf copied
+        Page *leafPage;
+        bufMgr->readPage(file, leafPageNo, leafPage);
+        VersionLatch &leafLatch = bufMgr->pageLatch(leafPage);
+        leafLatch.lock();
+        PageId rightSibPageNo;
+        try
+        {
+            int keys[COMPRESSEDLEAFMAXSIZE];
+            RecordId rids[COMPRESSEDLEAFMAXSIZE];
+            char leafIncluded[COVERINGLEAFDATASIZE];
+            int count = decodeLeaf(leafPage, keys, rids, leafIncluded);
+            std::vector<RecordId> slotRids;
+            for (int i = 0; i < count; i++)
+            {
+                slotRids.clear();
+                if (rids[i].slot_number == Page::INVALID_SLOT)
+                {
+                    // posting lists only change under the leaf latch
+                    appendPostingList(rids[i].page_number, slotRids);
+                }
+                else
+                {
+                    slotRids.push_back(rids[i]);
+                }
+                for (size_t r = 0; r < slotRids.size(); r++)
+                {
+                    RIDKeyPair<int> entry;
+                    entry.set(slotRids[r], keys[i]);
+                    entries.push_back(entry);
+                    if (relationFile != NULL)
+                    {
+                        // zeroes for rids of a posting list, which go back into one
+                        included.insert(included.end(), leafIncluded + i * includedSize, leafIncluded + (i + 1) * includedSize);
+                    }
+                }
+            }
+            {
+                std::lock_guard<std::mutex> guard(reorganizeState->mutex);
+                reorganizeState->copiedLeaves.insert(leafPageNo);
+            }
+            rightSibPageNo = leafRightSib(leafPage);
+        }
+        catch (...)
+        {
+            leafLatch.unlock();
+            bufMgr->unPinPage(file, leafPageNo, false);
+            throw;
+        }
+        leafLatch.unlock();
+        bufMgr->unPinPage(file, leafPageNo, false);
+        return rightSibPageNo;
+    }
+
+    void BTreeIndex::noteReorganizeInsert(PageId leafPageNo, PageId newLeafPageNo, int keyInt, RecordId rid)
+    {
+        std::lock_guard<std::mutex> guard(reorganizeState->mutex);
+        if (reorganizeState->copiedLeaves.count(leafPageNo) == 0)
+        {
+            // the entry is copied with its leaf, and so is any leaf split off it
+            return;
+        }
+        RIDKeyPair<int> entry;
+        entry.set(rid, keyInt);
+        reorganizeState->missedEntries.push_back(entry);
+        if (newLeafPageNo != Page::INVALID_NUMBER)
+        {
+            reorganizeState->copiedLeaves.insert(newLeafPageNo);
+        }
+    }
+
+    void BTreeIndex::enterInsert()
+    {
+        while (true)
+        {
+            activeInserts++;
+            if (!insertsPaused)
+            {
+                return;
+            }
+            leaveInsert();
+            std::unique_lock<std::mutex> lock(pauseMutex);
+            while (insertsPaused)
+            {
+                pauseChanged.wait(lock);
+            }
+        }
+    }
+
+    void BTreeIndex::leaveInsert()
+    {
+        // the pause is set before the count is read, so either this sees it or the pauser sees no insert
+        if (--activeInserts == 0 && insertsPaused)
+        {
+            std::lock_guard<std::mutex> lock(pauseMutex);
+            pauseChanged.notify_all();
+        }
+    }
+
+    void BTreeIndex::pauseInserts()
+    {
+        std::unique_lock<std::mutex> lock(pauseMutex);
+        insertsPaused = true;
+        while (activeInserts != 0)
+        {
+            pauseChanged.wait(lock);
+        }
+    }
+
+    void BTreeIndex::resumeInserts()
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex);
+        insertsPaused = false;
+        pauseChanged.notify_all();
+    }
+
+    int BTreeIndex::enterRead()
+    {
+        while (true)
+        {
+            int epoch = readEpoch;
+            activeReads[epoch & 1]++;
+            // counted before the epoch moved on, so waitForOldReads() waits for this read
+            if (readEpoch == epoch)
+            {
+                return epoch;
+            }
+            leaveRead(epoch);
+        }
+    }
+
+    void BTreeIndex::leaveRead(int epoch)
+    {
+        if (--activeReads[epoch & 1] == 0 && readEpoch != epoch)
+        {
+            std::lock_guard<std::mutex> lock(pauseMutex);
+            pauseChanged.notify_all();
+        }
+    }
+
+    void BTreeIndex::waitForOldReads()
+    {
+        // reorganize() calls are one at a time, so the reads of the epoch before the old one are done
+        int oldEpoch = readEpoch++;
+        std::unique_lock<std::mutex> lock(pauseMutex);
+        while (activeReads[oldEpoch & 1] != 0)
+        {
+            pauseChanged.wait(lock);
+        }
+    }
+
+    void BTreeIndex::collectTreePages(PageId rootPageNo, std::vector<PageId> &pageNos)
+    {
+        std::vector<PageId> level(1, rootPageNo);
+        bool leaves = false;
+        while (!level.empty())
+        {
+            pageNos.insert(pageNos.end(), level.begin(), level.end());
+            if (leaves && attributeType == STRING)
+            {
+                // STRING leaves keep every rid inline
+                break;
+            }
+            std::vector<PageId> children;
+            bool childrenAreLeaves = false;
+            for (size_t n = 0; n < level.size(); n++)
+            {
+                Page *nodePage;
+                bufMgr->readPage(file, level[n], nodePage);
+                if (leaves)
+                {
+                    int count = leafEntryCount(nodePage);
+                    for (int i = 0; i < count; i++)
+                    {
+                        RecordId rid = leafRid(nodePage, i);
+                        PageId postingPageNo = rid.slot_number == Page::INVALID_SLOT ? rid.page_number : Page::INVALID_NUMBER;
+                        while (postingPageNo != Page::INVALID_NUMBER)
+                        {
+                            pageNos.push_back(postingPageNo);
+                            Page *postingPage;
+                            bufMgr->readPage(file, postingPageNo, postingPage);
+                            PageId nextPageNo = reinterpret_cast<PostingNodeInt *>(postingPage)->nextPageNo;
+                            bufMgr->unPinPage(file, postingPageNo, false);
+                            postingPageNo = nextPageNo;
+                        }
+                    }
+                }
+                else if (attributeType == STRING)
+                {
+                    SlottedNodeString *node = reinterpret_cast<SlottedNodeString *>(nodePage);
+                    for (int i = 0; i <= node->numSlots; i++)
+                    {
+                        children.push_back(stringChildAt(node, i));
+                    }
+                    childrenAreLeaves = node->level == 1;
+                }
+                else
+                {
+                    int keyCount = nonLeafKeyCount(nodePage);
+                    PageId *pageNoArray = nonLeafPageNos(nodePage);
+                    children.insert(children.end(), pageNoArray, pageNoArray + keyCount + 1);
+                    childrenAreLeaves = nonLeafLevel(nodePage) == 1;
+                }
+                bufMgr->unPinPage(file, level[n], false);
+            }
+            level.swap(children);
+            leaves = childrenAreLeaves;
+        }
+    }
+
+}
@@ -0,0 +1,289 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * @file btree_stats.cpp
+ * @brief Structural statistics of a BTreeIndex. The tree is read level by level, the nodes of each
+ * level spread over a pool of threads that steal nodes from each other once their own run out.
+ */
+
+namespace badgerdb
+{
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::stats
+    // -----------------------------------------------------------------------------
+
+    IndexStats BTreeIndex::stats(const int numThreadsParm)
+    {
+        int numThreads = numThreadsParm;
+        if (numThreads <= 0)
+        {
+            numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+
+        ReadGuard readGuard(*this);
+        IndexStats result;
+        result.attrByteOffset = attrByteOffset;
+        result.attrType = attributeType;
+        result.filePages = numPages;
+        {
+            Page *metaPage;
+            bufMgr->readPage(file, headerPageNum, metaPage);
+            result.freePages = reinterpret_cast<IndexMetaInfo *>(metaPage)->numFreePages;
+            bufMgr->unPinPage(file, headerPageNum, false);
+        }
+
+        std::vector<PageId> level(1, rootPageNum);
+        bool leaves = false;
+        double nodeFillSum = 0;
+        int nonLeafNodes = 0;
+        while (!level.empty())
+        {
+            // the children of a non-leaf level are leaves if its nodes sit just above them
+            bool childrenAreLeaves = false;
+            if (!leaves)
+            {
+                Page *firstPage;
+                bufMgr->readPage(file, level[0], firstPage);
+                childrenAreLeaves = (attributeType == STRING ? reinterpret_cast<SlottedNodeString *>(firstPage)->level
+                                                             : nonLeafLevel(firstPage)) == 1;
+                bufMgr->unPinPage(file, level[0], false);
+            }
+
+            int numNodes = level.size();
+            std::vector<std::vector<PageId> > children(leaves ? 0 : numNodes);
+            std::vector<double> fills(numNodes);
+            std::vector<std::uint64_t> entries(numNodes);
+            std::vector<int> postingPages(numNodes);
+            int numWorkers = std::min(numThreads, numNodes);
+            WorkStealingQueues queues(numWorkers, numNodes);
+            std::vector<std::exception_ptr> errors(numWorkers);
+            std::vector<std::thread> threads;
+            for (int w = 0; w < numWorkers; w++)
+            {
+                threads.push_back(std::thread(&BTreeIndex::statsWorker, this, w, &queues, &level, leaves,
+                                              &children, &fills, &entries, &postingPages, &errors[w]));
+            }
+            for (int w = 0; w < numWorkers; w++)
+            {
+                threads[w].join();
+            }
+            for (int w = 0; w < numWorkers; w++)
+            {
+                if (errors[w])
+                {
+                    std::rethrow_exception(errors[w]);
+                }
+            }
+
+            result.height++;
+            result.nodesPerLevel.push_back(numNodes);
+            result.pages += numNodes;
+            if (!leaves)
+            {
+                nonLeafNodes += numNodes;
+                for (int n = 0; n < numNodes; n++)
+                {
+                    nodeFillSum += fills[n];
+                }
+
+                // children are gathered in node order, so each level lists its nodes in key order
+                std::vector<PageId> next;
+                for (int n = 0; n < numNodes; n++)
+                {
+                    next.insert(next.end(), children[n].begin(), children[n].end());
+                }
+                if (next.empty())
+                {
+                    break;
+                }
+                level.swap(next);
+                leaves = childrenAreLeaves;
+                continue;
+            }
+
+            double leafFillSum = 0;
+            int runs = 0;
+            for (int n = 0; n < numNodes; n++)
+            {
+                leafFillSum += fills[n];
+                int bucket = std::min(LEAFFILLBUCKETS - 1, (int)(fills[n] * LEAFFILLBUCKETS));
+                result.leafFill[bucket]++;
+                result.entries += entries[n];
+                result.postingPages += postingPages[n];
+                if (n == 0 || level[n] != level[n - 1] + 1)
+                {
+                    runs++;
+                }
+            }
+            result.averageLeafFill = leafFillSum / numNodes;
+            result.averageLeafRun = (double)numNodes / runs;
+            break;
+        }
+        result.averageNodeFill = nonLeafNodes == 0 ? 0 : nodeFillSum / nonLeafNodes;
+        result.pages += result.postingPages + 1;
+        result.bytesPerEntry = result.entries == 0 ? 0 : (double)result.pages * Page::SIZE / result.entries;
+
+        if (leaves && result.entries > 0)
+        {
+            // leaves may be left empty at either end of the chain
+            size_t first = 0;
+            size_t last = level.size() - 1;
+            Page *leafPage;
+            while (true)
+            {
+                bufMgr->readPage(file, level[first], leafPage);
+                if (leafEntryCount(leafPage) > 0)
+                {
+                    break;
+                }
+                bufMgr->unPinPage(file, level[first++], false);
+            }
+            if (attributeType == STRING)
+            {
+                result.minStringKey = stringKeyAt(reinterpret_cast<SlottedNodeString *>(leafPage), 0);
+            }
+            else
+            {
+                result.minKey = leafKey(leafPage, 0);
+            }
+            bufMgr->unPinPage(file, level[first], false);
+
+            while (true)
+            {
+                bufMgr->readPage(file, level[last], leafPage);
+                if (leafEntryCount(leafPage) > 0)
+                {
+                    break;
+                }
+                bufMgr->unPinPage(file, level[last--], false);
+            }
+            int count = leafEntryCount(leafPage);
+            if (attributeType == STRING)
+            {
+                result.maxStringKey = stringKeyAt(reinterpret_cast<SlottedNodeString *>(leafPage), count - 1);
+            }
+            else
+            {
+                result.maxKey = leafKey(leafPage, count - 1);
+            }
+            bufMgr->unPinPage(file, level[last], false);
+        }
+        return result;
+    }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::stats Helper
+    // -----------------------------------------------------------------------------
+
+    void BTreeIndex::statsWorker(int worker, WorkStealingQueues *queues, const std::vector<PageId> *level, bool leaves,
+                                 std::vector<std::vector<PageId> > *children, std::vector<double> *fills,
+                                 std::vector<std::uint64_t> *entries, std::vector<int> *postingPages, std::exception_ptr *error)
+    {
+        try
+        {
+            int node;
+            while (queues->next(worker, node))
+            {
+                PageId pageNo = (*level)[node];
+                Page *nodePage;
+                bufMgr->readPage(file, pageNo, nodePage);
+                if (leaves)
+                {
+                    int count = leafEntryCount(nodePage);
+                    (*fills)[node] = nodeFill(nodePage, true, count);
+                    std::uint64_t leafEntries = count;
+                    int leafPostingPages = 0;
+                    for (int i = 0; i < count && attributeType != STRING; i++)
+                    {
+                        RecordId rid = leafRid(nodePage, i);
+                        if (rid.slot_number != Page::INVALID_SLOT)
+                        {
+                            continue;
+                        }
+                        // the slot stands for every rid of its posting list
+                        PageId postingPageNo = rid.page_number;
+                        while (postingPageNo != 0)
+                        {
+                            Page *postingPage;
+                            bufMgr->readPage(file, postingPageNo, postingPage);
+                            PostingNodeInt *posting = reinterpret_cast<PostingNodeInt *>(postingPage);
+                            if (postingPageNo == rid.page_number)
+                            {
+                                leafEntries += posting->totalRids - 1;
+                            }
+                            PageId nextPageNo = posting->nextPageNo;
+                            bufMgr->unPinPage(file, postingPageNo, false);
+                            postingPageNo = nextPageNo;
+                            leafPostingPages++;
+                        }
+                    }
+                    (*entries)[node] = leafEntries;
+                    (*postingPages)[node] = leafPostingPages;
+                }
+                else if (attributeType == STRING)
+                {
+                    SlottedNodeString *stringNode = reinterpret_cast<SlottedNodeString *>(nodePage);
+                    (*fills)[node] = nodeFill(nodePage, false, stringNode->numSlots);
+                    for (int i = 0; i <= stringNode->numSlots; i++)
+                    {
+                        PageId childPageNo = stringChildAt(stringNode, i);
+                        if (childPageNo != Page::INVALID_NUMBER)
+                        {
+                            (*children)[node].push_back(childPageNo);
+                        }
+                    }
+                }
+                else
+                {
+                    int count = nonLeafKeyCount(nodePage);
+                    (*fills)[node] = nodeFill(nodePage, false, count);
+                    PageId *pageNos = nonLeafPageNos(nodePage);
+                    for (int i = 0; i <= count && pageNos[i] != Page::INVALID_NUMBER; i++)
+                    {
+                        (*children)[node].push_back(pageNos[i]);
+                    }
+                }
+                bufMgr->unPinPage(file, pageNo, false);
+            }
+        }
+        catch (...)
+        {
+            *error = std::current_exception();
+        }
+    }
+
+    double BTreeIndex::nodeFill(Page *nodePage, bool leaf, int count)
+    {
+        if (attributeType == STRING)
+        {
+            // slots grow from the start of data and key bytes from its end
+            SlottedNodeString *node = reinterpret_cast<SlottedNodeString *>(nodePage);
+            int used = node->numSlots * sizeof(StringSlot) + STRINGNODEDATASIZE - node->freeSpaceOffset;
+            return (double)used / STRINGNODEDATASIZE;
+        }
+        if (!leaf)
+        {
+            return (double)count / nodeOccupancy;
+        }
+        if (indexOptions & INDEX_COMPRESSED_LEAVES)
+        {
+            // bit packed keys, then the RecordIds
+            CompressedLeafNodeInt *node = reinterpret_cast<CompressedLeafNodeInt *>(nodePage);
+            int used = (count * node->keyBits + 7) / 8 + count * PACKEDRIDSIZE;
+            return (double)used / COMPRESSEDLEAFDATASIZE;
+        }
+        return (double)count / leafOccupancy;
+    }
+
+}
@@ -0,0 +1,543 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @file btree_string.cpp
+ * @brief Insert path and node format of BTreeIndex when the key is of STRING type.
+ * Nodes are slotted pages of variable length keys. Separators in non-leaf nodes are
+ * suffix truncated and leaves store the prefix shared by all of their keys once.
+ */
+
+namespace badgerdb
+{
+
+    static StringSlot *stringSlots(SlottedNodeString *node)
+    {
+        return reinterpret_cast<StringSlot *>(node->data);
+    }
+
+    static int stringFreeSpace(SlottedNodeString *node)
+    {
+        return node->freeSpaceOffset - node->numSlots * (int)sizeof(StringSlot);
+    }
+
+    static int commonPrefixLength(const std::string &left, const std::string &right)
+    {
+        int length = (int)std::min(left.size(), right.size());
+        int i = 0;
+        while (i < length && left[i] == right[i])
+        {
+            i++;
+        }
+        return i;
+    }
+
+    void BTreeIndex::initalizeStringNode(SlottedNodeString *node, bool isLeaf, int level)
+    {
+        node->level = level;
+        node->isLeaf = isLeaf;
+        node->rightSibPageNo = Page::INVALID_NUMBER;
+        node->leftSibPageNo = Page::INVALID_NUMBER;
+        node->leftmostPageNo = Page::INVALID_NUMBER;
+        node->numSlots = 0;
+        node->freeSpaceOffset = STRINGNODEDATASIZE;
+        node->prefixOffset = STRINGNODEDATASIZE;
+        node->prefixLength = 0;
+    }
+
+    int BTreeIndex::compareStringKey(SlottedNodeString *node, int index, const char *key, int keyLength)
+    {
+        // every key of the node starts with the prefix, compare against it first
+        int prefixLength = node->prefixLength;
+        int length = std::min(keyLength, prefixLength);
+        int result = memcmp(node->data + node->prefixOffset, key, length);
+        if (result != 0)
+        {
+            return result;
+        }
+        if (keyLength < prefixLength)
+        {
+            return 1;
+        }
+
+        StringSlot &slot = stringSlots(node)[index];
+        int restLength = keyLength - prefixLength;
+        length = std::min((int)slot.keyLength, restLength);
+        result = memcmp(node->data + slot.keyOffset, key + prefixLength, length);
+        if (result != 0)
+        {
+            return result;
+        }
+        return (int)slot.keyLength - restLength;
+    }
+
+    std::string BTreeIndex::stringKeyAt(SlottedNodeString *node, int index)
+    {
+        StringSlot &slot = stringSlots(node)[index];
+        std::string key((const char *)node->data + node->prefixOffset, node->prefixLength);
+        key.append((const char *)node->data + slot.keyOffset, slot.keyLength);
+        return key;
+    }
+
+    int BTreeIndex::findStringIndex(const char *key, int keyLength, SlottedNodeString *node, bool inclusive)
+    {
+        int low = 0;
+        int high = node->numSlots;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            int result = compareStringKey(node, mid, key, keyLength);
+            if (result < 0 || (!inclusive && result == 0))
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    PageId BTreeIndex::stringChildAt(SlottedNodeString *node, int index)
+    {
+        return index == 0 ? node->leftmostPageNo : stringSlots(node)[index - 1].pageNo;
+    }
+
+    void BTreeIndex::decodeStringLeaf(SlottedNodeString *node, std::vector<RIDKeyPair<std::string> > &entries)
+    {
+        StringSlot *slots = stringSlots(node);
+        entries.resize(node->numSlots);
+        for (int i = 0; i < node->numSlots; i++)
+        {
+            RecordId rid;
+            rid.page_number = slots[i].pageNo;
+            rid.slot_number = slots[i].slotNo;
+            rid.padding = 0;
+            entries[i].set(rid, stringKeyAt(node, i));
+        }
+    }
+
+    int BTreeIndex::stringLeafSize(std::vector<RIDKeyPair<std::string> > &entries, int begin, int end)
+    {
+        if (begin == end)
+        {
+            return 0;
+        }
+        // entries are sorted, so the first and last key share the prefix of all of them
+        int prefixLength = commonPrefixLength(entries[begin].key, entries[end - 1].key);
+        int size = prefixLength;
+        for (int i = begin; i < end; i++)
+        {
+            size += (int)entries[i].key.size() - prefixLength + sizeof(StringSlot);
+        }
+        return size;
+    }
+
+    void BTreeIndex::encodeStringLeaf(SlottedNodeString *node, std::vector<RIDKeyPair<std::string> > &entries, int begin, int end)
+    {
+        int prefixLength = begin == end ? 0 : commonPrefixLength(entries[begin].key, entries[end - 1].key);
+        int offset = STRINGNODEDATASIZE - prefixLength;
+        if (prefixLength > 0)
+        {
+            memcpy(node->data + offset, entries[begin].key.data(), prefixLength);
+        }
+        node->prefixOffset = offset;
+        node->prefixLength = prefixLength;
+
+        StringSlot *slots = stringSlots(node);
+        for (int i = begin; i < end; i++)
+        {
+            int suffixLength = (int)entries[i].key.size() - prefixLength;
+            offset -= suffixLength;
+            memcpy(node->data + offset, entries[i].key.data() + prefixLength, suffixLength);
+            StringSlot &slot = slots[i - begin];
+            slot.keyOffset = offset;
+            slot.keyLength = suffixLength;
+            slot.pageNo = entries[i].rid.page_number;
+            slot.slotNo = entries[i].rid.slot_number;
+        }
+        node->numSlots = end - begin;
+        node->freeSpaceOffset = offset;
+    }
+
+    PageId BTreeIndex::decodeStringNonLeaf(SlottedNodeString *node, std::vector<PageKeyPair<std::string> > &entries)
+    {
+        StringSlot *slots = stringSlots(node);
+        entries.resize(node->numSlots);
+        for (int i = 0; i < node->numSlots; i++)
+        {
+            entries[i].set(slots[i].pageNo, stringKeyAt(node, i));
+        }
+        return node->leftmostPageNo;
+    }
+
+    int BTreeIndex::stringNonLeafSize(std::vector<PageKeyPair<std::string> > &entries, int begin, int end)
+    {
+        int size = 0;
+        for (int i = begin; i < end; i++)
+        {
+            size += (int)entries[i].key.size() + sizeof(StringSlot);
+        }
+        return size;
+    }
+
+    void BTreeIndex::encodeStringNonLeaf(SlottedNodeString *node, PageId leftmost, std::vector<PageKeyPair<std::string> > &entries, int begin, int end)
+    {
+        StringSlot *slots = stringSlots(node);
+        int offset = STRINGNODEDATASIZE;
+        for (int i = begin; i < end; i++)
+        {
+            int keyLength = (int)entries[i].key.size();
+            offset -= keyLength;
+            memcpy(node->data + offset, entries[i].key.data(), keyLength);
+            StringSlot &slot = slots[i - begin];
+            slot.keyOffset = offset;
+            slot.keyLength = keyLength;
+            slot.pageNo = entries[i].pageNo;
+            slot.slotNo = 0;
+        }
+        node->leftmostPageNo = leftmost;
+        node->numSlots = end - begin;
+        node->freeSpaceOffset = offset;
+        node->prefixOffset = STRINGNODEDATASIZE;
+        node->prefixLength = 0;
+    }
+
+    std::string BTreeIndex::shortestSeparator(const std::string &left, const std::string &right)
+    {
+        // a run of one key split across two leaves needs the whole key
+        if (left == right)
+        {
+            return right;
+        }
+        // left < right, so right differs from left at or just after their common prefix
+        return right.substr(0, commonPrefixLength(left, right) + 1);
+    }
+
+    PageId BTreeIndex::bulkLoadString(std::vector<RIDKeyPair<std::string> > &entries, double fillFactor)
+    {
+        int capacity = (int)(STRINGNODEDATASIZE * fillFactor);
+
+        // leaves left to right, each with as many entries as fit in its share of the node. children[i].key is the
+        // separator between child i and the one before it
+        std::vector<PageKeyPair<std::string> > children;
+        PageId prevLeafPageNo = Page::INVALID_NUMBER;
+        int numEntries = (int)entries.size();
+        int begin = 0;
+        while (begin < numEntries)
+        {
+            // the common prefix of the leaf only shrinks as keys are added, so the size is kept up as it goes
+            int end = begin + 1;
+            int keyBytes = entries[begin].key.size();
+            while (end < numEntries)
+            {
+                int prefixLength = commonPrefixLength(entries[begin].key, entries[end].key);
+                int count = end + 1 - begin;
+                int size = prefixLength + keyBytes + (int)entries[end].key.size() - count * prefixLength + count * (int)sizeof(StringSlot);
+                if (size > capacity)
+                {
+                    break;
+                }
+                keyBytes += entries[end].key.size();
+                end++;
+            }
+
+            Page *leafPage;
+            PageId leafPageNo;
+            bufMgr->beginTransaction();
+            bufMgr->allocPage(file, leafPageNo, leafPage);
+            numPages++;
+            initalizeStringNode(reinterpret_cast<SlottedNodeString *>(leafPage), true, 0);
+            encodeStringLeaf(reinterpret_cast<SlottedNodeString *>(leafPage), entries, begin, end);
+            leafLeftSib(leafPage) = prevLeafPageNo;
+            bufMgr->unPinPage(file, leafPageNo, true);
+            if (prevLeafPageNo != Page::INVALID_NUMBER)
+            {
+                Page *prevLeafPage;
+                bufMgr->readPage(file, prevLeafPageNo, prevLeafPage);
+                leafRightSib(prevLeafPage) = leafPageNo;
+                bufMgr->unPinPage(file, prevLeafPageNo, true);
+            }
+            bufMgr->commitTransaction(false);
+
+            PageKeyPair<std::string> child;
+            child.set(leafPageNo, begin == 0 ? std::string() : shortestSeparator(entries[begin - 1].key, entries[begin].key));
+            children.push_back(child);
+            prevLeafPageNo = leafPageNo;
+            begin = end;
+        }
+
+        // levels of non leaf nodes until the separators fit in the root. The separator left of the first
+        // child of a node moves up to its parent
+        int level = 1;
+        while (stringNonLeafSize(children, 1, children.size()) > STRINGNODEDATASIZE)
+        {
+            std::vector<PageKeyPair<std::string> > parents;
+            int numChildren = (int)children.size();
+            begin = 0;
+            while (begin < numChildren)
+            {
+                // every node takes at least one separator, so each level is smaller than the one below
+                int end = begin + 2;
+                int size = end <= numChildren ? stringNonLeafSize(children, begin + 1, end) : 0;
+                while (end < numChildren && size + (int)(children[end].key.size() + sizeof(StringSlot)) <= capacity)
+                {
+                    size += children[end].key.size() + sizeof(StringSlot);
+                    end++;
+                }
+                end = std::min(end, numChildren);
+
+                Page *nodePage;
+                PageId nodePageNo;
+                bufMgr->beginTransaction();
+                bufMgr->allocPage(file, nodePageNo, nodePage);
+                numPages++;
+                SlottedNodeString *node = reinterpret_cast<SlottedNodeString *>(nodePage);
+                initalizeStringNode(node, false, level);
+                encodeStringNonLeaf(node, children[begin].pageNo, children, begin + 1, end);
+                bufMgr->unPinPage(file, nodePageNo, true);
+                bufMgr->commitTransaction(false);
+
+                PageKeyPair<std::string> parent;
+                parent.set(nodePageNo, children[begin].key);
+                parents.push_back(parent);
+                begin = end;
+            }
+            children.swap(parents);
+            level = 0;
+        }
+
+        Page *rootPage;
+        PageId rootPageNo;
+        bufMgr->beginTransaction();
+        bufMgr->allocPage(file, rootPageNo, rootPage);
+        numPages++;
+        SlottedNodeString *root = reinterpret_cast<SlottedNodeString *>(rootPage);
+        initalizeStringNode(root, false, level);
+        encodeStringNonLeaf(root, children[0].pageNo, children, 1, children.size());
+        bufMgr->unPinPage(file, rootPageNo, true);
+        bufMgr->commitTransaction(false);
+        return rootPageNo;
+    }
+
+    void BTreeIndex::insertEntryString(const char *key, int keyLength, RecordId rid)
+    {
+        int oldNumPages = numPages;
+        PageId oldRootPageNo = rootPageNum;
+
+        // get root page
+        Page *rootPage;
+        bufMgr->readPage(file, rootPageNum, rootPage);
+        SlottedNodeString *root = reinterpret_cast<SlottedNodeString *>(rootPage);
+
+        // check if this is the first entry, if so, need to create roots first child manually
+        if (root->leftmostPageNo == Page::INVALID_NUMBER)
+        {
+            Page *firstPage;
+            PageId firstPageId;
+            allocNodePage(firstPageId, firstPage);
+            initalizeStringNode(reinterpret_cast<SlottedNodeString *>(firstPage), true, 0);
+            bufMgr->unPinPage(file, firstPageId, true);
+            root->leftmostPageNo = firstPageId;
+            bufMgr->unPinPage(file, rootPageNum, true);
+        }
+        else
+        {
+            bufMgr->unPinPage(file, rootPageNum, false);
+        }
+
+        PageKeyPair<std::string> newChild;
+        if (insertStringRecursive(key, keyLength, rid, rootPageNum, false, newChild))
+        {
+            // root split, tree grows by one level
+            Page *newRootPage;
+            PageId newRootPageNo;
+            allocNodePage(newRootPageNo, newRootPage);
+            SlottedNodeString *newRoot = reinterpret_cast<SlottedNodeString *>(newRootPage);
+            initalizeStringNode(newRoot, false, 0);
+            std::vector<PageKeyPair<std::string> > entries(1, newChild);
+            encodeStringNonLeaf(newRoot, rootPageNum, entries, 0, 1);
+            bufMgr->unPinPage(file, newRootPageNo, true);
+            rootPageNum = newRootPageNo;
+        }
+
+        if (numPages != oldNumPages || rootPageNum != oldRootPageNo)
+        {
+            updateMetaInfo();
+        }
+    }
+
+    bool BTreeIndex::insertStringRecursive(const char *key, int keyLength, RecordId rid, PageId pageNo, bool isLeaf, PageKeyPair<std::string> &newChild)
+    {
+        if (isLeaf)
+        {
+            return insertIntoStringLeaf(key, keyLength, rid, pageNo, newChild);
+        }
+
+        Page *page;
+        bufMgr->readPage(file, pageNo, page);
+        SlottedNodeString *node = reinterpret_cast<SlottedNodeString *>(page);
+        int childIndex = findStringIndex(key, keyLength, node, false);
+        PageId childPageNo = stringChildAt(node, childIndex);
+        bool childIsLeaf = node->level == 1;
+        bufMgr->unPinPage(file, pageNo, false);
+
+        PageKeyPair<std::string> childSplit;
+        if (!insertStringRecursive(key, keyLength, rid, childPageNo, childIsLeaf, childSplit))
+        {
+            return false;
+        }
+
+        // child split, its separator goes right after the child it came from
+        bufMgr->readPage(file, pageNo, page);
+        node = reinterpret_cast<SlottedNodeString *>(page);
+        std::vector<PageKeyPair<std::string> > entries;
+        PageId leftmost = decodeStringNonLeaf(node, entries);
+        entries.insert(entries.begin() + childIndex, childSplit);
+        int count = (int)entries.size();
+        if (stringNonLeafSize(entries, 0, count) <= STRINGNODEDATASIZE)
+        {
+            encodeStringNonLeaf(node, leftmost, entries, 0, count);
+            bufMgr->unPinPage(file, pageNo, true);
+            return false;
+        }
+
+        // split by bytes, the middle separator moves up and its child becomes leftmost on the right
+        int total = stringNonLeafSize(entries, 0, count);
+        int mid = 0;
+        int size = 0;
+        while (mid < count - 2 && size + (int)(entries[mid].key.size() + sizeof(StringSlot)) <= total / 2)
+        {
+            size += entries[mid].key.size() + sizeof(StringSlot);
+            mid++;
+        }
+
+        Page *newPage;
+        PageId newPageNo;
+        allocNodePage(newPageNo, newPage);
+        SlottedNodeString *newNode = reinterpret_cast<SlottedNodeString *>(newPage);
+        initalizeStringNode(newNode, false, node->level);
+        encodeStringNonLeaf(newNode, entries[mid].pageNo, entries, mid + 1, count);
+        encodeStringNonLeaf(node, leftmost, entries, 0, mid);
+
+        newChild.set(newPageNo, entries[mid].key);
+        bufMgr->unPinPage(file, newPageNo, true);
+        bufMgr->unPinPage(file, pageNo, true);
+        return true;
+    }
+
+    bool BTreeIndex::insertIntoStringLeaf(const char *key, int keyLength, RecordId rid, PageId leafPageNo, PageKeyPair<std::string> &newChild)
+    {
+        Page *leafPage;
+        bufMgr->readPage(file, leafPageNo, leafPage);
+        SlottedNodeString *leaf = reinterpret_cast<SlottedNodeString *>(leafPage);
+
+        // position after every entry ordered before (key, rid)
+        int low = 0;
+        int high = leaf->numSlots;
+        StringSlot *slots = stringSlots(leaf);
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            int result = compareStringKey(leaf, mid, key, keyLength);
+            if (result < 0 || (result == 0 && (slots[mid].pageNo < rid.page_number ||
+                                               (slots[mid].pageNo == rid.page_number && slots[mid].slotNo < rid.slot_number))))
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        int index = low;
+
+        // common case, key shares the leaf prefix and its suffix fits into the free space
+        int prefixLength = leaf->prefixLength;
+        int suffixLength = keyLength - prefixLength;
+        if (keyLength >= prefixLength && memcmp(key, leaf->data + leaf->prefixOffset, prefixLength) == 0 &&
+            stringFreeSpace(leaf) >= suffixLength + (int)sizeof(StringSlot))
+        {
+            leaf->freeSpaceOffset -= suffixLength;
+            memcpy(leaf->data + leaf->freeSpaceOffset, key + prefixLength, suffixLength);
+            memmove(&slots[index + 1], &slots[index], (leaf->numSlots - index) * sizeof(StringSlot));
+            slots[index].keyOffset = leaf->freeSpaceOffset;
+            slots[index].keyLength = suffixLength;
+            slots[index].pageNo = rid.page_number;
+            slots[index].slotNo = rid.slot_number;
+            leaf->numSlots++;
+            bufMgr->unPinPage(file, leafPageNo, true);
+            return false;
+        }
+
+        // otherwise rebuild the leaf, the prefix may shrink
+        std::vector<RIDKeyPair<std::string> > entries;
+        decodeStringLeaf(leaf, entries);
+        RIDKeyPair<std::string> entry;
+        entry.set(rid, std::string(key, keyLength));
+        entries.insert(entries.begin() + index, entry);
+        int count = (int)entries.size();
+        if (stringLeafSize(entries, 0, count) <= STRINGNODEDATASIZE)
+        {
+            encodeStringLeaf(leaf, entries, 0, count);
+            bufMgr->unPinPage(file, leafPageNo, true);
+            return false;
+        }
+
+        // split by bytes so long and short keys both leave room on each side
+        int total = stringLeafSize(entries, 0, count);
+        int mid = 1;
+        int size = entries[0].key.size() + sizeof(StringSlot);
+        while (mid < count - 1 && size + (int)(entries[mid].key.size() + sizeof(StringSlot)) <= total / 2)
+        {
+            size += entries[mid].key.size() + sizeof(StringSlot);
+            mid++;
+        }
+
+        Page *newPage;
+        PageId newPageNo;
+        allocNodePage(newPageNo, newPage);
+        SlottedNodeString *newLeaf = reinterpret_cast<SlottedNodeString *>(newPage);
+        initalizeStringNode(newLeaf, true, 0);
+        encodeStringLeaf(newLeaf, entries, mid, count);
+        encodeStringLeaf(leaf, entries, 0, mid);
+        linkSplitLeaf(leafPageNo, leafPage, newPageNo, newPage);
+
+        newChild.set(newPageNo, shortestSeparator(entries[mid - 1].key, entries[mid].key));
+        bufMgr->unPinPage(file, newPageNo, true);
+        bufMgr->unPinPage(file, leafPageNo, true);
+        return true;
+    }
+
+    PageId BTreeIndex::locateStringLeaf(const char *key, int keyLength, bool rightmost)
+    {
+        // separators equal to key may have a run of key on their left, so descend left of them
+        // unless the last leaf holding key is wanted
+        PageId curPageNum = rootPageNum;
+        while (true)
+        {
+            Page *curPage;
+            bufMgr->readPage(file, curPageNum, curPage);
+            SlottedNodeString *curNode = reinterpret_cast<SlottedNodeString *>(curPage);
+            PageId childPageNum = stringChildAt(curNode, findStringIndex(key, keyLength, curNode, !rightmost));
+            bool childIsLeaf = curNode->level == 1;
+            bufMgr->unPinPage(file, curPageNum, false);
+
+            if (childIsLeaf || childPageNum == Page::INVALID_NUMBER)
+            {
+                return childPageNum;
+            }
+            curPageNum = childPageNum;
+        }
+    }
+
+}
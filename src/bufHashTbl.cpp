@@ -5,6 +5,7 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cstdint>
 #include <memory>
 #include <iostream>
 #include "buffer.h"
@@ -15,16 +16,35 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+namespace {
+
+/**
+ * Buckets of the old table moved by each operation during a resize.
+ */
+const int MIGRATE_BUCKETS = 2;
+
+void deleteChains(hashBucket** table, const int from, const int size)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  for(int i = from; i < size; i++) {
+    while (table[i]) {
+      hashBucket* tmpBuf = table[i];
+      table[i] = table[i]->next;
+      delete tmpBuf;
+    }
+  }
+}
+
+}
+
+int BufHashTbl::hash(const File* file, const PageId pageNo, const int size)
+{
+  // unsigned, since the address of the file may not fit a positive int
+  std::uintptr_t tmp = (std::uintptr_t)file;  // cast of pointer to the file object to an integer
+  return (int)((tmp + pageNo) % (std::uintptr_t)size);
 }
 
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(htSize), oldHt(NULL), OLDHTSIZE(0), migrated(0)
 {
   // allocate an array of pointers to hashBuckets
   ht = new hashBucket* [htSize];
@@ -34,32 +54,91 @@ BufHashTbl::BufHashTbl(int htSize)
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
+  deleteChains(ht, 0, HTSIZE);
+  delete [] ht;
+  if (oldHt)
+  {
+    deleteChains(oldHt, migrated, OLDHTSIZE);
+    delete [] oldHt;
+  }
+}
+
+void BufHashTbl::resize(const int htSize)
+{
+  if (oldHt)
+    migrate(OLDHTSIZE);
+
+  oldHt = ht;
+  OLDHTSIZE = HTSIZE;
+  migrated = 0;
+  ht = new hashBucket* [htSize];
+  HTSIZE = htSize;
+  for(int i=0; i < HTSIZE; i++)
+    ht[i] = NULL;
+}
+
+void BufHashTbl::migrate(const int buckets)
+{
+  if (!oldHt)
+    return;
+
+  for (int moved = 0; moved < buckets && migrated < OLDHTSIZE; moved++, migrated++)
+  {
+    while (oldHt[migrated])
+    {
+      hashBucket* tmpBuc = oldHt[migrated];
+      oldHt[migrated] = tmpBuc->next;
+      int index = hash(tmpBuc->file, tmpBuc->pageNo, HTSIZE);
+      tmpBuc->next = ht[index];
+      ht[index] = tmpBuc;
     }
   }
-  delete [] ht;
+
+  if (migrated == OLDHTSIZE)
+  {
+    delete [] oldHt;
+    oldHt = NULL;
+  }
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+hashBucket** BufHashTbl::find(const File* file, const PageId pageNo)
 {
-  int index = hash(file, pageNo);
+  hashBucket** link = &ht[hash(file, pageNo, HTSIZE)];
+  while (*link) {
+    if ((*link)->file == file && (*link)->pageNo == pageNo)
+      return link;
+    link = &(*link)->next;
+  }
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+  if (oldHt)
+  {
+    int index = hash(file, pageNo, OLDHTSIZE);
+    if (index >= migrated)
+    {
+      link = &oldHt[index];
+      while (*link) {
+        if ((*link)->file == file && (*link)->pageNo == pageNo)
+          return link;
+        link = &(*link)->next;
+      }
+    }
   }
+  return NULL;
+}
+
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  migrate(MIGRATE_BUCKETS);
 
-  tmpBuc = new hashBucket;
+  hashBucket** link = find(file, pageNo);
+  if (link)
+    throw HashAlreadyPresentException((*link)->file->filename(), (*link)->pageNo, (*link)->frameNo);
+
+  hashBucket* tmpBuc = new hashBucket;
   if (!tmpBuc)
   	throw HashTableException();
 
+  int index = hash(file, pageNo, HTSIZE);
   tmpBuc->file = (File*) file;
   tmpBuc->pageNo = pageNo;
   tmpBuc->frameNo = frameNo;
@@ -69,46 +148,33 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
-  }
+  if (!tryLookup(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+bool BufHashTbl::tryLookup(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  migrate(MIGRATE_BUCKETS);
+
+  hashBucket** link = find(file, pageNo);
+  if (!link)
+    return false;
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  frameNo = (*link)->frameNo; // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
-    }
-  }
+  migrate(MIGRATE_BUCKETS);
+
+  hashBucket** link = find(file, pageNo);
+  if (!link)
+    throw HashNotFoundException(file->filename(), pageNo);
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  hashBucket* tmpBuc = *link;
+  *link = tmpBuc->next;
+  delete tmpBuc;
 }
 
 }
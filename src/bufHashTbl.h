@@ -55,13 +55,47 @@ class BufHashTbl
   hashBucket**  ht;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * Table a resize is moving entries out of, or NULL.  Its buckets from
+	 * migrated on still hold entries and are searched after those of ht.
+	 */
+  hashBucket**  oldHt;
+
+	/**
+	 * Size of oldHt
+	 */
+  int OLDHTSIZE;
+
+	/**
+	 * Number of buckets of oldHt already moved to ht
+	 */
+  int migrated;
+
+	/**
+	 * returns hash value between 0 and size-1 computed using file and pageNo
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
+	 * @param size  	Size of the table hashed into
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  int	 hash(const File* file, const PageId pageNo, const int size);
+
+	/**
+	 * Returns the link pointing at the entry of (file, pageNo), in ht or in
+	 * the part of oldHt not moved yet, or NULL if there is none.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  hashBucket** find(const File* file, const PageId pageNo);
+
+	/**
+	 * Moves the entries of a few more buckets of oldHt to ht, and frees oldHt
+	 * once it is empty.
+	 *
+	 * @param buckets	Number of buckets to move
+	 */
+  void migrate(const int buckets);
 
  public:
 	/**
@@ -96,6 +130,18 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Like lookup(), but returns false instead of throwing if the page entry is
+   * not found, for callers to which a page missing from the buffer pool is
+   * no error.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference
+	 * @return  			True if the page entry was found
+	 */
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -104,6 +150,16 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+   * Change the number of buckets.  The entries are not rehashed at once:
+   * every later insert, lookup and remove moves a few buckets of the old
+   * table over, so no single call pays for the whole table.  A resize
+   * before the previous one is done finishes that one first.
+	 *
+	 * @param htSize	New number of buckets
+	 */
+  void resize(const int htSize);
 };
 
 }
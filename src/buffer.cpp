@@ -5,7 +5,11 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <memory>
+#include <new>
 #include <iostream>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
@@ -13,199 +17,716 @@
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/page_checksum_exception.h"
 
 namespace badgerdb { 
 
+namespace {
+
+/**
+ * Nanoseconds since the given time.
+ */
+std::uint64_t nanosSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Holds the locks of all partitions of a hash table, taken in order.
+ */
+class PartitionsGuard
+{
+  BufHashPartition* partitions;
+
+ public:
+  explicit PartitionsGuard(BufHashPartition* partitionsIn) : partitions(partitionsIn)
+  {
+    for (int p = 0; p < BUFHASHPARTITIONS; p++)
+      partitions[p].mutex.lock();
+  }
+
+  ~PartitionsGuard()
+  {
+    for (int p = BUFHASHPARTITIONS - 1; p >= 0; p--)
+      partitions[p].mutex.unlock();
+  }
+};
+
+}
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
+BufMgr::BufMgr(std::uint32_t bufs, LogManager* log, int poolOptions)
+	: numBufs(bufs), framesInIo(0), logManager(log), loggedPool(NULL), loggedMemory(NULL), lastCheckpointLSN(0),
+	  pageChecksums(false) {
+  // address space is reserved for as many frames as the machine has memory for, so resize() grows
+  // the pool in place and never moves a frame or its descriptor
+  std::size_t maxBufs = PoolMemory::physicalMemory() / sizeof(Page);
+  if (maxBufs < bufs)
+  {
+    maxBufs = bufs;
+  }
 
+  descMemory = new PoolMemory((std::size_t)bufs * sizeof(BufDesc), POOL_DEFAULT, maxBufs * sizeof(BufDesc));
+  bufDescTable = static_cast<BufDesc*>(descMemory->base());
   for (FrameId i = 0; i < bufs; i++) 
   {
+  	new (&bufDescTable[i]) BufDesc();
   	bufDescTable[i].frameNo = i;
-  	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  // frames are given a page before they are read, so the zeroed mapping is not initialized frame by
+  // frame, which would fault all of it in
+  poolMemory = new PoolMemory((std::size_t)bufs * sizeof(Page), poolOptions, maxBufs * sizeof(Page));
+  bufPool = static_cast<Page*>(poolMemory->base());
+  if (logManager != NULL)
+  {
+    // likewise filled in as each frame gets its page
+    loggedMemory = new PoolMemory((std::size_t)bufs * sizeof(Page), POOL_DEFAULT, maxBufs * sizeof(Page));
+    loggedPool = static_cast<Page*>(loggedMemory->base());
+  }
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  // allocate the buffer hash table
+  for (int p = 0; p < BUFHASHPARTITIONS; p++)
+  {
+    partitions[p].table = new BufHashTbl (hashTableSize(bufs));
+  }
 
   clockHand = bufs - 1;
 }
 
 
 BufMgr::~BufMgr() {
-  //Flush out all unwritten pages
+  //Flush out all unwritten pages, leaving out changes of transactions that never committed
   for (std::uint32_t i = 0; i < numBufs; i++) 
   {
   	BufDesc* tmpbuf = &(bufDescTable[i]);
-  	if (tmpbuf->valid == true && tmpbuf->dirty == true)
+  	if (tmpbuf->valid == true && tmpbuf->dirty == true && tmpbuf->txnCount == 0)
 		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+			writeBack(i);
   	}
   }
 
-	delete hashTable;
-  delete [] bufDescTable;
-  delete [] bufPool;
+  // every logged change is in the files now, so once they are synced the log is not needed
+  if (logManager != NULL)
+  {
+    for (std::set<std::string>::iterator it = unsyncedFiles.begin(); it != unsyncedFiles.end(); ++it)
+    {
+      LogManager::syncFile(*it);
+    }
+    logManager->reset();
+  }
+
+  for (int p = 0; p < BUFHASHPARTITIONS; p++)
+  {
+    delete partitions[p].table;
+  }
+  for (std::uint32_t i = 0; i < numBufs; i++) 
+  {
+  	bufDescTable[i].~BufDesc();
+  }
+  delete descMemory;
+  delete poolMemory;
+  delete loggedMemory;
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::resize(std::uint32_t newBufs)
+{
+  if (newBufs == 0)
+    throw BufferExceededException();
+
+  std::unique_lock<std::mutex> guard(bufMutex);
+  waitForFrameIo(guard);
+  // readers pin frames holding only their partition's lock, so every lock is taken to keep all pin
+  // counts still
+  PartitionsGuard partitionsGuard(partitions);
+
+  if (newBufs > numBufs)
+  {
+    try
+    {
+      poolMemory->resize((std::size_t)newBufs * sizeof(Page));
+      if (loggedMemory != NULL)
+        loggedMemory->resize((std::size_t)newBufs * sizeof(Page));
+      descMemory->resize((std::size_t)newBufs * sizeof(BufDesc));
+    }
+    catch (...)
+    {
+      poolMemory->resize((std::size_t)numBufs * sizeof(Page));
+      if (loggedMemory != NULL)
+        loggedMemory->resize((std::size_t)numBufs * sizeof(Page));
+      descMemory->resize((std::size_t)numBufs * sizeof(BufDesc));
+      throw;
+    }
+
+    for (FrameId i = numBufs; i < newBufs; i++)
+    {
+      new (&bufDescTable[i]) BufDesc();
+      bufDescTable[i].frameNo = i;
+    }
+    numBufs = newBufs;
+    for (int p = 0; p < BUFHASHPARTITIONS; p++)
+      partitions[p].table->resize(hashTableSize(newBufs));
+  }
+  else if (newBufs < numBufs)
+  {
+    // every frame to drop is checked before any is touched, so a refused shrink changes nothing
+    for (FrameId i = newBufs; i < numBufs; i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[i]);
+      if (tmpbuf->valid == true && (tmpbuf->pinCnt > 0 || tmpbuf->txnCount > 0))
+        throw PagePinnedException(tmpbuf->file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+    }
+
+    // written back before any frame is dropped, so a failed write leaves every page in the pool
+    for (FrameId i = newBufs; i < numBufs; i++)
+    {
+      if (bufDescTable[i].valid == true && bufDescTable[i].dirty == true)
+      {
+        writeBack(i);
+      }
+    }
+
+    for (FrameId i = newBufs; i < numBufs; i++)
+    {
+      if (bufDescTable[i].valid == true)
+        unmapFrame(i);
+      bufDescTable[i].~BufDesc();
+    }
+    numBufs = newBufs;
+    if (clockHand >= numBufs)
+      clockHand = numBufs - 1;
+
+    descMemory->resize((std::size_t)newBufs * sizeof(BufDesc));
+    poolMemory->resize((std::size_t)newBufs * sizeof(Page));
+    if (loggedMemory != NULL)
+      loggedMemory->resize((std::size_t)newBufs * sizeof(Page));
+    for (int p = 0; p < BUFHASHPARTITIONS; p++)
+      partitions[p].table->resize(hashTableSize(newBufs));
+  }
+}
+
+void BufMgr::allocBuf(FrameId & frame, std::unique_lock<std::mutex>& guard) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
   std::uint32_t numScanned = 0;
-  bool found = 0;
+  bool found = false;
+  bool evicted = false;
 
   while (numScanned < 2*numBufs)	//Need to scn twice
   {
     // advance the clock
     advanceClock();
     numScanned++;
+    frame = clockHand;
+    BufDesc* tmpbuf = &(bufDescTable[frame]);
+
+    // a frame being read in or written back, or claimed by allocPage(), is in use
+    if (tmpbuf->io != FRAME_READY)
+    {
+      continue;
+    }
 
     // if invalid, use frame
-    if (! bufDescTable[clockHand].valid)
+    if (! tmpbuf->valid)
     {
+      found = true;
       break;
     }
 
     // is valid, check referenced bit
-    if (! bufDescTable[clockHand].refbit)
+    if (! tmpbuf->refbit)
     {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
+      // check to see if someone has it pinned, or changed it in a transaction still open
+      if (tmpbuf->pinCnt == 0 && tmpbuf->txnCount == 0)
       {
+        // flush any existing changes to disk first, with the mutex let go. The frame may be pinned
+        // again or taken by another thread meanwhile, so it is looked at again afterwards
+        bool written = false;
+        if (tmpbuf->dirty)
+        {
+          written = writeBackUnlocked(frame, guard);
+          if (!written || frame >= numBufs)
+          {
+            continue;
+          }
+        }
+
         // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-        found = true;
-        break;
+        if (evictFrame(frame))
+        {
+          if (written)
+          {
+            bufStats.dirtyEvictions++;
+          }
+          found = evicted = true;
+          break;
+        }
       }
     }
     else
     {
       // has been referenced, clear the bit
-      bufStats.accesses++;
-      bufDescTable[clockHand].refbit = false;
+      tmpbuf->refbit = false;
     }
   }
+
+  bufStats.clockSweeps++;
+  bufStats.clockSteps += numScanned;
+  if (numScanned > bufStats.maxClockSweep)
+  {
+    bufStats.maxClockSweep = numScanned;
+  }
   
   // check for full buffer pool
-  if (!found && numScanned >= 2*numBufs)
+  if (!found)
   {
     throw BufferExceededException();
   }
   
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+  if (evicted)
   {
-    bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    bufStats.evictions++;
   }
 
 	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
-
-  // return new frame number
-  frame = clockHand;
+  bufDescTable[frame].Clear();
 } // end allocBuf
 
+bool BufMgr::evictFrame(FrameId frame)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+  if (tmpbuf->valid == false || tmpbuf->io != FRAME_READY || tmpbuf->txnCount > 0)
+  {
+    return false;
+  }
+
+  // a reader may have pinned it, and changed it, since the clock looked
+  BufHashPartition& partition = hashPartition(tmpbuf->file, tmpbuf->pageNo);
+  std::lock_guard<std::mutex> partitionGuard(partition.mutex);
+  if (tmpbuf->pinCnt > 0 || tmpbuf->refbit || tmpbuf->dirty)
+  {
+    return false;
+  }
+  unmapFrame(frame);
+  return true;
+}
+
+void BufMgr::unmapFrame(FrameId frame)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+  bufStats.accesses += tmpbuf->hits;
+  bufStats.hits += tmpbuf->hits;
+  tmpbuf->fileStats->hits += tmpbuf->hits;
+  hashPartition(tmpbuf->file, tmpbuf->pageNo).table->remove(tmpbuf->file, tmpbuf->pageNo);
+  tmpbuf->Clear();
+}
+
+void BufMgr::foldFrameStats()
+{
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    // a frame counts hits only while it holds a page, which it keeps as long as bufMutex is held
+    BufDesc* tmpbuf = &(bufDescTable[i]);
+    if (tmpbuf->valid == true)
+    {
+      std::lock_guard<std::mutex> partitionGuard(hashPartition(tmpbuf->file, tmpbuf->pageNo).mutex);
+      bufStats.accesses += tmpbuf->hits;
+      bufStats.hits += tmpbuf->hits;
+      tmpbuf->fileStats->hits += tmpbuf->hits;
+      tmpbuf->hits = 0;
+    }
+  }
+  bufStats.pinnedHighWater = 0;
+  for (int p = 0; p < BUFHASHPARTITIONS; p++)
+  {
+    std::lock_guard<std::mutex> partitionGuard(partitions[p].mutex);
+    bufStats.pinnedHighWater += partitions[p].pinnedHighWater;
+  }
+}
+
+void BufMgr::clearFrameStats()
+{
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[i]);
+    if (tmpbuf->valid == true)
+    {
+      std::lock_guard<std::mutex> partitionGuard(hashPartition(tmpbuf->file, tmpbuf->pageNo).mutex);
+      tmpbuf->hits = 0;
+    }
+  }
+  for (int p = 0; p < BUFHASHPARTITIONS; p++)
+  {
+    std::lock_guard<std::mutex> partitionGuard(partitions[p].mutex);
+    partitions[p].pinnedHighWater = partitions[p].pinnedFrames;
+    bufStats.pinnedHighWater += partitions[p].pinnedFrames;
+  }
+}
+
+void BufMgr::waitForFrameIo(std::unique_lock<std::mutex>& guard)
+{
+  while (framesInIo > 0)
+  {
+    frameIoDone.wait(guard);
+  }
+}
+
+void BufMgr::writeBack(FrameId frame)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+  if (logManager != NULL)
+  {
+    unsyncedFiles.insert(tmpbuf->file->filename());
+  }
+  bufStats.writeLatency.record(writeFrame(frame));
+  bufStats.diskwrites++;
+  tmpbuf->fileStats->diskwrites++;
+  tmpbuf->dirty = false;
+  tmpbuf->recLSN = 0;
+}
+
+bool BufMgr::writeBackUnlocked(FrameId frame, std::unique_lock<std::mutex>& guard)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+  BufHashPartition& partition = hashPartition(tmpbuf->file, tmpbuf->pageNo);
+  {
+    std::lock_guard<std::mutex> partitionGuard(partition.mutex);
+    if (tmpbuf->pinCnt > 0)
+    {
+      return false;
+    }
+    // nobody pins the frame from here on, so nobody changes the page while it is written
+    tmpbuf->io = FRAME_WRITING;
+  }
+  framesInIo++;
+  if (logManager != NULL)
+  {
+    unsyncedFiles.insert(tmpbuf->file->filename());
+  }
+  guard.unlock();
+
+  std::uint64_t nanos = 0;
+  std::exception_ptr error;
+  try
+  {
+    nanos = writeFrame(frame);
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  guard.lock();
+  if (!error)
+  {
+    bufStats.writeLatency.record(nanos);
+    bufStats.diskwrites++;
+    tmpbuf->fileStats->diskwrites++;
+    tmpbuf->dirty = false;
+    tmpbuf->recLSN = 0;
+  }
+  framesInIo--;
+  {
+    std::lock_guard<std::mutex> partitionGuard(partition.mutex);
+    tmpbuf->io = FRAME_READY;
+  }
+  partition.ioDone.notify_all();
+  frameIoDone.notify_all();
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+  return true;
+}
+
+std::uint64_t BufMgr::writeFrame(FrameId frame)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+  if (logManager != NULL)
+  {
+    // write-ahead rule: the log describes every change before the page reaches the file
+    logManager->flush(tmpbuf->pageLSN);
+  }
+  // a page holding a checksum gets it redone as the file writes it
+  if (pageChecksums && !bufPool[frame].hasChecksum())
+  {
+    bufPool[frame].updateChecksum();
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[frame]);
+  return nanosSince(start);
+}
+
+void BufMgr::logChange(FrameId frame)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frame]);
+  std::map<std::thread::id, BufTransaction>::iterator it = transactions.find(std::this_thread::get_id());
+  if (it != transactions.end())
+  {
+    // logged when the transaction commits
+    std::vector<FrameId>& frames = it->second.frames;
+    if (std::find(frames.begin(), frames.end(), frame) == frames.end())
+    {
+      frames.push_back(frame);
+      tmpbuf->txnCount++;
+    }
+    return;
+  }
+
+  std::string records;
+  if (LogManager::appendPageRecord(records, tmpbuf->file, tmpbuf->pageNo, loggedPool[frame], bufPool[frame]))
+  {
+    loggedPool[frame] = bufPool[frame];
+    LogSeqNum start;
+    tmpbuf->pageLSN = logManager->append(records, start);
+    if (tmpbuf->recLSN == 0)
+    {
+      tmpbuf->recLSN = start;
+    }
+  }
+}
+
 	
+bool BufMgr::pinFrame(BufHashPartition& partition, std::unique_lock<std::mutex>& partitionGuard,
+                      File* file, const PageId pageNo, FrameId & frame)
+{
+  while (true)
+  {
+    if (!partition.table->tryLookup(file, pageNo, frame))
+    {
+      return false;
+    }
+
+    BufDesc* tmpbuf = &(bufDescTable[frame]);
+    if (tmpbuf->io == FRAME_READY)
+    {
+      // set the referenced bit. Ordered with the clock by the partition lock
+      tmpbuf->refbit.store(true, std::memory_order_relaxed);
+      if (tmpbuf->pinCnt++ == 0)
+      {
+        framePinned(partition);
+      }
+      tmpbuf->hits++;
+      return true;
+    }
+
+    // the page may be gone from the pool once its transfer is done, so it is looked up again
+    partition.ioDone.wait(partitionGuard);
+  }
+}
+
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
-  // check to see if it is already in the buffer pool
-  // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
+  BufHashPartition& partition = hashPartition(file, pageNo);
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
 
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
-  }
-  catch(const HashNotFoundException &e) //not in the buffer pool, must allocate a new page
+  while (true)
   {
-    // alloc a new frame
-    allocBuf(frameNo);
+    // check to see if it is already in the buffer pool, taking no lock but the partition's
+    {
+      std::unique_lock<std::mutex> partitionGuard(partition.mutex);
+      if (pinFrame(partition, partitionGuard, file, pageNo, frameNo))
+      {
+        page = &bufPool[frameNo];
+        return;
+      }
+    }
+
+    //not in the buffer pool, must allocate a new page
+    std::unique_lock<std::mutex> guard(bufMutex);
+    allocBuf(frameNo, guard);
+    FileBufStats* fileStats = &bufStats.files[file->filename()];
+
+    std::unique_lock<std::mutex> partitionGuard(partition.mutex);
+    FrameId otherFrame;
+    if (partition.table->tryLookup(file, pageNo, otherFrame))
+    {
+      // read in by another thread while the partition was not locked. The frame just freed stays
+      // free, and the page is pinned like any other found in the pool
+      continue;
+    }
+
+    // set up the entry properly, so that other readers of the page wait for it
+    bufDescTable[frameNo].Set(file, pageNo, fileStats);
+    bufDescTable[frameNo].io = FRAME_READING;
+    framePinned(partition);
 
-    // read the page into the new frame
+    // insert in the hash table
+    partition.table->insert(file, pageNo, frameNo);
+    partitionGuard.unlock();
+
+    framesInIo++;
+    bufStats.accesses++;
     bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
+    bufStats.misses++;
+    fileStats->misses++;
+    break;
+  }
+
+  // read the page into the new frame, holding no lock
+  std::uint64_t nanos = 0;
+  bool checksumValid = true;
+  std::exception_ptr error;
+  try
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     bufPool[frameNo] = file->readPage(pageNo);
+    nanos = nanosSince(start);
+    checksumValid = !pageChecksums || bufPool[frameNo].checksumValid();
+    if (checksumValid && logManager != NULL)
+    {
+      loggedPool[frameNo] = bufPool[frameNo];
+    }
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+  {
+    std::lock_guard<std::mutex> guard(bufMutex);
+    if (!error)
+    {
+      bufStats.readLatency.record(nanos);
+    }
+    framesInIo--;
+    std::lock_guard<std::mutex> partitionGuard(partition.mutex);
+    if (error || !checksumValid)
+    {
+      // the frame stays free
+      partition.pinnedFrames--;
+      unmapFrame(frameNo);
+    }
+    else
+    {
+      bufDescTable[frameNo].io = FRAME_READY;
+    }
+  }
+  partition.ioDone.notify_all();
+  frameIoDone.notify_all();
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+  if (error)
+  {
+    std::rethrow_exception(error);
   }
+  if (!checksumValid)
+  {
+    throw PageChecksumException(pageNo, file->filename());
+  }
+  page = &bufPool[frameNo];
 }
 
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+  // a change is logged before the pin is let go, so that the frame is not written back or handed
+  // out first. The buffer mutex is taken before the partition lock
+  std::unique_lock<std::mutex> guard(bufMutex, std::defer_lock);
+  if (dirty == true && logManager != NULL)
+  {
+    guard.lock();
+  }
+
   // lookup in hashtable
+  BufHashPartition& partition = hashPartition(file, pageNo);
+  std::lock_guard<std::mutex> partitionGuard(partition.mutex);
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  partition.table->lookup(file, pageNo, frameNo);
+  BufDesc* tmpbuf = &(bufDescTable[frameNo]);
 
-  if (dirty == true) bufDescTable[frameNo].dirty = dirty;
+  if (dirty == true) tmpbuf->dirty = dirty;
 
   // make sure the page is actually pinned
-  if (bufDescTable[frameNo].pinCnt == 0)
+  if (tmpbuf->pinCnt == 0)
   {
   	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
   }
-  else bufDescTable[frameNo].pinCnt--;
+
+  if (dirty == true && logManager != NULL)
+  {
+    logChange(frameNo);
+  }
+
+  if (--tmpbuf->pinCnt == 0)
+  {
+    partition.pinnedFrames--;
+  }
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
   FrameId frameNo;
+  {
+    std::unique_lock<std::mutex> guard(bufMutex);
+    bufStats.accesses++;
 
-  // alloc a new frame
-  allocBuf(frameNo);
+    // alloc a new frame, kept from other threads until the page is allocated
+    allocBuf(frameNo, guard);
+    bufDescTable[frameNo].io = FRAME_READING;
+    framesInIo++;
+  }
 
-  // allocate a new page in the file
-	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
-  page = &bufPool[frameNo];
+  // allocate a new page in the file, holding no lock
+  std::exception_ptr error;
+  try
+  {
+    bufPool[frameNo] = file->allocatePage(pageNo);
+    if (logManager != NULL)
+    {
+      loggedPool[frameNo] = bufPool[frameNo];
+    }
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  std::lock_guard<std::mutex> guard(bufMutex);
+  framesInIo--;
+  frameIoDone.notify_all();
+  if (error)
+  {
+    // the frame stays free
+    bufDescTable[frameNo].io = FRAME_READY;
+    std::rethrow_exception(error);
+  }
 
   // set up the entry properly
-  bufDescTable[frameNo].Set(file, pageNo);
+  BufHashPartition& partition = hashPartition(file, pageNo);
+  std::lock_guard<std::mutex> partitionGuard(partition.mutex);
+  bufDescTable[frameNo].Set(file, pageNo, &bufStats.files[file->filename()]);
+  framePinned(partition);
+  page = &bufPool[frameNo];
 
   // insert in the hash table
-  hashTable->insert(file, pageNo, frameNo);
+  partition.table->insert(file, pageNo, frameNo);
 }
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::unique_lock<std::mutex> guard(bufMutex);
+  waitForFrameIo(guard);
+
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if(tmpbuf->file && tmpbuf->valid == true && tmpbuf->file == file)
 		{
-	    if (tmpbuf->pinCnt > 0)
+	    std::lock_guard<std::mutex> partitionGuard(hashPartition(file, tmpbuf->pageNo).mutex);
+	    if (tmpbuf->pinCnt > 0 || tmpbuf->txnCount > 0)
   			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
 
 	    if (tmpbuf->dirty == true)
 			{
 				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
+				writeBack(i);
     	}
 
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
+    	unmapFrame(i);
   	}
 		else if (tmpbuf->valid == false && tmpbuf->file == file)
   		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
@@ -214,18 +735,186 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
-	//Deallocate from file altogether
-  //See if it is in the buffer pool
-  FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  {
+    std::unique_lock<std::mutex> guard(bufMutex);
+    waitForFrameIo(guard);
+
+    //Deallocate from file altogether
+    //See if it is in the buffer pool
+    FrameId frameNo = 0;
+    BufHashPartition& partition = hashPartition(file, pageNo);
+    std::lock_guard<std::mutex> partitionGuard(partition.mutex);
+    partition.table->lookup(file, pageNo, frameNo);
+
+    // clear the page
+    if (bufDescTable[frameNo].pinCnt > 0)
+    {
+      partition.pinnedFrames--;
+    }
+    unmapFrame(frameNo);
+  }
 
-	// clear the page
-	bufDescTable[frameNo].Clear();
+  // deallocate it in the file, holding no lock
+  file->deletePage(pageNo);
+}
 
-	hashTable->remove(file, pageNo);
 
-  // deallocate it in the file	
-  file->deletePage(pageNo);
+void BufMgr::beginTransaction()
+{
+  if (logManager == NULL)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(bufMutex);
+  transactions[std::this_thread::get_id()].depth++;
+}
+
+LogSeqNum BufMgr::commitTransaction(bool wait)
+{
+  if (logManager == NULL)
+  {
+    return 0;
+  }
+
+  LogSeqNum lsn;
+  {
+    std::lock_guard<std::mutex> guard(bufMutex);
+    std::map<std::thread::id, BufTransaction>::iterator it = transactions.find(std::this_thread::get_id());
+    if (it == transactions.end() || --it->second.depth > 0)
+    {
+      return 0;
+    }
+
+    std::string records;
+    std::vector<FrameId> logged;
+    std::vector<FrameId>& frames = it->second.frames;
+    for (std::size_t i = 0; i < frames.size(); i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+      if (tmpbuf->valid == false || tmpbuf->txnCount == 0)
+      {
+        continue;
+      }
+      tmpbuf->txnCount--;
+      if (LogManager::appendPageRecord(records, tmpbuf->file, tmpbuf->pageNo, loggedPool[frames[i]], bufPool[frames[i]]))
+      {
+        loggedPool[frames[i]] = bufPool[frames[i]];
+        logged.push_back(frames[i]);
+      }
+    }
+    transactions.erase(it);
+    if (logged.empty())
+    {
+      return 0;
+    }
+
+    LogSeqNum start;
+    lsn = logManager->append(records, start);
+    for (std::size_t i = 0; i < logged.size(); i++)
+    {
+      bufDescTable[logged[i]].pageLSN = lsn;
+      if (bufDescTable[logged[i]].recLSN == 0)
+      {
+        bufDescTable[logged[i]].recLSN = start;
+      }
+    }
+  }
+
+  if (wait)
+  {
+    waitForLog(lsn);
+  }
+  return lsn;
+}
+
+void BufMgr::waitForLog(LogSeqNum lsn)
+{
+  // outside the buffer mutex, so other threads can commit into the same sync
+  if (logManager != NULL && lsn > 0)
+  {
+    logManager->flush(lsn);
+  }
+}
+
+void BufMgr::abortTransaction()
+{
+  if (logManager == NULL)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(bufMutex);
+  std::map<std::thread::id, BufTransaction>::iterator it = transactions.find(std::this_thread::get_id());
+  if (it == transactions.end())
+  {
+    return;
+  }
+
+  // the last logged image of a page is the page before the transaction changed it
+  std::vector<FrameId>& frames = it->second.frames;
+  for (std::size_t i = 0; i < frames.size(); i++)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+    if (tmpbuf->valid == true && tmpbuf->txnCount > 0)
+    {
+      bufPool[frames[i]] = loggedPool[frames[i]];
+      tmpbuf->txnCount--;
+    }
+  }
+  transactions.erase(it);
+}
+
+void BufMgr::checkpoint()
+{
+  if (logManager == NULL)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> checkpointGuard(checkpointMutex);
+
+  // a page dirty since before the last checkpoint would keep the redo start from moving, so write
+  // it back. The buffer mutex is let go during each write, so only readers of that page wait for it
+  for (std::uint32_t i = 0; ; i++)
+  {
+    std::unique_lock<std::mutex> guard(bufMutex);
+    // the pool may be resized between two frames
+    if (i >= numBufs)
+      break;
+    BufDesc* tmpbuf = &(bufDescTable[i]);
+    if (tmpbuf->valid == true && tmpbuf->io == FRAME_READY && tmpbuf->dirty == true && tmpbuf->recLSN != 0 &&
+        tmpbuf->recLSN < lastCheckpointLSN && tmpbuf->pinCnt == 0 && tmpbuf->txnCount == 0)
+    {
+      writeBackUnlocked(i, guard);
+    }
+  }
+
+  std::vector<DirtyPage> dirtyPages;
+  std::set<std::string> writtenFiles;
+  LogSeqNum beginLSN;
+  {
+    std::lock_guard<std::mutex> guard(bufMutex);
+    beginLSN = logManager->nextLSN();
+    for (std::uint32_t i = 0; i < numBufs; i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[i]);
+      if (tmpbuf->valid == true && tmpbuf->recLSN != 0)
+      {
+        DirtyPage dirtyPage;
+        dirtyPage.filename = tmpbuf->file->filename();
+        dirtyPage.pageNo = tmpbuf->pageNo;
+        dirtyPage.recLSN = tmpbuf->recLSN;
+        dirtyPages.push_back(dirtyPage);
+      }
+    }
+    writtenFiles.swap(unsyncedFiles);
+  }
+
+  // pages left out of the table were written back, and have to be on disk before recovery skips them
+  for (std::set<std::string>::iterator it = writtenFiles.begin(); it != writtenFiles.end(); ++it)
+  {
+    LogManager::syncFile(*it);
+  }
+  logManager->checkpoint(dirtyPages, beginLSN);
+  lastCheckpointLSN = beginLSN;
 }
 
 void BufMgr::printSelf(void) 
@@ -9,7 +9,19 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "version_latch.h"
+#include "log_manager.h"
+#include "pool_memory.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace badgerdb {
 
@@ -18,8 +30,70 @@ namespace badgerdb {
 */
 class BufMgr;
 
+/**
+* @brief Buffer pool usage of the pages of one file
+*/
+struct FileBufStats
+{
+	/**
+   * Number of reads of a page found in the buffer pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of reads of a page that had to be read from the file
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of pages written back to the file
+	 */
+  std::uint64_t diskwrites;
+
+	/**
+   * Fraction of reads found in the buffer pool, 0 if there were none
+	 */
+  double hitRatio() const
+  {
+		return hits + misses == 0 ? 0 : (double)hits / (hits + misses);
+  }
+
+	/**
+   * Clear all values 
+	 */
+  void clear()
+  {
+		hits = misses = diskwrites = 0;
+  }
+
+	/**
+   * Constructor of FileBufStats class 
+	 */
+  FileBufStats()
+  {
+		clear();
+  }
+};
+
+
+/**
+* @brief Transfer between a frame and its file under way
+*/
+enum FrameIo
+{
+	FRAME_READY,	// no transfer, the frame can be pinned
+	FRAME_READING,	// its page is being read in, or allocated in the file
+	FRAME_WRITING	// its page is being written back
+};
+
+
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* The page a frame holds (file, pageNo, valid) changes only under both the buffer mutex and the lock
+* of the page's hash partition, so either one keeps it in place. The pin count, dirty bit and hits
+* change under the partition lock alone; those the clock looks at holding only the buffer mutex are
+* atomic.
 */
 class BufDesc {
 
@@ -44,12 +118,12 @@ class BufDesc {
 	/**
    * Number of times this page has been pinned
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
 	 */
-  bool dirty;
+  std::atomic<bool> dirty;
 
 	/**
    * True if page is valid
@@ -59,7 +133,45 @@ class BufDesc {
 	/**
    * Has this buffer frame been reference recently
 	 */
-  bool refbit;
+  std::atomic<bool> refbit;
+
+	/**
+   * Transfer under way between the frame and the file. The frame is not pinned or replaced until it is done
+	 */
+  FrameIo io;
+
+	/**
+   * Reads of the page found in this frame, not yet added to the BufStats
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Latch of the page held in this frame, for callers sharing the page between threads
+	 */
+  VersionLatch latch;
+
+	/**
+   * Log sequence number just past the last logged change of the page. The log is flushed up to it
+   * before the page is written back
+	 */
+  LogSeqNum pageLSN;
+
+	/**
+   * Log sequence number of the first logged change of the page not yet written back, 0 if there is none.
+   * Recovery replays the page's records from here on
+	 */
+  LogSeqNum recLSN;
+
+	/**
+   * Number of open transactions holding changes to the page that are not logged yet. The frame is
+   * not replaced while this is above 0
+	 */
+  int txnCount;
+
+	/**
+   * Usage counts of the file of the page, kept by the BufMgr
+	 */
+  FileBufStats* fileStats;
 
 	/**
    * Initialize buffer frame for a new user
@@ -72,6 +184,12 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    pageLSN = 0;
+    recLSN = 0;
+    txnCount = 0;
+    fileStats = NULL;
+    io = FRAME_READY;
+    hits = 0;
   };
 
 	/**
@@ -80,15 +198,21 @@ class BufDesc {
 	 *
 	 * @param filePtr	File object
 	 * @param pageNum	Page number in the file
+	 * @param stats  	Usage counts of the file
 	 */
-  void Set(File* filePtr, PageId pageNum)
+  void Set(File* filePtr, PageId pageNum, FileBufStats* stats)
 	{ 
 		file = filePtr;
+    fileStats = stats;
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
     valid = true;
     refbit = true;
+    io = FRAME_READY;
+    pageLSN = 0;
+    recLSN = 0;
+    txnCount = 0;
   }
 
   void Print()
@@ -119,23 +243,129 @@ class BufDesc {
 
 /**
 * @brief Class to maintain statistics of buffer usage 
+*
+* Copies taken with BufMgr::snapshotBufStats() at two points in time can be subtracted to get the
+* usage between them.
 */
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool: pages read, found or not, and pages allocated
 	 */
-  int accesses;
+  std::uint64_t accesses;
 
 	/**
-   * Number of pages read from disk (including allocs)
+   * Number of pages read from disk
 	 */
-  int diskreads;
+  std::uint64_t diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::uint64_t diskwrites;
+
+	/**
+   * Number of reads of a page found in the buffer pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of reads of a page that had to be read from its file
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of pages dropped from a frame to make room for another
+	 */
+  std::uint64_t evictions;
+
+	/**
+   * Number of evicted pages that had to be written back first
+	 */
+  std::uint64_t dirtyEvictions;
+
+	/**
+   * Number of times the clock swept for a frame
+	 */
+  std::uint64_t clockSweeps;
+
+	/**
+   * Number of frames the clock looked at, over all sweeps
+	 */
+  std::uint64_t clockSteps;
+
+	/**
+   * Most frames looked at by a single sweep
+	 */
+  std::uint32_t maxClockSweep;
+
+	/**
+   * Most frames pinned at the same time. Counted in each hash partition and summed, so when the
+   * pinned frames move between partitions it may be above the most pinned at once
+	 */
+  std::uint32_t pinnedHighWater;
+
+	/**
+   * Time taken to read pages from their files
+	 */
+  LatencyHistogram readLatency;
+
+	/**
+   * Time taken to write pages back to their files
+	 */
+  LatencyHistogram writeLatency;
+
+	/**
+   * Usage of each file, by file name. Cleared counts stay in place, since frames holding pages of
+   * the file keep pointing at them
+	 */
+  std::map<std::string, FileBufStats> files;
+
+	/**
+   * Fraction of reads found in the buffer pool, 0 if there were none
+	 */
+  double hitRatio() const
+  {
+		return hits + misses == 0 ? 0 : (double)hits / (hits + misses);
+  }
+
+	/**
+   * Average number of frames a sweep of the clock looked at, 0 if there were none
+	 */
+  double averageClockSweep() const
+  {
+		return clockSweeps == 0 ? 0 : (double)clockSteps / clockSweeps;
+  }
+
+	/**
+	 * Usage between an earlier copy of these statistics and this one. Maximums and high-water marks
+	 * cannot be split in two, so they are the ones of this copy.
+	 *
+	 * @param earlier   	Copy of the statistics taken earlier, and not cleared since
+	 */
+  BufStats operator-(const BufStats& earlier) const
+  {
+		BufStats diff = *this;
+		diff.accesses -= earlier.accesses;
+		diff.diskreads -= earlier.diskreads;
+		diff.diskwrites -= earlier.diskwrites;
+		diff.hits -= earlier.hits;
+		diff.misses -= earlier.misses;
+		diff.evictions -= earlier.evictions;
+		diff.dirtyEvictions -= earlier.dirtyEvictions;
+		diff.clockSweeps -= earlier.clockSweeps;
+		diff.clockSteps -= earlier.clockSteps;
+		diff.readLatency -= earlier.readLatency;
+		diff.writeLatency -= earlier.writeLatency;
+		for (std::map<std::string, FileBufStats>::const_iterator it = earlier.files.begin(); it != earlier.files.end(); ++it)
+		{
+			FileBufStats& file = diff.files[it->first];
+			file.hits -= it->second.hits;
+			file.misses -= it->second.misses;
+			file.diskwrites -= it->second.diskwrites;
+		}
+		return diff;
+  }
 
 	/**
    * Clear all values 
@@ -143,6 +373,15 @@ struct BufStats
   void clear()
   {
 		accesses = diskreads = diskwrites = 0;
+		hits = misses = evictions = dirtyEvictions = 0;
+		clockSweeps = clockSteps = 0;
+		maxClockSweep = pinnedHighWater = 0;
+		readLatency.clear();
+		writeLatency.clear();
+		for (std::map<std::string, FileBufStats>::iterator it = files.begin(); it != files.end(); ++it)
+		{
+			it->second.clear();
+		}
   }
       
 	/**
@@ -155,6 +394,76 @@ struct BufStats
 };
 
 
+/**
+* @brief Transaction a thread has open on a logged BufMgr
+*/
+struct BufTransaction
+{
+	/**
+   * Number of beginTransaction() calls not yet matched by a commit
+	 */
+  int depth;
+
+	/**
+   * Frames of the pages the transaction changed
+	 */
+  std::vector<FrameId> frames;
+
+	/**
+   * Constructor of BufTransaction class
+	 */
+  BufTransaction() : depth(0) {}
+};
+
+
+/**
+ * Number of partitions the hash table of a BufMgr is split in.
+ */
+const int BUFHASHPARTITIONS = 64;
+
+
+/**
+* @brief One partition of the hash table of a BufMgr, with the lock readers of its pages take
+*/
+struct BufHashPartition
+{
+	/**
+   * Guards the table, and the pinning of the frames it maps pages to
+	 */
+  std::mutex mutex;
+
+	/**
+   * Signalled when a transfer between a frame of the partition and its file is done
+	 */
+  std::condition_variable ioDone;
+
+	/**
+   * Hash table mapping the (File, page) pairs of the partition to frames
+	 */
+  BufHashTbl* table;
+
+	/**
+   * Number of frames of the partition pinned at the moment
+	 */
+  std::uint32_t pinnedFrames;
+
+	/**
+   * Most frames of the partition pinned at the same time
+	 */
+  std::uint32_t pinnedHighWater;
+
+	/**
+   * Keeps the lock of the next partition off the cache lines of this one
+	 */
+  char padding[64];
+
+	/**
+   * Constructor of BufHashPartition class
+	 */
+  BufHashPartition() : table(NULL), pinnedFrames(0), pinnedHighWater(0) {}
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
 */
@@ -172,20 +481,88 @@ class BufMgr
   std::uint32_t numBufs;
 	
 	/**
-   * Hash table mapping (File, page) to frame
+   * Memory the frames of bufPool are mapped in
 	 */
-  BufHashTbl *hashTable;
+  PoolMemory* poolMemory;
+
+	/**
+   * Hash table mapping (File, page) to frame, split so that readers of different pages take
+   * different locks
+	 */
+  BufHashPartition partitions[BUFHASHPARTITIONS];
 
 	/**
    * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
 	 */
   BufDesc *bufDescTable;
 
+	/**
+   * Memory bufDescTable is mapped in, so it grows in place like the frames
+	 */
+  PoolMemory* descMemory;
+
 	/**
    * Maintains Buffer pool usage statistics 
 	 */
   BufStats bufStats;
 
+	/**
+   * Serializes the clock, the statistics, transactions and the handing of frames to other pages.
+   * Reading a page already in the pool does not take it, and no file is read or written while it
+   * is held, except by flushFile() and resize()
+	 */
+  std::mutex bufMutex;
+
+	/**
+   * Number of frames with a transfer under way, changed under bufMutex
+	 */
+  int framesInIo;
+
+	/**
+   * Signalled under bufMutex when a transfer is done
+	 */
+  std::condition_variable frameIoDone;
+
+	/**
+   * Log the changes to pages are written to before the pages, NULL if changes are not logged
+	 */
+  LogManager* logManager;
+
+	/**
+   * Every frame's page as it was last logged, which new changes are compared against. NULL without a log
+	 */
+  Page* loggedPool;
+
+	/**
+   * Memory loggedPool is mapped in, NULL without a log
+	 */
+  PoolMemory* loggedMemory;
+
+	/**
+   * Open transactions, one per thread
+	 */
+  std::map<std::thread::id, BufTransaction> transactions;
+
+	/**
+   * Files pages were written back to since the log was last emptied, synced before it is emptied again
+	 */
+  std::set<std::string> unsyncedFiles;
+
+	/**
+   * Log sequence number the last checkpoint began at
+	 */
+  LogSeqNum lastCheckpointLSN;
+
+	/**
+   * Lets one checkpoint run at a time
+	 */
+  std::mutex checkpointMutex;
+
+	/**
+   * True if pages get a checksum when written back and are checked when read in
+	 */
+  bool pageChecksums;
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -195,12 +572,133 @@ class BufMgr
   }
 
 	/**
-	 * Allocate a free frame.  
+	 * Allocate a free frame. Called holding bufMutex, which is let go while a dirty page is
+	 * written back to free its frame.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param guard   	Lock held on bufMutex
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(FrameId & frame, std::unique_lock<std::mutex>& guard);
+
+	/**
+	 * Pins the frame holding a page, waiting for a transfer of the frame under way to end.
+	 *
+	 * @param partition   	Hash partition of the page
+	 * @param partitionGuard	Lock held on the partition
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame holding the page, returned via this variable
+	 * @return False if the page is not in the pool
+	 */
+  bool pinFrame(BufHashPartition& partition, std::unique_lock<std::mutex>& partitionGuard,
+                File* file, const PageId pageNo, FrameId & frame);
+
+	/**
+	 * Writes the page held in a frame back to its file, flushing the log first up to the last
+	 * change of the page. Called holding bufMutex, and with no other thread able to pin the frame.
+	 *
+	 * @param frame   	Frame holding a dirty page
+	 */
+  void writeBack(FrameId frame);
+
+	/**
+	 * Writes the page of an unpinned frame back with bufMutex let go meanwhile. Readers of the page
+	 * wait until it is written.
+	 *
+	 * @param frame   	Frame holding a dirty page
+	 * @param guard   	Lock held on bufMutex
+	 * @return False if the frame was pinned, and not written
+	 */
+  bool writeBackUnlocked(FrameId frame, std::unique_lock<std::mutex>& guard);
+
+	/**
+	 * Writes a frame's page to its file, without touching the frame or the statistics.
+	 *
+	 * @param frame   	Frame holding a dirty page
+	 * @return Nanoseconds the write took
+	 */
+  std::uint64_t writeFrame(FrameId frame);
+
+	/**
+	 * Drops the page of an unpinned, clean frame the clock chose from the pool. Called holding bufMutex.
+	 *
+	 * @param frame   	Frame holding a page
+	 * @return False if the frame was pinned, changed or referenced meanwhile, and kept its page
+	 */
+  bool evictFrame(FrameId frame);
+
+	/**
+	 * Drops the page held in a frame from the hash table and clears the frame. Called holding
+	 * bufMutex and the lock of the page's partition.
+	 *
+	 * @param frame   	Frame holding a page
+	 */
+  void unmapFrame(FrameId frame);
+
+	/**
+	 * Returns once no frame has a transfer under way. Called holding bufMutex, which is let go
+	 * while waiting; no transfer starts again until it is.
+	 *
+	 * @param guard   	Lock held on bufMutex
+	 */
+  void waitForFrameIo(std::unique_lock<std::mutex>& guard);
+
+	/**
+	 * Adds the hits counted in the frames and the pinned high-water marks of the partitions to
+	 * bufStats. Called holding bufMutex.
+	 */
+  void foldFrameStats();
+
+	/**
+	 * Drops the hits counted in the frames, and starts the pinned high-water marks again from the
+	 * frames pinned now. Called holding bufMutex.
+	 */
+  void clearFrameStats();
+
+	/**
+	 * Hash partition of a page.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  BufHashPartition & hashPartition(const File* file, const PageId pageNo)
+  {
+		return partitions[((std::uintptr_t)file + pageNo) % BUFHASHPARTITIONS];
+  }
+
+	/**
+	 * Logs a change made to a page outside any transaction, or adds the page to the transaction
+	 * of the calling thread.
+	 *
+	 * @param frame   	Frame holding the changed page
+	 */
+  void logChange(FrameId frame);
+
+	/**
+	 * Counts a frame going from unpinned to pinned. Called holding the lock of its partition.
+	 *
+	 * @param partition   	Hash partition of the frame's page
+	 */
+  static void framePinned(BufHashPartition& partition)
+  {
+		partition.pinnedFrames++;
+		if (partition.pinnedFrames > partition.pinnedHighWater)
+		{
+			partition.pinnedHighWater = partition.pinnedFrames;
+		}
+  }
+
+	/**
+	 * Size of the hash table of each partition for the given number of frames. Odd, so that it
+	 * shares no factor with the number of partitions, which would leave buckets unused.
+	 *
+	 * @param bufs   	Number of frames
+	 */
+  static int hashTableSize(std::uint32_t bufs)
+  {
+		return (((int) (bufs * 1.2)) / BUFHASHPARTITIONS) | 1;
+  }
 
  public:
 	/**
@@ -210,8 +708,14 @@ class BufMgr
 
 	/**
    * Constructor of BufMgr class
-	 */
-  BufMgr(std::uint32_t bufs);
+   *
+   * @param bufs   	Number of frames in the buffer pool
+   * @param log   		Log changes to pages are written to, or NULL to write pages without logging.
+   *              		Must outlive the BufMgr
+   * @param poolOptions	PoolOption values or'ed together, choosing how the frames are mapped
+   * @throws std::bad_alloc If the frames cannot be mapped
+	 */
+  BufMgr(std::uint32_t bufs, LogManager* log = NULL, int poolOptions = POOL_DEFAULT);
 	
 	/**
    * Destructor of BufMgr class
@@ -222,10 +726,13 @@ class BufMgr
 	 * Reads the given page from the file into a frame and returns the pointer to page.
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
 	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * A page found in the pool is pinned holding only the lock of its hash partition. A page being
+	 * read in or written back by another thread is waited for. The file is read holding no lock.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+   * @throws  PageChecksumException If checksums are on and the page read from the file does not match its checksum
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
@@ -241,7 +748,8 @@ class BufMgr
 
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
-	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 * The newly allocated page is also assigned a frame in the buffer pool. The file allocates the
+	 * page while no lock is held.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
@@ -270,24 +778,143 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Starts a transaction of the calling thread. The changes to every page the thread unpins dirty
+	 * until the matching commit are logged together, and the pages stay in the pool until then.
+	 * Nested calls join the transaction already open. Does nothing without a log.
+	 */
+  void beginTransaction();
+
+	/**
+	 * Ends the calling thread's transaction. The outermost commit logs the changes and returns once
+	 * the log holding them is on disk; commits of other threads arriving meanwhile share that sync.
+	 * Pages changed by the transaction must not be changed by another thread until it commits.
+	 *
+	 * @param wait   	False to return without waiting for the log, see waitForLog()
+	 * @return Log sequence number the log has to reach for the changes to be on disk, 0 if there are none
+   * @throws  LogIoException If the log cannot be written
+	 */
+  LogSeqNum commitTransaction(bool wait = true);
+
+	/**
+	 * Returns once the log is on disk up to the given sequence number.
+	 *
+	 * @param lsn   	Sequence number returned by commitTransaction()
+   * @throws  LogIoException If the log cannot be written
+	 */
+  void waitForLog(LogSeqNum lsn);
+
+	/**
+	 * Undoes the changes the calling thread's transaction made to pages and ends it, nested levels
+	 * included.
+	 */
+  void abortTransaction();
+
+	/**
+	 * Takes a fuzzy checkpoint. Pages still dirty since before the previous checkpoint are written back
+	 * one at a time, then the dirty page table (file, page, recLSN) is copied and logged while other
+	 * threads go on changing pages. Recovery starts from the latest checkpoint. Does nothing without a log.
+	 *
+   * @throws  LogIoException If the log cannot be written
+	 */
+  void checkpoint();
+
+	/**
+	 * Turns page checksums on or off. While on, every page written back gets a CRC32C of its contents
+	 * in its last bytes, and a page read in whose checksum does not match throws. Pages written without
+	 * checksums hold none and are not checked.
+	 *
+	 * @param enable  	True to write and check checksums
+	 */
+  void enablePageChecksums(bool enable)
+  {
+		pageChecksums = enable;
+  }
+
+	/**
+	 * True if changes to pages are logged.
+	 */
+  bool isLogged() const
+  {
+		return logManager != NULL;
+  }
+
+	/**
+	 * Latch of the frame holding the given page. The page must stay pinned while the latch is used,
+	 * otherwise the frame may be handed to another page.
+	 *
+	 * @param page  	Page pointer returned by readPage() or allocPage()
+	 */
+  VersionLatch & pageLatch(const Page* page)
+  {
+		return bufDescTable[page - bufPool].latch;
+  }
+
+	/**
+	 * Changes the number of frames while the buffer pool is in use. Frames and their descriptors never
+	 * move, so pages pinned by other threads stay where they are. Growing maps the new frames and
+	 * lets the hash table spread its entries over more buckets a few at a time. Shrinking drops the
+	 * last frames, writing back their dirty pages first; it is refused if any of them is pinned or
+	 * holds changes of an open transaction, and then nothing is changed.
+	 *
+	 * @param newBufs   	New number of frames, at least 1
+	 * @throws BufferExceededException If newBufs is 0
+	 * @throws PagePinnedException If a frame to drop holds a pinned page or uncommitted changes
+	 * @throws std::bad_alloc If newBufs frames do not fit in the memory of the machine, or cannot be mapped
+	 */
+  void resize(std::uint32_t newBufs);
+
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
+	/**
+   * Memory the frames are mapped in, to see how it is backed and placed
+	 */
+  const PoolMemory & getPoolMemory() const
+  {
+		return *poolMemory;
+  }
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
 
 	/**
-   * Get buffer pool usage statistics
+   * Get buffer pool usage statistics. Other threads keep updating them; use snapshotBufStats() for a
+   * consistent copy
 	 */
   BufStats & getBufStats()
   {
+		std::lock_guard<std::mutex> guard(bufMutex);
+		foldFrameStats();
+		return bufStats;
+  }
+
+	/**
+   * Copy of the buffer pool usage statistics, taken while no other thread is handing out frames.
+   * Hits made meanwhile by other threads may or may not be in it
+	 */
+  BufStats snapshotBufStats()
+  {
+		std::lock_guard<std::mutex> guard(bufMutex);
+		foldFrameStats();
 		return bufStats;
   }
 
 	/**
-   * Clear buffer pool usage statistics
+   * Clear buffer pool usage statistics. The pinned high-water mark starts again from the frames
+   * pinned now
 	 */
   void clearBufStats() 
   {
+		std::lock_guard<std::mutex> guard(bufMutex);
 		bufStats.clear();
+		clearFrameStats();
   }
 };
 
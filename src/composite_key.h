@@ -0,0 +1,170 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+* @brief One attribute of a composite index key.
+*/
+struct KeyComponent
+{
+	/**
+   * Offset of the attribute inside the record
+	 */
+  int attrByteOffset;
+
+	/**
+   * Type of the attribute
+	 */
+  Datatype attrType;
+
+	/**
+   * Bytes the attribute takes in the record. Only read for STRING, INTEGER and DOUBLE have their own size
+	 */
+  int attrLength;
+};
+
+/**
+* @brief Value of a composite key, or of its leading components, encoded so that memcmp orders keys the
+* way comparing their components one after another would.
+*
+* INTEGER and DOUBLE values are written big endian with the sign bit flipped, and negative doubles have
+* all their bits flipped. STRING values stop at their first NUL and are padded with zeros to the attribute
+* length. Every component has a fixed width, so the leading components of a key are a prefix of its bytes.
+*/
+class CompositeKey
+{
+ private:
+	/**
+   * Encoded components added so far
+	 */
+  std::string encoded;
+
+  void appendBigEndian(std::uint64_t bits, int length)
+  {
+    for (int i = length - 1; i >= 0; i--)
+    {
+      encoded.push_back((char)(bits >> (8 * i)));
+    }
+  }
+
+ public:
+	/**
+	 * Appends an INTEGER component.
+	 *
+	 * @param value  	Value of the component
+	 */
+  CompositeKey &add(int value)
+  {
+    appendBigEndian((std::uint32_t)value ^ 0x80000000u, sizeof(int));
+    return *this;
+  }
+
+	/**
+	 * Appends a DOUBLE component.
+	 *
+	 * @param value  	Value of the component
+	 */
+  CompositeKey &add(double value)
+  {
+    std::uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = (bits >> 63) ? ~bits : bits ^ ((std::uint64_t)1 << 63);
+    appendBigEndian(bits, sizeof(double));
+    return *this;
+  }
+
+	/**
+	 * Appends a STRING component.
+	 *
+	 * @param value  			Characters of the component, read up to the first NUL
+	 * @param attrLength  	Width of the attribute
+	 */
+  CompositeKey &add(const char *value, int attrLength)
+  {
+    int length = strnlen(value, attrLength);
+    encoded.append(value, length);
+    encoded.append(attrLength - length, '\0');
+    return *this;
+  }
+
+	/**
+	 * Appends the value of an attribute read from a record.
+	 *
+	 * @param record  		Record holding the attribute
+	 * @param component  	Attribute to read
+	 */
+  CompositeKey &add(const char *record, const KeyComponent &component)
+  {
+    const char *field = record + component.attrByteOffset;
+    if (component.attrType == INTEGER)
+    {
+      int value;
+      memcpy(&value, field, sizeof(int));
+      return add(value);
+    }
+    if (component.attrType == DOUBLE)
+    {
+      double value;
+      memcpy(&value, field, sizeof(double));
+      return add(value);
+    }
+    return add(field, component.attrLength);
+  }
+
+	/**
+	 * Key of a record on every component of an index.
+	 *
+	 * @param record  			Record holding the attributes
+	 * @param components  	Attributes of the key
+	 */
+  static CompositeKey fromRecord(const char *record, const std::vector<KeyComponent> &components)
+  {
+    CompositeKey key;
+    for (size_t c = 0; c < components.size(); c++)
+    {
+      key.add(record, components[c]);
+    }
+    return key;
+  }
+
+	/**
+	 * Bytes one component takes in an encoded key.
+	 *
+	 * @param component  	Attribute of the key
+	 */
+  static int encodedLength(const KeyComponent &component)
+  {
+    if (component.attrType == INTEGER)
+    {
+      return sizeof(int);
+    }
+    if (component.attrType == DOUBLE)
+    {
+      return sizeof(double);
+    }
+    return component.attrLength;
+  }
+
+	/**
+	 * Encoded components, compared with memcmp.
+	 */
+  const std::string &bytes() const
+  {
+    return encoded;
+  }
+};
+
+}
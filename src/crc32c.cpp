@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Castagnoli polynomial, bit reversed.
+ */
+const std::uint32_t POLYNOMIAL = 0x82f63b78;
+
+struct Crc32cTable {
+  std::uint32_t entries[256];
+
+  Crc32cTable() {
+    for (std::uint32_t i = 0; i < 256; i++) {
+      std::uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+      }
+      entries[i] = crc;
+    }
+  }
+};
+
+const Crc32cTable table;
+
+#if defined(__x86_64__)
+
+bool detectHardware() {
+  return __builtin_cpu_supports("sse4.2");
+}
+
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cHardwareUpdate(std::uint32_t crc, const unsigned char* bytes,
+                                   std::size_t length) {
+  std::uint64_t crc64 = crc;
+  for (; length >= sizeof(std::uint64_t); length -= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    bytes += sizeof(word);
+  }
+  crc = (std::uint32_t)crc64;
+  for (; length > 0; length--) {
+    crc = _mm_crc32_u8(crc, *bytes++);
+  }
+  return crc;
+}
+
+#elif defined(__aarch64__)
+
+bool detectHardware() {
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+__attribute__((target("+crc")))
+std::uint32_t crc32cHardwareUpdate(std::uint32_t crc, const unsigned char* bytes,
+                                   std::size_t length) {
+  for (; length >= sizeof(std::uint64_t); length -= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    crc = __crc32cd(crc, word);
+    bytes += sizeof(word);
+  }
+  for (; length > 0; length--) {
+    crc = __crc32cb(crc, *bytes++);
+  }
+  return crc;
+}
+
+#else
+
+bool detectHardware() {
+  return false;
+}
+
+std::uint32_t crc32cHardwareUpdate(std::uint32_t crc, const unsigned char* bytes,
+                                   std::size_t length) {
+  return crc;
+}
+
+#endif
+
+const bool useHardware = detectHardware();
+
+}
+
+std::uint32_t crc32c(const void* data, const std::size_t length,
+                     const std::uint32_t crc) {
+  if (!useHardware) {
+    return crc32cSoftware(data, length, crc);
+  }
+  return ~crc32cHardwareUpdate(~crc, static_cast<const unsigned char*>(data), length);
+}
+
+std::uint32_t crc32cSoftware(const void* data, const std::size_t length,
+                             const std::uint32_t crc) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint32_t state = ~crc;
+  for (std::size_t i = 0; i < length; i++) {
+    state = (state >> 8) ^ table.entries[(state ^ bytes[i]) & 0xff];
+  }
+  return ~state;
+}
+
+bool crc32cHardware() {
+  return useHardware;
+}
+
+}
@@ -0,0 +1,39 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Computes the CRC32C (Castagnoli) checksum of a buffer, with the SSE4.2 or
+ * ARMv8 CRC instructions when the processor has them.
+ *
+ * @param data  Bytes to checksum.
+ * @param length  Number of bytes.
+ * @param crc  Checksum of the bytes before these, to checksum a buffer in
+ *             pieces; 0 to start.
+ * @return  Checksum of the bytes so far.
+ */
+std::uint32_t crc32c(const void* data, const std::size_t length,
+                     const std::uint32_t crc = 0);
+
+/**
+ * Same as crc32c(), one table lookup per byte, whatever the processor.
+ */
+std::uint32_t crc32cSoftware(const void* data, const std::size_t length,
+                             const std::uint32_t crc = 0);
+
+/**
+ * Returns true if crc32c() uses CRC instructions of the processor.
+ */
+bool crc32cHardware();
+
+}
@@ -0,0 +1,184 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "extent_map.h"
+
+#include <cstring>
+
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
+#include "file.h"
+#include "page_codec.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Mark stored after the file header of a compressed file.
+ */
+const std::uint64_t COMPRESSED_MAGIC = 0x3130545a52474442ull;  // "BDGRZT01"
+
+/**
+ * Header of an extent.  A page stored with length Page::SIZE is not
+ * compressed, since compressing it did not make it smaller.
+ */
+struct ExtentHeader {
+  std::uint64_t sequence;
+  PageId page_number;
+  std::uint16_t length;
+  std::uint16_t units;
+};
+
+std::uint32_t roundToUnit(const std::size_t size) {
+  return (size + ExtentMap::EXTENT_UNIT - 1) / ExtentMap::EXTENT_UNIT *
+         ExtentMap::EXTENT_UNIT;
+}
+
+}
+
+bool ExtentMap::isCompressed(std::fstream& stream) {
+  std::uint64_t magic = 0;
+  stream.seekg(sizeof(FileHeader), std::ios::beg);
+  stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  // a file of a header alone ends before the mark
+  stream.clear();
+  return magic == COMPRESSED_MAGIC;
+}
+
+ExtentMap::ExtentMap(const std::string& name,
+                     std::shared_ptr<std::fstream> stream,
+                     const bool create_new)
+    : filename_(name), stream_(stream), end_(EXTENT_UNIT), next_sequence_(1) {
+  if (create_new) {
+    stream_->seekp(sizeof(FileHeader), std::ios::beg);
+    stream_->write(reinterpret_cast<const char*>(&COMPRESSED_MAGIC),
+                   sizeof(COMPRESSED_MAGIC));
+    stream_->flush();
+  } else {
+    load();
+  }
+}
+
+void ExtentMap::load() {
+  stream_->seekg(0, std::ios::end);
+  const std::uint64_t file_end = stream_->tellg();
+  std::uint64_t offset = EXTENT_UNIT;
+  std::vector<std::uint64_t> sequences;
+  while (offset + sizeof(ExtentHeader) <= file_end) {
+    ExtentHeader header;
+    stream_->seekg(offset, std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (header.units == 0) {
+      // torn write of the last extent
+      break;
+    }
+    Extent extent = {offset, (std::uint32_t)header.units * EXTENT_UNIT,
+                     header.length};
+    if (header.page_number >= extents_.size()) {
+      extents_.resize(header.page_number + 1, Extent());
+      sequences.resize(header.page_number + 1, 0);
+    }
+
+    // of two extents of a page the later write wins, the other one is free
+    Extent& current = extents_[header.page_number];
+    if (current.capacity == 0 || header.sequence > sequences[header.page_number]) {
+      if (current.capacity != 0) {
+        free_extents_.insert(std::make_pair(current.capacity, current.offset));
+      }
+      current = extent;
+      sequences[header.page_number] = header.sequence;
+    } else {
+      free_extents_.insert(std::make_pair(extent.capacity, extent.offset));
+    }
+    if (header.sequence >= next_sequence_) {
+      next_sequence_ = header.sequence + 1;
+    }
+    offset += extent.capacity;
+  }
+  stream_->clear();
+  end_ = offset;
+}
+
+void ExtentMap::readPage(const PageId page_number, Page& page) const {
+  if (page_number >= extents_.size() || extents_[page_number].capacity == 0) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Extent& extent = extents_[page_number];
+  char buffer[Page::SIZE];
+  stream_->seekg(extent.offset + sizeof(ExtentHeader), std::ios::beg);
+  stream_->read(buffer, extent.length);
+  char* image = reinterpret_cast<char*>(&page);
+  if (extent.length == Page::SIZE) {
+    memcpy(image, buffer, Page::SIZE);
+  } else if (!decompressBlock(buffer, extent.length, image, Page::SIZE)) {
+    throw PageChecksumException(page_number, filename_);
+  }
+}
+
+void ExtentMap::writePage(const PageId page_number, const Page& page) {
+  char buffer[sizeof(ExtentHeader) + Page::SIZE];
+  const char* image = reinterpret_cast<const char*>(&page);
+  std::size_t length = compressBlock(image, Page::SIZE,
+                                     buffer + sizeof(ExtentHeader),
+                                     Page::SIZE - 1);
+  if (length == 0) {
+    memcpy(buffer + sizeof(ExtentHeader), image, Page::SIZE);
+    length = Page::SIZE;
+  }
+
+  if (page_number >= extents_.size()) {
+    extents_.resize(page_number + 1, Extent());
+  }
+  Extent& extent = extents_[page_number];
+  const std::uint32_t size = roundToUnit(sizeof(ExtentHeader) + length);
+  if (extent.capacity < size) {
+    // the old extent is only reused once the page is written elsewhere
+    Extent moved = allocate(size);
+    if (extent.capacity != 0) {
+      free_extents_.insert(std::make_pair(extent.capacity, extent.offset));
+    }
+    extent = moved;
+  }
+  extent.length = length;
+
+  ExtentHeader header = {next_sequence_++, page_number, (std::uint16_t)length,
+                         (std::uint16_t)(extent.capacity / EXTENT_UNIT)};
+  memcpy(buffer, &header, sizeof(header));
+  stream_->seekp(extent.offset, std::ios::beg);
+  stream_->write(buffer, sizeof(header) + length);
+  stream_->flush();
+}
+
+ExtentMap::Extent ExtentMap::allocate(const std::uint32_t size) {
+  // a free extent much larger than needed is left for a page that needs it
+  std::multimap<std::uint32_t, std::uint64_t>::iterator it =
+      free_extents_.lower_bound(size);
+  if (it != free_extents_.end() && it->first <= 2 * size) {
+    Extent extent = {it->second, it->first, 0};
+    free_extents_.erase(it);
+    return extent;
+  }
+  Extent extent = {end_, size, 0};
+  end_ += size;
+  return extent;
+}
+
+CompressionStats ExtentMap::getCompressionStats() const {
+  CompressionStats stats;
+  for (std::size_t i = 0; i < extents_.size(); i++) {
+    if (extents_[i].capacity != 0) {
+      stats.pages++;
+      stats.storedBytes += extents_[i].length;
+    }
+  }
+  stats.pageBytes = (std::uint64_t)stats.pages * Page::SIZE;
+  stats.extentBytes = end_ - EXTENT_UNIT;
+  return stats;
+}
+
+}
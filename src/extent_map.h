@@ -0,0 +1,173 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Space used by the pages of a compressed file.
+ */
+struct CompressionStats {
+  /**
+   * Number of pages stored.
+   */
+  std::uint32_t pages;
+
+  /**
+   * Bytes the pages hold once decompressed.
+   */
+  std::uint64_t pageBytes;
+
+  /**
+   * Bytes of compressed page images.
+   */
+  std::uint64_t storedBytes;
+
+  /**
+   * Bytes of the extents holding the pages, free extents included.
+   */
+  std::uint64_t extentBytes;
+
+  /**
+   * Clear all values.
+   */
+  void clear() {
+    pages = 0;
+    pageBytes = storedBytes = extentBytes = 0;
+  }
+
+  /**
+   * Constructor of CompressionStats class.
+   */
+  CompressionStats() { clear(); }
+};
+
+/**
+ * @brief Page-offset map of a file whose pages are stored compressed.
+ *
+ * Each page is kept in an extent: a header naming the page, then the page
+ * compressed with compressBlock().  Extents are multiples of EXTENT_UNIT bytes
+ * and never split or merged, so the file is a chain of extents that can be
+ * walked from its start.  A page rewritten into an extent too small for it
+ * moves to a free extent or to the end of the file, and leaves its old extent
+ * for other pages.  Every write stamps its extent with a sequence number, so
+ * opening the file keeps the latest extent of each page and rebuilds the map
+ * and the free extents from the headers alone.
+ *
+ * The map is shared by every File object open on the file, like the stream.
+ */
+class ExtentMap {
+ public:
+  /**
+   * Size extents are a multiple of.  The first extent starts at this offset,
+   * after the file header and the mark of a compressed file.
+   */
+  static const std::uint32_t EXTENT_UNIT = 256;
+
+  /**
+   * Returns true if the file open in the stream has its pages compressed.
+   *
+   * @param stream  Stream of the file.
+   */
+  static bool isCompressed(std::fstream& stream);
+
+  /**
+   * Marks a new file as compressed, or reads the map of an existing one.
+   *
+   * @param name  Name of the file.
+   * @param stream  Stream of the file.
+   * @param create_new  Whether the file was just created.
+   */
+  ExtentMap(const std::string& name, std::shared_ptr<std::fstream> stream,
+            const bool create_new);
+
+  /**
+   * Reads and decompresses a page.
+   *
+   * @param page_number  Number of the page.
+   * @param page  Set to the page.
+   * @throws  InvalidPageException  If the page was never written.
+   * @throws  PageChecksumException  If the stored page cannot be decompressed.
+   */
+  void readPage(const PageId page_number, Page& page) const;
+
+  /**
+   * Compresses a page and writes it, in place if its extent is large enough.
+   *
+   * @param page_number  Number of the page.
+   * @param page  Page to write.
+   */
+  void writePage(const PageId page_number, const Page& page);
+
+  /**
+   * Returns the space used by the pages.
+   */
+  CompressionStats getCompressionStats() const;
+
+ private:
+  /**
+   * Place of a page in the file.
+   */
+  struct Extent {
+    std::uint64_t offset;
+    std::uint32_t capacity;
+    std::uint32_t length;
+  };
+
+  /**
+   * Walks the extents of the file, keeping the latest one of each page.
+   */
+  void load();
+
+  /**
+   * Returns an extent of at least the given size, free or new.
+   */
+  Extent allocate(const std::uint32_t size);
+
+  /**
+   * Name of the file.
+   */
+  std::string filename_;
+
+  /**
+   * Stream of the file.
+   */
+  std::shared_ptr<std::fstream> stream_;
+
+  /**
+   * Extent of every page, by page number.  Pages never written have capacity 0.
+   */
+  std::vector<Extent> extents_;
+
+  /**
+   * Offsets of free extents, by capacity.
+   */
+  std::multimap<std::uint32_t, std::uint64_t> free_extents_;
+
+  /**
+   * Offset just past the last extent.
+   */
+  std::uint64_t end_;
+
+  /**
+   * Sequence number the next write stamps its extent with.
+   */
+  std::uint64_t next_sequence_;
+};
+
+}
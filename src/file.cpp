@@ -11,10 +11,12 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 #include <cstdio>
 #include <cassert>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
@@ -23,8 +25,19 @@
 
 namespace badgerdb {
 
+namespace {
+
+/**
+ * Marks a file whose pages end in a checksum trailer.
+ */
+const std::uint32_t FILE_FORMAT = 0x32474442;
+
+}
+
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::ExtentMapMap File::open_extents_;
+File::MutexMap File::open_mutexes_;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -64,21 +77,31 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const bool compressed)
+    : filename_(name) {
+  openIfNeeded(create_new, compressed);
 
   if (create_new) {
     // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    FileHeader header = {FILE_FORMAT /* format */, 1 /* num_pages */,
+                         0 /* first_used_page */, 0 /* num_free_pages */,
+                         0 /* first_free_page */};
     writeHeader(header);
+  } else if (readHeader().format != FILE_FORMAT) {
+    // the last bytes of an older file's pages hold records, which a checksum
+    // written over them would destroy
+    close();
+    throw FileFormatException(filename_);
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::openIfNeeded(const bool create_new, const bool compressed) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    extents_ = open_extents_[filename_];
+    stream_mutex_ = open_mutexes_[filename_];
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -97,7 +120,13 @@ void File::openIfNeeded(const bool create_new) {
       }
     }
     stream_.reset(new std::fstream(filename_, mode));
+    stream_mutex_.reset(new std::recursive_mutex());
+    if (create_new ? compressed : ExtentMap::isCompressed(*stream_)) {
+      extents_.reset(new ExtentMap(filename_, stream_, create_new));
+    }
     open_streams_[filename_] = stream_;
+    open_extents_[filename_] = extents_;
+    open_mutexes_[filename_] = stream_mutex_;
     open_counts_[filename_] = 1;
   }
 }
@@ -107,41 +136,84 @@ void File::close() {
   	--open_counts_[filename_];
 
   stream_.reset();
+  extents_.reset();
+  stream_mutex_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
     open_streams_.erase(filename_);
+    open_extents_.erase(filename_);
+    open_mutexes_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
 FileHeader File::readHeader() const {
-  FileHeader header;
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
+  FileHeader header = FileHeader();
   stream_->seekg(0 /* pos */, std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
   stream_->flush();
 }
 
+CompressionStats File::getCompressionStats() const {
+  return extents_ != NULL ? extents_->getCompressionStats() : CompressionStats();
+}
+
+Page File::readImage(const PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
+  Page page;
+  if (extents_ != NULL) {
+    extents_->readPage(page_number, page);
+    return page;
+  }
+  stream_->seekg(pagePosition(page_number), std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+  return page;
+}
+
+void File::writeImage(const PageId page_number, const PageHeader& header,
+                      const Page& new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
+  // the header may differ from the page's own, so a stored checksum is redone over it
+  const std::uint32_t checksum =
+      new_page.hasChecksum() ? new_page.computeChecksum(header) : 0;
+  if (extents_ != NULL) {
+    Page image(new_page);
+    image.header_ = header;
+    image.checksum_ = checksum;
+    extents_->writePage(page_number, image);
+    return;
+  }
+  stream_->seekp(pagePosition(page_number), std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
+  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
+  stream_->write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+  stream_->flush();
+}
+
 
 
 
 
-PageFile PageFile::create(const std::string& filename) {
-  return PageFile(filename, true /* create_new */);
+PageFile PageFile::create(const std::string& filename, const bool compressed) {
+  return PageFile(filename, true /* create_new */, compressed);
 }
 
 PageFile PageFile::open(const std::string& filename) {
   return PageFile(filename, false /* create_new */);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const bool compressed)
+: File(name, create_new, compressed)
 {
 }
 
@@ -163,6 +235,7 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
 }
 
 Page PageFile::allocatePage(PageId &new_page_number) {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
   FileHeader header = readHeader();
   Page new_page;
   Page existing_page;
@@ -236,6 +309,7 @@ Page PageFile::allocatePage(PageId &new_page_number) {
 }
 
 Page PageFile::readPage(const PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
   FileHeader header = readHeader();
 
 	if (page_number >= header.num_pages)
@@ -246,10 +320,7 @@ Page PageFile::readPage(const PageId page_number) const {
 }
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  Page page = readImage(page_number);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -258,6 +329,7 @@ Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
 	PageHeader header = readPageHeader(new_page_number);
 	if (header.current_page_number == Page::INVALID_NUMBER)
 	{
@@ -274,6 +346,7 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 }
 
 void PageFile::deletePage(const PageId page_number) {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
   FileHeader header = readHeader();
 
   Page existing_page = readPage(page_number);
@@ -313,15 +386,37 @@ FileIterator PageFile::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
+std::vector<PageId> PageFile::pageDirectory() const {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
+  const FileHeader& header = readHeader();
+  std::vector<bool> is_free(header.num_pages, false);
+  PageId free_page_number = header.first_free_page;
+  for (PageId i = 0; i < header.num_free_pages; ++i) {
+    is_free[free_page_number] = true;
+    free_page_number = readPageHeader(free_page_number).next_page_number;
+  }
+
+  std::vector<PageId> page_numbers;
+  page_numbers.reserve(header.num_pages - 1 - header.num_free_pages);
+  for (PageId page_number = 1; page_number < header.num_pages; ++page_number) {
+    if (!is_free[page_number]) {
+      page_numbers.push_back(page_number);
+    }
+  }
+  return page_numbers;
+}
+
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  writeImage(page_number, header, new_page);
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
+  if (extents_ != NULL) {
+    // a compressed header cannot be read on its own
+    return readImage(page_number).header_;
+  }
   PageHeader header;
   stream_->seekg(pagePosition(page_number), std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
@@ -331,16 +426,17 @@ PageHeader PageFile::readPageHeader(PageId page_number) const {
 
 
 
-BlobFile BlobFile::create(const std::string& filename) {
-  return BlobFile(filename, true /* create_new */);
+BlobFile BlobFile::create(const std::string& filename, const bool compressed) {
+  return BlobFile(filename, true /* create_new */, compressed);
 }
 
 BlobFile BlobFile::open(const std::string& filename) {
   return BlobFile(filename, false /* create_new */);
 }
 
-BlobFile::BlobFile(const std::string& name, const bool create_new)
-: File(name, create_new) {
+BlobFile::BlobFile(const std::string& name, const bool create_new,
+                   const bool compressed)
+: File(name, create_new, compressed) {
 }
 
 BlobFile::~BlobFile() {
@@ -361,6 +457,7 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
 }
 
 Page BlobFile::allocatePage(PageId &new_page_number) {
+  std::lock_guard<std::recursive_mutex> guard(*stream_mutex_);
   FileHeader header = readHeader();
 	Page new_page;
 
@@ -379,16 +476,11 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 }
 
 Page BlobFile::readPage(const PageId page_number) const {
-	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
-	return page;
+	return readImage(page_number);
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+	writeImage(new_page_number, new_page.header_, new_page);
 }
 
 //delePage should not be called for a blob_file, not supported
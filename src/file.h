@@ -7,11 +7,15 @@
 
 #pragma once
 
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include "extent_map.h"
 #include "page.h"
 
 namespace badgerdb {
@@ -22,6 +26,12 @@ class FileIterator;
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
+  /**
+   * Format of the pages in the file.  Files of this version hold the checksum
+   * trailer at the end of every page, see Page::CHECKSUM_SIZE.
+   */
+  std::uint32_t format;
+
   /**
    * Number of pages allocated in the file.
    */
@@ -49,7 +59,8 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
+    return format == rhs.format &&
+        num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
         first_free_page == rhs.first_free_page;
@@ -68,7 +79,18 @@ struct FileHeader {
  * detects this (by looking in the open_streams_ map) and just returns a file object with
  * the already created stream for the file without actually opening the UNIX file again. 
  *
- * @warning This class is not threadsafe.
+ * A file can be created compressed, for files that are large and read more
+ * than written.  Its pages are then stored compressed in extents of varying
+ * size, see ExtentMap, and decompressed as they are read.  Opening a file finds
+ * out by itself whether it is compressed.
+ *
+ * The header of a file records the format of its pages.  Files of an older
+ * format are refused when opened, as their records run into the bytes that
+ * now hold the checksum of a page.
+ *
+ * Pages of one file may be read, written, allocated and deleted by several
+ * threads at once; each call has the stream to itself while it runs.  Opening
+ * and closing files is not threadsafe.
  */
 
 
@@ -80,12 +102,16 @@ class File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileFormatException     If the existing file is not in the format
+   *                                  of this version.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const bool compressed = false);
 
   /**
    * Deletes an existing file.
@@ -136,7 +162,8 @@ class File {
 
   /**
    * Writes a page into the file at the given page number.
-   * No bounds checking is performed.
+   * No bounds checking is performed.  If the page holds a checksum it is
+   * recomputed as the page is written.
    *
    * @param page_number Number of page whose contents to replace.
    * @param new_page    Page to write.
@@ -157,6 +184,18 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns true if the pages of the file are stored compressed.
+   */
+  bool compressed() const { return extents_ != NULL; }
+
+  /**
+   * Returns the space used by the pages of a compressed file.
+   *
+   * @return  Space used, all zero if the file is not compressed.
+   */
+  CompressionStats getCompressionStats() const;
+
  	/**
    * Returns pageid of first page in the file.
    *
@@ -182,12 +221,13 @@ class File {
    * the same filesystem file; otherwise, it reuses the existing stream.
    *
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const bool compressed = false);
 
   /**
    * Closes the underlying file stream in <stream_>.
@@ -210,8 +250,31 @@ class File {
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Reads the whole image of a page, decompressing it if the file is
+   * compressed.  No bounds checking is performed on uncompressed files.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   */
+  Page readImage(const PageId page_number) const;
+
+  /**
+   * Writes the whole image of a page with the given header, compressing it if
+   * the file is compressed.  A page holding a checksum gets one computed over
+   * the given header.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param header      Header of page to write.
+   * @param new_page    Page to write.
+   */
+  void writeImage(const PageId page_number, const PageHeader& header,
+                  const Page& new_page);
+
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, std::shared_ptr<ExtentMap> > ExtentMapMap;
+  typedef std::map<std::string, std::shared_ptr<std::recursive_mutex> > MutexMap;
 
   /**
    * Streams for opened files.
@@ -223,6 +286,16 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * Page-offset maps of opened files, NULL for files not compressed.
+   */
+  static ExtentMapMap open_extents_;
+
+  /**
+   * Mutexes serializing the use of the streams of opened files.
+   */
+  static MutexMap open_mutexes_;
+
   /**
    * Name of the file this object represents.
    */
@@ -233,6 +306,17 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Page-offset map of the file if it is compressed, shared like the stream.
+   */
+  std::shared_ptr<ExtentMap> extents_;
+
+  /**
+   * Held while the stream is used, shared like the stream.  Recursive, as
+   * calls that change several pages are made of calls that change one.
+   */
+  std::shared_ptr<std::recursive_mutex> stream_mutex_;
+
   friend class FileIterator;
 };
 
@@ -243,9 +327,10 @@ class PageFile : public File {
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param compressed  Whether to store the pages compressed.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static PageFile create(const std::string& filename);
+  static PageFile create(const std::string& filename, const bool compressed = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
@@ -264,12 +349,14 @@ class PageFile : public File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+           const bool compressed = false);
 
   /**
    * Copy constructor.
@@ -341,6 +428,15 @@ class PageFile : public File {
    */
   FileIterator end();
 
+  /**
+   * Returns the numbers of all used pages in ascending order. Every page below
+   * the header's page count is either used or on the free list, so the list is
+   * worked out from the header and the free list without reading used pages.
+   *
+   * @return  Numbers of the used pages in the file.
+   */
+  std::vector<PageId> pageDirectory() const;
+
  private:
 
   /**
@@ -361,7 +457,8 @@ class PageFile : public File {
   /**
    * Writes a page into the file at the given page number with the given header.
    * This does not ensure that the number in the header equals the position on
-   * disk.  No bounds checking is performed.
+   * disk.  No bounds checking is performed.  A page holding a checksum gets
+   * one computed over the given header.
    *
    * @param page_number Number of page whose contents to replace.
    * @param header      Header of page to write.
@@ -389,9 +486,10 @@ class BlobFile : public File {
    * Creates a new BlobFile.
    *
    * @param filename  Name of the file.
+   * @param compressed  Whether to store the pages compressed.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static BlobFile create(const std::string& filename);
+  static BlobFile create(const std::string& filename, const bool compressed = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
@@ -412,12 +510,14 @@ class BlobFile : public File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  BlobFile(const std::string& name, const bool create_new);
+  BlobFile(const std::string& name, const bool create_new,
+           const bool compressed = false);
 
   /**
    * Copy constructor.
@@ -6,10 +6,123 @@
  */
 
 #include "filescan.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "btree.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
 
 namespace badgerdb { 
 
+ScanPredicate::ScanPredicate(int offset, Operator opIn, int value)
+  : attrByteOffset(offset), attrLength(sizeof(int)), attrType(INTEGER), op(opIn),
+    intValue(value), doubleValue(0)
+{
+}
+
+ScanPredicate::ScanPredicate(int offset, Operator opIn, double value)
+  : attrByteOffset(offset), attrLength(sizeof(double)), attrType(DOUBLE), op(opIn),
+    intValue(0), doubleValue(value)
+{
+}
+
+ScanPredicate::ScanPredicate(int offset, int length, Operator opIn, const std::string &value)
+  : attrByteOffset(offset), attrLength(length), attrType(STRING), op(opIn),
+    intValue(0), doubleValue(0), stringValue(value)
+{
+}
+
+// -1, 0 or 1 as a is below, equal to or above b
+template <class T>
+static int compareValues(const T &a, const T &b)
+{
+  return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+bool ScanPredicate::matches(const char *record, std::size_t length) const
+{
+  if (attrByteOffset < 0 || (std::size_t)attrByteOffset + attrLength > length)
+  {
+    return false;
+  }
+
+  // the record bytes need not be aligned for the field type
+  const char *field = record + attrByteOffset;
+  int result;
+  if (attrType == INTEGER)
+  {
+    int value;
+    memcpy(&value, field, sizeof(int));
+    result = compareValues(value, intValue);
+  }
+  else if (attrType == DOUBLE)
+  {
+    double value;
+    memcpy(&value, field, sizeof(double));
+    result = compareValues(value, doubleValue);
+  }
+  else
+  {
+    std::size_t fieldLength = strnlen(field, attrLength);
+    int prefix = memcmp(field, stringValue.data(), std::min(fieldLength, stringValue.size()));
+    result = prefix != 0 ? prefix : compareValues(fieldLength, stringValue.size());
+  }
+
+  switch (op)
+  {
+    case LT:  return result < 0;
+    case LTE: return result <= 0;
+    case GTE: return result >= 0;
+    case GT:  return result > 0;
+    case EQ:  return result == 0;
+    case NE:  return result != 0;
+  }
+  return false;
+}
+
+// true if the record satisfies every predicate
+static bool matchesAll(const std::vector<ScanPredicate> &predicates, const char *record, std::size_t length)
+{
+  for (std::size_t i = 0; i < predicates.size(); i++)
+  {
+    if (!predicates[i].matches(record, length))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// copies the record, or just the projected fields of it, into outRecord
+static void copyRecord(const std::vector<ScanField> &projection, const char *record, std::size_t length,
+                       std::string &outRecord)
+{
+  if (projection.empty())
+  {
+    outRecord.assign(record, length);
+    return;
+  }
+  outRecord.clear();
+  for (std::size_t i = 0; i < projection.size(); i++)
+  {
+    std::size_t begin = std::min(length, (std::size_t)projection[i].attrByteOffset);
+    std::size_t end = std::min(length, begin + projection[i].attrLength);
+    outRecord.append(record + begin, end - begin);
+  }
+}
+
+ColumnBatch::ColumnBatch(const std::vector<ScanField> &fieldsIn, const int capacity)
+  : fields(fieldsIn), ridColumn(std::max(1, capacity)), columns(fieldsIn.size()), numRows(0),
+    maxRows(std::max(1, capacity))
+{
+  for (std::size_t c = 0; c < fields.size(); c++)
+  {
+    columns[c].resize((std::size_t)maxRows * fields[c].attrLength + 1);
+  }
+}
+
 FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 {
   file = new PageFile(name, false);	//dont create new file
@@ -19,12 +132,23 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 	filePageIter = file->begin();
 }
 
+FileScan::FileScan(const std::string &name, BufMgr *bufferMgr, const std::vector<ScanPredicate> &predicatesIn,
+                   const std::vector<ScanField> &projectionIn)
+  : predicates(predicatesIn), projection(projectionIn)
+{
+  file = new PageFile(name, false);	//dont create new file
+	bufMgr = bufferMgr;
+	curDirtyFlag = false;
+  curPage = NULL;
+	filePageIter = file->begin();
+}
+
 FileScan::~FileScan()
 {
   // generally must unpin last page of the scan
   if (curPage != NULL)
   {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
     curPage = NULL;
 		curDirtyFlag = false;
     filePageIter = file->begin();
@@ -35,86 +159,330 @@ FileScan::~FileScan()
 
 void FileScan::scanNext(RecordId& outRid)
 {
-  std::string rec;
-
   if (filePageIter == file->end())
 	{
 		throw EndOfFileException();
 	}
 
-  // special case of the first record of the first page of the file
   if (curPage == NULL)
   {
-    // need to get the first page of the file
+    // special case of the first record of the first page of the file
 		filePageIter = file->begin();
     if(filePageIter == file->end())
 		{
 			throw EndOfFileException();
 		}
-	 
-		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    bufMgr->readPage(file, filePageIter.page_number(), curPage);
 		curDirtyFlag = false;
+    pageRecordIter = curPage->begin();
+  }
+  else
+  {
+    pageRecordIter++;
+  }
 
-		// get the first record off the page
-    pageRecordIter = curPage->begin(); 
+	// Loop, looking for a record that satisfies the predicates
+  while (true)
+  {
+    while (pageRecordIter == curPage->end())
+    {
+      // unpin the current page
+      bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
+      curPage = NULL;
+      curDirtyFlag = false;
 
-		if(pageRecordIter != curPage->end()) 
-		{
-		  // get pointer to record
-		  rec = *pageRecordIter;
+      filePageIter++;
+      if (filePageIter == file->end())
+      {
+        throw EndOfFileException();
+      }
 
-			outRid = pageRecordIter.getCurrentRecord();
-			return;
-		}
+      // read the next page of the file
+      bufMgr->readPage(file, filePageIter.page_number(), curPage);
+
+      // get the first record off the page
+      pageRecordIter = curPage->begin();
+    }
+
+    if (predicates.empty())
+    {
+      break;
+    }
+    // checked against the bytes on the pinned page, nothing is copied
+    std::size_t length;
+    const char *record = curPage->getRecordData(pageRecordIter.getCurrentRecord(), length);
+    if (matchesAll(predicates, record, length))
+    {
+      break;
+    }
+    pageRecordIter++;
   }
 
-	// Loop, looking for a record that satisfied the predicate.
-	// First try and get the next record off the current page
-	pageRecordIter++;
+	// return rid of the record
+	outRid = pageRecordIter.getCurrentRecord();
+}
+
+// returns a copy of the current record, or of its projected fields.
+// page is left pinned and the scan logic is required to unpin the page
+std::string FileScan::getRecord()
+{
+  std::string record;
+  getRecord(record);
+  return record;
+}
+
+void FileScan::getRecord(std::string& outRecord)
+{
+  std::size_t length;
+  const char *record = curPage->getRecordData(pageRecordIter.getCurrentRecord(), length);
+  copyRecord(projection, record, length, outRecord);
+}
+
+int FileScan::scanBatch(ColumnBatch& batch)
+{
+  batch.clear();
+  if (filePageIter == file->end())
+	{
+		return 0;
+	}
+
+  // next slot to look at on the current page
+  SlotId slot;
+  if (curPage == NULL)
+  {
+		filePageIter = file->begin();
+    if(filePageIter == file->end())
+		{
+			return 0;
+		}
+    bufMgr->readPage(file, filePageIter.page_number(), curPage);
+		curDirtyFlag = false;
+    slot = 1;
+  }
+  else
+  {
+    slot = pageRecordIter.getCurrentRecord().slot_number + 1;
+  }
 
-  while (pageRecordIter == curPage->end())
+  while (true)
   {
-    // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    const PageId pageNo = filePageIter.page_number();
+    const SlotId numSlots = curPage->num_slots();
+    for (; slot <= numSlots && !batch.full(); slot++)
+    {
+      std::size_t length;
+      const char *record = curPage->getSlotData(slot, length);
+      if (record != NULL && matchesAll(predicates, record, length))
+      {
+        RecordId rid = {pageNo, slot, 0};
+        batch.append(rid, record, length);
+      }
+    }
+    if (batch.full())
+    {
+      // leave the scan on the last record taken
+      RecordId lastRid = {pageNo, (SlotId)(slot - 1), 0};
+      pageRecordIter = PageIterator(curPage, lastRid);
+      return batch.size();
+    }
+
+    bufMgr->unPinPage(file, pageNo, curDirtyFlag);
     curPage = NULL;
     curDirtyFlag = false;
-
     filePageIter++;
     if (filePageIter == file->end())
     {
-      curPage = NULL;
-			throw EndOfFileException();
+      return batch.size();
     }
+    bufMgr->readPage(file, filePageIter.page_number(), curPage);
+    slot = 1;
+  }
+}
 
-    // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+// mark current page of scan dirty
+void FileScan::markDirty()
+{
+  curDirtyFlag = true;
+}
+
+ParallelFileScan::ParallelFileScan(const std::string &name, BufMgr *bufferMgr, const int threads, const int pagesPerMorsel,
+                                   const std::vector<ScanPredicate> &predicatesIn, const std::vector<ScanField> &projectionIn)
+  : nextPage(0), predicates(predicatesIn), projection(projectionIn)
+{
+  file = new PageFile(name, false);	//dont create new file
+  bufMgr = bufferMgr;
+  pageNos = file->pageDirectory();
+  numThreads = threads > 0 ? threads : std::max(1, (int)std::thread::hardware_concurrency());
+  morselPages = std::max(1, pagesPerMorsel);
+}
+
+ParallelFileScan::~ParallelFileScan()
+{
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+void ParallelFileScan::scan(const std::function<void(int, const RecordId&, const std::string&)> &visit)
+{
+  nextPage = 0;
+  int workers = std::max(1, std::min(numThreads, (int)((pageNos.size() + morselPages - 1) / morselPages)));
+  std::vector<std::exception_ptr> errors(workers);
+  std::vector<std::thread> threads;
+  for (int w = 0; w < workers; w++)
+  {
+    threads.push_back(std::thread(&ParallelFileScan::scanWorker, this, w, &visit, &errors[w]));
+  }
+  for (int w = 0; w < workers; w++)
+  {
+    threads[w].join();
+  }
+  for (int w = 0; w < workers; w++)
+  {
+    if (errors[w])
+    {
+      std::rethrow_exception(errors[w]);
+    }
+  }
+}
+
+void ParallelFileScan::scanWorker(int worker, const std::function<void(int, const RecordId&, const std::string&)> *visit,
+                                  std::exception_ptr *error)
+{
+  std::size_t begin, end;
+  std::string record;
+  Page *page = NULL;
+  PageId pageNo = Page::INVALID_NUMBER;
+  try
+  {
+    while (nextMorsel(begin, end))
+    {
+      for (std::size_t i = begin; i < end; i++)
+      {
+        pageNo = pageNos[i];
+        bufMgr->readPage(file, pageNo, page);
+        for (PageIterator iter = page->begin(); iter != page->end(); ++iter)
+        {
+          RecordId rid = iter.getCurrentRecord();
+          std::size_t length;
+          const char *data = page->getRecordData(rid, length);
+          if (matchesAll(predicates, data, length))
+          {
+            copyRecord(projection, data, length, record);
+            (*visit)(worker, rid, record);
+          }
+        }
+        bufMgr->unPinPage(file, pageNo, false);
+        page = NULL;
+      }
+    }
+  }
+  catch (...)
+  {
+    if (page != NULL)
+    {
+      bufMgr->unPinPage(file, pageNo, false);
+    }
+    *error = std::current_exception();
+    // let the other workers run out of morsels
+    nextPage = pageNos.size();
+  }
+}
 
-    // get the first record off the page
-    pageRecordIter = curPage->begin(); 
+bool ParallelFileScan::nextMorsel(std::size_t &begin, std::size_t &end)
+{
+  begin = nextPage.fetch_add(morselPages);
+  if (begin >= pageNos.size())
+  {
+    return false;
   }
+  end = std::min(pageNos.size(), begin + morselPages);
+  return true;
+}
 
-  // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
-  // get a pointer to the record
-  rec = *pageRecordIter;
+BitmapHeapScan::BitmapHeapScan(const std::string &name, BufMgr *bufferMgr, const std::vector<ScanField> &projectionIn)
+  : projection(projectionIn)
+{
+  file = new PageFile(name, false);	//dont create new file
+  bufMgr = bufferMgr;
+}
 
-	// return rid of the record
-	outRid = pageRecordIter.getCurrentRecord();
-	return;
+BitmapHeapScan::~BitmapHeapScan()
+{
+  bufMgr->flushFile(file);
+  delete file;
 }
 
-// returns pointer to the current record.  page is left pinned
-// and the scan logic is required to unpin the page 
-std::string FileScan::getRecord()
+void BitmapHeapScan::addRid(const RecordId &rid)
 {
-  return *pageRecordIter;
+  rids.push_back(rid);
 }
 
-// mark current page of scan dirty
-void FileScan::markDirty()
+int BitmapHeapScan::addIndexScan(BTreeIndex &index, const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp)
 {
-  curDirtyFlag = true;
+  try
+  {
+    index.startScan(lowVal, lowOp, highVal, highOp);
+  }
+  catch (const NoSuchKeyFoundException &e)
+  {
+    return 0;
+  }
+  int added = 0;
+  try
+  {
+    RecordId rid;
+    while (true)
+    {
+      index.scanNext(rid);
+      rids.push_back(rid);
+      added++;
+    }
+  }
+  catch (const IndexScanCompletedException &e)
+  {
+  }
+  index.endScan();
+  return added;
+}
+
+int BitmapHeapScan::scan(const std::function<void(const RecordId&, const std::string&)> &visit)
+{
+  std::sort(rids.begin(), rids.end(), [](const RecordId &a, const RecordId &b) {
+    return a.page_number != b.page_number ? a.page_number < b.page_number : a.slot_number < b.slot_number;
+  });
+  rids.erase(std::unique(rids.begin(), rids.end()), rids.end());
+
+  std::string record;
+  std::size_t i = 0;
+  while (i < rids.size())
+  {
+    // every wanted record of this page while it is pinned
+    PageId pageNo = rids[i].page_number;
+    Page *page;
+    bufMgr->readPage(file, pageNo, page);
+    try
+    {
+      for (; i < rids.size() && rids[i].page_number == pageNo; i++)
+      {
+        std::size_t length;
+        const char *data = page->getRecordData(rids[i], length);
+        copyRecord(projection, data, length, record);
+        visit(rids[i], record);
+      }
+    }
+    catch (...)
+    {
+      bufMgr->unPinPage(file, pageNo, false);
+      throw;
+    }
+    bufMgr->unPinPage(file, pageNo, false);
+  }
+  return rids.size();
+}
+
+void BitmapHeapScan::clear()
+{
+  rids.clear();
 }
 
 }
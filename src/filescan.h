@@ -8,7 +8,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <string>
+#include <vector>
 #include "types.h"
 #include "page.h"
 #include "buffer.h"
@@ -17,6 +23,149 @@
 
 namespace badgerdb {
 
+class BTreeIndex;
+
+/**
+ * @brief Condition on one field of a record, checked by a scan against the bytes
+ * on the pinned page before anything is copied out.
+ */
+struct ScanPredicate
+{
+  /**
+   * Compares the INTEGER field at attrByteOffset with value.
+   */
+  ScanPredicate(int attrByteOffset, Operator op, int value);
+
+  /**
+   * Compares the DOUBLE field at attrByteOffset with value.
+   */
+  ScanPredicate(int attrByteOffset, Operator op, double value);
+
+  /**
+   * Compares the STRING field of attrLength bytes at attrByteOffset with value.
+   * The field ends at its first null byte, if it has one.
+   */
+  ScanPredicate(int attrByteOffset, int attrLength, Operator op, const std::string &value);
+
+  /**
+   * True if the record satisfies the predicate. Records too short to hold the
+   * field never do.
+   *
+   * @param record   Start of the record
+   * @param length   Length of the record in bytes
+   */
+  bool matches(const char *record, std::size_t length) const;
+
+  /**
+   * Offset of the field inside the record.
+   */
+  int attrByteOffset;
+
+  /**
+   * Length of the field in bytes.
+   */
+  int attrLength;
+
+  /**
+   * Type of the field.
+   */
+  Datatype attrType;
+
+  /**
+   * How the field is compared with the value.
+   */
+  Operator op;
+
+  int intValue;
+  double doubleValue;
+  std::string stringValue;
+};
+
+/**
+ * @brief Records of a relation stored column by column, filled by FileScan::scanBatch().
+ *
+ * Every column holds one fixed-width field of each record, attrLength bytes
+ * at attrByteOffset, packed one after another, so column(c) can be read as a
+ * plain array of int or double by filters and aggregates.
+ */
+class ColumnBatch
+{
+ public:
+  /**
+   * Number of records a batch holds unless told otherwise.
+   */
+  static const int DEFAULT_CAPACITY = 1024;
+
+  /**
+   * Creates an empty batch.
+   *
+   * @param fields    Field each column is taken from
+   * @param capacity  Largest number of records the batch holds
+   */
+  ColumnBatch(const std::vector<ScanField> &fields, const int capacity = DEFAULT_CAPACITY);
+
+  /**
+   * Number of records in the batch.
+   */
+  int size() const { return numRows; }
+
+  /**
+   * Largest number of records the batch holds.
+   */
+  int capacity() const { return maxRows; }
+
+  /**
+   * True if no more records fit.
+   */
+  bool full() const { return numRows == maxRows; }
+
+  /**
+   * RecordIds of the records in the batch, size() of them.
+   */
+  const RecordId *rids() const { return &ridColumn[0]; }
+
+  /**
+   * Values of column c, size() of them.
+   */
+  template <class T>
+  const T *column(int c) const { return reinterpret_cast<const T *>(&columns[c][0]); }
+
+  /**
+   * Empties the batch.
+   */
+  void clear() { numRows = 0; }
+
+  /**
+   * Adds a record, copying each column's field out of it. Bytes of a field
+   * past the end of the record are set to zero.
+   *
+   * @param rid     RecordId of the record
+   * @param record  Start of the record
+   * @param length  Length of the record in bytes
+   */
+  void append(const RecordId &rid, const char *record, std::size_t length)
+  {
+    ridColumn[numRows] = rid;
+    for (std::size_t c = 0; c < fields.size(); c++)
+    {
+      std::size_t width = fields[c].attrLength;
+      char *value = &columns[c][numRows * width];
+      std::size_t begin = std::min(length, (std::size_t)fields[c].attrByteOffset);
+      std::size_t copied = std::min(width, length - begin);
+      memcpy(value, record + begin, copied);
+      memset(value + copied, 0, width - copied);
+    }
+    numRows++;
+  }
+
+ private:
+  std::vector<ScanField> fields;
+  std::vector<RecordId> ridColumn;
+  std::vector<std::vector<char> > columns;
+  int numRows;
+  int maxRows;
+};
+
 /**
  * @brief This class is used to sequentially scan records in a relation.
  */
@@ -26,6 +175,19 @@ class FileScan
 
   FileScan(const std::string &name, BufMgr *bufMgr);
 
+  /**
+   * Scan returning only the records that satisfy every predicate. With a
+   * projection, getRecord() returns the listed fields one after another
+   * instead of the whole record.
+   *
+   * @param name        Name of the relation file
+   * @param bufMgr      Buffer manager the pages are read through
+   * @param predicates  Conditions a record must meet, all of them
+   * @param projection  Fields to return, empty for the whole record
+   */
+  FileScan(const std::string &name, BufMgr *bufMgr, const std::vector<ScanPredicate> &predicates,
+           const std::vector<ScanField> &projection = std::vector<ScanField>());
+
   ~FileScan();
 
   //return RecordId of next record that satisfies the scan 
@@ -34,6 +196,19 @@ class FileScan
   //read current record, returning pointer and length
   std::string getRecord();
 
+  //read current record into outRecord, reusing its storage
+  void getRecord(std::string& outRecord);
+
+  /**
+   * Fills batch with the next records that satisfy the scan's predicates,
+   * walking each page's slot directory directly. The scan continues after the
+   * last record put in the batch, so scanNext() and scanBatch() can be mixed.
+   *
+   * @param batch   Emptied, then filled with up to batch.capacity() records
+   * @return number of records in the batch, 0 once the end of the file is reached
+   */
+  int scanBatch(ColumnBatch& batch);
+
   //marks current page of scan dirty
   void markDirty();
 
@@ -60,6 +235,181 @@ class FileScan
    * True if page has been updated
    */
   bool  	      curDirtyFlag;
+
+  /**
+   * Conditions every returned record meets
+   */
+  std::vector<ScanPredicate> predicates;
+
+  /**
+   * Fields getRecord() returns, empty for the whole record
+   */
+  std::vector<ScanField> projection;
+};
+
+/**
+ * @brief Scans all records of a relation with several threads.
+ *
+ * The page numbers are taken from the file's page directory up front. Workers
+ * then claim morsels, runs of consecutive entries of the directory, from a shared
+ * counter and iterate the records of each page of a morsel on their own, so a
+ * slow page holds up one morsel rather than a whole share of the relation.
+ */
+class ParallelFileScan
+{
+ public:
+
+  /**
+   * Opens the relation and reads its page directory.
+   *
+   * @param name          Name of the relation file
+   * @param bufMgr        Buffer manager the pages are read through
+   * @param numThreads    Number of worker threads, 0 for one per hardware thread
+   * @param morselPages   Number of pages a worker claims at a time
+   * @param predicates    Conditions a record must meet to be visited, all of them
+   * @param projection    Fields passed to visit, empty for the whole record
+   */
+  ParallelFileScan(const std::string &name, BufMgr *bufMgr, const int numThreads = 0, const int morselPages = 16,
+                   const std::vector<ScanPredicate> &predicates = std::vector<ScanPredicate>(),
+                   const std::vector<ScanField> &projection = std::vector<ScanField>());
+
+  ~ParallelFileScan();
+
+  /**
+   * Calls visit once for every record of the relation that satisfies the
+   * predicates, passing the record or its projected fields. visit is called from the
+   * worker threads, with the number of the calling worker, in no particular order;
+   * calls from different workers may run at the same time. An exception thrown
+   * by visit stops its worker and is rethrown here once all workers are done.
+   *
+   * @param visit   Called with the worker number, the record id and the record
+   */
+  void scan(const std::function<void(int, const RecordId&, const std::string&)> &visit);
+
+ private:
+  /**
+   * Body of one worker: claim morsels until none are left and visit their records.
+   */
+  void scanWorker(int worker, const std::function<void(int, const RecordId&, const std::string&)> *visit,
+                  std::exception_ptr *error);
+
+  /**
+   * Claims the next morsel, setting begin and end to its range of directory entries.
+   * Returns false once every morsel has been claimed.
+   */
+  bool nextMorsel(std::size_t &begin, std::size_t &end);
+
+  /**
+   * File which is being scanned.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read pages into the buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * Numbers of the used pages of the file, in ascending order
+   */
+  std::vector<PageId> pageNos;
+
+  /**
+   * Morsel dispenser: index into pageNos of the first page not yet claimed
+   */
+  std::atomic<std::size_t> nextPage;
+
+  int           numThreads;
+  int           morselPages;
+
+  /**
+   * Conditions every visited record meets
+   */
+  std::vector<ScanPredicate> predicates;
+
+  /**
+   * Fields passed to visit, empty for the whole record
+   */
+  std::vector<ScanField> projection;
+};
+
+/**
+ * @brief Fetches the records behind a set of RecordIds, such as the result of an
+ * index range scan, in page order.
+ *
+ * An index returns RecordIds in key order, so fetching them one by one jumps
+ * between heap pages and pins a page again for every record on it. Here the
+ * RecordIds are collected first and sorted by page and slot, and each page is
+ * then pinned once while all of its wanted records are read.
+ */
+class BitmapHeapScan
+{
+ public:
+
+  /**
+   * Opens the relation. No RecordIds are collected yet.
+   *
+   * @param name          Name of the relation file
+   * @param bufMgr        Buffer manager the pages are read through
+   * @param projection    Fields passed to visit, empty for the whole record
+   */
+  BitmapHeapScan(const std::string &name, BufMgr *bufMgr,
+                 const std::vector<ScanField> &projection = std::vector<ScanField>());
+
+  ~BitmapHeapScan();
+
+  /**
+   * Adds one RecordId to fetch. A RecordId added twice is fetched once.
+   */
+  void addRid(const RecordId &rid);
+
+  /**
+   * Runs a range scan of index and adds every RecordId it returns. Adding the
+   * ranges of several scans fetches the records of their union.
+   *
+   * @param index     Index on the relation
+   * @param lowVal    Low value of range, as for BTreeIndex::startScan()
+   * @param lowOp     Low operator (GT/GTE)
+   * @param highVal   High value of range, as for BTreeIndex::startScan()
+   * @param highOp    High operator (LT/LTE)
+   * @return number of RecordIds the scan returned
+   */
+  int addIndexScan(BTreeIndex &index, const void *lowVal, const Operator lowOp, const void *highVal, const Operator highOp);
+
+  /**
+   * Calls visit for the record of every distinct RecordId added, in page and
+   * slot order. Each page is pinned once.
+   *
+   * @param visit   Called with the record id and the record or its projected fields
+   * @return number of records visited
+   */
+  int scan(const std::function<void(const RecordId&, const std::string&)> &visit);
+
+  /**
+   * Forgets the RecordIds added so far.
+   */
+  void clear();
+
+ private:
+  /**
+   * File which is being scanned.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read pages into the buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * RecordIds added, sorted and deduplicated by scan()
+   */
+  std::vector<RecordId> rids;
+
+  /**
+   * Fields passed to visit, empty for the whole record
+   */
+  std::vector<ScanField> projection;
 };
 
 }
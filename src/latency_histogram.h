@@ -0,0 +1,191 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+* @brief Histogram of latencies in nanoseconds, with buckets on a log-linear scale.
+*
+* Values below SUB_BUCKETS get a bucket each. Above that every power of two is split into SUB_BUCKETS
+* equal buckets, so a value is known to within 1/SUB_BUCKETS of itself whatever its size, and the whole
+* 64-bit range fits in a fixed array. Recording is a few shifts and an increment.
+*/
+class LatencyHistogram
+{
+ public:
+	/**
+   * Bits of a value kept below its highest set bit
+	 */
+  static const int SUB_BUCKET_BITS = 3;
+
+	/**
+   * Buckets each power of two is split into
+	 */
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+	/**
+   * Number of buckets
+	 */
+  static const int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+ private:
+	/**
+   * Number of values recorded in each bucket
+	 */
+  std::uint64_t counts[BUCKETS];
+
+	/**
+   * Number of values recorded
+	 */
+  std::uint64_t total;
+
+	/**
+   * Sum of the values recorded
+	 */
+  std::uint64_t sum;
+
+	/**
+   * Largest value recorded
+	 */
+  std::uint64_t maximum;
+
+	/**
+	 * Bucket a value is counted in.
+	 */
+  static int bucketOf(std::uint64_t value)
+  {
+    if (value < (std::uint64_t)SUB_BUCKETS)
+    {
+      return (int)value;
+    }
+    const int shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + (int)((value >> shift) & (SUB_BUCKETS - 1));
+  }
+
+	/**
+	 * Largest value counted in a bucket.
+	 */
+  static std::uint64_t bucketEnd(int bucket)
+  {
+    if (bucket < SUB_BUCKETS)
+    {
+      return bucket;
+    }
+    const int shift = bucket / SUB_BUCKETS - 1;
+    const std::uint64_t sub = SUB_BUCKETS + bucket % SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+  }
+
+ public:
+	/**
+   * Clear all values
+	 */
+  void clear()
+  {
+    for (int i = 0; i < BUCKETS; i++)
+    {
+      counts[i] = 0;
+    }
+    total = sum = maximum = 0;
+  }
+
+	/**
+   * Constructor of LatencyHistogram class
+	 */
+  LatencyHistogram()
+  {
+    clear();
+  }
+
+	/**
+	 * Counts one value.
+	 *
+	 * @param nanos   	Latency in nanoseconds
+	 */
+  void record(std::uint64_t nanos)
+  {
+    counts[bucketOf(nanos)]++;
+    total++;
+    sum += nanos;
+    if (nanos > maximum)
+    {
+      maximum = nanos;
+    }
+  }
+
+	/**
+   * Number of values recorded
+	 */
+  std::uint64_t count() const
+  {
+    return total;
+  }
+
+	/**
+   * Average of the values recorded, 0 if there are none
+	 */
+  double mean() const
+  {
+    return total == 0 ? 0 : (double)sum / total;
+  }
+
+	/**
+   * Largest value recorded
+	 */
+  std::uint64_t max() const
+  {
+    return maximum;
+  }
+
+	/**
+	 * Value at or below which the given fraction of the recorded values lie, rounded up to the end of
+	 * its bucket. 0 if nothing was recorded.
+	 *
+	 * @param fraction   	Fraction of the values, from 0 to 1; 0.99 gives the 99th percentile
+	 */
+  std::uint64_t percentile(double fraction) const
+  {
+    std::uint64_t rank = (std::uint64_t)(fraction * total + 0.5);
+    if (rank == 0)
+    {
+      rank = 1;
+    }
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS && total != 0; i++)
+    {
+      seen += counts[i];
+      if (seen >= rank)
+      {
+        return bucketEnd(i) < maximum ? bucketEnd(i) : maximum;
+      }
+    }
+    return maximum;
+  }
+
+	/**
+	 * Removes the values of an earlier copy of this histogram, leaving those recorded since. The
+	 * maximum stays the one of this histogram, which covers the earlier values too.
+	 *
+	 * @param earlier   	Copy of this histogram taken earlier
+	 */
+  LatencyHistogram& operator-=(const LatencyHistogram& earlier)
+  {
+    for (int i = 0; i < BUCKETS; i++)
+    {
+      counts[i] -= earlier.counts[i];
+    }
+    total -= earlier.total;
+    sum -= earlier.sum;
+    return *this;
+  }
+};
+
+}
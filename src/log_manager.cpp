@@ -0,0 +1,490 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "crc32c.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/log_io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Marks a file as a log of this format.
+ */
+const std::uint32_t LOG_MAGIC = 0x4c474442;
+
+/**
+ * Changed bytes separated by fewer equal bytes than this go in one range,
+ * which is cheaper than the header of a second range.
+ */
+const std::size_t RANGE_GAP = 8;
+
+/**
+ * Holes punched into the log start and end on multiples of this, the block
+ * size of common file systems.  The first block keeps the header.
+ */
+const std::size_t HOLE_ALIGNMENT = 4096;
+
+/**
+ * First bytes of the log file.
+ */
+struct LogFileHeader {
+  std::uint32_t magic;
+  std::uint32_t has_checkpoint;
+  LogSeqNum base_lsn;
+  LogSeqNum checkpoint_lsn;
+};
+
+enum LogRecordType {
+  PAGE_RECORD = 1,
+  COMMIT_RECORD = 2,
+  CHECKPOINT_RECORD = 3
+};
+
+/**
+ * Start of every record.  Page records follow it with the file name and then
+ * the changed ranges of the page, each a LogRange and its bytes.
+ */
+struct LogRecordHeader {
+  std::uint32_t length;
+  std::uint32_t checksum;
+  std::uint16_t type;
+  std::uint16_t name_length;
+  PageId page_number;
+  std::uint32_t blob_file;
+};
+
+struct LogRange {
+  std::uint16_t offset;
+  std::uint16_t length;
+};
+
+/**
+ * One page of the dirty page table in a checkpoint record, followed by the
+ * file name.  The record starts with the LSN the checkpoint began at.
+ */
+struct CheckpointEntry {
+  LogSeqNum rec_lsn;
+  PageId page_number;
+  std::uint32_t name_length;
+};
+
+/**
+ * CRC32C of a record, with its checksum field read as zero.
+ */
+std::uint32_t recordChecksum(const char* record, const std::size_t length) {
+  const std::size_t field = offsetof(LogRecordHeader, checksum);
+  const std::uint32_t zero = 0;
+  std::uint32_t crc = crc32c(record, field);
+  crc = crc32c(&zero, sizeof(zero), crc);
+  return crc32c(record + field + sizeof(zero), length - field - sizeof(zero), crc);
+}
+
+/**
+ * Fills in the length and checksum of the record starting at the given offset
+ * and running to the end of the records.
+ */
+void sealRecord(std::string& records, const std::size_t start) {
+  LogRecordHeader header;
+  memcpy(&header, &records[start], sizeof(header));
+  header.length = records.size() - start;
+  memcpy(&records[start], &header, sizeof(header));
+  header.checksum = recordChecksum(&records[start], header.length);
+  memcpy(&records[start], &header, sizeof(header));
+}
+
+void writeAll(const int fd, const char* data, std::size_t length,
+              const std::string& name) {
+  while (length > 0) {
+    ssize_t written = ::write(fd, data, length);
+    if (written < 0) {
+      throw LogIoException(name, "write");
+    }
+    data += written;
+    length -= written;
+  }
+}
+
+/**
+ * Applies a page record to its page in the data file.  Files are opened on
+ * first use and kept in the given map, NULL if the file is gone.
+ */
+void redoPageRecord(const char* record, std::map<std::string, File*>& files) {
+  LogRecordHeader page_header;
+  memcpy(&page_header, record, sizeof(page_header));
+  std::string name(record + sizeof(page_header), page_header.name_length);
+  std::map<std::string, File*>::iterator it = files.find(name);
+  if (it == files.end()) {
+    // a file removed since it was logged needs no redo
+    File* file = NULL;
+    if (File::exists(name)) {
+      file = page_header.blob_file ? (File*)new BlobFile(BlobFile::open(name))
+                                   : (File*)new PageFile(PageFile::open(name));
+    }
+    it = files.insert(std::make_pair(name, file)).first;
+  }
+  if (it->second == NULL) {
+    return;
+  }
+
+  try {
+    // a page torn by a write-back is repaired too: the records from its
+    // recLSN on hold every byte the write changed, and the file restamps a
+    // stored checksum.  Only pages no record covers keep a bad checksum.
+    Page page = it->second->readPage(page_header.page_number);
+    char* bytes = reinterpret_cast<char*>(&page);
+    std::size_t offset = sizeof(page_header) + page_header.name_length;
+    while (offset < page_header.length) {
+      LogRange range;
+      memcpy(&range, record + offset, sizeof(range));
+      memcpy(bytes + range.offset, record + offset + sizeof(range), range.length);
+      offset += sizeof(range) + range.length;
+    }
+    it->second->writePage(page_header.page_number, page);
+  } catch (const InvalidPageException&) {
+    // the page was deleted after the record was written
+  }
+}
+
+}
+
+LogManager::LogManager(const std::string& name)
+    : filename_(name), base_lsn_(0), next_lsn_(0), durable_lsn_(0),
+      syncing_(false) {
+  fd_ = ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw LogIoException(name, "open");
+  }
+  recover();
+}
+
+LogManager::~LogManager() {
+  try {
+    flush(nextLSN());
+  } catch (const LogIoException&) {
+  }
+  ::close(fd_);
+}
+
+LogSeqNum LogManager::append(const std::string& records, LogSeqNum& start) {
+  std::string commit(sizeof(LogRecordHeader), '\0');
+  LogRecordHeader header = {0, 0, COMMIT_RECORD, 0, Page::INVALID_NUMBER, 0};
+  memcpy(&commit[0], &header, sizeof(header));
+  sealRecord(commit, 0);
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  start = next_lsn_;
+  buffer_.append(records);
+  buffer_.append(commit);
+  next_lsn_ += records.size() + commit.size();
+  stats_.transactions++;
+  return next_lsn_;
+}
+
+void LogManager::flush(const LogSeqNum lsn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (durable_lsn_ < lsn) {
+    if (syncing_) {
+      // commits arriving now pile up in the buffer for the next sync
+      synced_.wait(lock);
+      continue;
+    }
+    syncing_ = true;
+    std::string records;
+    records.swap(buffer_);
+    LogSeqNum end = next_lsn_;
+    lock.unlock();
+    try {
+      writeOut(records);
+    } catch (...) {
+      lock.lock();
+      syncing_ = false;
+      synced_.notify_all();
+      throw;
+    }
+    lock.lock();
+    syncing_ = false;
+    durable_lsn_ = end;
+    stats_.syncs++;
+    synced_.notify_all();
+  }
+}
+
+void LogManager::reset() {
+  flush(nextLSN());
+  std::lock_guard<std::mutex> guard(mutex_);
+  base_lsn_ = next_lsn_;
+  startOver();
+}
+
+LogSeqNum LogManager::nextLSN() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return next_lsn_;
+}
+
+LogStats LogManager::getLogStats() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return stats_;
+}
+
+bool LogManager::appendPageRecord(std::string& records, const File* file,
+                                  const PageId page_number, const Page& before,
+                                  const Page& after) {
+  const char* old_bytes = reinterpret_cast<const char*>(&before);
+  const char* new_bytes = reinterpret_cast<const char*>(&after);
+  const std::size_t start = records.size();
+  const std::string& name = file->filename();
+  LogRecordHeader header = {0, 0, PAGE_RECORD, (std::uint16_t)name.size(),
+                            page_number,
+                            dynamic_cast<const BlobFile*>(file) != NULL};
+  records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  records.append(name);
+
+  bool changed = false;
+  std::size_t i = 0;
+  // the checksum is redone whenever the page is written, so it is not logged
+  const std::size_t size = Page::SIZE - Page::CHECKSUM_SIZE;
+  while (i < size) {
+    if (i + sizeof(std::uint64_t) <= size &&
+        memcmp(old_bytes + i, new_bytes + i, sizeof(std::uint64_t)) == 0) {
+      i += sizeof(std::uint64_t);
+      continue;
+    }
+    if (old_bytes[i] == new_bytes[i]) {
+      i++;
+      continue;
+    }
+    // grow the range until RANGE_GAP equal bytes in a row end it
+    std::size_t end = i + 1;
+    for (std::size_t j = end; j < size && j - end < RANGE_GAP; j++) {
+      if (old_bytes[j] != new_bytes[j]) {
+        end = j + 1;
+      }
+    }
+    LogRange range = {(std::uint16_t)i, (std::uint16_t)(end - i)};
+    records.append(reinterpret_cast<const char*>(&range), sizeof(range));
+    records.append(new_bytes + i, end - i);
+    changed = true;
+    i = end;
+  }
+
+  if (!changed) {
+    records.resize(start);
+    return false;
+  }
+  sealRecord(records, start);
+  return true;
+}
+
+void LogManager::syncFile(const std::string& name) {
+  int fd = ::open(name.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
+void LogManager::recover() {
+  // a new log starts at 1, leaving 0 to mean no change at all
+  LogFileHeader file_header = {LOG_MAGIC, 0, 1, 0};
+  std::string head = readLog(0, sizeof(file_header));
+  if (head.size() == sizeof(file_header)) {
+    memcpy(&file_header, &head[0], sizeof(file_header));
+    if (file_header.magic != LOG_MAGIC) {
+      throw LogIoException(filename_, "recognize");
+    }
+  }
+  base_lsn_ = file_header.base_lsn;
+
+  // records from begin_lsn on are all redone. Older ones only matter to pages
+  // that the last checkpoint found dirty, from the page's recLSN on
+  LogSeqNum begin_lsn = base_lsn_;
+  LogSeqNum redo_lsn = base_lsn_;
+  std::map<std::pair<std::string, PageId>, LogSeqNum> dirty_pages;
+  if (file_header.has_checkpoint) {
+    std::string checkpoint = readLog(offsetOf(file_header.checkpoint_lsn), sizeof(LogRecordHeader));
+    if (checkpoint.size() != sizeof(LogRecordHeader)) {
+      throw LogIoException(filename_, "read checkpoint of");
+    }
+    LogRecordHeader header;
+    memcpy(&header, &checkpoint[0], sizeof(header));
+    checkpoint = readLog(offsetOf(file_header.checkpoint_lsn), header.length);
+    if (checkpoint.size() != header.length ||
+        header.checksum != recordChecksum(&checkpoint[0], header.length)) {
+      throw LogIoException(filename_, "read checkpoint of");
+    }
+    std::size_t offset = sizeof(header);
+    memcpy(&begin_lsn, &checkpoint[offset], sizeof(begin_lsn));
+    offset += sizeof(begin_lsn);
+    redo_lsn = begin_lsn;
+    while (offset < checkpoint.size()) {
+      CheckpointEntry entry;
+      memcpy(&entry, &checkpoint[offset], sizeof(entry));
+      std::string name(&checkpoint[offset + sizeof(entry)], entry.name_length);
+      dirty_pages[std::make_pair(name, entry.page_number)] = entry.rec_lsn;
+      redo_lsn = std::min(redo_lsn, entry.rec_lsn);
+      offset += sizeof(entry) + entry.name_length;
+    }
+  }
+
+  // pages a transaction changed are only touched once its commit record is read;
+  // records after the last commit belong to a transaction cut off by the crash
+  std::string log = readLog(offsetOf(redo_lsn), std::string::npos);
+  std::map<std::string, File*> files;
+  std::vector<std::size_t> pending;
+  std::size_t pos = 0;
+  std::size_t end = pos;
+  while (pos + sizeof(LogRecordHeader) <= log.size()) {
+    LogRecordHeader header;
+    memcpy(&header, &log[pos], sizeof(header));
+    if (header.length < sizeof(header) || header.length > log.size() - pos ||
+        header.checksum != recordChecksum(&log[pos], header.length)) {
+      break;
+    }
+    if (header.type == PAGE_RECORD) {
+      pending.push_back(pos);
+    } else if (header.type == COMMIT_RECORD) {
+      for (std::size_t r = 0; r < pending.size(); r++) {
+        const char* record = &log[pending[r]];
+        LogSeqNum lsn = redo_lsn + pending[r];
+        if (lsn < begin_lsn) {
+          LogRecordHeader page_header;
+          memcpy(&page_header, record, sizeof(page_header));
+          std::string name(record + sizeof(page_header), page_header.name_length);
+          std::map<std::pair<std::string, PageId>, LogSeqNum>::iterator it =
+              dirty_pages.find(std::make_pair(name, page_header.page_number));
+          if (it == dirty_pages.end() || lsn < it->second) {
+            // the page was written back with this change before the checkpoint
+            stats_.skippedRecords++;
+            continue;
+          }
+        }
+        redoPageRecord(record, files);
+      }
+      pending.clear();
+      stats_.recoveredTransactions++;
+      end = pos + header.length;
+    } else if (header.type == CHECKPOINT_RECORD) {
+      end = pos + header.length;
+    } else {
+      break;
+    }
+    pos += header.length;
+  }
+
+  for (std::map<std::string, File*>::iterator it = files.begin(); it != files.end(); ++it) {
+    if (it->second != NULL) {
+      delete it->second;
+      syncFile(it->first);
+    }
+  }
+
+  // the redone changes are on disk, so the log starts over after the last commit
+  base_lsn_ = redo_lsn + end;
+  next_lsn_ = durable_lsn_ = base_lsn_;
+  startOver();
+}
+
+void LogManager::checkpoint(const std::vector<DirtyPage>& dirtyPages,
+                            const LogSeqNum beginLSN) {
+  std::string record(sizeof(LogRecordHeader), '\0');
+  LogRecordHeader header = {0, 0, CHECKPOINT_RECORD, 0, Page::INVALID_NUMBER, 0};
+  memcpy(&record[0], &header, sizeof(header));
+  record.append(reinterpret_cast<const char*>(&beginLSN), sizeof(beginLSN));
+  LogSeqNum redo_lsn = beginLSN;
+  for (std::size_t i = 0; i < dirtyPages.size(); i++) {
+    CheckpointEntry entry = {dirtyPages[i].recLSN, dirtyPages[i].pageNo,
+                             (std::uint32_t)dirtyPages[i].filename.size()};
+    record.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    record.append(dirtyPages[i].filename);
+    redo_lsn = std::min(redo_lsn, dirtyPages[i].recLSN);
+  }
+  sealRecord(record, 0);
+
+  LogSeqNum lsn;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    lsn = next_lsn_;
+    buffer_.append(record);
+    next_lsn_ += record.size();
+  }
+  flush(lsn + record.size());
+
+  // recovery starts from this checkpoint once the header points at it
+  std::lock_guard<std::mutex> guard(mutex_);
+  LogFileHeader file_header = {LOG_MAGIC, 1, base_lsn_, lsn};
+  if (::pwrite(fd_, &file_header, sizeof(file_header), 0) != sizeof(file_header) ||
+      ::fdatasync(fd_) != 0) {
+    throw LogIoException(filename_, "write checkpoint to");
+  }
+  stats_.checkpoints++;
+
+  // hand the blocks before the redo start back to the file system. Later
+  // records keep their offsets, and file systems without holes keep the blocks
+  off_t hole_end = offsetOf(redo_lsn) / HOLE_ALIGNMENT * HOLE_ALIGNMENT;
+  if (hole_end > (off_t)HOLE_ALIGNMENT) {
+    ::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, HOLE_ALIGNMENT,
+                hole_end - HOLE_ALIGNMENT);
+  }
+}
+
+void LogManager::startOver() {
+  LogFileHeader header = {LOG_MAGIC, 0, base_lsn_, 0};
+  if (::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) != 0) {
+    throw LogIoException(filename_, "truncate");
+  }
+  writeAll(fd_, reinterpret_cast<const char*>(&header), sizeof(header), filename_);
+  if (::fdatasync(fd_) != 0) {
+    throw LogIoException(filename_, "sync");
+  }
+}
+
+off_t LogManager::offsetOf(const LogSeqNum lsn) const {
+  return sizeof(LogFileHeader) + (lsn - base_lsn_);
+}
+
+std::string LogManager::readLog(const off_t offset, const std::size_t length) {
+  struct stat info;
+  if (::fstat(fd_, &info) != 0) {
+    throw LogIoException(filename_, "read");
+  }
+  std::size_t available = info.st_size > offset ? info.st_size - offset : 0;
+  std::string bytes(std::min(length, available), '\0');
+  std::size_t size = 0;
+  while (size < bytes.size()) {
+    ssize_t got = ::pread(fd_, &bytes[size], bytes.size() - size, offset + size);
+    if (got <= 0) {
+      break;
+    }
+    size += got;
+  }
+  bytes.resize(size);
+  return bytes;
+}
+
+void LogManager::writeOut(const std::string& records) {
+  writeAll(fd_, records.data(), records.size(), filename_);
+  if (::fdatasync(fd_) != 0) {
+    throw LogIoException(filename_, "sync");
+  }
+}
+
+}
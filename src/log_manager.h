@@ -0,0 +1,275 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Statistics of a write-ahead log.
+ */
+struct LogStats {
+  /**
+   * Transactions appended to the log since it was opened.
+   */
+  int transactions;
+
+  /**
+   * Number of times the log was forced to disk.  Below transactions when
+   * group commit folds several commits into one sync.
+   */
+  int syncs;
+
+  /**
+   * Checkpoints written since the log was opened.
+   */
+  int checkpoints;
+
+  /**
+   * Transactions replayed when the log was opened.
+   */
+  int recoveredTransactions;
+
+  /**
+   * Page records read but not replayed when the log was opened, because the
+   * last checkpoint showed their page was written back after them.
+   */
+  int skippedRecords;
+
+  /**
+   * Clear all values.
+   */
+  void clear() {
+    transactions = syncs = checkpoints = recoveredTransactions = skippedRecords = 0;
+  }
+
+  /**
+   * Constructor of LogStats class.
+   */
+  LogStats() { clear(); }
+};
+
+/**
+ * @brief Page of the dirty page table kept in a checkpoint.
+ */
+struct DirtyPage {
+  /**
+   * Name of the file the page belongs to.
+   */
+  std::string filename;
+
+  /**
+   * Number of the page in the file.
+   */
+  PageId pageNo;
+
+  /**
+   * Sequence number of the first logged change not yet written to the file.
+   */
+  LogSeqNum recLSN;
+};
+
+/**
+ * @brief Write-ahead log of the pages changed through a BufMgr.
+ *
+ * Records are physical redo records: the bytes of a page that a transaction
+ * changed, next to the file and page number they belong to.  A transaction is
+ * appended as its page records followed by a commit record, all at once, so the
+ * log never holds half a transaction except at a torn tail.
+ *
+ * Opening a log replays every complete transaction in it onto the data files,
+ * syncs those files and empties the log.  A checkpoint bounds how far back the
+ * replay starts: it records which pages were dirty in the pool, and from which
+ * record on, so older records for other pages are skipped.  Records are redo only, so nothing a
+ * transaction changed may reach disk before it commits, and no other
+ * transaction may change those pages meanwhile.
+ *
+ * Commits ask flush() for their records to be on disk.  A commit arriving while
+ * another one syncs waits for that sync and then has its records written with
+ * every other commit that piled up, so many commits share one sync.
+ */
+class LogManager {
+ public:
+  /**
+   * Opens the log, creating it if needed, and redoes the transactions it holds.
+   *
+   * @param name  Name of the log file.
+   * @throws LogIoException If the log cannot be opened or written.
+   */
+  explicit LogManager(const std::string& name);
+
+  /**
+   * Writes out the records not yet on disk and closes the log.
+   */
+  ~LogManager();
+
+  /**
+   * Appends a transaction to the log buffer.  The records are not on disk
+   * until flush() returns for the sequence number returned here.
+   *
+   * @param records  Page records of the transaction, from appendPageRecord().
+   * @param start  Set to the sequence number of the first record.
+   * @return Sequence number just past the commit record of the transaction.
+   */
+  LogSeqNum append(const std::string& records, LogSeqNum& start);
+
+  /**
+   * Returns once every record before the given sequence number is on disk.
+   *
+   * @param lsn  Sequence number returned by append().
+   * @throws LogIoException If the log cannot be written.
+   */
+  void flush(const LogSeqNum lsn);
+
+  /**
+   * Writes a checkpoint and makes recovery start from it.  Records before the
+   * oldest recLSN of the table, or before beginLSN if that is older, are no
+   * longer read, and the blocks holding them are freed.
+   *
+   * @param dirtyPages  Pages of the pool with logged changes not yet written.
+   * @param beginLSN  Sequence number of the log when the table was taken.  The
+   *                  files must be synced for every write back before it.
+   * @throws LogIoException If the log cannot be written.
+   */
+  void checkpoint(const std::vector<DirtyPage>& dirtyPages,
+                  const LogSeqNum beginLSN);
+
+  /**
+   * Discards every record.  Only correct once every change the log holds is
+   * synced to the data files.
+   */
+  void reset();
+
+  /**
+   * Sequence number the next transaction gets.
+   */
+  LogSeqNum nextLSN();
+
+  /**
+   * Name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Get log statistics.
+   */
+  LogStats getLogStats();
+
+  /**
+   * Appends a record of the bytes of a page that differ from an older image of
+   * the same page.  Nothing is appended when the two are equal.
+   *
+   * @param records  Records of a transaction.
+   * @param file  File the page belongs to.
+   * @param page_number  Number of the page in the file.
+   * @param before  Page as last logged.
+   * @param after  Page as it is now.
+   * @return True if a record was appended.
+   */
+  static bool appendPageRecord(std::string& records, const File* file,
+                               const PageId page_number, const Page& before,
+                               const Page& after);
+
+  /**
+   * Forces the contents of a data file to disk.
+   *
+   * @param name  Name of the file.
+   */
+  static void syncFile(const std::string& name);
+
+ private:
+  /**
+   * Replays the complete transactions in the log file onto the data files.
+   */
+  void recover();
+
+  /**
+   * Empties the log file, leaving a header that starts it at base_lsn_.
+   */
+  void startOver();
+
+  /**
+   * Offset in the log file of the record with the given sequence number.
+   */
+  off_t offsetOf(const LogSeqNum lsn) const;
+
+  /**
+   * Reads bytes of the log file, fewer if it ends first.
+   *
+   * @param offset  Offset of the first byte.
+   * @param length  Number of bytes, npos for the rest of the file.
+   */
+  std::string readLog(const off_t offset, const std::size_t length);
+
+  /**
+   * Writes the buffered records and syncs the log.  Called by the one thread
+   * leading a group commit, without the mutex held.
+   */
+  void writeOut(const std::string& records);
+
+  /**
+   * Name of the log file.
+   */
+  std::string filename_;
+
+  /**
+   * Descriptor of the log file.
+   */
+  int fd_;
+
+  /**
+   * Sequence number of the first byte after the log file header.
+   */
+  LogSeqNum base_lsn_;
+
+  /**
+   * Sequence number the next appended byte gets.
+   */
+  LogSeqNum next_lsn_;
+
+  /**
+   * Every record before this sequence number is on disk.
+   */
+  LogSeqNum durable_lsn_;
+
+  /**
+   * Records appended but not yet written.
+   */
+  std::string buffer_;
+
+  /**
+   * True while a thread writes and syncs the log.
+   */
+  bool syncing_;
+
+  /**
+   * Guards the buffer and the sequence numbers.
+   */
+  std::mutex mutex_;
+
+  /**
+   * Signalled when a sync finishes.
+   */
+  std::condition_variable synced_;
+
+  /**
+   * Log statistics.
+   */
+  LogStats stats_;
+};
+
+}
@@ -5,8 +5,16 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <climits>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fstream>
 #include "btree.h"
+#include "crc32c.h"
+#include "page_codec.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -14,11 +22,17 @@
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/no_such_key_found_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/page_checksum_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -74,21 +88,81 @@ BufMgr * bufMgr = new BufMgr(100);
 // Forward declarations
 // -----------------------------------------------------------------------------
 
-void createRelationForward();
+void createRelationForward(bool compressed = false);
 void createRelationForwardInRange(int begin, int end);
 void createRelationBackward();
 void createRelationBackwardSize(int size);
 void createRelationRandom();
-void intTests();
+void createRelationDuplicates(int numDistinct);
+void createRelationKeys(const std::vector<int> &keys);
+void intTests(int indexOptions);
 void intNegativeTests();
 void intEmptyTests();
-int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
-void indexTests();
+void intDuplicateTests(bool lowCardinality, int indexOptions);
+int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order = ASCENDING);
+void stringTests();
+int stringScan(BTreeIndex *index, const char *lowVal, Operator lowOp, const char *highVal, Operator highOp, ScanOrder order = ASCENDING);
+void indexTests(int indexOptions = INDEX_DEFAULT);
 void addIndexTests(bool isNeg);
+void duplicateIndexTests(bool lowCardinality, int indexOptions = INDEX_DEFAULT);
+void countIndexTests(bool lowCardinality);
+void intCountTests(bool lowCardinality);
+void concurrentIndexTests(int indexOptions);
+void intConcurrentTests(int indexOptions);
+void buildIndexTests(int indexOptions);
+void intBuildTests(int indexOptions);
+void stringBuildTests();
+void multiIndexBuildTests();
+void parallelScanIndexTests(bool duplicates);
+void intParallelScanTests(bool duplicates);
+int intParallelScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+void parallelFileScanTests();
+void filteredScanTests();
+int filteredScan(const std::vector<ScanPredicate> &predicates, const std::vector<ScanField> &projection);
+void batchScanTests();
+void coveringIndexTests(bool duplicates);
+void intCoveringTests(bool duplicates);
+int coveringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order = ASCENDING);
+void compositeIndexTests();
+void bitmapHeapScanTests();
+void logRecoveryTests();
+void checksumTests();
+void compressionTests();
+void poolMemoryTests();
+void resizeTests();
+void bufStatsTests();
+void indexStatsTests();
+void reorganizeTests();
+void extremeKeyTests();
+void intExtremeKeyTests(int indexOptions);
+int logScan(BTreeIndex *index, int lowVal, int highVal);
+int compositeScan(BTreeIndex *index, const std::vector<KeyComponent> &components, const CompositeKey &lowVal, Operator lowOp,
+                  const CompositeKey &highVal, Operator highOp);
 void test1();
 void test2();
 void test3();
 void test4();
+void test5();
+void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
 void testNegative();
 void testEmptyTree();
 void testNonLeafSplit();
@@ -157,6 +231,28 @@ int main(int argc, char **argv)
 	test1();
     test2();
     test3();
+    test4();
+    test5();
+    test6();
+    test7();
+    test8();
+    test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+    test17();
+    test18();
+    test19();
+    test20();
+    test21();
+    test22();
+    test23();
+    test24();
+    test25();
 	testNegative();
 	testEmptyTree();
 	//testNonLeafSplit(); //too long to run
@@ -200,6 +296,255 @@ void test3()
     deleteRelation();
 }
 
+void test4()
+{
+    // Create relations where every key repeats and check that scans return every duplicate,
+    // both for keys kept inline in the leaves and for keys moved out into posting lists
+    std::cout << "------------------------" << std::endl;
+    std::cout << "createRelationDuplicates" << std::endl;
+    createRelationDuplicates(2000);
+    duplicateIndexTests(false);
+    deleteRelation();
+
+    createRelationDuplicates(10);
+    duplicateIndexTests(true);
+    deleteRelation();
+}
+
+void test5()
+{
+    // Same checks against an index built with compressed leaves
+    std::cout << "------------------------------------" << std::endl;
+    std::cout << "createRelationRandom compressed leaves" << std::endl;
+    createRelationRandom();
+    indexTests(INDEX_COMPRESSED_LEAVES);
+    deleteRelation();
+
+    createRelationDuplicates(2000);
+    duplicateIndexTests(false, INDEX_COMPRESSED_LEAVES);
+    deleteRelation();
+
+    createRelationDuplicates(10);
+    duplicateIndexTests(true, INDEX_COMPRESSED_LEAVES);
+    deleteRelation();
+}
+
+void test6()
+{
+    // Index keeping subtree counts: scans behave as before and counts are read off the inner nodes
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationRandom subtree counts" << std::endl;
+    createRelationRandom();
+    indexTests(INDEX_SUBTREE_COUNTS);
+    countIndexTests(false);
+    deleteRelation();
+
+    createRelationDuplicates(10);
+    duplicateIndexTests(true, INDEX_SUBTREE_COUNTS | INDEX_COMPRESSED_LEAVES);
+    countIndexTests(true);
+    deleteRelation();
+}
+
+void test7()
+{
+    // Several threads insert into one index while looking up what they inserted
+    std::cout << "------------------" << std::endl;
+    std::cout << "concurrent inserts" << std::endl;
+    createRelationBackwardSize(0);
+    concurrentIndexTests(INDEX_DEFAULT);
+    concurrentIndexTests(INDEX_COMPRESSED_LEAVES);
+    concurrentIndexTests(INDEX_SUBTREE_COUNTS);
+    deleteRelation();
+}
+
+void test8()
+{
+    // Indexes built by 4 threads, each sorting the entries of its share of the relation pages
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationRandom parallel build" << std::endl;
+    createRelationRandom();
+    buildIndexTests(INDEX_DEFAULT);
+    buildIndexTests(INDEX_COMPRESSED_LEAVES | INDEX_SUBTREE_COUNTS);
+    deleteRelation();
+}
+
+void test9()
+{
+    // Integer and string indexes created from a single read of the relation
+    std::cout << "---------------------------------" << std::endl;
+    std::cout << "createRelationRandom multi index" << std::endl;
+    createRelationRandom();
+    multiIndexBuildTests();
+    deleteRelation();
+}
+
+void test10()
+{
+    // Range scans cut into pieces and scanned by 4 threads
+    std::cout << "------------------------------------" << std::endl;
+    std::cout << "createRelationRandom parallel scan" << std::endl;
+    createRelationRandom();
+    parallelScanIndexTests(false);
+    deleteRelation();
+
+    createRelationDuplicates(10);
+    parallelScanIndexTests(true);
+    deleteRelation();
+}
+
+void test11()
+{
+    // Relation read by 4 threads claiming a few pages at a time
+    std::cout << "--------------------------------------" << std::endl;
+    std::cout << "createRelationRandom parallel file scan" << std::endl;
+    createRelationRandom();
+    parallelFileScanTests();
+    deleteRelation();
+}
+
+void test12()
+{
+    // File scans filtering on the pinned page and copying out only some fields
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationRandom filtered scans" << std::endl;
+    createRelationRandom();
+    filteredScanTests();
+    deleteRelation();
+}
+
+void test13()
+{
+    // File scans handing back the i and d columns of up to 1024 records per call
+    std::cout << "-------------------------------" << std::endl;
+    std::cout << "createRelationRandom batch scan" << std::endl;
+    createRelationRandom();
+    batchScanTests();
+    deleteRelation();
+}
+
+void test14()
+{
+    // Index-only scans returning d and the start of s from the leaves
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationRandom covering index" << std::endl;
+    createRelationRandom();
+    coveringIndexTests(false);
+    deleteRelation();
+
+    createRelationDuplicates(10);
+    coveringIndexTests(true);
+    deleteRelation();
+}
+
+void test15()
+{
+    // Keys on (i, d) and (s, i), scanned on their leading attributes
+    std::cout << "--------------------------------------" << std::endl;
+    std::cout << "createRelationDuplicates composite keys" << std::endl;
+    createRelationDuplicates(10);
+    compositeIndexTests();
+    deleteRelation();
+}
+
+void test16()
+{
+    // Index range results fetched from the heap in page order
+    std::cout << "-------------------------------------" << std::endl;
+    std::cout << "createRelationRandom bitmap heap scan" << std::endl;
+    createRelationRandom();
+    bitmapHeapScanTests();
+    deleteRelation();
+}
+
+void test17()
+{
+    // Index and heap changes redone from the write-ahead log after a crash
+    std::cout << "--------------------------------------" << std::endl;
+    std::cout << "createRelationForward write-ahead log" << std::endl;
+    createRelationForward();
+    logRecoveryTests();
+    deleteRelation();
+}
+
+void test18()
+{
+    // Pages written back with checksums, and a corrupt page caught when read in
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationForward page checksums" << std::endl;
+    createRelationForward();
+    checksumTests();
+    deleteRelation();
+}
+
+void test19()
+{
+    // Relation and index files storing their pages compressed
+    std::cout << "--------------------------------------" << std::endl;
+    std::cout << "createRelationForward compressed files" << std::endl;
+    createRelationForward(true);
+    indexTests(INDEX_COMPRESSED_PAGES);
+    compressionTests();
+    deleteRelation();
+}
+
+void test20()
+{
+    // Buffer pools mapped with huge pages, prefaulted and placed on NUMA nodes
+    std::cout << "---------------------------------" << std::endl;
+    std::cout << "createRelationForward pool memory" << std::endl;
+    createRelationForward();
+    poolMemoryTests();
+    deleteRelation();
+}
+
+void test21()
+{
+    // Buffer pool grown and shrunk while an index is in use
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationForward resized pool" << std::endl;
+    createRelationForward();
+    resizeTests();
+    deleteRelation();
+}
+
+void test22()
+{
+    // Hits, misses, evictions and latencies counted by the buffer pool
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationForward pool statistics" << std::endl;
+    createRelationForward();
+    bufStatsTests();
+    deleteRelation();
+}
+
+void test23()
+{
+    // Shape of indexes: levels, leaf fill, key range and leaf chain runs
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationForward index statistics" << std::endl;
+    createRelationForward();
+    indexStatsTests();
+    deleteRelation();
+}
+
+void test24()
+{
+    // Rewrite indexes scattered by random inserts into consecutive pages
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationRandom reorganize" << std::endl;
+    createRelationRandom();
+    reorganizeTests();
+    deleteRelation();
+}
+
+void test25()
+{
+    // Keys equal to INT_MAX, which plain nodes once used to pad their key arrays
+    std::cout << "-----------------------------------" << std::endl;
+    std::cout << "createRelationKeys INT_MAX keys" << std::endl;
+    extremeKeyTests();
+}
+
 /**
  * Checking for negative numbers was tested since are implementation
  * was supposed to not behave differently when processing
@@ -243,7 +588,7 @@ void testNonLeafSplit() {
 // createRelationForward
 // -----------------------------------------------------------------------------
 
-void createRelationForward()
+void createRelationForward(bool compressed)
 {
     std::vector<RecordId> ridVec;
     // destroy any old copies of relation file
@@ -255,7 +600,7 @@ void createRelationForward()
     {
     }
 
-    file1 = new PageFile(relationName, true);
+    file1 = new PageFile(relationName, true, compressed);
 
     // initialize all of record1.s to keep purify happy
     memset(record1.s, ' ', sizeof(record1.s));
@@ -490,13 +835,103 @@ void createRelationRandom()
     file1->writePage(new_page_number, new_page);
 }
 
+// -----------------------------------------------------------------------------
+// createRelationDuplicates
+// -----------------------------------------------------------------------------
+
+void createRelationDuplicates(int numDistinct)
+{
+    // destroy any old copies of relation file
+    try
+    {
+        File::remove(relationName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+    file1 = new PageFile(relationName, true);
+
+    // initialize all of record1.s to keep purify happy
+    memset(record1.s, ' ', sizeof(record1.s));
+    PageId new_page_number;
+    Page new_page = file1->allocatePage(new_page_number);
+
+    // Insert a bunch of tuples into the relation, key i cycles through 0 to numDistinct - 1.
+    for(int i = 0; i < relationSize; i++ )
+    {
+        sprintf(record1.s, "%05d string record", i);
+        record1.i = i % numDistinct;
+        record1.d = (double)i;
+        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+        while(1)
+        {
+            try
+            {
+                new_page.insertRecord(new_data);
+                break;
+            }
+            catch(const InsufficientSpaceException &e)
+            {
+                file1->writePage(new_page_number, new_page);
+                new_page = file1->allocatePage(new_page_number);
+            }
+        }
+    }
+
+    file1->writePage(new_page_number, new_page);
+}
+
+void createRelationKeys(const std::vector<int> &keys)
+{
+    // destroy any old copies of relation file
+    try
+    {
+        File::remove(relationName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+    file1 = new PageFile(relationName, true);
+
+    // initialize all of record1.s to keep purify happy
+    memset(record1.s, ' ', sizeof(record1.s));
+    PageId new_page_number;
+    Page new_page = file1->allocatePage(new_page_number);
+
+    // Insert one tuple per key, in the order given.
+    for(size_t i = 0; i < keys.size(); i++ )
+    {
+        sprintf(record1.s, "%05d string record", (int)i);
+        record1.i = keys[i];
+        record1.d = (double)i;
+        std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+        while(1)
+        {
+            try
+            {
+                new_page.insertRecord(new_data);
+                break;
+            }
+            catch(const InsufficientSpaceException &e)
+            {
+                file1->writePage(new_page_number, new_page);
+                new_page = file1->allocatePage(new_page_number);
+            }
+        }
+    }
+
+    file1->writePage(new_page_number, new_page);
+}
+
 // -----------------------------------------------------------------------------
 // indexTests
 // -----------------------------------------------------------------------------
 
-void indexTests()
+void indexTests(int indexOptions)
 {
-    intTests();
+    intTests(indexOptions);
     try
     {
         File::remove(intIndexName);
@@ -504,6 +939,19 @@ void indexTests()
     catch(const FileNotFoundException &e)
     {
     }
+
+    // index options only change the leaves of INTEGER indexes
+    if (indexOptions == INDEX_DEFAULT)
+    {
+        stringTests();
+        try
+        {
+            File::remove(stringIndexName);
+        }
+        catch(const FileNotFoundException &e)
+        {
+        }
+    }
 }
 
 void addIndexTests(bool isNeg) // additional index tests
@@ -524,43 +972,1841 @@ void addIndexTests(bool isNeg) // additional index tests
     }
 }
 
-void intNegativeTests()
+void duplicateIndexTests(bool lowCardinality, int indexOptions)
 {
-   std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 14)
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 0)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 5)
-	checkPassFail(intScan(&index,300,GT,400,LT), 99)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,-40,GT,50,LT), 89)
+    intDuplicateTests(lowCardinality, indexOptions);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
 }
 
-void intEmptyTests()
+void countIndexTests(bool lowCardinality)
 {
-   std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 0)
-    checkPassFail(intScan(&index,20,GTE,35,LTE), 0)
-    checkPassFail(intScan(&index,996,GT,1001,LT), 0)
-    checkPassFail(intScan(&index,0,GT,1,LT), 0)
-    checkPassFail(intScan(&index,300,GT,400,LT), 0)
-    checkPassFail(intScan(&index,3000,GTE,4000,LT), 0)
+    intCountTests(lowCardinality);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
 }
 
-// -----------------------------------------------------------------------------
-// intTests
-// -----------------------------------------------------------------------------
+void concurrentIndexTests(int indexOptions)
+{
+    intConcurrentTests(indexOptions);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
 
-void intTests()
+void buildIndexTests(int indexOptions)
+{
+    intBuildTests(indexOptions);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+
+    if (indexOptions == INDEX_DEFAULT)
+    {
+        stringBuildTests();
+        try
+        {
+            File::remove(stringIndexName);
+        }
+        catch(const FileNotFoundException &e)
+        {
+        }
+    }
+}
+
+void parallelScanIndexTests(bool duplicates)
+{
+    intParallelScanTests(duplicates);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
+
+void multiIndexBuildTests()
+{
+    std::vector<IndexSpec> specs(2);
+    specs[0].attrByteOffset = offsetof(tuple,i);
+    specs[0].attrType = INTEGER;
+    specs[0].indexOptions = INDEX_SUBTREE_COUNTS;
+    specs[1].attrByteOffset = offsetof(tuple,s);
+    specs[1].attrType = STRING;
+    specs[1].indexOptions = INDEX_DEFAULT;
+    std::vector<std::string> indexNames;
+    BTreeIndex::buildIndexes(relationName, specs, indexNames, bufMgr, 2);
+    intIndexName = indexNames[0];
+    stringIndexName = indexNames[1];
+
+    {
+        std::cout << "Open the integer index built with the string index" << std::endl;
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(intScan(&index,25,GT,40,LT), 14)
+        checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+        checkPassFail(index.entryCount(), 5000)
+    }
+    {
+        std::cout << "Open the string index built with the integer index" << std::endl;
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+        checkPassFail(stringScan(&index,"00025 string record",GT,"00040 string record",LT), 14)
+        checkPassFail(stringScan(&index,"0",GTE,"1",LT), 5000)
+    }
+
+    File::remove(intIndexName);
+    File::remove(stringIndexName);
+}
+
+void intNegativeTests()
+{
+   std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 0)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 5)
+	checkPassFail(intScan(&index,300,GT,400,LT), 99)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,-40,GT,50,LT), 89)
+}
+
+void intEmptyTests()
+{
+   std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 0)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 0)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 0)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,300,GT,400,LT), 0)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 0)
+}
+
+void intDuplicateTests(bool lowCardinality, int indexOptions)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
+
+    if (lowCardinality)
+    {
+        // 10 distinct keys, 500 rows each, all held in posting lists
+        checkPassFail(intScan(&index,2,GTE,4,LTE), 1500)
+        checkPassFail(intScan(&index,2,GT,4,LT), 500)
+        checkPassFail(intScan(&index,-1,GT,9,LTE), 5000)
+        checkPassFail(intScan(&index,8,GT,100,LT), 500)
+        checkPassFail(intScan(&index,10,GTE,20,LT), 0)
+        checkPassFail(intScan(&index,2,GTE,4,LTE,DESCENDING), 1500)
+        checkPassFail(intScan(&index,-1,GT,9,LTE,DESCENDING), 5000)
+    }
+    else
+    {
+        // 2000 distinct keys, keys below 1000 appear 3 times and the rest twice
+        checkPassFail(intScan(&index,20,GTE,35,LTE), 48)
+        checkPassFail(intScan(&index,996,GT,1001,LT), 11)
+        checkPassFail(intScan(&index,0,GTE,1999,LTE), 5000)
+        checkPassFail(intScan(&index,3000,GTE,4000,LT), 0)
+        checkPassFail(intScan(&index,20,GTE,35,LTE,DESCENDING), 48)
+        checkPassFail(intScan(&index,0,GTE,1999,LTE,DESCENDING), 5000)
+    }
+}
+
+void intCountTests(bool lowCardinality)
+{
+    std::cout << "Create a B+ Tree index with subtree counts on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, INDEX_SUBTREE_COUNTS);
+    int low, high, key;
+    RecordId selected;
+
+    checkPassFail(index.entryCount(), 5000)
+    if (lowCardinality)
+    {
+        // keys 0 to 9, 500 rows each, held in posting lists
+        low = 2; high = 4;
+        checkPassFail(index.countRange(&low, GTE, &high, LTE), 1500)
+        checkPassFail(index.countRange(&low, GT, &high, LT), 500)
+        checkPassFail(index.rank(&high), 2000)
+        index.select(1750, &key, selected);
+        checkPassFail(key, 3)
+
+        // the leaf keeps the length of each posting list, so ranking past four of them reads no more
+        // pages than ranking past none
+        key = 0;
+        BufStats before = bufMgr->snapshotBufStats();
+        index.rank(&key);
+        BufStats descent = bufMgr->snapshotBufStats() - before;
+        before = bufMgr->snapshotBufStats();
+        index.rank(&high);
+        BufStats counted = bufMgr->snapshotBufStats() - before;
+        checkPassFail(counted.accesses, descent.accesses)
+    }
+    else
+    {
+        // keys 0 to 4999 once each
+        low = 25; high = 40;
+        checkPassFail(index.countRange(&low, GT, &high, LT), 14)
+        checkPassFail(index.countRange(&low, GTE, &high, LTE), 16)
+        checkPassFail(index.countRange(&low, GT, &low, LT), 0)
+        low = 3000; high = 4000;
+        checkPassFail(index.countRange(&low, GTE, &high, LT), 1000)
+        checkPassFail(index.rank(&low), 3000)
+        index.select(1234, &key, selected);
+        checkPassFail(key, 1234)
+        index.select(4999, &key, selected);
+        checkPassFail(key, 4999)
+    }
+
+    // select past the end
+    bool pastEnd = false;
+    try
+    {
+        index.select(5000, &key, selected);
+    }
+    catch(const NoSuchKeyFoundException &e)
+    {
+        pastEnd = true;
+    }
+    checkPassFail(pastEnd, true)
+
+    // every sampled rid must point at a record of the relation
+    std::vector<RecordId> sampled;
+    index.sample(200, 42, sampled);
+    int validSamples = 0;
+    for (size_t i = 0; i < sampled.size(); i++)
+    {
+        Page *curPage;
+        bufMgr->readPage(file1, sampled[i].page_number, curPage);
+        RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(sampled[i]).data()));
+        bufMgr->unPinPage(file1, sampled[i].page_number, false);
+        if (myRec.i >= 0 && myRec.i < 5000)
+        {
+            validSamples++;
+        }
+    }
+    checkPassFail(validSamples, 200)
+}
+
+void intConcurrentTests(int indexOptions)
+{
+    std::cout << "Insert into a B+ Tree index on the integer field from 4 threads" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
+    const int numThreads = 4;
+    const int perThread = 5000;
+    std::atomic<int> notFound(0);
+
+    // the relation is empty, so the rids are made up and never read.
+    // keys 0 to 15999 appear once, keys -1 to -10 get 400 rids each and move into posting lists
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.push_back(std::thread([&index, &notFound, t, numThreads, perThread]() {
+            for (int j = 0; j < perThread; j++)
+            {
+                int key = j < 4000 ? j * numThreads + t : -1 - (j % 10);
+                RecordId insertRid;
+                insertRid.page_number = 1 + j;
+                insertRid.slot_number = 1 + t;
+                insertRid.padding = 0;
+                index.insertEntry(&key, insertRid);
+
+                std::vector<RecordId> found;
+                index.lookup(&key, found);
+                bool present = false;
+                for (size_t i = 0; i < found.size(); i++)
+                {
+                    present = present || (found[i].page_number == insertRid.page_number && found[i].slot_number == insertRid.slot_number);
+                }
+                if (!present)
+                {
+                    notFound++;
+                }
+            }
+        }));
+    }
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads[t].join();
+    }
+    checkPassFail(notFound.load(), 0)
+
+    std::vector<RecordId> found;
+    int key = 12345;
+    index.lookup(&key, found);
+    checkPassFail(found.size(), 1u)
+    key = -7;
+    index.lookup(&key, found);
+    checkPassFail(found.size(), 400u)
+    key = 16000;
+    index.lookup(&key, found);
+    checkPassFail(found.size(), 0u)
+
+    // every entry is reachable through the leaves as well
+    int low = -100;
+    int high = 20000;
+    int numResults = 0;
+    index.startScan(&low, GT, &high, LT);
+    try
+    {
+        while (true)
+        {
+            index.scanNext(rid);
+            numResults++;
+        }
+    }
+    catch(const IndexScanCompletedException &e)
+    {
+    }
+    index.endScan();
+    checkPassFail(numResults, 20000)
+}
+
+void intBuildTests(int indexOptions)
+{
+    std::cout << "Build a B+ Tree index on the integer field from 4 threads" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions, 4);
+
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScan(&index,-1,GT,5000,LT), 5000)
+    checkPassFail(intScan(&index,-1,GT,5000,LT,DESCENDING), 5000)
+    if (indexOptions & INDEX_SUBTREE_COUNTS)
+    {
+        int low = 3000;
+        int high = 4000;
+        checkPassFail(index.entryCount(), 5000)
+        checkPassFail(index.countRange(&low, GTE, &high, LT), 1000)
+    }
+}
+
+void intParallelScanTests(bool duplicates)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+    if (duplicates)
+    {
+        // 10 distinct keys, 500 rows each, all held in posting lists
+        checkPassFail(intParallelScan(&index,2,GTE,4,LTE), 1500)
+        checkPassFail(intParallelScan(&index,-1,GT,9,LTE), 5000)
+        checkPassFail(intParallelScan(&index,10,GTE,20,LT), 0)
+        return;
+    }
+
+    checkPassFail(intParallelScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intParallelScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intParallelScan(&index,-1,GT,5000,LT), 5000)
+    checkPassFail(intParallelScan(&index,5000,GT,6000,LT), 0)
+    checkPassFail(intParallelScan(&index,INT_MAX,GT,INT_MAX,LTE), 0)
+
+    // unordered: each worker sums into its own slot
+    std::vector<long long> sums(4, 0);
+    int low = 0;
+    int high = 4999;
+    index.parallelScan(&low, GTE, &high, LTE, [&sums](int worker, const RecordId &visitRid) {
+        sums[worker] += visitRid.slot_number;
+    }, 4);
+    std::vector<RecordId> rids;
+    index.parallelScan(&low, GTE, &high, LTE, rids, 1);
+    long long expected = 0;
+    for (size_t i = 0; i < rids.size(); i++)
+    {
+        expected += rids[i].slot_number;
+    }
+    checkPassFail(sums[0] + sums[1] + sums[2] + sums[3], expected)
+}
+
+int intParallelScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+    std::cout << "Parallel scan for ";
+    if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+    std::cout << std::endl;
+
+    std::vector<RecordId> rids;
+    index->parallelScan(&lowVal, lowOp, &highVal, highOp, rids, 4);
+
+    // the pieces must come back in key order
+    int prevKey = 0;
+    bool outOfOrder = false;
+    for (size_t i = 0; i < rids.size(); i++)
+    {
+        Page *curPage;
+        bufMgr->readPage(file1, rids[i].page_number, curPage);
+        RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rids[i]).data()));
+        bufMgr->unPinPage(file1, rids[i].page_number, false);
+        if( i > 0 && myRec.i < prevKey )
+        {
+            std::cout << "Scan out of order at key " << myRec.i << std::endl;
+            outOfOrder = true;
+        }
+        prevKey = myRec.i;
+    }
+    std::cout << "Number of results: " << rids.size() << std::endl << std::endl;
+
+    return outOfOrder ? -1 : (int)rids.size();
+}
+
+void parallelFileScanTests()
+{
+    std::cout << "Scan the relation from 4 threads" << std::endl;
+
+    // the page directory lists the same pages as the used page list
+    std::vector<PageId> walked;
+    for (FileIterator iter = file1->begin(); iter != file1->end(); ++iter)
+    {
+        walked.push_back(iter.page_number());
+    }
+    bool sameDirectory = file1->pageDirectory() == walked;
+    checkPassFail(sameDirectory, true)
+
+    std::vector<int> counts(4, 0);
+    std::vector<long long> sums(4, 0);
+    {
+        ParallelFileScan scan(relationName, bufMgr, 4, 2);
+        scan.scan([&counts, &sums](int worker, const RecordId &recordRid, const std::string &record) {
+            RECORD myRec = *(reinterpret_cast<const RECORD*>(record.data()));
+            counts[worker]++;
+            sums[worker] += myRec.i;
+        });
+    }
+    checkPassFail(counts[0] + counts[1] + counts[2] + counts[3], relationSize)
+    checkPassFail(sums[0] + sums[1] + sums[2] + sums[3], (long long)relationSize * (relationSize - 1) / 2)
+}
+
+void filteredScanTests()
+{
+    std::cout << "Scan the relation with predicates and projections" << std::endl;
+    std::vector<ScanField> projectI(1);
+    projectI[0].attrByteOffset = offsetof(tuple,i);
+    projectI[0].attrLength = sizeof(int);
+
+    std::vector<ScanPredicate> predicates;
+    predicates.push_back(ScanPredicate(offsetof(tuple,i), GTE, 1000));
+    predicates.push_back(ScanPredicate(offsetof(tuple,i), LT, 1100));
+    predicates.push_back(ScanPredicate(offsetof(tuple,d), NE, 1050.0));
+    checkPassFail(filteredScan(predicates, projectI), 99)
+    checkPassFail(filteredScan(predicates, std::vector<ScanField>()), 99)
+
+    predicates.clear();
+    predicates.push_back(ScanPredicate(offsetof(tuple,s), sizeof(tuple().s), EQ, "01234 string record"));
+    checkPassFail(filteredScan(predicates, projectI), 1)
+    predicates[0] = ScanPredicate(offsetof(tuple,s), sizeof(tuple().s), LT, "00100");
+    checkPassFail(filteredScan(predicates, projectI), 100)
+
+    // the same pushdown in a parallel scan
+    predicates[0] = ScanPredicate(offsetof(tuple,i), GT, 4000);
+    std::vector<int> counts(4, 0);
+    std::vector<int> badRecords(4, 0);
+    {
+        ParallelFileScan scan(relationName, bufMgr, 4, 2, predicates, projectI);
+        scan.scan([&counts, &badRecords](int worker, const RecordId &recordRid, const std::string &record) {
+            int key = *((const int *)record.data());
+            counts[worker]++;
+            if (record.size() != sizeof(int) || key <= 4000)
+            {
+                badRecords[worker]++;
+            }
+        });
+    }
+    checkPassFail(counts[0] + counts[1] + counts[2] + counts[3], 999)
+    checkPassFail(badRecords[0] + badRecords[1] + badRecords[2] + badRecords[3], 0)
+}
+
+// returns the number of records the scan finds, or -1 if one of them fails the predicates
+int filteredScan(const std::vector<ScanPredicate> &predicates, const std::vector<ScanField> &projection)
+{
+    FileScan fscan(relationName, bufMgr, predicates, projection);
+    RecordId scanRid;
+    std::string record;
+    int numResults = 0;
+    bool wrongRecord = false;
+    try
+    {
+        while (true)
+        {
+            fscan.scanNext(scanRid);
+            fscan.getRecord(record);
+            if (projection.empty())
+            {
+                wrongRecord = wrongRecord || !predicates[0].matches(record.data(), record.size());
+            }
+            else
+            {
+                wrongRecord = wrongRecord || record.size() != sizeof(int);
+            }
+            numResults++;
+        }
+    }
+    catch(const EndOfFileException &e)
+    {
+    }
+    return wrongRecord ? -1 : numResults;
+}
+
+void batchScanTests()
+{
+    std::cout << "Scan the relation in column batches" << std::endl;
+    std::vector<ScanField> fields(2);
+    fields[0].attrByteOffset = offsetof(tuple,i);
+    fields[0].attrLength = sizeof(int);
+    fields[1].attrByteOffset = offsetof(tuple,d);
+    fields[1].attrLength = sizeof(double);
+    ColumnBatch batch(fields);
+
+    int numResults = 0;
+    long long sum = 0;
+    int mismatches = 0;
+    {
+        FileScan fscan(relationName, bufMgr);
+        while (fscan.scanBatch(batch) > 0)
+        {
+            const int *iColumn = batch.column<int>(0);
+            const double *dColumn = batch.column<double>(1);
+            for (int r = 0; r < batch.size(); r++)
+            {
+                sum += iColumn[r];
+                mismatches += iColumn[r] != (int)dColumn[r];
+            }
+            numResults += batch.size();
+        }
+    }
+    checkPassFail(numResults, relationSize)
+    checkPassFail(sum, (long long)relationSize * (relationSize - 1) / 2)
+    checkPassFail(mismatches, 0)
+
+    // batches continue where scanNext() left off and honour the predicates
+    std::vector<ScanPredicate> predicates;
+    predicates.push_back(ScanPredicate(offsetof(tuple,i), LT, 2000));
+    numResults = 0;
+    {
+        FileScan fscan(relationName, bufMgr, predicates);
+        RecordId scanRid;
+        fscan.scanNext(scanRid);
+        numResults++;
+        while (fscan.scanBatch(batch) > 0)
+        {
+            for (int r = 0; r < batch.size(); r++)
+            {
+                mismatches += batch.column<int>(0)[r] >= 2000;
+            }
+            numResults += batch.size();
+        }
+    }
+    checkPassFail(numResults, 2000)
+    checkPassFail(mismatches, 0)
+}
+
+void coveringIndexTests(bool duplicates)
+{
+    intCoveringTests(duplicates);
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
+
+void intCoveringTests(bool duplicates)
+{
+    std::cout << "Create a B+ Tree index on the integer field including d and s" << std::endl;
+    std::vector<ScanField> included(2);
+    included[0].attrByteOffset = offsetof(tuple,d);
+    included[0].attrLength = sizeof(double);
+    included[1].attrByteOffset = offsetof(tuple,s);
+    included[1].attrLength = 5;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, INDEX_DEFAULT, 0, included);
+        checkPassFail(index.includedColumnsSize(), 13)
+        if (duplicates)
+        {
+            // 10 distinct keys, 500 rows each, all held in posting lists
+            checkPassFail(coveringScan(&index,2,GTE,4,LTE), 1500)
+            checkPassFail(coveringScan(&index,-1,GT,9,LTE,DESCENDING), 5000)
+        }
+        else
+        {
+            checkPassFail(coveringScan(&index,25,GT,40,LT), 14)
+            checkPassFail(coveringScan(&index,3000,GTE,4000,LT), 1000)
+            checkPassFail(coveringScan(&index,-1,GT,5000,LT,DESCENDING), 5000)
+        }
+    }
+
+    // entries inserted into the reopened index read their fields off the records
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    {
+        FileScan fscan(relationName, bufMgr);
+        try
+        {
+            RecordId scanRid;
+            while (true)
+            {
+                fscan.scanNext(scanRid);
+                RECORD myRec = *(reinterpret_cast<const RECORD*>(fscan.getRecord().data()));
+                int key = myRec.i + 10000;
+                index.insertEntry(&key, scanRid);
+            }
+        }
+        catch(const EndOfFileException &e)
+        {
+        }
+    }
+    checkPassFail(coveringScan(&index,10000,GTE,15000,LT), 5000)
+    checkPassFail(coveringScan(&index,-1,GT,15000,LT,DESCENDING), 10000)
+}
+
+// returns the number of entries found, or -1 if the fields of one differ from its record
+int coveringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order)
+{
+    std::cout << "Covering scan for ";
+    if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+    std::cout << std::endl;
+
+    RecordId scanRid;
+    char included[13];
+    int numResults = 0;
+    bool wrongFields = false;
+    try
+    {
+        index->startScan(&lowVal, lowOp, &highVal, highOp, order);
+    }
+    catch(const NoSuchKeyFoundException &e)
+    {
+        std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+        return 0;
+    }
+    try
+    {
+        while (true)
+        {
+            index->scanNext(scanRid, included);
+            Page *curPage;
+            bufMgr->readPage(file1, scanRid.page_number, curPage);
+            RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+            bufMgr->unPinPage(file1, scanRid.page_number, false);
+            if (memcmp(included, &myRec.d, sizeof(double)) != 0 || memcmp(included + sizeof(double), myRec.s, 5) != 0)
+            {
+                wrongFields = true;
+            }
+            numResults++;
+        }
+    }
+    catch(const IndexScanCompletedException &e)
+    {
+    }
+    index->endScan();
+    std::cout << "Number of results: " << numResults << std::endl << std::endl;
+
+    return wrongFields ? -1 : numResults;
+}
+
+void compositeIndexTests()
+{
+    std::vector<KeyComponent> iThenD(2);
+    iThenD[0].attrByteOffset = offsetof(tuple,i);
+    iThenD[0].attrType = INTEGER;
+    iThenD[1].attrByteOffset = offsetof(tuple,d);
+    iThenD[1].attrType = DOUBLE;
+
+    // the (s, i) index is built through buildIndexes()
+    std::vector<KeyComponent> sThenI(2);
+    sThenI[0].attrByteOffset = offsetof(tuple,s);
+    sThenI[0].attrType = STRING;
+    sThenI[0].attrLength = 5;
+    sThenI[1] = iThenD[0];
+    std::vector<IndexSpec> specs(1);
+    specs[0].indexOptions = INDEX_DEFAULT;
+    specs[0].keyComponents = sThenI;
+    std::vector<std::string> indexNames;
+    BTreeIndex::buildIndexes(relationName, specs, indexNames, bufMgr);
+
+    std::string iThenDName;
+    {
+        std::cout << "Create a B+ Tree index on (i, d)" << std::endl;
+        BTreeIndex index(relationName, iThenDName, bufMgr, iThenD);
+
+        // i cycles through 0 to 9 and d is the position of the row
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(3), GTE, CompositeKey().add(3), LTE), 500)
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(3).add(1000.0), GTE, CompositeKey().add(3).add(2000.0), LT), 100)
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(3), GT, CompositeKey().add(5), LTE), 1000)
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(3).add(1003.0), GT, CompositeKey().add(4), LT), 399)
+
+        // negative components sort before positive ones. The entries point at the first row, whose key is the smallest
+        RecordId anyRid;
+        anyRid.page_number = 1;
+        anyRid.slot_number = 1;
+        anyRid.padding = 0;
+        CompositeKey negativeKeys[4];
+        negativeKeys[0].add(-1).add(-2.5);
+        negativeKeys[1].add(-1).add(3.0);
+        negativeKeys[2].add(-1).add(-0.5);
+        negativeKeys[3].add(-2).add(7.0);
+        for (int k = 0; k < 4; k++)
+        {
+            index.insertEntry(&negativeKeys[k], anyRid);
+        }
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(-2), GTE, CompositeKey().add(-1), LTE), 4)
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(-1).add(-3.0), GTE, CompositeKey().add(-1).add(0.0), LT), 2)
+    }
+    {
+        std::cout << "Reopen the (i, d) index" << std::endl;
+        BTreeIndex index(relationName, iThenDName, bufMgr, iThenD);
+        checkPassFail(compositeScan(&index, iThenD, CompositeKey().add(-2), GTE, CompositeKey().add(9), LTE), relationSize + 4)
+    }
+    {
+        std::cout << "Open the (s, i) index" << std::endl;
+        std::string sThenIName;
+        BTreeIndex index(relationName, sThenIName, bufMgr, sThenI);
+        bool sameName = sThenIName == indexNames[0];
+        checkPassFail(sameName, true)
+        checkPassFail(compositeScan(&index, sThenI, CompositeKey().add("01234", 5), GTE, CompositeKey().add("01234", 5), LTE), 1)
+        checkPassFail(compositeScan(&index, sThenI, CompositeKey().add("01000", 5), GTE, CompositeKey().add("01099", 5), LTE), 100)
+    }
+
+    bool tooFewComponents = false;
+    try
+    {
+        std::string oneName;
+        BTreeIndex index(relationName, oneName, bufMgr, std::vector<KeyComponent>(1, iThenD[0]));
+    }
+    catch(const BadIndexInfoException &e)
+    {
+        tooFewComponents = true;
+    }
+    checkPassFail(tooFewComponents, true)
+
+    File::remove(iThenDName);
+    File::remove(indexNames[0]);
+}
+
+void bitmapHeapScanTests()
+{
+    std::cout << "Fetch the records of index range scans sorted by RecordId" << std::endl;
+    std::vector<ScanField> projectI(1);
+    projectI[0].attrByteOffset = offsetof(tuple,i);
+    projectI[0].attrLength = sizeof(int);
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        BitmapHeapScan heapScan(relationName, bufMgr, projectI);
+        int low = 1000;
+        int high = 3000;
+        checkPassFail(heapScan.addIndexScan(index, &low, GTE, &high, LT), 2000)
+
+        long long sum = 0;
+        int outOfRange = 0;
+        int outOfOrder = 0;
+        RecordId prevRid;
+        prevRid.page_number = 0;
+        prevRid.slot_number = 0;
+        int numResults = heapScan.scan([&](const RecordId &fetchedRid, const std::string &record) {
+            int key = *((const int *)record.data());
+            sum += key;
+            outOfRange += key < 1000 || key >= 3000;
+            outOfOrder += fetchedRid.page_number < prevRid.page_number ||
+                          (fetchedRid.page_number == prevRid.page_number && fetchedRid.slot_number <= prevRid.slot_number);
+            prevRid = fetchedRid;
+        });
+        checkPassFail(numResults, 2000)
+        checkPassFail(sum, (long long)(1000 + 2999) * 2000 / 2)
+        checkPassFail(outOfRange, 0)
+        checkPassFail(outOfOrder, 0)
+
+        // overlapping ranges fetch each record once
+        low = 2500;
+        high = 3500;
+        checkPassFail(heapScan.addIndexScan(index, &low, GTE, &high, LT), 1000)
+        checkPassFail(heapScan.scan([](const RecordId &fetchedRid, const std::string &record) {}), 2500)
+    }
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
+
+void logRecoveryTests()
+{
+    std::cout << "Crash after logged inserts and recover the index from the log" << std::endl;
+    const std::string logName = relationName + ".log";
+    try
+    {
+        File::remove(logName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+
+    // the child commits its changes to the log and dies without writing a single page back
+    pid_t child = fork();
+    if (child == 0)
+    {
+        LogManager *log = new LogManager(logName);
+        BufMgr *loggedBufMgr = new BufMgr(100, log);
+        BTreeIndex *index = new BTreeIndex(relationName, intIndexName, loggedBufMgr, offsetof(tuple,i), INTEGER);
+
+        // one transaction per insert, then ten inserts per transaction
+        RecordId insertRid;
+        insertRid.page_number = 1;
+        insertRid.slot_number = 1;
+        insertRid.padding = 0;
+        for (int key = relationSize; key < relationSize + 200; key++)
+        {
+            index->insertEntry(&key, insertRid);
+        }
+        for (int key = relationSize + 200; key < relationSize + 2000; key++)
+        {
+            if (key % 10 == 0)
+            {
+                loggedBufMgr->beginTransaction();
+            }
+            index->insertEntry(&key, insertRid);
+            if (key % 10 == 9)
+            {
+                loggedBufMgr->commitTransaction();
+            }
+        }
+
+        // a record and its index entry committed together
+        loggedBufMgr->beginTransaction();
+        PageId heapPageNo;
+        Page *heapPage;
+        loggedBufMgr->allocPage(file1, heapPageNo, heapPage);
+        record1.i = 100000;
+        record1.d = 100000.0;
+        sprintf(record1.s, "%05d string record", 100000);
+        RecordId heapRid = heapPage->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+        loggedBufMgr->unPinPage(file1, heapPageNo, true);
+        index->insertEntry(&record1.i, heapRid);
+        loggedBufMgr->commitTransaction();
+
+        // never committed, so never redone
+        loggedBufMgr->beginTransaction();
+        for (int key = relationSize + 2000; key < relationSize + 2100; key++)
+        {
+            index->insertEntry(&key, insertRid);
+        }
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    bool childExited = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    checkPassFail(childExited, true)
+
+    // tear the heap page the child allocated last: its trailer no longer
+    // matches what the file holds, as if only part of a write-back landed
+    {
+        std::fstream raw(relationName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        raw.seekp(0, std::ios::end);
+        std::streamoff fileEnd = raw.tellp();
+        raw.seekp(fileEnd - (std::streamoff)Page::CHECKSUM_SIZE);
+        const std::uint32_t torn = 0x5a5a5a5a;
+        raw.write(reinterpret_cast<const char*>(&torn), sizeof(torn));
+    }
+
+    {
+        LogManager log(logName);
+        bool redone = log.getLogStats().recoveredTransactions > 0;
+        checkPassFail(redone, true)
+    }
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(logScan(&index, 0, relationSize + 2000), relationSize + 2000)
+        checkPassFail(logScan(&index, relationSize + 2000, relationSize + 2100), 0)
+
+        std::vector<RecordId> found;
+        int key = 100000;
+        index.lookup(&key, found);
+        checkPassFail(found.size(), 1u)
+        Page *heapPage;
+        bufMgr->readPage(file1, found[0].page_number, heapPage);
+        RECORD heapRecord = *(reinterpret_cast<const RECORD*>(heapPage->getRecord(found[0]).data()));
+        bufMgr->unPinPage(file1, found[0].page_number, false);
+        checkPassFail(heapRecord.i, 100000)
+
+        // redo restamped the torn page
+        BufMgr checkedBufMgr(10);
+        checkedBufMgr.enablePageChecksums(true);
+        checkedBufMgr.readPage(file1, found[0].page_number, heapPage);
+        checkedBufMgr.unPinPage(file1, found[0].page_number, false);
+    }
+
+    // commits of four threads share syncs of the log
+    std::cout << "Insert into a logged B+ Tree index from 4 threads" << std::endl;
+    {
+        LogManager log(logName);
+        BufMgr loggedBufMgr(100, &log);
+        {
+            BTreeIndex index(relationName, intIndexName, &loggedBufMgr, offsetof(tuple,i), INTEGER);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; t++)
+            {
+                threads.push_back(std::thread([&index, t]() {
+                    RecordId insertRid;
+                    insertRid.page_number = 1;
+                    insertRid.slot_number = 1;
+                    insertRid.padding = 0;
+                    for (int j = 0; j < 250; j++)
+                    {
+                        int key = 200000 + j * 4 + t;
+                        index.insertEntry(&key, insertRid);
+                    }
+                }));
+            }
+            for (int t = 0; t < 4; t++)
+            {
+                threads[t].join();
+            }
+            checkPassFail(logScan(&index, 200000, 201000), 1000)
+        }
+        LogStats stats = log.getLogStats();
+        std::cout << stats.transactions << " transactions in " << stats.syncs << " syncs" << std::endl;
+        bool grouped = stats.transactions >= 1000 && stats.syncs <= stats.transactions;
+        checkPassFail(grouped, true)
+
+        std::cout << "Reorganize a logged B+ Tree index while a thread inserts" << std::endl;
+        {
+            BTreeIndex index(relationName, intIndexName, &loggedBufMgr, offsetof(tuple,i), INTEGER);
+            std::thread inserter([&index]() {
+                RecordId insertRid;
+                insertRid.page_number = 1;
+                insertRid.slot_number = 1;
+                insertRid.padding = 0;
+                for (int key = 201000; key < 202000; key++)
+                {
+                    index.insertEntry(&key, insertRid);
+                }
+            });
+            index.reorganize();
+            inserter.join();
+            checkPassFail(logScan(&index, 200000, 202000), 2000)
+            IndexStats reorganized = index.stats();
+            bool freed = reorganized.freePages > 0 && reorganized.pages + reorganized.freePages == reorganized.filePages;
+            checkPassFail(freed, true)
+        }
+    }
+
+    // with checkpoints, only the log since the oldest change not yet written back is replayed
+    std::cout << "Crash after checkpoints and recover from the last one" << std::endl;
+    child = fork();
+    if (child == 0)
+    {
+        LogManager *log = new LogManager(logName);
+        BufMgr *loggedBufMgr = new BufMgr(10, log);
+        BTreeIndex *index = new BTreeIndex(relationName, intIndexName, loggedBufMgr, offsetof(tuple,i), INTEGER);
+        RecordId insertRid;
+        insertRid.page_number = 1;
+        insertRid.slot_number = 1;
+        insertRid.padding = 0;
+        for (int key = 300000; key < 301100; key++)
+        {
+            if (key % 10 == 0)
+            {
+                loggedBufMgr->beginTransaction();
+            }
+            index->insertEntry(&key, insertRid);
+            if (key % 10 == 9)
+            {
+                loggedBufMgr->commitTransaction();
+            }
+            if (key == 300499 || key == 300999)
+            {
+                loggedBufMgr->checkpoint();
+            }
+        }
+        _exit(0);
+    }
+    waitpid(child, &status, 0);
+    childExited = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    checkPassFail(childExited, true)
+
+    {
+        LogManager log(logName);
+        LogStats stats = log.getLogStats();
+        std::cout << stats.recoveredTransactions << " of 110 transactions replayed" << std::endl;
+        bool fromCheckpoint = stats.recoveredTransactions >= 10 && stats.recoveredTransactions < 110;
+        checkPassFail(fromCheckpoint, true)
+    }
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(logScan(&index, 300000, 301100), 1100)
+        checkPassFail(logScan(&index, 200000, 201000), 1000)
+    }
+
+    try
+    {
+        File::remove(intIndexName);
+        File::remove(logName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
+
+void checksumTests()
+{
+    std::cout << "CRC32C of the standard check string" << std::endl;
+    const char *check = "123456789";
+    checkPassFail(crc32c(check, 9), 0xE3069283u)
+    checkPassFail(crc32cSoftware(check, 9), 0xE3069283u)
+    std::cout << "CRC32C instructions used: " << (crc32cHardware() ? "yes" : "no") << std::endl;
+
+    std::cout << "Build an index through a pool writing checksums and read it back" << std::endl;
+    {
+        // a small pool, so most pages are written back and read in again while the index is built
+        BufMgr checkedBufMgr(20);
+        checkedBufMgr.enablePageChecksums(true);
+        {
+            BTreeIndex index(relationName, intIndexName, &checkedBufMgr, offsetof(tuple,i), INTEGER);
+        }
+        {
+            BTreeIndex index(relationName, intIndexName, &checkedBufMgr, offsetof(tuple,i), INTEGER);
+            checkPassFail(logScan(&index, 0, relationSize), relationSize)
+        }
+        BlobFile indexFile = BlobFile::open(intIndexName);
+        bool stored = indexFile.readPage(2).hasChecksum();
+        checkPassFail(stored, true)
+
+        // the relation was written without checksums, which is never mistaken for corruption
+        FileScan fscan(relationName, &checkedBufMgr);
+        int numRecords = 0;
+        try
+        {
+            RecordId scanRid;
+            while (true)
+            {
+                fscan.scanNext(scanRid);
+                numRecords++;
+            }
+        }
+        catch(const EndOfFileException &e)
+        {
+        }
+        checkPassFail(numRecords, relationSize)
+    }
+
+    std::cout << "Flip a byte of an index page on disk" << std::endl;
+    {
+        std::fstream raw(intIndexName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        raw.seekg(sizeof(FileHeader) + Page::SIZE + 100);
+        char byte = raw.get();
+        raw.seekp(sizeof(FileHeader) + Page::SIZE + 100);
+        raw.put(byte ^ 0x10);
+    }
+    {
+        BufMgr checkedBufMgr(20);
+        checkedBufMgr.enablePageChecksums(true);
+        BlobFile indexFile = BlobFile::open(intIndexName);
+        Page *page;
+        bool caught = false;
+        try
+        {
+            checkedBufMgr.readPage(&indexFile, 2, page);
+            checkedBufMgr.unPinPage(&indexFile, 2, false);
+        }
+        catch(const PageChecksumException &e)
+        {
+            caught = true;
+        }
+        checkPassFail(caught, true)
+
+        // the metadata page is intact
+        checkedBufMgr.readPage(&indexFile, 1, page);
+        checkedBufMgr.unPinPage(&indexFile, 1, false);
+
+        // without checksums the page is read as it is
+        BufMgr uncheckedBufMgr(20);
+        uncheckedBufMgr.readPage(&indexFile, 2, page);
+        uncheckedBufMgr.unPinPage(&indexFile, 2, false);
+    }
+
+    std::cout << "Open a file written before pages had a checksum trailer" << std::endl;
+    {
+        const std::string oldName = relationName + ".old";
+        {
+            // the old header holds only the page count and the heads of the used and free lists
+            std::ofstream raw(oldName.c_str(), std::ios::binary);
+            PageId oldHeader[4] = {2, 1, 0, 0};
+            raw.write(reinterpret_cast<const char*>(oldHeader), sizeof(oldHeader));
+            raw.write(std::string(Page::SIZE, 'x').data(), Page::SIZE);
+        }
+        bool refused = false;
+        try
+        {
+            PageFile oldFile = PageFile::open(oldName);
+        }
+        catch(const FileFormatException &e)
+        {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+        bool leftOpen = File::isOpen(oldName);
+        checkPassFail(leftOpen, false)
+        File::remove(oldName);
+    }
+
+    try
+    {
+        File::remove(intIndexName);
+    }
+    catch(const FileNotFoundException &e)
+    {
+    }
+}
+
+void compressionTests()
+{
+    std::cout << "Compress a page of padding and a page of noise" << std::endl;
+    {
+        std::vector<int> padding(Page::SIZE / sizeof(int), INT_MAX);
+        std::vector<char> packed(Page::SIZE), unpacked(Page::SIZE);
+        size_t length = compressBlock(reinterpret_cast<char*>(&padding[0]), Page::SIZE, &packed[0], Page::SIZE - 1);
+        bool small = length > 0 && length < 100;
+        checkPassFail(small, true)
+        bool restored = decompressBlock(&packed[0], length, &unpacked[0], Page::SIZE) &&
+                        memcmp(&unpacked[0], &padding[0], Page::SIZE) == 0;
+        checkPassFail(restored, true)
+
+        std::vector<char> noise(Page::SIZE);
+        srand(1);
+        for (size_t i = 0; i < noise.size(); i++)
+        {
+            noise[i] = (char)rand();
+        }
+        checkPassFail(compressBlock(&noise[0], Page::SIZE, &packed[0], Page::SIZE - 1), 0u)
+    }
+
+    std::cout << "Grow a compressed index and reopen it" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, INDEX_COMPRESSED_PAGES);
+        // leaves filling up no longer fit their extents and move
+        RecordId insertRid;
+        insertRid.page_number = 1;
+        insertRid.slot_number = 1;
+        insertRid.padding = 0;
+        for (int key = relationSize; key < relationSize + 3000; key++)
+        {
+            index.insertEntry(&key, insertRid);
+        }
+    }
+    {
+        // compression is found out when the file is opened
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(logScan(&index, 0, relationSize + 3000), relationSize + 3000)
+        checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    }
+    {
+        BlobFile indexFile = BlobFile::open(intIndexName);
+        checkPassFail(indexFile.compressed(), true)
+        CompressionStats stats = indexFile.getCompressionStats();
+        std::cout << stats.pages << " index pages in " << stats.extentBytes << " bytes of extents" << std::endl;
+        bool smaller = stats.extentBytes * 2 < stats.pageBytes;
+        checkPassFail(smaller, true)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Reuse a deleted page of a compressed relation" << std::endl;
+    {
+        CompressionStats stats = file1->getCompressionStats();
+        std::cout << stats.pages << " relation pages in " << stats.extentBytes << " bytes of extents" << std::endl;
+        bool smaller = stats.extentBytes < stats.pageBytes;
+        checkPassFail(smaller, true)
+    }
+    const std::string scratchName = relationName + ".z";
+    {
+        PageFile scratch = PageFile::create(scratchName, true);
+        for (int i = 0; i < 10; i++)
+        {
+            PageId pageNo;
+            Page page = scratch.allocatePage(pageNo);
+            record1.i = i;
+            page.insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+            scratch.writePage(pageNo, page);
+        }
+        scratch.deletePage(3);
+        PageId pageNo;
+        scratch.allocatePage(pageNo);
+        checkPassFail(pageNo, 3u)
+    }
+    {
+        // the page map is read back from the extents
+        PageFile scratch = PageFile::open(scratchName);
+        int numPages = 0;
+        int sum = 0;
+        for (FileIterator iter = scratch.begin(); iter != scratch.end(); ++iter)
+        {
+            numPages++;
+            Page page = *iter;
+            for (PageIterator pageIter = page.begin(); pageIter != page.end(); ++pageIter)
+            {
+                sum += reinterpret_cast<const RECORD*>((*pageIter).data())->i;
+            }
+        }
+        checkPassFail(numPages, 10)
+        checkPassFail(sum, 45 - 2)
+    }
+    File::remove(scratchName);
+}
+
+void poolMemoryTests()
+{
+    const int poolOptions[] = {POOL_DEFAULT, POOL_HUGE_PAGES | POOL_PREFAULT, POOL_NUMA_INTERLEAVE,
+                               POOL_NUMA_PARTITION | POOL_PREFAULT};
+    for (int i = 0; i < 4; i++)
+    {
+        std::cout << "Build an index through a pool mapped with options " << poolOptions[i] << std::endl;
+        BufMgr pooledBufMgr(300, NULL, poolOptions[i]);
+        const PoolMemory &memory = pooledBufMgr.getPoolMemory();
+        std::cout << "page size " << memory.pageSize() << ", transparent huge pages "
+                  << memory.transparentHugePages() << ", " << memory.numaNodes() << " NUMA nodes" << std::endl;
+        bool mapped = memory.length() >= 300 * sizeof(Page) && (size_t)memory.base() % memory.pageSize() == 0;
+        checkPassFail(mapped, true)
+        // only a partitioned pool on a NUMA machine knows the node of a frame
+        bool partitioned = (poolOptions[i] & POOL_NUMA_PARTITION) && PoolMemory::onlineNodes().size() > 1;
+        bool placed = partitioned ? memory.nodeOf(memory.base()) == PoolMemory::onlineNodes()[0]
+                                  : memory.nodeOf(memory.base()) == -1;
+        checkPassFail(placed, true)
+        {
+            BTreeIndex index(relationName, intIndexName, &pooledBufMgr, offsetof(tuple,i), INTEGER);
+            checkPassFail(logScan(&index, 0, relationSize), relationSize)
+            checkPassFail(intScan(&index,25,GT,40,LT), 14)
+        }
+        File::remove(intIndexName);
+    }
+}
+
+void resizeTests()
+{
+    std::cout << "Resize a hash table while it is in use" << std::endl;
+    {
+        BufHashTbl table(7);
+        for (PageId pageNo = 1; pageNo <= 600; pageNo++)
+        {
+            table.insert(file1, pageNo, pageNo + 1);
+        }
+        // the second resize comes before the first one has moved every bucket
+        table.resize(701);
+        for (PageId pageNo = 1; pageNo <= 600; pageNo += 3)
+        {
+            table.remove(file1, pageNo);
+        }
+        table.resize(13);
+        int found = 0;
+        int missing = 0;
+        for (PageId pageNo = 1; pageNo <= 600; pageNo++)
+        {
+            try
+            {
+                FrameId frameNo;
+                table.lookup(file1, pageNo, frameNo);
+                if (frameNo == pageNo + 1)
+                {
+                    found++;
+                }
+            }
+            catch(const HashNotFoundException &e)
+            {
+                missing++;
+            }
+        }
+        checkPassFail(found, 400)
+        checkPassFail(missing, 200)
+    }
+
+    std::cout << "Grow and shrink a pool holding an index" << std::endl;
+    BufMgr resizedBufMgr(50);
+    {
+        BTreeIndex index(relationName, intIndexName, &resizedBufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+
+        resizedBufMgr.resize(500);
+        checkPassFail(resizedBufMgr.getNumBufs(), 500u)
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+        // the whole index fits in the grown pool, so scanning it again reads nothing
+        resizedBufMgr.clearBufStats();
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+        checkPassFail(resizedBufMgr.getBufStats().diskreads, 0)
+
+        const std::string scratchName = relationName + ".resize";
+        {
+            PageFile scratch = PageFile::create(scratchName);
+            PageId pageNo;
+            Page *page;
+            resizedBufMgr.allocPage(&scratch, pageNo, page);
+            page->insertRecord("kept across the shrink");
+            // frames past the first 50 were never used, so the new page lands in one of them
+            bool inTail = page - resizedBufMgr.bufPool >= 10;
+            checkPassFail(inTail, true)
+
+            bool refused = false;
+            try
+            {
+                resizedBufMgr.resize(10);
+            }
+            catch(const PagePinnedException &e)
+            {
+                refused = true;
+            }
+            checkPassFail(refused, true)
+            checkPassFail(resizedBufMgr.getNumBufs(), 500u)
+
+            resizedBufMgr.unPinPage(&scratch, pageNo, true);
+            resizedBufMgr.clearBufStats();
+            resizedBufMgr.resize(10);
+            checkPassFail(resizedBufMgr.getNumBufs(), 10u)
+            bool written = resizedBufMgr.getBufStats().diskwrites >= 1;
+            checkPassFail(written, true)
+
+            resizedBufMgr.readPage(&scratch, pageNo, page);
+            bool kept = *page->begin() == "kept across the shrink";
+            checkPassFail(kept, true)
+            resizedBufMgr.unPinPage(&scratch, pageNo, false);
+            resizedBufMgr.flushFile(&scratch);
+        }
+        File::remove(scratchName);
+
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+        checkPassFail(intScan(&index,25,GT,40,LT), 14)
+        resizedBufMgr.resize(100);
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+
+        bool empty = false;
+        try
+        {
+            resizedBufMgr.resize(0);
+        }
+        catch(const BufferExceededException &e)
+        {
+            empty = true;
+        }
+        checkPassFail(empty, true)
+    }
+    File::remove(intIndexName);
+}
+
+void bufStatsTests()
+{
+    std::cout << "Percentiles of a latency histogram" << std::endl;
+    {
+        LatencyHistogram histogram;
+        for (std::uint64_t nanos = 1; nanos <= 1000; nanos++)
+        {
+            histogram.record(nanos);
+        }
+        checkPassFail(histogram.count(), 1000u)
+        checkPassFail(histogram.max(), 1000u)
+        // buckets are an eighth of a power of two wide, so the median is off by less than that
+        bool median = histogram.percentile(0.5) >= 500 && histogram.percentile(0.5) < 500 + 500 / 8;
+        checkPassFail(median, true)
+        checkPassFail(histogram.percentile(1), 1000u)
+        checkPassFail(histogram.percentile(0.001), 1u)
+    }
+
+    std::cout << "Count the accesses of an index build and scans" << std::endl;
+    BufMgr statsBufMgr(20);
+    {
+        BTreeIndex index(relationName, intIndexName, &statsBufMgr, offsetof(tuple,i), INTEGER);
+        BufStats built = statsBufMgr.snapshotBufStats();
+        // the pool is much smaller than the relation and index, so both were read and pages evicted
+        bool evicted = built.evictions > 0 && built.dirtyEvictions > 0 && built.dirtyEvictions <= built.evictions;
+        checkPassFail(evicted, true)
+        bool bothFiles = built.files[relationName].misses > 0 && built.files[intIndexName].hits > 0;
+        checkPassFail(bothFiles, true)
+        checkPassFail(built.readLatency.count(), built.diskreads)
+        checkPassFail(built.writeLatency.count(), built.diskwrites)
+        bool sweeps = built.clockSweeps > 0 && built.maxClockSweep <= 2 * 20 && built.averageClockSweep() >= 1;
+        checkPassFail(sweeps, true)
+
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+        BufStats scan = statsBufMgr.snapshotBufStats() - built;
+        checkPassFail(scan.hits + scan.misses, scan.files[intIndexName].hits + scan.files[intIndexName].misses)
+        checkPassFail(scan.files[relationName].hits + scan.files[relationName].misses, 0u)
+        checkPassFail(scan.misses, scan.diskreads)
+        bool ordered = scan.readLatency.percentile(0.5) <= scan.readLatency.percentile(0.99) &&
+                       scan.readLatency.percentile(0.99) <= scan.readLatency.max();
+        checkPassFail(ordered, true)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Count accesses and pins, not clock sweeps" << std::endl;
+    {
+        statsBufMgr.clearBufStats();
+        Page *page;
+        for (int i = 0; i < 5; i++)
+        {
+            statsBufMgr.readPage(file1, 1, page);
+        }
+        statsBufMgr.readPage(file1, 2, page);
+        statsBufMgr.readPage(file1, 3, page);
+        BufStats pinned = statsBufMgr.snapshotBufStats();
+        checkPassFail(pinned.accesses, 7u)
+        checkPassFail(pinned.hits + pinned.misses, 7u)
+        checkPassFail(pinned.pinnedHighWater, 3u)
+        for (int i = 0; i < 5; i++)
+        {
+            statsBufMgr.unPinPage(file1, 1, false);
+        }
+        statsBufMgr.unPinPage(file1, 2, false);
+        statsBufMgr.unPinPage(file1, 3, false);
+        statsBufMgr.clearBufStats();
+        checkPassFail(statsBufMgr.getBufStats().pinnedHighWater, 0u)
+        statsBufMgr.flushFile(file1);
+    }
+}
+
+void indexStatsTests()
+{
+    std::cout << "Statistics of a bulk loaded index" << std::endl;
+    IndexStats built;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        built = index.stats();
+        checkPassFail(built.entries, (std::uint64_t)relationSize)
+        checkPassFail(built.minKey, 0)
+        checkPassFail(built.maxKey, relationSize - 1)
+        checkPassFail(built.nodesPerLevel[0], 1)
+        checkPassFail(built.height, (int)built.nodesPerLevel.size())
+        int leaves = 0;
+        for (int b = 0; b < LEAFFILLBUCKETS; b++)
+        {
+            leaves += built.leafFill[b];
+        }
+        checkPassFail(leaves, built.nodesPerLevel.back())
+        // every page allocated is reached from the root, and a fresh load lays the leaves out in order
+        checkPassFail(built.pages, built.filePages)
+        checkPassFail(built.averageLeafRun, (double)leaves)
+        bool sized = built.bytesPerEntry > 0 && built.averageLeafFill > 0.5 && built.averageLeafFill <= 1;
+        checkPassFail(sized, true)
+
+        // the walk gives the same answer whatever the number of threads
+        IndexStats single = index.stats(1);
+        bool same = single.entries == built.entries && single.pages == built.pages &&
+                    single.leafFill == built.leafFill && single.averageLeafRun == built.averageLeafRun;
+        checkPassFail(same, true)
+    }
+
+    std::cout << "Statistics of a reopened index after splits" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        IndexStats reopened = index.stats();
+        checkPassFail(reopened.attrByteOffset, (int)offsetof(tuple,i))
+        checkPassFail(reopened.pages, built.pages)
+
+        // a second entry per key splits leaves all over the tree, and the new leaves go to the end of the file
+        for (int i = 0; i < relationSize; i++)
+        {
+            RecordId extraRid;
+            extraRid.page_number = 1000;
+            extraRid.slot_number = i + 1;
+            extraRid.padding = 0;
+            index.insertEntry(&i, extraRid);
+        }
+        // enough duplicates of one key move them to a posting list
+        for (int i = 0; i < 500; i++)
+        {
+            RecordId extraRid;
+            extraRid.page_number = 2000 + i;
+            extraRid.slot_number = 1;
+            extraRid.padding = 0;
+            int key = 7;
+            index.insertEntry(&key, extraRid);
+        }
+        IndexStats split = index.stats();
+        checkPassFail(split.entries, (std::uint64_t)(2 * relationSize + 500))
+        checkPassFail(split.pages, split.filePages)
+        bool scattered = split.averageLeafRun < built.averageLeafRun && split.postingPages > 0;
+        checkPassFail(scattered, true)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Statistics of a STRING index" << std::endl;
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+        IndexStats strings = index.stats();
+        checkPassFail(strings.entries, (std::uint64_t)relationSize)
+        bool range = strings.minStringKey.compare(0, 5, "00000") == 0 && strings.maxStringKey.compare(0, 5, "04999") == 0;
+        checkPassFail(range, true)
+        checkPassFail(strings.pages, strings.filePages)
+    }
+    File::remove(stringIndexName);
+}
+
+void extremeKeyTests()
+{
+    // two rows of INT_MAX among six others
+    int keyArray[] = {INT_MAX, 5, -3, INT_MAX, 100, INT_MIN, 7, 42};
+    createRelationKeys(std::vector<int>(keyArray, keyArray + 8));
+    intExtremeKeyTests(INDEX_DEFAULT);
+    File::remove(intIndexName);
+    intExtremeKeyTests(INDEX_COMPRESSED_LEAVES);
+    File::remove(intIndexName);
+    intExtremeKeyTests(INDEX_SUBTREE_COUNTS);
+    File::remove(intIndexName);
+    deleteRelation();
+
+    std::cout << "Bulk load a leaf that starts with INT_MAX" << std::endl;
+    std::vector<int> keys;
+    for (int i = 0; i < INTARRAYLEAFSIZE; i++)
+    {
+        keys.push_back(i);
+    }
+    keys.push_back(INT_MAX);
+    createRelationKeys(keys);
+    {
+        // the first leaf is full, so INT_MAX is the separator of the second
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        checkPassFail(index.stats().nodesPerLevel.back(), 2)
+        int maxKey = INT_MAX;
+        std::vector<RecordId> found;
+        index.lookup(&maxKey, found);
+        checkPassFail((int)found.size(), 1)
+        checkPassFail(intScan(&index,INT_MIN,GTE,INT_MAX,LTE), INTARRAYLEAFSIZE + 1)
+        checkPassFail(intScan(&index,INT_MAX,GTE,INT_MAX,LTE,DESCENDING), 1)
+    }
+    File::remove(intIndexName);
+    deleteRelation();
+}
+
+void intExtremeKeyTests(int indexOptions)
 {
     std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
+
+    int minKey = INT_MIN;
+    int maxKey = INT_MAX;
+    std::vector<RecordId> found;
+    checkPassFail(intScan(&index,INT_MIN,GTE,INT_MAX,LTE), 8)
+    index.lookup(&maxKey, found);
+    checkPassFail((int)found.size(), 2)
+
+    // a third entry for a row already indexed, so the scan can read its record
+    RecordId maxRid = found[0];
+    index.insertEntry(&maxKey, maxRid);
+    checkPassFail(intScan(&index,INT_MIN,GTE,INT_MAX,LTE), 9)
+    checkPassFail(intScan(&index,INT_MIN,GTE,INT_MAX,LTE,DESCENDING), 9)
+    index.lookup(&maxKey, found);
+    checkPassFail((int)found.size(), 3)
+    if (indexOptions & INDEX_SUBTREE_COUNTS)
+    {
+        checkPassFail(index.countRange(&minKey, GTE, &maxKey, LTE), 9)
+        checkPassFail(index.rank(&maxKey), 6)
+    }
+}
+
+void reorganizeTests()
+{
+    std::cout << "Reorganize an index scattered by random inserts" << std::endl;
+    IndexStats compact;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+        // a second entry per key, in scattered key order, splits leaves all over the file
+        for (int i = 0; i < relationSize; i++)
+        {
+            int key = (int)((long long)i * 7919 % relationSize);
+            RecordId extraRid;
+            extraRid.page_number = 1000;
+            extraRid.slot_number = i + 1;
+            extraRid.padding = 0;
+            index.insertEntry(&key, extraRid);
+        }
+        IndexStats scattered = index.stats();
+        index.reorganize();
+        compact = index.stats();
+        checkPassFail(compact.entries, (std::uint64_t)(2 * relationSize))
+        checkPassFail(compact.averageLeafRun, (double)compact.nodesPerLevel.back())
+        checkPassFail(logScan(&index, 0, relationSize), 2 * relationSize)
+        bool rewritten = scattered.averageLeafRun < compact.averageLeafRun && compact.averageLeafFill > 0.8 &&
+                         compact.averageLeafFill <= REORGANIZEFILLFACTOR;
+        checkPassFail(rewritten, true)
+        // the pages of the old tree are free
+        bool freed = compact.freePages > 0 && compact.pages + compact.freePages == compact.filePages;
+        checkPassFail(freed, true)
+    }
+    {
+        // the meta page points at the new root and the free list
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        IndexStats reopened = index.stats();
+        bool same = reopened.entries == compact.entries && reopened.nodesPerLevel == compact.nodesPerLevel &&
+                    reopened.averageLeafRun == compact.averageLeafRun && reopened.freePages == compact.freePages;
+        checkPassFail(same, true)
+
+        // splits take free pages before the file grows
+        for (int i = 0; i < relationSize; i++)
+        {
+            int key = (int)((long long)i * 7919 % relationSize);
+            RecordId extraRid;
+            extraRid.page_number = 1001;
+            extraRid.slot_number = i + 1;
+            extraRid.padding = 0;
+            index.insertEntry(&key, extraRid);
+        }
+        IndexStats grown = index.stats();
+        bool reused = grown.filePages == compact.filePages && grown.freePages < compact.freePages &&
+                      grown.pages + grown.freePages == grown.filePages;
+        checkPassFail(reused, true)
+        checkPassFail(logScan(&index, 0, relationSize), 3 * relationSize)
+
+        bool thrown = false;
+        try
+        {
+            index.reorganize(0);
+        }
+        catch (const BadIndexInfoException &e)
+        {
+            thrown = true;
+        }
+        checkPassFail(thrown, true)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Reorganize while 3 threads insert" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+        const int numThreads = 3;
+        const int perThread = 3000;
+        std::atomic<int> inserted(0);
+
+        // new keys above the relation, and every tenth insert one more rid for the posting list of -1
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads.push_back(std::thread([&index, &inserted, t, numThreads, perThread]() {
+                for (int j = 0; j < perThread; j++)
+                {
+                    int key = j % 10 == 0 ? -1 : relationSize + j * numThreads + t;
+                    RecordId insertRid;
+                    insertRid.page_number = 1000 + t;
+                    insertRid.slot_number = j + 1;
+                    insertRid.padding = 0;
+                    index.insertEntry(&key, insertRid);
+                    inserted++;
+                }
+            }));
+        }
+        // several rebuilds, so some run while leaves they copied take inserts
+        for (int r = 1; r <= 4; r++)
+        {
+            while (inserted < r * numThreads * perThread / 5)
+            {
+                std::this_thread::yield();
+            }
+            index.reorganize(0.7);
+        }
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads[t].join();
+        }
+
+        IndexStats afterInserts = index.stats();
+        checkPassFail(afterInserts.entries, (std::uint64_t)(relationSize + numThreads * perThread))
+        int missing = 0;
+        std::vector<RecordId> found;
+        for (int key = relationSize; key < relationSize + numThreads * perThread; key++)
+        {
+            index.lookup(&key, found);
+            int j = (key - relationSize) / numThreads;
+            if (j % 10 != 0 && found.size() != 1)
+            {
+                missing++;
+            }
+        }
+        checkPassFail(missing, 0)
+        int postingKey = -1;
+        index.lookup(&postingKey, found);
+        checkPassFail((int)found.size(), numThreads * perThread / 10)
+        checkPassFail(logScan(&index, 0, relationSize), relationSize)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Reorganize a compressed index with subtree counts" << std::endl;
+    {
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, INDEX_COMPRESSED_LEAVES | INDEX_SUBTREE_COUNTS);
+        for (int i = 0; i < relationSize; i++)
+        {
+            int key = (int)((long long)i * 7919 % relationSize);
+            RecordId extraRid;
+            extraRid.page_number = 1000;
+            extraRid.slot_number = i + 1;
+            extraRid.padding = 0;
+            index.insertEntry(&key, extraRid);
+        }
+        index.reorganize(0.5);
+        IndexStats half = index.stats();
+        checkPassFail(half.averageLeafRun, (double)half.nodesPerLevel.back())
+        bool halfFull = half.averageLeafFill > 0.4 && half.averageLeafFill <= 0.5;
+        checkPassFail(halfFull, true)
+        checkPassFail(index.entryCount(), 2 * relationSize)
+        int low = 100;
+        int high = 199;
+        checkPassFail(index.countRange(&low, GTE, &high, LTE), 200)
+        checkPassFail(index.rank(&high), 398)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Reorganize a covering index" << std::endl;
+    {
+        std::vector<ScanField> included(2);
+        included[0].attrByteOffset = offsetof(tuple,d);
+        included[0].attrLength = sizeof(double);
+        included[1].attrByteOffset = offsetof(tuple,s);
+        included[1].attrLength = 5;
+        BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, INDEX_DEFAULT, 0, included);
+        index.reorganize(0.6);
+        checkPassFail(coveringScan(&index,-1,GT,5000,LT), 5000)
+        checkPassFail(coveringScan(&index,3000,GTE,4000,LT,DESCENDING), 1000)
+    }
+    File::remove(intIndexName);
+
+    std::cout << "Reorganize a STRING index" << std::endl;
+    {
+        BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+        for (int i = 0; i < relationSize; i++)
+        {
+            char key[STRINGKEYSIZE];
+            sprintf(key, "%05d string record", (int)((long long)i * 7919 % relationSize));
+            RecordId extraRid;
+            extraRid.page_number = 1000;
+            extraRid.slot_number = i + 1;
+            extraRid.padding = 0;
+            index.insertEntry(key, extraRid);
+        }
+        IndexStats scattered = index.stats();
+        index.reorganize();
+        IndexStats compact = index.stats();
+        checkPassFail(compact.entries, (std::uint64_t)(2 * relationSize))
+        checkPassFail(compact.averageLeafRun, (double)compact.nodesPerLevel.back())
+        bool rewritten = scattered.averageLeafRun < compact.averageLeafRun &&
+                         compact.minStringKey == scattered.minStringKey && compact.maxStringKey == scattered.maxStringKey;
+        checkPassFail(rewritten, true)
+
+        // both entries of each key are found
+        int numResults = 0;
+        index.startScan("00100", GTE, "00200", LT);
+        try
+        {
+            while (true)
+            {
+                index.scanNext(rid);
+                numResults++;
+            }
+        }
+        catch (const IndexScanCompletedException &e)
+        {
+        }
+        index.endScan();
+        checkPassFail(numResults, 200)
+    }
+    File::remove(stringIndexName);
+}
+
+// returns the number of entries with keys in [lowVal, highVal); their rids are made up, so no record is read
+int logScan(BTreeIndex *index, int lowVal, int highVal)
+{
+    int numResults = 0;
+    try
+    {
+        index->startScan(&lowVal, GTE, &highVal, LT);
+    }
+    catch(const NoSuchKeyFoundException &e)
+    {
+        return 0;
+    }
+    try
+    {
+        while (true)
+        {
+            index->scanNext(rid);
+            numResults++;
+        }
+    }
+    catch(const IndexScanCompletedException &e)
+    {
+    }
+    index->endScan();
+    return numResults;
+}
+
+// returns the number of entries found, or -1 if they are not in key order
+int compositeScan(BTreeIndex *index, const std::vector<KeyComponent> &components, const CompositeKey &lowVal, Operator lowOp,
+                  const CompositeKey &highVal, Operator highOp)
+{
+    RecordId scanRid;
+    std::string prevKey;
+    int numResults = 0;
+    bool outOfOrder = false;
+    try
+    {
+        index->startScan(&lowVal, lowOp, &highVal, highOp);
+    }
+    catch(const NoSuchKeyFoundException &e)
+    {
+        std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+        return 0;
+    }
+    try
+    {
+        while (true)
+        {
+            index->scanNext(scanRid);
+            Page *curPage;
+            bufMgr->readPage(file1, scanRid.page_number, curPage);
+            std::string record = curPage->getRecord(scanRid);
+            bufMgr->unPinPage(file1, scanRid.page_number, false);
+            std::string key = CompositeKey::fromRecord(record.data(), components).bytes();
+            if (numResults > 0 && key < prevKey)
+            {
+                outOfOrder = true;
+            }
+            prevKey = key;
+            numResults++;
+        }
+    }
+    catch(const IndexScanCompletedException &e)
+    {
+    }
+    index->endScan();
+    std::cout << "Number of results: " << numResults << std::endl << std::endl;
+
+    return outOfOrder ? -1 : numResults;
+}
+
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTests(int indexOptions)
+{
+    std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
 
     // run some tests
     checkPassFail(intScan(&index,25,GT,40,LT), 14)
@@ -570,9 +2816,15 @@ void intTests()
     checkPassFail(intScan(&index,0,GT,1,LT), 0)
     checkPassFail(intScan(&index,300,GT,400,LT), 99)
     checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScan(&index,25,GT,40,LT,DESCENDING), 14)
+    checkPassFail(intScan(&index,-3,GT,3,LT,DESCENDING), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT,DESCENDING), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT,DESCENDING), 0)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT,DESCENDING), 1000)
+    checkPassFail(intScan(&index,4990,GTE,6000,LTE,DESCENDING), 10)
 }
 
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order)
 {
     RecordId scanRid;
     Page *curPage;
@@ -581,13 +2833,16 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
     if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
     std::cout << lowVal << "," << highVal;
     if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+    if( order == DESCENDING ) { std::cout << " descending"; }
     std::cout << std::endl;
 
     int numResults = 0;
+    int prevKey = 0;
+    bool outOfOrder = false;
 
     try
     {
-        index->startScan(&lowVal, lowOp, &highVal, highOp);
+        index->startScan(&lowVal, lowOp, &highVal, highOp, order);
     }
     catch(const NoSuchKeyFoundException &e)
     {
@@ -604,6 +2859,14 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
             RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
             bufMgr->unPinPage(file1, scanRid.page_number, false);
 
+            // keys must come back in scan order
+            if( numResults > 0 && (order == ASCENDING ? myRec.i < prevKey : myRec.i > prevKey) )
+            {
+                std::cout << "Scan out of order at key " << myRec.i << std::endl;
+                outOfOrder = true;
+            }
+            prevKey = myRec.i;
+
             if( numResults < 5 )
             {
                 std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
@@ -629,7 +2892,111 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
     index->endScan();
     std::cout << std::endl;
 
-    return numResults;
+    return outOfOrder ? -1 : numResults;
+}
+
+// -----------------------------------------------------------------------------
+// stringTests
+// -----------------------------------------------------------------------------
+
+void stringTests()
+{
+    std::cout << "Create a B+ Tree index on the string field" << std::endl;
+    BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+
+    // run some tests
+    checkPassFail(stringScan(&index,"00025 string record",GT,"00040 string record",LT), 14)
+    checkPassFail(stringScan(&index,"00020",GTE,"00035",LTE), 15)
+    checkPassFail(stringScan(&index,"00996",GT,"01001",LT), 5)
+    checkPassFail(stringScan(&index,"00300",GT,"00400",LT), 100)
+    checkPassFail(stringScan(&index,"03000",GTE,"04000",LT), 1000)
+    checkPassFail(stringScan(&index,"0",GTE,"1",LT), 5000)
+    checkPassFail(stringScan(&index,"05000",GTE,"zzzz",LT), 0)
+    checkPassFail(stringScan(&index,"00996",GT,"01001",LT,DESCENDING), 5)
+    checkPassFail(stringScan(&index,"0",GTE,"1",LT,DESCENDING), 5000)
+    checkPassFail(stringScan(&index,"00025 string record",GTE,"00040 string record",LTE,DESCENDING), 16)
+}
+
+void stringBuildTests()
+{
+    std::cout << "Build a B+ Tree index on the string field from 4 threads" << std::endl;
+    BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, INDEX_DEFAULT, 4);
+
+    checkPassFail(stringScan(&index,"00025 string record",GT,"00040 string record",LT), 14)
+    checkPassFail(stringScan(&index,"03000",GTE,"04000",LT), 1000)
+    checkPassFail(stringScan(&index,"0",GTE,"1",LT), 5000)
+}
+
+int stringScan(BTreeIndex * index, const char *lowVal, Operator lowOp, const char *highVal, Operator highOp, ScanOrder order)
+{
+    RecordId scanRid;
+    Page *curPage;
+
+    std::cout << "Scan for ";
+    if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+    std::cout << lowVal << "," << highVal;
+    if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+    if( order == DESCENDING ) { std::cout << " descending"; }
+    std::cout << std::endl;
+
+    int numResults = 0;
+    std::string prevKey;
+    bool outOfOrder = false;
+
+    try
+    {
+        index->startScan(lowVal, lowOp, highVal, highOp, order);
+    }
+    catch(const NoSuchKeyFoundException &e)
+    {
+        std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+        return 0;
+    }
+
+    while(1)
+    {
+        try
+        {
+            index->scanNext(scanRid);
+            bufMgr->readPage(file1, scanRid.page_number, curPage);
+            RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+            bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+            // keys must come back in scan order
+            std::string key(myRec.s);
+            if( numResults > 0 && (order == ASCENDING ? key < prevKey : key > prevKey) )
+            {
+                std::cout << "Scan out of order at key " << key << std::endl;
+                outOfOrder = true;
+            }
+            prevKey = key;
+
+            if( numResults < 5 )
+            {
+                std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+                std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+            }
+            else if( numResults == 5 )
+            {
+                std::cout << "..." << std::endl;
+            }
+        }
+        catch(const IndexScanCompletedException &e)
+        {
+            break;
+        }
+
+        numResults++;
+    }
+
+    if( numResults >= 5 )
+    {
+        std::cout << "Number of results: " << numResults << std::endl;
+    }
+    index->endScan();
+    std::cout << std::endl;
+
+    return outOfOrder ? -1 : numResults;
 }
 
 // -----------------------------------------------------------------------------
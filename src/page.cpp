@@ -12,6 +12,7 @@
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
 #include "exceptions/slot_in_use_exception.h"
+#include "crc32c.h"
 #include "page_iterator.h"
 #include "page.h"
 #include "string.h"
@@ -31,6 +32,13 @@ void Page::initialize() {
   header_.next_page_number = INVALID_NUMBER;
   //data_.assign(DATA_SIZE, char());
 	memset(data_, '\0', DATA_SIZE);
+  checksum_ = 0;
+}
+
+std::uint32_t Page::computeChecksum(const PageHeader& header) const {
+  std::uint32_t crc = crc32c(&header, sizeof(header));
+  crc = crc32c(data_, DATA_SIZE, crc);
+  return crc == 0 ? ~crc : crc;
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
@@ -46,11 +54,18 @@ RecordId Page::insertRecord(const std::string& record_data) {
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
+	std::string retStr = std::string(data_ + slot.item_offset, slot.item_length);
 
 	return retStr;
 }
 
+const char* Page::getRecordData(const RecordId& record_id, std::size_t& length) const {
+  validateRecordId(record_id);
+  const PageSlot& slot = getSlot(record_id.slot_number);
+  length = slot.item_length;
+  return data_ + slot.item_offset;
+}
+
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
@@ -113,10 +113,17 @@ class Page {
    */
   static const std::size_t SIZE = 8192;
 
+  /**
+   * Size of the checksum kept in the last bytes of every page.  Nodes of an
+   * index must leave these bytes alone.  The header of a file records that
+   * its pages have this trailer, see FileHeader::format.
+   */
+  static const std::size_t CHECKSUM_SIZE = sizeof(std::uint32_t);
+
   /**
    * Size of page free space area in bytes.
    */
-  static const std::size_t DATA_SIZE = SIZE - sizeof(PageHeader);
+  static const std::size_t DATA_SIZE = SIZE - sizeof(PageHeader) - CHECKSUM_SIZE;
 
   /**
    * Number of page indicating that it's invalid.
@@ -151,6 +158,18 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a pointer to the bytes of the record with the given ID where they
+   * sit on the page, without copying them.  The pointer is only good until the
+   * page is next changed.
+   *
+   * @see getRecord
+   * @param record_id  ID of the record to return.
+   * @param length     Set to the length of the record in bytes.
+   * @return  Start of the record on the page.
+   */
+  const char* getRecordData(const RecordId& record_id, std::size_t& length) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -200,6 +219,53 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the number of slots in the slot directory, used or not.  Slots
+   * are numbered from 1 to this number.
+   *
+   * @return  Number of slots.
+   */
+  SlotId num_slots() const { return header_.num_slots; }
+
+  /**
+   * Returns a pointer to the record in the given slot where it sits on the
+   * page, or NULL if the slot holds no record.  Nothing is validated besides
+   * the slot being used, so loops over the whole slot directory can call it
+   * for every slot from 1 to num_slots().
+   *
+   * @param slot_number  Number of the slot.
+   * @param length       Set to the length of the record in bytes.
+   * @return  Start of the record on the page, or NULL.
+   */
+  const char* getSlotData(const SlotId slot_number, std::size_t& length) const {
+    const PageSlot& slot = getSlot(slot_number);
+    if (!slot.used) {
+      return NULL;
+    }
+    length = slot.item_length;
+    return data_ + slot.item_offset;
+  }
+
+  /**
+   * Stores the checksum of the rest of the page in its last bytes.
+   */
+  void updateChecksum() { checksum_ = computeChecksum(header_); }
+
+  /**
+   * Returns true if the page holds no checksum, or one matching its contents.
+   * Pages never written back with checksums on hold none.
+   *
+   * @return  False if the page changed since its checksum was stored.
+   */
+  bool checksumValid() const {
+    return checksum_ == 0 || checksum_ == computeChecksum(header_);
+  }
+
+  /**
+   * Returns true if a checksum is stored in the page.
+   */
+  bool hasChecksum() const { return checksum_ != 0; }
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -216,6 +282,15 @@ class Page {
   PageIterator end();
 
  private:
+  /**
+   * Computes the CRC32C of the given header followed by the data of this page,
+   * never 0 so that 0 can mean no checksum.
+   *
+   * @param header  Header to checksum in place of the page's own.
+   * @return  Checksum of the page.
+   */
+  std::uint32_t computeChecksum(const PageHeader& header) const;
+
   /**
    * Initializes this page as a new page with no header information or data.
    */
@@ -333,6 +408,11 @@ class Page {
 
   char data_[DATA_SIZE];
 
+  /**
+   * Checksum of the header and data, or 0 if none is stored.
+   */
+  std::uint32_t checksum_;
+
   friend class File;
   friend class PageFile;
   friend class BlobFile;
@@ -343,5 +423,7 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must be laid out as header, data and checksum.");
 
 }
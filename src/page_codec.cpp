@@ -0,0 +1,202 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest copy worth encoding.
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * The last bytes of a block are always literals.
+ */
+const std::size_t LAST_LITERALS = 5;
+
+/**
+ * No copy starts this close to the end of a block.
+ */
+const std::size_t MATCH_LIMIT = 12;
+
+/**
+ * Farthest back a copy can reach.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+const int HASH_BITS = 12;
+
+std::uint32_t read32(const char* bytes) {
+  std::uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(const std::uint32_t value) {
+  return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Appends a length that did not fit in its 4 bits of the token, 255 at a time.
+ */
+bool putLength(std::size_t length, char*& out, const char* end) {
+  while (length >= 255) {
+    if (out >= end) {
+      return false;
+    }
+    *out++ = (char)255;
+    length -= 255;
+  }
+  if (out >= end) {
+    return false;
+  }
+  *out++ = (char)length;
+  return true;
+}
+
+/**
+ * Appends literals followed by a copy of match_length bytes from offset back,
+ * or the literals alone when match_length is 0.
+ */
+bool putSequence(const char* literals, const std::size_t literal_length,
+                 const std::size_t offset, const std::size_t match_length,
+                 char*& out, const char* end) {
+  if (out >= end) {
+    return false;
+  }
+  char* token = out++;
+  std::size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+  *token = (char)(((literal_length < 15 ? literal_length : 15) << 4) |
+                  (match_code < 15 ? match_code : 15));
+  if (literal_length >= 15 && !putLength(literal_length - 15, out, end)) {
+    return false;
+  }
+  if ((std::size_t)(end - out) < literal_length) {
+    return false;
+  }
+  memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (match_length == 0) {
+    return true;
+  }
+  if (end - out < 2) {
+    return false;
+  }
+  *out++ = (char)(offset & 0xff);
+  *out++ = (char)(offset >> 8);
+  return match_code < 15 || putLength(match_code - 15, out, end);
+}
+
+/**
+ * Reads a length continued past its 4 bits of the token.
+ */
+bool getLength(std::size_t& length, const unsigned char*& in,
+               const unsigned char* end) {
+  unsigned char byte;
+  do {
+    if (in >= end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}
+
+std::size_t compressBlock(const char* source, const std::size_t length,
+                          char* dest, const std::size_t capacity) {
+  // positions are kept plus one, so 0 means none
+  std::uint32_t table[1 << HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  char* out = dest;
+  const char* end = dest + capacity;
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  while (length > MATCH_LIMIT && pos < length - MATCH_LIMIT) {
+    const std::uint32_t value = read32(source + pos);
+    const std::uint32_t h = hash(value);
+    const std::size_t candidate = table[h];
+    table[h] = pos + 1;
+    if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+        read32(source + candidate - 1) != value) {
+      pos++;
+      continue;
+    }
+
+    const std::size_t match = candidate - 1;
+    std::size_t match_length = MIN_MATCH;
+    while (pos + match_length < length - LAST_LITERALS &&
+           source[match + match_length] == source[pos + match_length]) {
+      match_length++;
+    }
+    if (!putSequence(source + anchor, pos - anchor, pos - match, match_length,
+                     out, end)) {
+      return 0;
+    }
+    pos += match_length;
+    anchor = pos;
+  }
+  if (!putSequence(source + anchor, length - anchor, 0, 0, out, end)) {
+    return 0;
+  }
+  return out - dest;
+}
+
+bool decompressBlock(const char* source, const std::size_t length, char* dest,
+                     const std::size_t dest_length) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(source);
+  const unsigned char* in_end = in + length;
+  std::size_t out = 0;
+  while (in < in_end) {
+    const unsigned char token = *in++;
+    std::size_t literal_length = token >> 4;
+    if (literal_length == 15 && !getLength(literal_length, in, in_end)) {
+      return false;
+    }
+    if ((std::size_t)(in_end - in) < literal_length ||
+        dest_length - out < literal_length) {
+      return false;
+    }
+    memcpy(dest + out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == in_end) {
+      // the last sequence has no copy
+      break;
+    }
+
+    if (in_end - in < 2) {
+      return false;
+    }
+    const std::size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    std::size_t match_length = token & 15;
+    if (match_length == 15 && !getLength(match_length, in, in_end)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > out || dest_length - out < match_length) {
+      return false;
+    }
+    // byte by byte, since a copy may overlap the bytes it produces
+    for (std::size_t i = 0; i < match_length; i++, out++) {
+      dest[out] = dest[out - offset];
+    }
+  }
+  return out == dest_length;
+}
+
+}
@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Compresses a block of bytes in the LZ4 block format: runs of literals, each
+ * followed by a copy of 4 or more bytes from at most 64 KB back.  Fast rather
+ * than small; a page of repeated padding shrinks to a few dozen bytes.
+ *
+ * @param source  Bytes to compress.
+ * @param length  Number of bytes.
+ * @param dest  Buffer for the compressed bytes.
+ * @param capacity  Size of the buffer.
+ * @return  Number of compressed bytes, 0 if they do not fit in the buffer.
+ */
+std::size_t compressBlock(const char* source, const std::size_t length,
+                          char* dest, const std::size_t capacity);
+
+/**
+ * Decompresses a block written by compressBlock().
+ *
+ * @param source  Compressed bytes.
+ * @param length  Number of compressed bytes.
+ * @param dest  Buffer for the original bytes.
+ * @param dest_length  Number of original bytes.
+ * @return  False if the block is malformed or does not decompress to exactly
+ *          dest_length bytes.
+ */
+bool decompressBlock(const char* source, const std::size_t length, char* dest,
+                     const std::size_t dest_length);
+
+}
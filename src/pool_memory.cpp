@@ -0,0 +1,256 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pool_memory.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Memory policies of mbind(2), from <numaif.h>, which comes with libnuma.
+ */
+const int MPOL_BIND_POLICY = 2;
+const int MPOL_INTERLEAVE_POLICY = 3;
+
+/**
+ * Size of the huge pages MAP_HUGETLB maps by default on x86-64 and arm64.
+ */
+const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * Reads a list such as "0-3,8" from sysfs.  Empty if the file is missing.
+ */
+std::vector<int> readList(const std::string& path) {
+  std::vector<int> values;
+  std::ifstream in(path.c_str());
+  std::string list;
+  if (!std::getline(in, list)) {
+    return values;
+  }
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    std::size_t dash = range.find('-');
+    int first = std::atoi(range.c_str());
+    int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+    for (int value = first; value <= last; value++) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+std::size_t roundUp(const std::size_t value, const std::size_t unit) {
+  return (value + unit - 1) / unit * unit;
+}
+
+/**
+ * Sets the memory policy of a range.  Failures leave the default policy, which
+ * places memory on the node of the thread first touching it.
+ */
+void bindRange(void* start, const std::size_t length, const int policy,
+               const std::vector<int>& nodes) {
+#ifdef SYS_mbind
+  unsigned long mask[4] = {0, 0, 0, 0};
+  const int bits = 8 * sizeof(unsigned long);
+  for (std::size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i] < 4 * bits) {
+      mask[nodes[i] / bits] |= 1ul << (nodes[i] % bits);
+    }
+  }
+  syscall(SYS_mbind, start, length, policy, mask, 4 * bits + 1, 0);
+#endif
+}
+
+}
+
+PoolMemory::PoolMemory(const std::size_t length, const int options,
+                       const std::size_t capacity)
+    : reserved_(MAP_FAILED), reserved_length_(0), base_(NULL), length_(0),
+      capacity_(0), granularity_(sysconf(_SC_PAGESIZE)), options_(options),
+      page_size_(sysconf(_SC_PAGESIZE)), transparent_huge_pages_(false) {
+  if (options & POOL_HUGE_PAGES) {
+    granularity_ = HUGE_PAGE_SIZE;
+  }
+  capacity_ = roundUp(capacity > length ? capacity : length, granularity_);
+
+  // nothing backs the reservation, so it costs address space only; where
+  // even that is limited, the memory cannot grow
+  reserved_length_ = capacity_ + granularity_;
+  reserved_ = mmap(NULL, reserved_length_, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserved_ == MAP_FAILED && capacity_ > roundUp(length, granularity_)) {
+    capacity_ = roundUp(length, granularity_);
+    reserved_length_ = capacity_ + granularity_;
+    reserved_ = mmap(NULL, reserved_length_, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  }
+  if (reserved_ == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  base_ = reinterpret_cast<char*>(
+      roundUp(reinterpret_cast<std::size_t>(reserved_), granularity_));
+
+  length_ = roundUp(length, granularity_);
+  try {
+    commit(0, length_);
+  } catch (...) {
+    munmap(reserved_, reserved_length_);
+    throw;
+  }
+}
+
+PoolMemory::~PoolMemory() {
+  munmap(reserved_, reserved_length_);
+}
+
+void PoolMemory::resize(const std::size_t length) {
+  const std::size_t new_length = roundUp(length, granularity_);
+  if (new_length > capacity_) {
+    throw std::bad_alloc();
+  }
+  if (new_length > length_) {
+    commit(length_, new_length);
+  } else if (new_length < length_) {
+    // mapping the tail over with a reservation again frees its pages
+    if (mmap(base_ + new_length, length_ - new_length, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+             -1, 0) == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    while (!partition_starts_.empty() &&
+           partition_starts_.back() >= new_length) {
+      partition_starts_.pop_back();
+      partition_nodes_.pop_back();
+    }
+  }
+  length_ = new_length;
+}
+
+void PoolMemory::commit(const std::size_t start, const std::size_t end) {
+  if (start == end) {
+    return;
+  }
+  void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (options_ & POOL_HUGE_PAGES) {
+    // only succeeds if the administrator reserved enough huge pages
+    memory = mmap(base_ + start, end - start, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED && start == 0) {
+      page_size_ = HUGE_PAGE_SIZE;
+    }
+  }
+#endif
+  if (memory == MAP_FAILED) {
+    memory = mmap(base_ + start, end - start, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (memory == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if ((options_ & POOL_HUGE_PAGES) &&
+        madvise(memory, end - start, MADV_HUGEPAGE) == 0) {
+      transparent_huge_pages_ = true;
+    }
+#endif
+  }
+
+  // placement has to be set before the first touch
+  place(start, end);
+
+  if (options_ & POOL_PREFAULT) {
+    bool populated = false;
+#ifdef MADV_POPULATE_WRITE
+    populated = madvise(base_ + start, end - start, MADV_POPULATE_WRITE) == 0;
+#endif
+    if (!populated) {
+      // writing one byte per page faults it in, as zeroes
+      for (std::size_t offset = start; offset < end; offset += sysconf(_SC_PAGESIZE)) {
+        static_cast<volatile char*>(base_)[offset] = 0;
+      }
+    }
+  }
+}
+
+void PoolMemory::place(const std::size_t start, const std::size_t end) {
+  std::vector<int> nodes = onlineNodes();
+  if (nodes.size() > 1 && (options_ & POOL_NUMA_INTERLEAVE)) {
+    bindRange(base_ + start, end - start, MPOL_INTERLEAVE_POLICY, nodes);
+    partition_nodes_ = nodes;
+  } else if (nodes.size() > 1 && (options_ & POOL_NUMA_PARTITION)) {
+    // each range is split between the nodes, so a grown pool keeps its
+    // earlier shares and adds one more per node; shares end on page
+    // boundaries, so the last one may be a little larger
+    const std::size_t length = end - start;
+    const std::size_t share = roundUp(length / nodes.size(), granularity_);
+    for (std::size_t i = 0; i < nodes.size() && i * share < length; i++) {
+      const std::size_t share_start = i * share;
+      const std::size_t share_end =
+          i + 1 == nodes.size() || share_start + share > length
+              ? length : share_start + share;
+      bindRange(base_ + start + share_start, share_end - share_start,
+                MPOL_BIND_POLICY, std::vector<int>(1, nodes[i]));
+      partition_nodes_.push_back(nodes[i]);
+      partition_starts_.push_back(start + share_start);
+    }
+  }
+}
+
+int PoolMemory::nodeOf(const void* address) const {
+  if (partition_starts_.empty()) {
+    return -1;
+  }
+  const std::size_t offset = static_cast<const char*>(address) - base_;
+  std::size_t share = partition_starts_.size() - 1;
+  while (share > 0 && partition_starts_[share] > offset) {
+    share--;
+  }
+  return partition_nodes_[share];
+}
+
+std::size_t PoolMemory::physicalMemory() {
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  return pages > 0 ? (std::size_t)pages * sysconf(_SC_PAGESIZE) : 0;
+}
+
+std::vector<int> PoolMemory::onlineNodes() {
+  std::vector<int> nodes = readList("/sys/devices/system/node/online");
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+
+bool PoolMemory::runOnNode(const int node) {
+  std::stringstream path;
+  path << "/sys/devices/system/node/node" << node << "/cpulist";
+  std::vector<int> cpus = readList(path.str());
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (std::size_t i = 0; i < cpus.size(); i++) {
+    CPU_SET(cpus[i], &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+}
@@ -0,0 +1,201 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief How the memory of a buffer pool is mapped.  Values are or'ed together
+ * and passed to the BufMgr constructor.
+ */
+enum PoolOption {
+  POOL_DEFAULT = 0,          /* Anonymous mapping of 4 KB pages, faulted in as frames are first used */
+  POOL_HUGE_PAGES = 1,       /* Reserved huge pages if the system has enough, else transparent huge pages */
+  POOL_PREFAULT = 2,         /* Fault the whole pool in when it is created */
+  POOL_NUMA_INTERLEAVE = 4,  /* Spread the pool page by page over every NUMA node */
+  POOL_NUMA_PARTITION = 8    /* Give each NUMA node one contiguous share of the frames */
+};
+
+/**
+ * @brief Memory mapped for a buffer pool.
+ *
+ * The memory is a private anonymous mapping, so it starts zeroed and is only
+ * backed once touched, unless POOL_PREFAULT asks for all of it up front.  NUMA
+ * placement is set with mbind(2) before anything is touched, so no library
+ * beyond the kernel is needed; on a machine with one node it is left alone.
+ *
+ * Address space for the largest length the memory may grow to is reserved
+ * when it is created, and only the part in use is mapped in it, so resize()
+ * never moves the memory: pointers into it stay valid across a resize.
+ */
+class PoolMemory {
+ public:
+  /**
+   * Maps memory.
+   *
+   * @param length  Number of bytes needed.
+   * @param options  PoolOption values or'ed together.
+   * @param capacity  Number of bytes the memory may grow to.  Less than length
+   *                  means length.
+   * @throws std::bad_alloc  If the memory cannot be mapped.
+   */
+  PoolMemory(const std::size_t length, const int options,
+             const std::size_t capacity = 0);
+
+  /**
+   * Unmaps the memory.
+   */
+  ~PoolMemory();
+
+  /**
+   * Start of the memory, aligned to the page size it is mapped with.
+   */
+  void* base() const { return base_; }
+
+  /**
+   * Number of bytes mapped, the length asked for rounded up to whole pages.
+   */
+  std::size_t length() const { return length_; }
+
+  /**
+   * Number of bytes the memory may grow to.
+   */
+  std::size_t capacity() const { return capacity_; }
+
+  /**
+   * Grows or shrinks the memory in place.  Bytes added are mapped like the
+   * first ones and start zeroed; bytes removed are given back to the system.
+   *
+   * @param length  Number of bytes needed.
+   * @throws std::bad_alloc  If length is beyond the capacity or cannot be
+   *                         mapped.
+   */
+  void resize(const std::size_t length);
+
+  /**
+   * Size of the pages backing the memory: the huge page size if reserved huge
+   * pages were mapped, else the base page size.
+   */
+  std::size_t pageSize() const { return page_size_; }
+
+  /**
+   * True if transparent huge pages were asked for the memory.
+   */
+  bool transparentHugePages() const { return transparent_huge_pages_; }
+
+  /**
+   * Number of NUMA nodes the memory is spread over, 1 if it was not placed.
+   */
+  int numaNodes() const {
+    return partition_nodes_.empty() ? 1 : (int)partition_nodes_.size();
+  }
+
+  /**
+   * Returns the NUMA node holding the given byte of the memory, or -1 if the
+   * memory was not partitioned between nodes.
+   *
+   * @param address  Byte of the memory.
+   */
+  int nodeOf(const void* address) const;
+
+  /**
+   * Returns the number of bytes of memory of the machine, 0 if unknown.
+   */
+  static std::size_t physicalMemory();
+
+  /**
+   * Returns the numbers of the NUMA nodes of the machine.
+   */
+  static std::vector<int> onlineNodes();
+
+  /**
+   * Restricts the calling thread to the CPUs of a NUMA node, so that it works
+   * on the share of a partitioned pool local to it.
+   *
+   * @param node  Number of the node.
+   * @return  False if the thread could not be moved.
+   */
+  static bool runOnNode(const int node);
+
+ private:
+  PoolMemory(const PoolMemory&);
+  PoolMemory& operator=(const PoolMemory&);
+
+  /**
+   * Maps the bytes from start to end in the reserved address space.
+   */
+  void commit(const std::size_t start, const std::size_t end);
+
+  /**
+   * Sets the NUMA placement of the bytes from start to end.
+   */
+  void place(const std::size_t start, const std::size_t end);
+
+  /**
+   * Start of the reserved address space, which base_ is aligned in.
+   */
+  void* reserved_;
+
+  /**
+   * Number of bytes of reserved address space.
+   */
+  std::size_t reserved_length_;
+
+  /**
+   * Start of the memory.
+   */
+  char* base_;
+
+  /**
+   * Number of bytes mapped.
+   */
+  std::size_t length_;
+
+  /**
+   * Number of bytes the memory may grow to.
+   */
+  std::size_t capacity_;
+
+  /**
+   * Unit lengths are rounded to: the huge page size if huge pages were asked
+   * for, else the base page size.
+   */
+  std::size_t granularity_;
+
+  /**
+   * PoolOption values the memory was created with.
+   */
+  int options_;
+
+  /**
+   * Size of the pages backing the memory.
+   */
+  std::size_t page_size_;
+
+  /**
+   * True if transparent huge pages were asked for.
+   */
+  bool transparent_huge_pages_;
+
+  /**
+   * Node of each share of a partitioned pool, or the nodes it is interleaved
+   * over.  Empty without NUMA placement.
+   */
+  std::vector<int> partition_nodes_;
+
+  /**
+   * Offset each share of a partitioned pool starts at.  Empty unless the
+   * memory is partitioned.
+   */
+  std::vector<std::size_t> partition_starts_;
+};
+
+}
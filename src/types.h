@@ -7,8 +7,44 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace badgerdb {
 
+/**
+ * @brief Datatype enumeration type.
+ */
+enum Datatype
+{
+  INTEGER = 0,
+  DOUBLE = 1,
+  STRING = 2
+};
+
+/**
+ * @brief Comparison operators. Range scans of BTreeIndex take LT or LTE as the
+ * high bound and GT or GTE as the low bound; scan predicates take any of them.
+ */
+enum Operator
+{
+  LT,  /* Less Than */
+  LTE, /* Less Than or Equal to */
+  GTE, /* Greater Than or Equal to */
+  GT,  /* Greater Than */
+  EQ,  /* Equal to */
+  NE   /* Not Equal to */
+};
+
+/**
+ * @brief Fixed-width field of a record: attrLength bytes at attrByteOffset.
+ * Names what a scan projects or batches and what an index includes in its leaves.
+ */
+struct ScanField
+{
+  int attrByteOffset;
+  int attrLength;
+};
+
 /**
  * @brief Identifier for a page in a file.
  */
@@ -24,6 +60,11 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Position of a record in the write-ahead log. Grows with every record appended.
+ */
+typedef std::uint64_t LogSeqNum;
+
 /**
  * @brief Identifier for a record in a page.
  */
@@ -0,0 +1,97 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+* @brief Version counter used as an optimistic latch on a buffer frame.
+*
+* An even version means unlocked. A writer makes it odd while it changes the frame and even again when
+* done, so every change moves the version on. Readers remember the version, read without writing to the
+* latch, and check afterwards that it did not move; if it did, whatever they read may be torn and they retry.
+*/
+class VersionLatch
+{
+ private:
+	/**
+   * Current version, odd while a writer holds the latch
+	 */
+  std::atomic<std::uint64_t> version;
+
+ public:
+	/**
+   * Constructor of VersionLatch class
+	 */
+  VersionLatch() : version(0) {}
+
+	/**
+	 * Waits until no writer holds the latch and returns the version to validate against.
+	 */
+  std::uint64_t readLock() const
+  {
+    std::uint64_t v = version.load(std::memory_order_acquire);
+    int spins = 0;
+    while (v & 1)
+    {
+      if (++spins == 64)
+      {
+        std::this_thread::yield();
+        spins = 0;
+      }
+      v = version.load(std::memory_order_acquire);
+    }
+    return v;
+  }
+
+	/**
+	 * True if nothing changed the frame since readLock() returned the given version.
+	 *
+	 * @param v   	Version returned by readLock()
+	 */
+  bool validate(std::uint64_t v) const
+  {
+    // keep the reads of the frame before the check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.load(std::memory_order_relaxed) == v;
+  }
+
+	/**
+	 * Takes the latch for writing if the version is still the one read. Fails instead of waiting.
+	 *
+	 * @param v   	Version returned by readLock()
+	 */
+  bool tryUpgrade(std::uint64_t v)
+  {
+    return version.compare_exchange_strong(v, v + 1, std::memory_order_acquire);
+  }
+
+	/**
+	 * Takes the latch for writing, waiting for the current writer if there is one.
+	 */
+  void lock()
+  {
+    while (!tryUpgrade(readLock()))
+    {
+    }
+  }
+
+	/**
+	 * Releases the latch taken by lock() or tryUpgrade().
+	 */
+  void unlock()
+  {
+    version.fetch_add(1, std::memory_order_release);
+  }
+};
+
+}
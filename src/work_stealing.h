@@ -0,0 +1,91 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+* @brief Task numbers dealt out to a fixed set of workers, one queue per worker.
+*
+* Worker w starts with a contiguous block of tasks and takes them from the front of its own queue.
+* A worker whose queue runs dry steals from the back of another queue, so neighbouring tasks tend to
+* stay with one worker and the work still evens out when some tasks take longer than others.
+*/
+class WorkStealingQueues
+{
+ private:
+	/**
+   * Tasks not yet taken, one queue per worker
+	 */
+  std::vector<std::deque<int> > queues;
+
+	/**
+   * One lock per queue, taken by its owner and by thieves
+	 */
+  std::vector<std::mutex> locks;
+
+ public:
+	/**
+	 * Deals tasks 0 to numTasks - 1 out in contiguous blocks.
+	 *
+	 * @param numWorkers  	Number of workers
+	 * @param numTasks  		Number of tasks
+	 */
+  WorkStealingQueues(int numWorkers, int numTasks)
+    : queues(numWorkers), locks(numWorkers)
+  {
+    for (int w = 0; w < numWorkers; w++)
+    {
+      int begin = (int)((long long)numTasks * w / numWorkers);
+      int end = (int)((long long)numTasks * (w + 1) / numWorkers);
+      for (int task = begin; task < end; task++)
+      {
+        queues[w].push_back(task);
+      }
+    }
+  }
+
+	/**
+	 * Takes the next task of a worker, stealing one if its own queue is empty.
+	 *
+	 * @param worker  	Worker asking for a task
+	 * @param task  		Set to the task taken
+	 * @return true if a task was taken, false once every queue is empty
+	 */
+  bool next(int worker, int &task)
+  {
+    {
+      std::lock_guard<std::mutex> guard(locks[worker]);
+      if (!queues[worker].empty())
+      {
+        task = queues[worker].front();
+        queues[worker].pop_front();
+        return true;
+      }
+    }
+    int numWorkers = queues.size();
+    for (int i = 1; i < numWorkers; i++)
+    {
+      int victim = (worker + i) % numWorkers;
+      std::lock_guard<std::mutex> guard(locks[victim]);
+      if (!queues[victim].empty())
+      {
+        task = queues[victim].back();
+        queues[victim].pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+}